@@ -21,12 +21,15 @@
 
 #include <vector>
 #include <string>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 
 namespace Percussa {
 namespace SSP {
 
     constexpr static unsigned API_MAJOR_VERSION = 3;
-    constexpr static unsigned API_MINOR_VERSION = 5;
+    constexpr static unsigned API_MINOR_VERSION = 14;
 
 	// struct describing your plugin. for backwards compatibility, you should
 	// assign the same values to the members in the struct as what you used
@@ -51,6 +54,322 @@ namespace SSP {
 		| 0x00 ; // blue
 	};
 
+	// struct with DSP load counters of a plugin instance. the plugin (or the
+	// SDK helper in PercussaStats.h) updates the counters from the audio
+	// callback, the host reads them from the UI thread without locking, e.g.
+	// to show a per-module CPU meter. all times are in nanoseconds.
+	// nsPerBlockAvg is an exponentially weighted moving average of the time
+	// spent in process(), nsPerBlockMax is the worst case seen so far (the
+	// host may store 0 to restart the measurement). samplesSkipped counts
+	// samples the plugin did not need to compute, because it took a fast path
+	// (e.g. no outputs enabled). overruns counts calls to process() which took
+	// longer than the duration of the audio block they were processing.
+	struct PluginStats
+	{
+		std::atomic<uint32_t> nsPerBlockAvg{0};
+		std::atomic<uint32_t> nsPerBlockMax{0};
+		std::atomic<uint64_t> blocksProcessed{0};
+		std::atomic<uint64_t> samplesSkipped{0};
+		std::atomic<uint32_t> overruns{0};
+	};
+
+	// memory held by a plugin instance, in bytes, see getMemoryUsage().
+	// dspBytes is what process() needs (delay lines, buffers allocated in
+	// prepare(), including memory from the host's arena), uiBytes what the
+	// editor holds (images, fonts, scope buffers ...). memory shared by all
+	// instances of the plugin (e.g. a cached image) is not part of either, it
+	// goes into sharedBytes, which the host counts once per plugin.
+	struct MemoryUsage
+	{
+		size_t dspBytes = 0;
+		size_t uiBytes = 0;
+		size_t sharedBytes = 0;
+	};
+
+	// class interface to the worker threads of the host, which plugins can
+	// use to spread their DSP work over multiple cores, instead of starting
+	// their own threads (which compete with the host's DSP workers).
+	// work is submitted as a batch of count tasks, the host calls
+	// fun(context, 0) ... fun(context, count - 1) on its worker threads.
+	// a batch is owned by the plugin (e.g. as a member of your plugin class)
+	// so submit() and join() do not need to allocate, and are safe to call
+	// from the audio callback. a batch can be submitted again after join()
+	// has returned. tasks should be short, and must not block.
+	class TaskPool
+	{
+	public:
+		typedef void (*TaskFun)(void* context, int index);
+
+		struct Batch
+		{
+			TaskFun fun = nullptr;
+			void* context = nullptr;
+			int count = 0;
+
+			// used by the host
+			std::atomic<int> done{0};
+			int slot = -1;
+			uint32_t generation = 0;
+		};
+
+		virtual ~TaskPool() {}
+
+		// number of worker threads, not counting the thread calling join()
+		virtual int numWorkers() const = 0;
+
+		// start running the tasks of the batch on the worker threads,
+		// returns immediately.
+		virtual void submit(Batch& batch) = 0;
+
+		// returns when all tasks of the batch have finished. the calling thread
+		// runs tasks of the batch itself while waiting.
+		virtual void join(Batch& batch) = 0;
+	};
+
+	// size of a cache line, of the SSP's cores and of most desktop CPUs. data
+	// written by different threads is kept this far apart, so the threads do
+	// not take the line from each other (false sharing). keep it apart with
+	// padding (char pad_[CACHE_LINE]) rather than alignas(): before C++17,
+	// operator new does not align beyond 16 bytes, so the aligned members of
+	// an object on the heap, e.g. of a plugin instance, are not aligned.
+	constexpr static size_t CACHE_LINE = 64;
+
+	// class interface to a memory arena owned by the host. blocks allocated
+	// from it come from a large region which the host has pre-faulted and
+	// locked in memory, and are padded to whole cache lines, so the buffers of
+	// all plugins sit close together, and never cause page faults in the audio
+	// callback. blocks cannot be freed individually, the host frees the whole
+	// arena when the patch is torn down, after deleting the plugin instances.
+	// so allocate your buffers once in prepare(), and keep using them when
+	// prepare() is called again with the same or a smaller block size.
+	class MemoryArena
+	{
+	public:
+		virtual ~MemoryArena() {}
+
+		// returns nullptr when the arena is exhausted, fall back to your own
+		// allocation in that case. alignment has to be a power of two, blocks are
+		// aligned to at least a cache line. memory is zeroed.
+		// this function is called from the UI thread.
+		virtual void* allocate(size_t size, size_t alignment = 64) = 0;
+	};
+
+	// layouts of the samples passed to processFrames(), see getBufferLayout().
+	// LAYOUT_PLANAR: one buffer per channel, as passed to process().
+	// LAYOUT_INTERLEAVED: one buffer holding frames of all channels,
+	//	sample i of channel ch is data[i * numChannels + ch].
+	// LAYOUT_PACKED4: channels in groups of 4, each group holding frames of
+	//	its 4 channels, so a frame fills one 128 bit NEON register.
+	//	sample i of channel ch is data[((ch / 4) * numSamples + i) * 4 + ch % 4].
+	//	the last group is padded with silent channels.
+	// PercussaLayout.h has the conversions between them.
+	enum BufferLayout
+	{
+		LAYOUT_PLANAR = 0,
+		LAYOUT_INTERLEAVED = 1,
+		LAYOUT_PACKED4 = 2
+	};
+
+	// an encoder or button event, passed to processEvents() together with the
+	// block it takes effect in. offset is the position in that block, in
+	// samples (0 ... numSamples - 1). the host timestamps events when they
+	// arrive, and delivers them with the next block, at the offset matching
+	// their arrival within the previous block. so events are one block late,
+	// but keep their spacing to the sample.
+	// index and value are the arguments of the matching PluginInterface call
+	// (e.g. encoderTurned(index, value)).
+	struct Event
+	{
+		enum Type
+		{
+			ENCODER_TURNED = 0,
+			ENCODER_PRESSED = 1,
+			BUTTON_PRESSED = 2
+		};
+
+		uint32_t offset;
+		uint16_t type;
+		int16_t index;
+		int32_t value;
+	};
+
+	// class interface through which plugins hand the threads they start
+	// themselves (e.g. to stream samples from disk, or to analyse audio in the
+	// background) to the host, which sets their priority, the cores they run
+	// on and what they keep locked in memory according to their role. plain
+	// threads get default scheduling on any core, where they compete with the
+	// audio thread and the host's DSP workers.
+	// call registerThread() on the thread itself, before it starts working,
+	// and unregisterThread() on it before it exits.
+	class ThreadRegistry
+	{
+	public:
+		enum Role
+		{
+			// work the audio callback depends on (e.g. voices rendered a block
+			// ahead). real-time priority below the audio thread, on the cores of
+			// the audio thread and the DSP workers, its stack locked in memory.
+			// must not block on locks, allocate or do I/O.
+			THREAD_DSP = 0,
+
+			// long computations the audio callback does not wait for (e.g. an
+			// analysis, or building a wavetable). lowest priority, on the cores
+			// the host keeps free of real-time work.
+			THREAD_COMPUTE = 1,
+
+			// threads mostly waiting for files or the network (e.g. disk
+			// streaming). normal priority, so they are woken quickly, on the
+			// same cores as compute threads.
+			THREAD_IO = 2
+		};
+
+		virtual ~ThreadRegistry() {}
+
+		// applies the policy of the role to the calling thread, and names it
+		// (tools like top show the first 15 characters). returns false if the
+		// host could not apply all of it, e.g. without permission for
+		// real-time priority. the thread can keep running in that case.
+		virtual bool registerThread(Role role, const char* name) = 0;
+
+		// returns the calling thread to default scheduling, on any core.
+		virtual void unregisterThread() = 0;
+	};
+
+	// class interface to the host's disk streaming, for modules playing
+	// samples or loops too long to keep in memory. process() must not wait for
+	// the SD card, so a voice plays a file through a ring buffer, which the
+	// host's I/O thread keeps filled ahead of it. the start of each file is
+	// kept in memory, so voices can start playing it at once.
+	// ids are small integers, -1 means none.
+	class DiskStreamer
+	{
+	public:
+		struct FileInfo
+		{
+			int channels = 0;
+			int64_t frames = 0;
+			double sampleRate = 0.0;
+		};
+
+		virtual ~DiskStreamer() {}
+
+		// UI thread. opens a wav file (16 or 24 bit integer, or 32 bit float
+		// samples) and reads its first prefetchMs milliseconds into memory,
+		// where they stay while the file is open. returns -1 if the file
+		// cannot be read, or is not a supported wav file.
+		virtual int openFile(const char* path, int prefetchMs, FileInfo* info) = 0;
+
+		// UI thread. stop the voices playing the file first.
+		virtual void closeFile(int file) = 0;
+
+		// UI thread. a voice plays files of up to channels channels, through a
+		// ring buffer of ringFrames frames, i.e. the I/O thread reads up to
+		// ringFrames / sampleRate seconds ahead of it.
+		virtual int createVoice(int channels, int ringFrames) = 0;
+		virtual void destroyVoice(int voice) = 0;
+
+		// audio thread. starts the voice at frame of file, after the last
+		// frame it continues at the first if loop is set. returns false if
+		// the file has more channels than the voice.
+		virtual bool start(int voice, int file, int64_t frame, bool loop) = 0;
+		virtual void stop(int voice) = 0;
+
+		// audio thread. copies the next numFrames frames of the voice into
+		// buffer, interleaved, with the channels of its file. returns the
+		// number of frames, fewer than numFrames at the end of the file, and
+		// 0 when the voice is stopped. never blocks: frames the I/O thread
+		// has not read yet are silent, and the voice continues where it
+		// stopped with the next call. such calls are counted as underruns.
+		virtual int read(int voice, float* buffer, int numFrames) = 0;
+
+		// calls of read() which came short because the disk was too slow,
+		// since the voice was created
+		virtual uint64_t underruns(int voice) const = 0;
+	};
+
+	// class interface to the host's store of read-only assets (samples,
+	// wavetables, images), shared by all instances of all plugins, so eight
+	// instances loading the same tables hold one copy of them. an asset is
+	// the content of a file, or what a builder makes of it (e.g. band limited
+	// tables computed from a wavetable file). assets are identified by that
+	// content and the key of the builder, so the same file under another path
+	// is still one asset. the host loads them in the background, maps them
+	// read-only, and frees them when the last reference is released.
+	class AssetStore
+	{
+	public:
+		enum Status
+		{
+			LOADING = 0,
+			READY = 1,
+			FAILED = 2
+		};
+
+		// a reference to an asset. data and size can be used once status is
+		// READY (load it with std::memory_order_acquire), until the reference
+		// is released. the memory is read-only.
+		struct Asset
+		{
+			std::atomic<int> status{LOADING};
+			const void* data = nullptr;
+			size_t size = 0;
+		};
+
+		// makes an asset from the content of a file (source is nullptr and
+		// sourceSize 0 for assets made from nothing but the key). size()
+		// returns the size of the asset in bytes, build() writes it into
+		// data, which is zeroed, and returns false if the source cannot be
+		// used. both are called once per asset, on the host's loader thread,
+		// possibly after the instance which asked for it is gone, so they
+		// must not use it (make them static functions).
+		struct Builder
+		{
+			size_t (*size)(const char* key, const void* source, size_t sourceSize);
+			bool (*build)(const char* key, const void* source, size_t sourceSize, void* data, size_t size);
+		};
+
+		virtual ~AssetStore() {}
+
+		// UI thread. returns a reference to the asset made by builder from
+		// the file at path, or to the file's content if builder is nullptr.
+		// key names what the builder makes (e.g. "mytables-v2"), change it
+		// when the builder changes. path can be nullptr for assets made from
+		// the key alone. returns at once, check status before using the
+		// asset. returns nullptr if the file does not exist, or both path
+		// and builder are nullptr.
+		virtual const Asset* acquire(const char* path, const char* key, const Builder* builder) = 0;
+
+		// UI thread. releases a reference returned by acquire().
+		virtual void release(const Asset* asset) = 0;
+	};
+
+	constexpr static unsigned HOST_SERVICES_VERSION = 5;
+
+	// services the host offers to a plugin, passed in with setHostServices().
+	// new members are only ever added at the end of the struct, and version
+	// is incremented when they are. so check the version before using a
+	// member which was added later. members can be nullptr, if the host does
+	// not offer that particular service.
+	struct HostServices
+	{
+		unsigned version = HOST_SERVICES_VERSION;
+
+		// version 1
+		TaskPool* taskPool = nullptr;
+
+		// version 2
+		MemoryArena* arena = nullptr;
+
+		// version 3
+		ThreadRegistry* threads = nullptr;
+
+		// version 4
+		DiskStreamer* streamer = nullptr;
+
+		// version 5
+		AssetStore* assets = nullptr;
+	};
+
 	// class interface allowing the host application to ask your plugin
 	// to draw its user interface graphics. the host will call renderToImage()
 	// to make your plugin draw onto a texture image, which is mapped onto
@@ -75,6 +394,10 @@ namespace SSP {
 		// visible, and false is passed when the editor becomes hidden.
 		// typically, this is called before renderToImage() starts being called,
 		// and after renderToImage() stops being called (see below).
+		// only one editor is visible at a time, so create resources only
+		// needed for drawing (images, fonts ...) when the editor becomes
+		// visible, and release them when it is hidden, to keep patches with
+		// many instances small (see PluginInterface::getMemoryUsage()).
 		// this function is called from the UI thread.
 		virtual void visibilityChanged(bool b) {}
 
@@ -193,6 +516,132 @@ namespace SSP {
 		// or allocate memory, under any circumstances.
 		// this function is called from the audio callback.
 		virtual void process(float** channelData, int numChannels, int numSamples) = 0;
+
+		// the functions below were added in later versions of the API. the host
+		// only calls them if getApiVersion() reports a version which has them,
+		// so older plugins keep working.
+
+		// (API 3.6) return a pointer to the DSP load counters of this instance
+		// (see PluginStats above), or nullptr if the plugin does not keep them.
+		// the returned struct has to stay valid for the lifetime of the instance,
+		// and writable: the host restarts nsPerBlockMax through it.
+		// this function is called from the UI thread.
+		virtual PluginStats* getStats() { return nullptr; }
+
+		// (API 3.7) first phase of a staged state load, which replaces
+		// setState() when the host recalls a patch. the host calls this function
+		// from a background thread, while process() keeps being called. decode
+		// the state in the buffer into a prepared, immutable snapshot, without
+		// touching anything the audio callback uses, and hand the snapshot over
+		// to the audio callback (e.g. with Percussa::SSP::StagedState from
+		// PercussaState.h), which swaps it in at the start of the next block.
+		// the buffer is only valid during the call. the host does not call
+		// prepareState() or setState() concurrently for the same instance.
+		// return false if your plugin does not support staged loads (or cannot
+		// stage this particular state), the host then calls setState() from
+		// the UI thread instead.
+		virtual bool prepareState(const void* buffer, size_t size) { return false; }
+
+		// (API 3.8) called right before prepare(), passing the services the
+		// host offers to plugins (see HostServices above). the struct stays
+		// valid until the instance is deleted.
+		// this function is called from the UI thread.
+		virtual void setHostServices(const HostServices* services) {}
+
+		// (API 3.9) the layout your plugin wants its samples in (see BufferLayout
+		// above). for anything but LAYOUT_PLANAR, the host calls processFrames()
+		// instead of process(), and converts the samples (with SIMD transposes),
+		// unless they come from a plugin using the same layout.
+		// called once, before prepare(). this function is called from the UI thread.
+		virtual int getBufferLayout() { return LAYOUT_PLANAR; }
+
+		// (API 3.9) process() for the interleaved and packed layouts. data holds
+		// numChannels channels (numChannels rounded up to a multiple of 4 for
+		// LAYOUT_PACKED4) of numSamples samples each, and is aligned to 16 bytes.
+		// the same rules as for process() apply.
+		// this function is called from the audio callback.
+		virtual void processFrames(float* data, int numChannels, int numSamples) {}
+
+		// (API 3.10) process() with the events of the block (see Event above),
+		// sorted by offset. the host calls this instead of process() and
+		// encoderTurned() for plugins using LAYOUT_PLANAR. encoderPressed() and
+		// buttonPressed() are still called from the UI thread as well, the events
+		// give the DSP their timing. split the block at the event offsets to
+		// apply them sample accurately (see Percussa::SSP::splitBlock() in
+		// PercussaEvents.h). the default implementation passes the encoder
+		// events to encoderTurned(), and calls process() for the whole block.
+		// the events are only valid during the call.
+		// this function is called from the audio callback.
+		virtual void processEvents(float** channelData, int numChannels, int numSamples,
+			const Event* events, int numEvents) {
+			for (int i = 0; i < numEvents; i++) {
+				if (events[i].type == Event::ENCODER_TURNED) encoderTurned(events[i].index, events[i].value);
+			}
+			process(channelData, numChannels, numSamples);
+		}
+
+		// (API 3.11) switch to another sample rate or block size without a new
+		// prepare(), e.g. when the host changes its latency profile. the host
+		// calls this between two blocks, samplesPerBlock is never larger than
+		// the block size passed to prepare(), so size your buffers for that
+		// in prepare(), and only recompute coefficients etc. here. it must not
+		// allocate or block, the same rules as for process() apply.
+		// return true if the new configuration is in effect for the next
+		// process() call. plugins returning true also accept process() calls
+		// with any number of samples up to the samplesPerBlock passed here.
+		// return false if a new prepare() is needed, the host then stops
+		// calling process() and calls prepare() from the UI thread.
+		// this function is called from the audio callback.
+		virtual bool reconfigure(double sampleRate, int samplesPerBlock) { return false; }
+
+		// (API 3.12) fill in the memory this instance currently holds (see
+		// MemoryUsage above), so the host can show the footprint of a patch.
+		// estimates are fine, but do include memory allocated from the host's
+		// arena. return false if the plugin does not keep track of it.
+		// this function is called from the UI thread.
+		virtual bool getMemoryUsage(MemoryUsage& usage) { return false; }
+
+		// (API 3.13) warm start: put this instance back into the state of a
+		// newly created one (default parameter values, silent delay lines and
+		// filters, nothing staged), keeping the configuration and the memory of
+		// the last prepare(). the host keeps a few prepared instances of each
+		// plugin, resets them when their module is removed, and hands them out
+		// when one is inserted, so inserting a module does not have to wait for
+		// createInstance() and prepare(). the host only calls this while
+		// process() is not being called for the instance, and calls
+		// inputEnabled()/outputEnabled() again for the new patch. the editor
+		// stays: the host calls visibilityChanged(false) before reset(), so it
+		// can release what it only needs while visible.
+		// return false if the instance cannot be reset, the host deletes it then.
+		// this function is called from the UI thread.
+		virtual bool reset() { return false; }
+
+		// (API 3.14) a number that changes whenever the state getState() would
+		// return changes, e.g. a counter incremented on every parameter change.
+		// when the host autosaves a patch, it skips the modules whose version is
+		// the one it saved last. return 0 if the plugin does not version its
+		// state, the host then calls getState() every time.
+		// this function is called from the UI thread.
+		virtual uint64_t stateVersion() { return 0; }
+
+		// (API 3.14) the changes of the state since since, a version returned
+		// by stateVersion() or this function before, so the host only has to
+		// append them to its autosave journal. allocate the buffer with
+		// new char[...], as in getState(), and set *version to the version of
+		// the state the delta leads to. the format is up to the plugin, only
+		// applyStateDelta() reads it (see Percussa::SSP::ValueVersions in
+		// PercussaState.h for plugins whose state is a set of values).
+		// return false if there is no delta from that version, the host
+		// calls getState() then.
+		// this function is called from the UI thread.
+		virtual bool getStateDelta(uint64_t since, void** buffer, size_t* size, uint64_t* version) { return false; }
+
+		// (API 3.14) applies a delta returned by getStateDelta(), after the host
+		// restored the state it was taken from with setState() and the deltas
+		// before it, in order. the buffer is only valid during the call.
+		// return false if the delta cannot be applied.
+		// this function is called from the UI thread.
+		virtual bool applyStateDelta(const void* buffer, size_t size) { return false; }
 	};
 
 	// your plugin needs to implement the createDescriptor and createInstance
@@ -223,6 +672,43 @@ namespace SSP {
 	typedef PluginInterface* (*InstantiateFun)();
 	typedef PluginDescriptor* (*DescriptorFun)();
     typedef void (*VersionFun)(unsigned&, unsigned&);
+
+	// optional functions of a shared object containing several plugins (a
+	// bundle), so they share one copy of their libraries (e.g. a statically
+	// linked JUCE), which is then only loaded and relocated once.
+	// getPluginCount() returns the number of plugins, createDescriptorAt() and
+	// createInstanceAt() take the index of the plugin (0 ... count - 1), and
+	// work like createDescriptor() and createInstance() above. a bundle still
+	// exports those, for plugin 0, so hosts which do not know about bundles
+	// can load it. the host tells plugins apart by their uid, not the index.
+	// PercussaBundle.h implements these functions for you.
+	//
+	// extern "C" {
+	//	__attribute__ ((visibility("default"))) int getPluginCount();
+	//	__attribute__ ((visibility("default"))) Percussa::SSP::PluginDescriptor* createDescriptorAt(int index);
+	//	__attribute__ ((visibility("default"))) Percussa::SSP::PluginInterface* createInstanceAt(int index);
+	// }
+
+	static const char* getPluginCountName = "getPluginCount";
+	static const char* createDescriptorAtName = "createDescriptorAt";
+	static const char* createInstanceAtName = "createInstanceAt";
+
+	typedef int (*PluginCountFun)();
+	typedef PluginDescriptor* (*DescriptorAtFun)(int);
+	typedef PluginInterface* (*InstantiateAtFun)(int);
+
+	// optional function a plugin can export, to report the statistics of its
+	// profiling zones as text (see PercussaProfile.h). it writes at most size
+	// bytes into buffer, and returns the full length of the report.
+	// the host looks it up with dlsym(), and does not require it.
+	//
+	// extern "C" {
+	//	__attribute__ ((visibility("default"))) size_t getProfileReport(char* buffer, size_t size);
+	// }
+
+	static const char* getProfileReportName = "getProfileReport";
+
+	typedef size_t (*ProfileReportFun)(char*, size_t);
 };
 };
 
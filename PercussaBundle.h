@@ -0,0 +1,168 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_BUNDLE_H_INCLUDED
+#define PERCUSSA_BUNDLE_H_INCLUDED
+
+#include "Percussa.h"
+#include "PercussaProfile.h"
+
+#include <algorithm>
+#include <mutex>
+
+// several plugins in one shared object (a bundle, see getPluginCount() in
+// Percussa.h), so they load and relocate their libraries only once.
+// end one source file of each plugin with
+//
+//	SSP_PLUGIN_EXPORT(createMyDescriptor, createMyInstance)
+//
+// where the two functions work like createDescriptor() and createInstance().
+// built on its own, this exports createDescriptor(), createInstance() and
+// getApiVersion(), as for any plugin. compiled with SSP_BUNDLE defined to 1,
+// it adds the plugin to the bundle instead, and SSP_BUNDLE_EXPORT() in one
+// source file of the bundle exports the functions for all its plugins. the
+// cmake functions ssp_add_plugin() and ssp_add_bundle() set this up (see
+// examples/SSPBundle.cmake).
+//
+// plugins are numbered in the order of their uids, whatever order their
+// object files are linked in, so the numbers do not change when plugins are
+// added to or removed from the ssp_add_bundle() list, or with link time
+// optimisation. the plugins of a bundle share
+// one shared object, so keep their classes in anonymous namespaces (or give
+// them different names). the same goes for SSP_PROFILE_EXPORT(), which the
+// bundle exports once for all its plugins.
+
+namespace Percussa {
+namespace SSP {
+
+	// the plugins of the bundle, hidden so every bundle has its own
+	class __attribute__ ((visibility("hidden"))) Bundle
+	{
+	public:
+		static constexpr int MAX_PLUGINS = 64;
+
+		static Bundle& instance() {
+			static Bundle bundle;
+			return bundle;
+		}
+
+		// called while the shared object is loaded, by SSP_PLUGIN_EXPORT(), in
+		// the order the static initialisers run. plugins beyond MAX_PLUGINS
+		// are left out.
+		void add(DescriptorFun descriptorFun, InstantiateFun instantiateFun) {
+			if (count_ == MAX_PLUGINS) return;
+			plugins_[count_].descriptorFun = descriptorFun;
+			plugins_[count_].instantiateFun = instantiateFun;
+			count_++;
+		}
+
+		int count() {
+			sort();
+			return count_;
+		}
+
+		PluginDescriptor* createDescriptor(int index) {
+			sort();
+			return index >= 0 && index < count_ ? plugins_[index].descriptorFun() : nullptr;
+		}
+
+		PluginInterface* createInstance(int index) {
+			sort();
+			return index >= 0 && index < count_ ? plugins_[index].instantiateFun() : nullptr;
+		}
+
+	private:
+		struct Plugin
+		{
+			DescriptorFun descriptorFun;
+			InstantiateFun instantiateFun;
+			int uid;
+		};
+
+		// orders the plugins by uid, on the first call from the host rather
+		// than while the shared object is loaded: it creates a descriptor of
+		// every plugin, which may run code of the plugin's libraries
+		void sort() {
+			std::call_once(sorted_, [this] {
+				for (int i = 0; i < count_; i++) {
+					PluginDescriptor* desc = plugins_[i].descriptorFun();
+					plugins_[i].uid = desc ? desc->uid : 0;
+					delete desc;
+				}
+				std::stable_sort(plugins_, plugins_ + count_, [](const Plugin& a, const Plugin& b) {
+					return a.uid < b.uid;
+				});
+			});
+		}
+
+		Plugin plugins_[MAX_PLUGINS] = {};
+		int count_ = 0;
+		std::once_flag sorted_;
+	};
+
+	struct __attribute__ ((visibility("hidden"))) BundleEntry
+	{
+		BundleEntry(DescriptorFun descriptorFun, InstantiateFun instantiateFun) {
+			Bundle::instance().add(descriptorFun, instantiateFun);
+		}
+	};
+};
+};
+
+#define SSP_API_VERSION_EXPORT() \
+	extern "C" __attribute__ ((visibility("default"))) \
+	void getApiVersion(unsigned& major, unsigned& minor) { \
+		major = Percussa::SSP::API_MAJOR_VERSION; \
+		minor = Percussa::SSP::API_MINOR_VERSION; \
+	}
+
+#if SSP_BUNDLE
+
+#define SSP_PLUGIN_EXPORT(descriptorFun, instantiateFun) \
+	static const Percussa::SSP::BundleEntry sspBundleEntry(descriptorFun, instantiateFun);
+
+#else
+
+#define SSP_PLUGIN_EXPORT(descriptorFun, instantiateFun) \
+	extern "C" __attribute__ ((visibility("default"))) \
+	Percussa::SSP::PluginDescriptor* createDescriptor() { return descriptorFun(); } \
+	extern "C" __attribute__ ((visibility("default"))) \
+	Percussa::SSP::PluginInterface* createInstance() { return instantiateFun(); } \
+	SSP_API_VERSION_EXPORT()
+
+#endif
+
+#define SSP_BUNDLE_EXPORT() \
+	extern "C" __attribute__ ((visibility("default"))) \
+	int getPluginCount() { return Percussa::SSP::Bundle::instance().count(); } \
+	extern "C" __attribute__ ((visibility("default"))) \
+	Percussa::SSP::PluginDescriptor* createDescriptorAt(int index) { \
+		return Percussa::SSP::Bundle::instance().createDescriptor(index); \
+	} \
+	extern "C" __attribute__ ((visibility("default"))) \
+	Percussa::SSP::PluginInterface* createInstanceAt(int index) { \
+		return Percussa::SSP::Bundle::instance().createInstance(index); \
+	} \
+	extern "C" __attribute__ ((visibility("default"))) \
+	Percussa::SSP::PluginDescriptor* createDescriptor() { return createDescriptorAt(0); } \
+	extern "C" __attribute__ ((visibility("default"))) \
+	Percussa::SSP::PluginInterface* createInstance() { return createInstanceAt(0); } \
+	SSP_API_VERSION_EXPORT() \
+	SSP_PROFILE_EXPORT()
+
+#endif
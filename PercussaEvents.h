@@ -0,0 +1,78 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_EVENTS_H_INCLUDED
+#define PERCUSSA_EVENTS_H_INCLUDED
+
+#include "Percussa.h"
+
+namespace Percussa {
+namespace SSP {
+
+	// most channels splitBlock() handles, blocks with more are not split
+	constexpr static int MAX_SPLIT_CHANNELS = 32;
+
+	// splits a block at the offsets of its events (see processEvents() in
+	// Percussa.h). onEvent(const Event&) is called for each event, and
+	// onSegment(float** channelData, int numChannels, int numSamples) for the
+	// samples up to the next event, with the channel pointers moved to the
+	// start of the segment. a segment is at least granularity samples long
+	// (except at the end of the block), events closer than that to the start
+	// of a segment are applied at its start, up to granularity - 1 samples
+	// early. this bounds the number of calls per block for bursts of events.
+	//
+	//	void processEvents(float** channelData, int numChannels, int numSamples,
+	//			const Percussa::SSP::Event* events, int numEvents) override {
+	//		Percussa::SSP::splitBlock(channelData, numChannels, numSamples, events, numEvents,
+	//			[this](const Percussa::SSP::Event& e) { applyEvent(e); },
+	//			[this](float** data, int channels, int samples) { process(data, channels, samples); },
+	//			16);
+	//	}
+	//
+	// does not allocate, so it is safe to use in the audio callback.
+	template <typename OnEvent, typename OnSegment>
+	inline void splitBlock(float** channelData, int numChannels, int numSamples,
+		const Event* events, int numEvents, OnEvent onEvent, OnSegment onSegment, int granularity = 1) {
+		if (granularity < 1) granularity = 1;
+		if (numChannels > MAX_SPLIT_CHANNELS) {
+			for (int i = 0; i < numEvents; i++) onEvent(events[i]);
+			onSegment(channelData, numChannels, numSamples);
+			return;
+		}
+
+		float* segment[MAX_SPLIT_CHANNELS];
+		int next = 0;
+		int start = 0;
+		while (start < numSamples) {
+			while (next < numEvents && (int) events[next].offset < start + granularity) {
+				onEvent(events[next++]);
+			}
+			int end = numSamples;
+			if (next < numEvents && (int) events[next].offset < numSamples) end = (int) events[next].offset;
+			for (int ch = 0; ch < numChannels; ch++) segment[ch] = channelData[ch] + start;
+			onSegment(segment, numChannels, end - start);
+			start = end;
+		}
+		// events past the end of the block
+		while (next < numEvents) onEvent(events[next++]);
+	}
+
+};
+};
+
+#endif
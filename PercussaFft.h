@@ -0,0 +1,272 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_FFT_H_INCLUDED
+#define PERCUSSA_FFT_H_INCLUDED
+
+#include "PercussaSimd.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace Percussa {
+namespace SSP {
+
+	// forward fft of real signals, for analysis (see PercussaSpectrum.h).
+	// a real fft of size N is a complex fft of N / 2 points, of the even
+	// samples as real and the odd samples as imaginary parts, followed by a
+	// pass that separates the two. the complex fft is a radix-4 Stockham fft
+	// (with one radix-2 pass if N / 2 is not a power of 4), on separate real
+	// and imaginary arrays, 4 butterflies at a time (NEON on the SSP, SSE on
+	// a desktop). Stockham passes alternate between two buffers, so there is
+	// no bit reversal pass.
+	//
+	// the constructor allocates the twiddle tables and work buffers, forward()
+	// does not allocate, and can run on any thread, but one thread at a time.
+	class Fft {
+	public:
+		static constexpr int MIN_SIZE = 32;
+		static constexpr int MAX_SIZE = 65536;
+
+		// size is a power of 2, MIN_SIZE ... MAX_SIZE
+		explicit Fft(int size) : size_(size), half_(size / 2) {
+			if (size < MIN_SIZE || size > MAX_SIZE || (size & (size - 1)) != 0) {
+				throw std::invalid_argument("fft size has to be a power of 2, 32 ... 65536");
+			}
+			// the radix-4 passes, and a radix-2 pass for what is left
+			int offset = 0;
+			for (int n = half_, s = 1; n > 1; s *= n > 2 ? 4 : 2, n /= n > 2 ? 4 : 2) {
+				passes_.push_back(Pass{n, s, n > 2 ? 4 : 2, offset});
+				if (n > 2) offset += 6 * (n / 4);
+			}
+			twiddles_.resize(offset);
+			for (const Pass& pass : passes_) {
+				if (pass.radix != 4) continue;
+				const int n0 = pass.n / 4;
+				float* w = twiddles_.data() + pass.twiddles;
+				for (int p = 0; p < n0; p++) {
+					for (int k = 1; k <= 3; k++) {
+						const double a = -2.0 * M_PI * k * p / pass.n;
+						w[(2 * k - 2) * n0 + p] = (float) std::cos(a);
+						w[(2 * k - 1) * n0 + p] = (float) std::sin(a);
+					}
+				}
+			}
+			// e^(-2 pi i k / N) of the pass separating the even and odd samples
+			cos_.resize(half_);
+			sin_.resize(half_);
+			for (int k = 0; k < half_; k++) {
+				const double a = 2.0 * M_PI * k / size;
+				cos_[k] = (float) std::cos(a);
+				sin_[k] = (float) std::sin(a);
+			}
+			// one more complex value than the fft, see forward()
+			for (int i = 0; i < 2; i++) {
+				re_[i].resize(half_ + 4);
+				im_[i].resize(half_ + 4);
+			}
+		}
+
+		int size() const { return size_; }
+		// N / 2 + 1, 0 Hz ... half the sample rate
+		int numBins() const { return half_ + 1; }
+
+		size_t memoryBytes() const {
+			return sizeof(*this) + passes_.size() * sizeof(Pass)
+				+ (twiddles_.size() + cos_.size() + sin_.size() + 4 * re_[0].size()) * sizeof(float);
+		}
+
+		// in has size() samples, re and im get numBins() values, not scaled:
+		// a sine of amplitude 1 at a bin's frequency has a magnitude of N / 2
+		void forward(const float* in, float* re, float* im) {
+			using namespace Simd;
+			const int m = half_;
+			float* xr = re_[0].data();
+			float* xi = im_[0].data();
+			for (int i = 0; i < m; i += 4) {
+				f4 even, odd;
+				unzip(loadU(in + 2 * i), loadU(in + 2 * i + 4), even, odd);
+				storeU(xr + i, even);
+				storeU(xi + i, odd);
+			}
+
+			int from = 0;
+			for (const Pass& pass : passes_) {
+				float* yr = re_[1 - from].data();
+				float* yi = im_[1 - from].data();
+				if (pass.radix == 2) radix2(pass, xr, xi, yr, yi);
+				else if (pass.s == 1) radix4First(pass, xr, xi, yr, yi);
+				else radix4(pass, xr, xi, yr, yi);
+				xr = yr;
+				xi = yi;
+				from = 1 - from;
+			}
+
+			// X[k] = E[k] + e^(-2 pi i k / N) O[k], with the spectra of the even
+			// and odd samples E[k] = (Z[k] + conj(Z[m - k])) / 2 and
+			// O[k] = -i (Z[k] - conj(Z[m - k])) / 2. Z[m] is Z[0], so m - k is
+			// in range for k = 0, and the buffers have room for it.
+			xr[m] = xr[0];
+			xi[m] = xi[0];
+			const f4 half = set1(0.5f);
+			for (int k = 0; k < m; k += 4) {
+				const f4 ar = loadU(xr + k), ai = loadU(xi + k);
+				const f4 br = reverse(loadU(xr + m - k - 3)), bi = reverse(loadU(xi + m - k - 3));
+				const f4 er = mul(add(ar, br), half), ei = mul(sub(ai, bi), half);
+				const f4 orr = mul(add(ai, bi), half), oi = mul(sub(br, ar), half);
+				const f4 c = loadU(cos_.data() + k), s = loadU(sin_.data() + k);
+				storeU(re + k, add(er, madd(c, orr, mul(s, oi))));
+				storeU(im + k, add(ei, sub(mul(c, oi), mul(s, orr))));
+			}
+			re[m] = xr[0] - xi[0];
+			im[m] = 0.0f;
+			im[0] = 0.0f;
+		}
+
+	private:
+		struct Pass {
+			int n;          // length of the sub-ffts
+			int s;          // stride, number of sub-ffts
+			int radix;
+			int twiddles;   // offset of w^p, w^2p, w^3p (re, im) in twiddles_
+		};
+
+		// y[q + s (4p + k)] = w^kp sum_j x[q + s (p + j n / 4)] (-i)^jk,
+		// vectorised over q, s is 4 or more
+		void radix4(const Pass& pass, const float* xr, const float* xi, float* yr, float* yi) const {
+			using namespace Simd;
+			const int s = pass.s, n0 = pass.n / 4;
+			const float* w = twiddles_.data() + pass.twiddles;
+			for (int p = 0; p < n0; p++) {
+				const f4 w1r = set1(w[p]), w1i = set1(w[n0 + p]);
+				const f4 w2r = set1(w[2 * n0 + p]), w2i = set1(w[3 * n0 + p]);
+				const f4 w3r = set1(w[4 * n0 + p]), w3i = set1(w[5 * n0 + p]);
+				const int in = s * p, out = s * 4 * p;
+				for (int q = 0; q < s; q += 4) {
+					const int a = in + q, b = a + s * n0, c = b + s * n0, d = c + s * n0;
+					f4 y0r, y0i, y1r, y1i, y2r, y2i, y3r, y3i;
+					butterfly(loadU(xr + a), loadU(xi + a), loadU(xr + b), loadU(xi + b),
+						loadU(xr + c), loadU(xi + c), loadU(xr + d), loadU(xi + d),
+						y0r, y0i, y1r, y1i, y2r, y2i, y3r, y3i);
+					const int o = out + q;
+					storeU(yr + o, y0r);
+					storeU(yi + o, y0i);
+					storeU(yr + o + s, sub(mul(w1r, y1r), mul(w1i, y1i)));
+					storeU(yi + o + s, madd(w1r, y1i, mul(w1i, y1r)));
+					storeU(yr + o + 2 * s, sub(mul(w2r, y2r), mul(w2i, y2i)));
+					storeU(yi + o + 2 * s, madd(w2r, y2i, mul(w2i, y2r)));
+					storeU(yr + o + 3 * s, sub(mul(w3r, y3r), mul(w3i, y3i)));
+					storeU(yi + o + 3 * s, madd(w3r, y3i, mul(w3i, y3r)));
+				}
+			}
+		}
+
+		// the first pass, s = 1: vectorised over p, the outputs of 4
+		// butterflies are next to each other, and get transposed
+		void radix4First(const Pass& pass, const float* xr, const float* xi, float* yr, float* yi) const {
+			using namespace Simd;
+			const int n0 = pass.n / 4;
+			const float* w = twiddles_.data() + pass.twiddles;
+			for (int p = 0; p < n0; p += 4) {
+				f4 y0r, y0i, y1r, y1i, y2r, y2i, y3r, y3i;
+				butterfly(loadU(xr + p), loadU(xi + p), loadU(xr + p + n0), loadU(xi + p + n0),
+					loadU(xr + p + 2 * n0), loadU(xi + p + 2 * n0), loadU(xr + p + 3 * n0), loadU(xi + p + 3 * n0),
+					y0r, y0i, y1r, y1i, y2r, y2i, y3r, y3i);
+				const f4 w1r = loadU(w + p), w1i = loadU(w + n0 + p);
+				const f4 w2r = loadU(w + 2 * n0 + p), w2i = loadU(w + 3 * n0 + p);
+				const f4 w3r = loadU(w + 4 * n0 + p), w3i = loadU(w + 5 * n0 + p);
+				f4 r0 = y0r, r1 = sub(mul(w1r, y1r), mul(w1i, y1i));
+				f4 r2 = sub(mul(w2r, y2r), mul(w2i, y2i)), r3 = sub(mul(w3r, y3r), mul(w3i, y3i));
+				f4 i0 = y0i, i1 = madd(w1r, y1i, mul(w1i, y1r));
+				f4 i2 = madd(w2r, y2i, mul(w2i, y2r)), i3 = madd(w3r, y3i, mul(w3i, y3r));
+				transpose(r0, r1, r2, r3);
+				transpose(i0, i1, i2, i3);
+				float* outr = yr + 4 * p;
+				float* outi = yi + 4 * p;
+				storeU(outr, r0);
+				storeU(outr + 4, r1);
+				storeU(outr + 8, r2);
+				storeU(outr + 12, r3);
+				storeU(outi, i0);
+				storeU(outi + 4, i1);
+				storeU(outi + 8, i2);
+				storeU(outi + 12, i3);
+			}
+		}
+
+		// the last pass when N / 2 is not a power of 4, n = 2, no twiddles
+		void radix2(const Pass& pass, const float* xr, const float* xi, float* yr, float* yi) const {
+			using namespace Simd;
+			const int s = pass.s;
+			for (int q = 0; q < s; q += 4) {
+				const f4 ar = loadU(xr + q), ai = loadU(xi + q);
+				const f4 br = loadU(xr + q + s), bi = loadU(xi + q + s);
+				storeU(yr + q, add(ar, br));
+				storeU(yi + q, add(ai, bi));
+				storeU(yr + q + s, sub(ar, br));
+				storeU(yi + q + s, sub(ai, bi));
+			}
+		}
+
+		// the 4 point dft of a, b, c, d, before the twiddles
+		static void butterfly(Simd::f4 ar, Simd::f4 ai, Simd::f4 br, Simd::f4 bi,
+			Simd::f4 cr, Simd::f4 ci, Simd::f4 dr, Simd::f4 di,
+			Simd::f4& y0r, Simd::f4& y0i, Simd::f4& y1r, Simd::f4& y1i,
+			Simd::f4& y2r, Simd::f4& y2i, Simd::f4& y3r, Simd::f4& y3i) {
+			using namespace Simd;
+			const f4 apcR = add(ar, cr), apcI = add(ai, ci);
+			const f4 amcR = sub(ar, cr), amcI = sub(ai, ci);
+			const f4 bpdR = add(br, dr), bpdI = add(bi, di);
+			const f4 bmdR = sub(br, dr), bmdI = sub(bi, di);
+			y0r = add(apcR, bpdR);
+			y0i = add(apcI, bpdI);
+			// (a - c) - i (b - d)
+			y1r = add(amcR, bmdI);
+			y1i = sub(amcI, bmdR);
+			y2r = sub(apcR, bpdR);
+			y2i = sub(apcI, bpdI);
+			// (a - c) + i (b - d)
+			y3r = sub(amcR, bmdI);
+			y3i = add(amcI, bmdR);
+		}
+
+		int size_;
+		int half_;
+		std::vector<Pass> passes_;
+		std::vector<float> twiddles_;
+		std::vector<float> cos_, sin_;
+		std::vector<float> re_[2], im_[2];
+	};
+
+	// window functions, filled into a buffer of size samples
+	inline void hannWindow(float* window, int size) {
+		for (int i = 0; i < size; i++) window[i] = (float) (0.5 - 0.5 * std::cos(2.0 * M_PI * i / size));
+	}
+
+	inline void blackmanHarrisWindow(float* window, int size) {
+		for (int i = 0; i < size; i++) {
+			const double a = 2.0 * M_PI * i / size;
+			window[i] = (float) (0.35875 - 0.48829 * std::cos(a) + 0.14128 * std::cos(2 * a) - 0.01168 * std::cos(3 * a));
+		}
+	}
+
+};
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_LAYOUT_H_INCLUDED
+#define PERCUSSA_LAYOUT_H_INCLUDED
+
+#include <cstddef>
+#include "Percussa.h"
+#include "PercussaSimd.h"
+
+namespace Percussa {
+namespace SSP {
+
+	// conversions between the planar channel buffers passed to process(), and
+	// the interleaved and packed layouts (see BufferLayout in Percussa.h).
+	// the kernels transpose 4x4 blocks in registers. planar buffers can have
+	// any alignment, the interleaved/packed buffer has to be aligned to 16 bytes.
+
+	// number of channels in the buffer, including the padding of LAYOUT_PACKED4
+	inline int layoutChannels(int layout, int numChannels) {
+		return layout == LAYOUT_PACKED4 ? (numChannels + 3) & ~3 : numChannels;
+	}
+
+	// size of the buffer in floats
+	inline size_t layoutSize(int layout, int numChannels, int numSamples) {
+		return (size_t) layoutChannels(layout, numChannels) * (size_t) numSamples;
+	}
+
+	inline void interleave(const float* const* planar, int numChannels, int numSamples, float* data) {
+		using namespace Simd;
+		int i = 0;
+		if ((numChannels & 3) == 0) {
+			for (; i + 4 <= numSamples; i += 4) {
+				for (int ch = 0; ch < numChannels; ch += 4) {
+					f4 a = loadU(planar[ch] + i), b = loadU(planar[ch + 1] + i);
+					f4 c = loadU(planar[ch + 2] + i), d = loadU(planar[ch + 3] + i);
+					transpose(a, b, c, d);
+					float* out = data + (size_t) i * numChannels + ch;
+					store(out, a);
+					store(out + numChannels, b);
+					store(out + 2 * numChannels, c);
+					store(out + 3 * numChannels, d);
+				}
+			}
+		}
+		for (; i < numSamples; i++) {
+			for (int ch = 0; ch < numChannels; ch++) data[(size_t) i * numChannels + ch] = planar[ch][i];
+		}
+	}
+
+	inline void deinterleave(const float* data, int numChannels, int numSamples, float* const* planar) {
+		using namespace Simd;
+		int i = 0;
+		if ((numChannels & 3) == 0) {
+			for (; i + 4 <= numSamples; i += 4) {
+				for (int ch = 0; ch < numChannels; ch += 4) {
+					const float* in = data + (size_t) i * numChannels + ch;
+					f4 a = load(in), b = load(in + numChannels);
+					f4 c = load(in + 2 * numChannels), d = load(in + 3 * numChannels);
+					transpose(a, b, c, d);
+					storeU(planar[ch] + i, a);
+					storeU(planar[ch + 1] + i, b);
+					storeU(planar[ch + 2] + i, c);
+					storeU(planar[ch + 3] + i, d);
+				}
+			}
+		}
+		for (; i < numSamples; i++) {
+			for (int ch = 0; ch < numChannels; ch++) planar[ch][i] = data[(size_t) i * numChannels + ch];
+		}
+	}
+
+	inline void pack4(const float* const* planar, int numChannels, int numSamples, float* data) {
+		using namespace Simd;
+		static const float silence[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+		for (int g = 0; g < numChannels; g += 4) {
+			float* out = data + (size_t) g * numSamples;
+			// channels of the padding read silence, without advancing
+			const float* src[4];
+			int step[4];
+			for (int k = 0; k < 4; k++) {
+				bool present = g + k < numChannels;
+				src[k] = present ? planar[g + k] : silence;
+				step[k] = present ? 1 : 0;
+			}
+			int i = 0;
+			for (; i + 4 <= numSamples; i += 4) {
+				f4 a = loadU(src[0] + i * step[0]), b = loadU(src[1] + i * step[1]);
+				f4 c = loadU(src[2] + i * step[2]), d = loadU(src[3] + i * step[3]);
+				transpose(a, b, c, d);
+				store(out + i * 4, a);
+				store(out + i * 4 + 4, b);
+				store(out + i * 4 + 8, c);
+				store(out + i * 4 + 12, d);
+			}
+			for (; i < numSamples; i++) {
+				for (int k = 0; k < 4; k++) out[i * 4 + k] = src[k][i * step[k]];
+			}
+		}
+	}
+
+	inline void unpack4(const float* data, int numChannels, int numSamples, float* const* planar) {
+		using namespace Simd;
+		for (int g = 0; g < numChannels; g += 4) {
+			const float* in = data + (size_t) g * numSamples;
+			int n = numChannels - g < 4 ? numChannels - g : 4;
+			int i = 0;
+			for (; i + 4 <= numSamples; i += 4) {
+				f4 r[4] = {load(in + i * 4), load(in + i * 4 + 4), load(in + i * 4 + 8), load(in + i * 4 + 12)};
+				transpose(r[0], r[1], r[2], r[3]);
+				for (int k = 0; k < n; k++) storeU(planar[g + k] + i, r[k]);
+			}
+			for (; i < numSamples; i++) {
+				for (int k = 0; k < n; k++) planar[g + k][i] = in[i * 4 + k];
+			}
+		}
+	}
+
+	// planar channels to the layout, nothing is done for LAYOUT_PLANAR
+	inline void toLayout(int layout, const float* const* planar, int numChannels, int numSamples, float* data) {
+		if (layout == LAYOUT_INTERLEAVED) interleave(planar, numChannels, numSamples, data);
+		else if (layout == LAYOUT_PACKED4) pack4(planar, numChannels, numSamples, data);
+	}
+
+	inline void fromLayout(int layout, const float* data, int numChannels, int numSamples, float* const* planar) {
+		if (layout == LAYOUT_INTERLEAVED) deinterleave(data, numChannels, numSamples, planar);
+		else if (layout == LAYOUT_PACKED4) unpack4(data, numChannels, numSamples, planar);
+	}
+
+};
+};
+
+#endif
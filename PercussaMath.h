@@ -0,0 +1,178 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_MATH_H_INCLUDED
+#define PERCUSSA_MATH_H_INCLUDED
+
+#include "PercussaSimd.h"
+
+namespace Percussa {
+namespace SSP {
+namespace Math {
+
+	// fast approximations of the functions modules spend most time on,
+	// computed 4 samples at a time (NEON on the SSP, SSE on a desktop), on
+	// whole buffers. in and out can be the same buffer, neither has to be
+	// aligned. the tail of a buffer goes through the same vector code, so
+	// every sample gets the same result, wherever it is in the buffer.
+	//
+	// maximum errors over the input ranges given, measured against libm in
+	// double precision (bench_fastmath in examples/host checks them). errors
+	// are relative to the result, or absolute, where marked so (relative for
+	// results beyond +-1):
+	//
+	//	exp2(x)        x in -126 ... 127          2.5e-7
+	//	log2(x)        x > 0, normal              3e-7 absolute
+	//	tanh(x)        any x                      2e-7 absolute
+	//	sin(x), cos(x) |x| <= 1000                5e-7 absolute, growing to 1.5e-6
+	//	                                          at |x| = 10^5
+	//	sinTurns(t)    |t| <= 1                   2e-7 absolute
+	//	voltsToHz(v)   v in -10 ... 10            3e-7
+	//
+	// inputs of exp2 and tanh outside the ranges are clamped, others give
+	// undefined results. NaN and infinities are not handled.
+
+	namespace Kernel {
+		using namespace Simd;
+
+		// 2^x: 2^n * 2^f with n = round(x), f in -0.5 ... 0.5, 2^f from its
+		// Taylor series up to f^6
+		inline f4 exp2(f4 x) {
+			x = min(max(x, set1(-126.0f)), set1(127.0f));
+			const f4 n = floor(add(x, set1(0.5f)));
+			const f4 f = sub(x, n);
+			f4 p = set1(1.5403530393381608e-4f);
+			p = madd(p, f, set1(1.3333558146428443e-3f));
+			p = madd(p, f, set1(9.6181291076284772e-3f));
+			p = madd(p, f, set1(5.5504108664821580e-2f));
+			p = madd(p, f, set1(2.4022650695910071e-1f));
+			p = madd(p, f, set1(6.9314718055994531e-1f));
+			p = madd(p, f, set1(1.0f));
+			return mul(p, pow2i(n));
+		}
+
+		// log2(x) = e + log2(m), with x = m * 2^e and m in 1 ... 2, from the
+		// series log(m) = 2 * atanh(s), s = (m - 1) / (m + 1) in 0 ... 1/3
+		inline f4 log2(f4 x) {
+			const f4 e = exponent(x);
+			const f4 m = mantissa(x);
+			const f4 s = div(sub(m, set1(1.0f)), add(m, set1(1.0f)));
+			const f4 s2 = mul(s, s);
+			f4 p = set1(1.0f / 13.0f);
+			p = madd(p, s2, set1(1.0f / 11.0f));
+			p = madd(p, s2, set1(1.0f / 9.0f));
+			p = madd(p, s2, set1(1.0f / 7.0f));
+			p = madd(p, s2, set1(1.0f / 5.0f));
+			p = madd(p, s2, set1(1.0f / 3.0f));
+			p = madd(p, s2, set1(1.0f));
+			return madd(mul(p, s), set1(2.8853900817779268f), e);
+		}
+
+		// tanh(|x|) = 1 - 2 / (e^2|x| + 1), with the sign of x. beyond |x| = 9,
+		// tanh(x) rounds to +-1 in single precision
+		inline f4 tanh(f4 x) {
+			const f4 a = min(abs(x), set1(9.0f));
+			const f4 e = exp2(mul(a, set1(2.8853900817779268f)));
+			const f4 t = sub(set1(1.0f), div(set1(2.0f), add(e, set1(1.0f))));
+			return copySign(t, x);
+		}
+
+		// sin(2 pi t) for t in turns: reduced to u in -0.25 ... 0.25 (using
+		// the symmetries of sin), then the odd Taylor series of sin(2 pi u)
+		// up to u^11
+		inline f4 sinTurns(f4 t) {
+			t = sub(t, floor(add(t, set1(0.5f))));
+			const f4 u = copySign(sub(set1(0.25f), abs(sub(abs(t), set1(0.25f)))), t);
+			const f4 u2 = mul(u, u);
+			f4 p = set1(-15.094642576822990f);
+			p = madd(p, u2, set1(42.058693944897653f));
+			p = madd(p, u2, set1(-76.705859753061390f));
+			p = madd(p, u2, set1(81.605249276075040f));
+			p = madd(p, u2, set1(-41.341702240399760f));
+			p = madd(p, u2, set1(6.2831853071795865f));
+			return mul(p, u);
+		}
+
+		// x - n * 2 pi in -pi ... pi, with 2 pi split in two parts (Cody and
+		// Waite), the first short enough that n * part is exact, in turns
+		inline f4 reduceRadians(f4 x) {
+			const f4 n = floor(madd(x, set1(0.15915494309189535f), set1(0.5f)));
+			f4 r = madd(n, set1(-6.28125f), x);
+			r = madd(n, set1(-1.9353071795864769e-3f), r);
+			return mul(r, set1(0.15915494309189535f));
+		}
+
+		inline f4 sin(f4 x) { return sinTurns(reduceRadians(x)); }
+		inline f4 cos(f4 x) { return sinTurns(add(reduceRadians(x), set1(0.25f))); }
+
+		// out = f(in) for a kernel f, the tail through a padded vector
+		template <typename F>
+		inline void apply(const float* in, float* out, int numSamples, F f) {
+			int i = 0;
+			for (; i + 4 <= numSamples; i += 4) storeU(out + i, f(loadU(in + i)));
+			if (i < numSamples) {
+				float tail[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+				for (int k = 0; i + k < numSamples; k++) tail[k] = in[i + k];
+				storeU(tail, f(loadU(tail)));
+				for (int k = 0; i + k < numSamples; k++) out[i + k] = tail[k];
+			}
+		}
+	};
+
+	inline void exp2(const float* in, float* out, int numSamples) {
+		Kernel::apply(in, out, numSamples, [](Simd::f4 x) { return Kernel::exp2(x); });
+	}
+
+	// in > 0
+	inline void log2(const float* in, float* out, int numSamples) {
+		Kernel::apply(in, out, numSamples, [](Simd::f4 x) {
+			// keep the padding of the tail away from log2(0)
+			return Kernel::log2(Simd::max(x, Simd::set1(1.17549435e-38f)));
+		});
+	}
+
+	inline void tanh(const float* in, float* out, int numSamples) {
+		Kernel::apply(in, out, numSamples, [](Simd::f4 x) { return Kernel::tanh(x); });
+	}
+
+	// x in radians
+	inline void sin(const float* in, float* out, int numSamples) {
+		Kernel::apply(in, out, numSamples, [](Simd::f4 x) { return Kernel::sin(x); });
+	}
+
+	inline void cos(const float* in, float* out, int numSamples) {
+		Kernel::apply(in, out, numSamples, [](Simd::f4 x) { return Kernel::cos(x); });
+	}
+
+	// phase in turns (0 ... 1 is one period), sin(2 pi phase), e.g. for an
+	// oscillator keeping its phase in turns. cheaper than sin(), and as
+	// accurate for any |phase| < 2^20 as the phase itself is.
+	inline void sinTurns(const float* phase, float* out, int numSamples) {
+		Kernel::apply(phase, out, numSamples, [](Simd::f4 t) { return Kernel::sinTurns(t); });
+	}
+
+	// 1V/oct pitch CV to a frequency, hz = hzAt0V * 2^volts
+	inline void voltsToHz(const float* volts, float* hz, int numSamples, float hzAt0V) {
+		const Simd::f4 base = Simd::set1(hzAt0V);
+		Kernel::apply(volts, hz, numSamples, [base](Simd::f4 v) { return Simd::mul(base, Kernel::exp2(v)); });
+	}
+};
+};
+};
+
+#endif
@@ -0,0 +1,309 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_PARAMS_H_INCLUDED
+#define PERCUSSA_PARAMS_H_INCLUDED
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "Percussa.h"
+#include "PercussaSimd.h"
+
+namespace Percussa {
+namespace SSP {
+
+	// mappings from the normalised range 0 ... 1 to a parameter's range.
+	// CURVE_EXPONENTIAL needs min and max of the same sign, and not 0
+	// (e.g. frequencies), CURVE_SQUARED gives more resolution near min.
+	enum ParamCurve
+	{
+		CURVE_LINEAR = 0,
+		CURVE_EXPONENTIAL = 1,
+		CURVE_SQUARED = 2
+	};
+
+	// one entry of a plugin's parameter table. smoothingMs is the length of
+	// the ramp a ParamRamp takes to a new value, 0 to jump.
+	struct ParamSpec
+	{
+		const char* id;
+		const char* name;
+		float min;
+		float max;
+		float defaultValue;
+		int curve;
+		float smoothingMs;
+	};
+
+	inline float paramFrom0to1(const ParamSpec& spec, float normalised) {
+		const float x = normalised < 0.0f ? 0.0f : normalised > 1.0f ? 1.0f : normalised;
+		switch (spec.curve) {
+			case CURVE_EXPONENTIAL: return spec.min * std::pow(spec.max / spec.min, x);
+			case CURVE_SQUARED: return spec.min + (spec.max - spec.min) * x * x;
+			default: return spec.min + (spec.max - spec.min) * x;
+		}
+	}
+
+	inline float paramTo0to1(const ParamSpec& spec, float value) {
+		float x;
+		switch (spec.curve) {
+			case CURVE_EXPONENTIAL: x = std::log(value / spec.min) / std::log(spec.max / spec.min); break;
+			case CURVE_SQUARED: x = std::sqrt((value - spec.min) / (spec.max - spec.min)); break;
+			default: x = (value - spec.min) / (spec.max - spec.min); break;
+		}
+		return x != x || x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x;
+	}
+
+	// the parameters of a plugin, defined by a constant table, with their
+	// current values in cache lines of their own. the editor and
+	// setState() set values with set(), the audio thread (encoderTurned(),
+	// a staged state) with setFromAudio(), and copies all of them into a
+	// Snapshot at the start of a block, in plain values, already converted
+	// from the normalised range:
+	//
+	//	enum { GAIN, CUTOFF, NUM_PARAMS };
+	//	static constexpr Percussa::SSP::ParamSpec paramSpecs[NUM_PARAMS] = {
+	//		{"gain", "Gain", 0.0f, 2.0f, 1.0f, Percussa::SSP::CURVE_SQUARED, 20.0f},
+	//		{"cutoff", "Cutoff", 20.0f, 20000.0f, 1000.0f, Percussa::SSP::CURVE_EXPONENTIAL, 0.0f},
+	//	};
+	//	Percussa::SSP::ParamTable<NUM_PARAMS> params_{paramSpecs};
+	//	Percussa::SSP::ParamTable<NUM_PARAMS>::Snapshot snapshot_;
+	//
+	//	void process(float** channelData, int numChannels, int numSamples) override {
+	//		params_.update(snapshot_);
+	//		... snapshot_.values[GAIN] ...
+	//	}
+	//
+	// the values are published with a sequence lock: a writer makes the
+	// sequence odd while it stores, and even again when done, the reader
+	// copies the values and retries if the sequence changed meanwhile.
+	// writers only wait for each other, so the audio thread does not take
+	// the lock: it stores its values directly, and its next update() picks
+	// them up. nothing allocates, and the audio thread never waits.
+	template <size_t N>
+	class ParamTable
+	{
+	public:
+		// plain values, padded to whole cache lines
+		struct Snapshot
+		{
+			float values[(N + 15) & ~(size_t)15];
+		};
+
+		// the table has to outlive this object (make it static constexpr)
+		explicit ParamTable(const ParamSpec (&specs)[N]) : specs_(specs) {
+			for (size_t i = 0; i < N; i++) values_[i].store(specs[i].defaultValue, std::memory_order_relaxed);
+			for (size_t i = N; i < sizeof(Snapshot) / sizeof(float); i++) values_[i].store(0.0f, std::memory_order_relaxed);
+		}
+
+		static constexpr size_t size() { return N; }
+		const ParamSpec& spec(size_t i) const { return specs_[i]; }
+
+		// index of the parameter with this id, -1 if there is none
+		int indexOf(const char* id) const {
+			for (size_t i = 0; i < N; i++) {
+				const char* a = specs_[i].id;
+				const char* b = id;
+				while (*a && *a == *b) a++, b++;
+				if (*a == *b) return (int)i;
+			}
+			return -1;
+		}
+
+		// any thread but the audio thread, value in the parameter's range
+		void set(size_t i, float value) {
+			const float clamped = clamp(i, value);
+			const uint32_t s = lock();
+			values_[i].store(clamped, std::memory_order_relaxed);
+			sequence_.store(s + 2, std::memory_order_release);
+		}
+
+		// any thread but the audio thread, value in the range 0 ... 1
+		void setNormalised(size_t i, float normalised) {
+			set(i, paramFrom0to1(specs_[i], normalised));
+		}
+
+		// audio thread, value in the parameter's range. in the snapshot of
+		// the next update(), unless another thread sets it again meanwhile.
+		void setFromAudio(size_t i, float value) {
+			values_[i].store(clamp(i, value), std::memory_order_relaxed);
+			changed_ = true;
+		}
+
+		// any thread, the last value set
+		float get(size_t i) const { return values_[i].load(std::memory_order_relaxed); }
+
+		// audio thread, at the start of a block. copies the values into
+		// snapshot if they changed since the last call, and returns true then.
+		// gives up after a few tries if writers keep changing them, the
+		// snapshot keeps its values then, and the next block picks them up.
+		bool update(Snapshot& snapshot) {
+			for (int tries = 0; tries < 4; tries++) {
+				const uint32_t before = sequence_.load(std::memory_order_acquire);
+				if (before == seen_ && !changed_) return false;
+				if (before & 1) continue;
+				for (size_t i = 0; i < N; i++) snapshot.values[i] = values_[i].load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (sequence_.load(std::memory_order_relaxed) == before) {
+					seen_ = before;
+					changed_ = false;
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		float clamp(size_t i, float value) const {
+			const float lo = std::fmin(specs_[i].min, specs_[i].max);
+			const float hi = std::fmax(specs_[i].min, specs_[i].max);
+			return value < lo ? lo : value > hi ? hi : value;
+		}
+
+		// makes the sequence odd, returns the even value it had
+		uint32_t lock() {
+			uint32_t s = sequence_.load(std::memory_order_relaxed);
+			for (;;) {
+				if (s & 1) {
+					s = sequence_.load(std::memory_order_relaxed);
+					continue;
+				}
+				if (sequence_.compare_exchange_weak(s, s + 1, std::memory_order_relaxed)) break;
+			}
+			std::atomic_thread_fence(std::memory_order_release);
+			return s;
+		}
+
+		// the parts are a cache line apart (see CACHE_LINE in Percussa.h)
+		const ParamSpec* specs_;
+		char pad0_[CACHE_LINE];
+		std::atomic<float> values_[sizeof(Snapshot) / sizeof(float)];
+		char pad1_[CACHE_LINE];
+		std::atomic<uint32_t> sequence_{0};
+		char pad2_[CACHE_LINE];
+		// audio thread, the snapshot starts out with the defaults
+		uint32_t seen_ = 0xffffffffu;
+		bool changed_ = false;
+		char pad3_[CACHE_LINE];
+	};
+
+	// linear per sample ramp of a value, e.g. a gain, so changes do not click
+	// (zipper noise). the ramps are computed 4 samples at a time. call
+	// prepare() and reset() with the parameter's value from prepare(), and
+	// setTarget() with the snapshot's value at the start of every block.
+	class ParamRamp
+	{
+	public:
+		// UI thread, from prepare()
+		void prepare(double sampleRate, float smoothingMs) {
+			rampSamples_ = (int)(sampleRate * smoothingMs / 1000.0);
+			remaining_ = 0;
+			current_ = target_;
+		}
+
+		// audio thread, e.g. from reconfigure(): ramps started from now on take
+		// smoothingMs at the new rate. a ramp in flight keeps its value and
+		// its remaining steps, so it does not jump.
+		void setSampleRate(double sampleRate, float smoothingMs) {
+			rampSamples_ = (int)(sampleRate * smoothingMs / 1000.0);
+		}
+
+		// jump to the value, e.g. after a state was recalled
+		void reset(float value) {
+			current_ = target_ = value;
+			remaining_ = 0;
+		}
+
+		// audio thread, ramp from the current value to target
+		void setTarget(float target) {
+			if (target == target_) return;
+			target_ = target;
+			if (rampSamples_ <= 0) {
+				current_ = target;
+				remaining_ = 0;
+				return;
+			}
+			remaining_ = rampSamples_;
+			step_ = (target_ - current_) / (float)rampSamples_;
+		}
+
+		bool ramping() const { return remaining_ > 0; }
+		float current() const { return current_; }
+		float target() const { return target_; }
+
+		// multiplies data by the ramp, and advances it by numSamples
+		void apply(float* data, int numSamples) {
+			int i = 0;
+			if (remaining_ > 0) i = rampPart(data, numSamples, true);
+			const float g = current_;
+			const Simd::f4 gv = Simd::set1(g);
+			for (; i + 4 <= numSamples; i += 4) Simd::storeU(data + i, Simd::mul(Simd::loadU(data + i), gv));
+			for (; i < numSamples; i++) data[i] *= g;
+		}
+
+		// advances the ramp by numSamples, e.g. for a block that was not computed
+		void skip(int numSamples) {
+			if (remaining_ <= 0) return;
+			const int n = remaining_ < numSamples ? remaining_ : numSamples;
+			remaining_ -= n;
+			current_ = remaining_ > 0 ? current_ + (float)n * step_ : target_;
+		}
+
+		// writes the values of the ramp into out, and advances it by numSamples
+		void fill(float* out, int numSamples) {
+			int i = 0;
+			if (remaining_ > 0) i = rampPart(out, numSamples, false);
+			const Simd::f4 gv = Simd::set1(current_);
+			for (; i + 4 <= numSamples; i += 4) Simd::storeU(out + i, gv);
+			for (; i < numSamples; i++) out[i] = current_;
+		}
+
+	private:
+		// the part of the block within the ramp, returns its length
+		int rampPart(float* data, int numSamples, bool multiply) {
+			using namespace Simd;
+			const int n = remaining_ < numSamples ? remaining_ : numSamples;
+			f4 g = set(current_ + step_, current_ + 2.0f * step_, current_ + 3.0f * step_, current_ + 4.0f * step_);
+			const f4 step4 = set1(4.0f * step_);
+			int i = 0;
+			for (; i + 4 <= n; i += 4) {
+				storeU(data + i, multiply ? mul(loadU(data + i), g) : g);
+				g = add(g, step4);
+			}
+			float c = current_ + (float)i * step_;
+			for (; i < n; i++) {
+				c += step_;
+				data[i] = multiply ? data[i] * c : c;
+			}
+			remaining_ -= n;
+			current_ = remaining_ > 0 ? current_ + (float)n * step_ : target_;
+			return n;
+		}
+
+		float current_ = 0.0f;
+		float target_ = 0.0f;
+		float step_ = 0.0f;
+		int remaining_ = 0;
+		int rampSamples_ = 0;
+	};
+};
+};
+
+#endif
@@ -0,0 +1,282 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_PROFILE_H_INCLUDED
+#define PERCUSSA_PROFILE_H_INCLUDED
+
+// scoped profiling zones for plugin code. put a zone at the top of a block
+// of code, and the time spent in it is accumulated per thread. the name of
+// a zone is a string literal:
+//
+//	void process(float** channelData, int numChannels, int numSamples) override {
+//		{
+//			SSP_PROFILE_ZONE("multiply");
+//			...
+//		}
+//		{
+//			SSP_PROFILE_ZONE("gain");
+//			...
+//		}
+//	}
+//
+// zones are only compiled in when SSP_PROFILING is defined to 1, which the
+// examples do when cmake is run with -DSSP_PROFILING=ON. otherwise the macros
+// expand to nothing, so release builds pay nothing for them.
+//
+// add SSP_PROFILE_EXPORT() to one source file of your plugin, and the host
+// (e.g. ssphost) can ask for the zone statistics through the optional
+// getProfileReport function (see Percussa.h). you can also show the report
+// in your editor, using Percussa::SSP::Profile::report().
+//
+// the first zone entered on a thread allocates that thread's statistics
+// (thread local storage of a dlopen'ed library), so enter your zones once
+// before measuring, e.g. by ignoring the first few blocks.
+//
+// time is measured in cpu cycles where they can be read from user space
+// (x86, or armv7 when the kernel enables user access to the cycle counter
+// and SSP_PROFILE_PMCCNTR is defined), otherwise in nanoseconds.
+
+#if SSP_PROFILING
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Percussa {
+namespace SSP {
+namespace Profile {
+
+	static constexpr unsigned MAX_ZONES = 64;
+	static constexpr unsigned MAX_THREADS = 32;
+
+	inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#elif defined(__arm__) && defined(SSP_PROFILE_PMCCNTR)
+		uint32_t r;
+		asm volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(r));
+		return r;
+#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+	}
+
+	inline uint64_t elapsed(uint64_t start, uint64_t end) {
+#if defined(__arm__) && defined(SSP_PROFILE_PMCCNTR)
+		// the armv7 cycle counter is 32 bits wide and wraps around
+		return (uint32_t)((uint32_t)end - (uint32_t)start);
+#else
+		return end - start;
+#endif
+	}
+
+	inline const char* tickUnit() {
+#if defined(__x86_64__) || defined(__i386__) || (defined(__arm__) && defined(SSP_PROFILE_PMCCNTR))
+		return "cycles";
+#else
+		return "ns";
+#endif
+	}
+
+	// statistics of one zone on one thread. only the owning thread writes,
+	// report() reads them from another thread, hence the relaxed atomics.
+	struct ZoneStats
+	{
+		std::atomic<uint64_t> calls{0};
+		std::atomic<uint64_t> total{0};
+		std::atomic<uint64_t> min{UINT64_MAX};
+		std::atomic<uint64_t> max{0};
+
+		void add(uint64_t t) {
+			const std::memory_order relaxed = std::memory_order_relaxed;
+			calls.store(calls.load(relaxed) + 1, relaxed);
+			total.store(total.load(relaxed) + t, relaxed);
+			if (t < min.load(relaxed)) min.store(t, relaxed);
+			if (t > max.load(relaxed)) max.store(t, relaxed);
+		}
+	};
+
+	struct Registry
+	{
+		std::atomic<const char*> names[MAX_ZONES];
+		std::atomic<unsigned> numZones{0};
+		std::atomic<ZoneStats*> threads[MAX_THREADS];
+		// statistics of threads which have exited
+		ZoneStats retired[MAX_ZONES];
+		std::atomic_flag retireLock = ATOMIC_FLAG_INIT;
+
+		static Registry& get() {
+			static Registry registry;
+			return registry;
+		}
+	};
+
+	// per thread statistics, registered on first use, and folded into the
+	// retired statistics when the thread exits.
+	struct ThreadStats
+	{
+		ZoneStats zones[MAX_ZONES];
+		int slot = -1;
+
+		ThreadStats() {
+			Registry& r = Registry::get();
+			for (unsigned i = 0; i < MAX_THREADS; i++) {
+				ZoneStats* expected = nullptr;
+				if (r.threads[i].compare_exchange_strong(expected, zones)) {
+					slot = (int)i;
+					break;
+				}
+			}
+		}
+
+		~ThreadStats() {
+			Registry& r = Registry::get();
+			while (r.retireLock.test_and_set(std::memory_order_acquire)) {}
+			for (unsigned i = 0; i < MAX_ZONES; i++) {
+				uint64_t calls = zones[i].calls.load();
+				if (!calls) continue;
+				ZoneStats& z = r.retired[i];
+				z.calls.store(z.calls.load() + calls);
+				z.total.store(z.total.load() + zones[i].total.load());
+				if (zones[i].min.load() < z.min.load()) z.min.store(zones[i].min.load());
+				if (zones[i].max.load() > z.max.load()) z.max.store(zones[i].max.load());
+			}
+			if (slot >= 0) r.threads[slot].store(nullptr);
+			r.retireLock.clear(std::memory_order_release);
+		}
+
+		static ThreadStats& get() {
+			static thread_local ThreadStats stats;
+			return stats;
+		}
+	};
+
+	// one zone in the code, created once as a function static by SSP_PROFILE_ZONE
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name) {
+			Registry& r = Registry::get();
+			id_ = r.numZones.fetch_add(1);
+			if (id_ < MAX_ZONES) r.names[id_].store(name, std::memory_order_release);
+		}
+
+		unsigned id() const { return id_; }
+
+	private:
+		unsigned id_;
+	};
+
+	class ZoneScope
+	{
+	public:
+		explicit ZoneScope(const Zone& zone) : id_(zone.id()), start_(ticks()) {}
+
+		~ZoneScope() {
+			uint64_t t = elapsed(start_, ticks());
+			if (id_ < MAX_ZONES) ThreadStats::get().zones[id_].add(t);
+		}
+
+	private:
+		unsigned id_;
+		uint64_t start_;
+
+		ZoneScope(const ZoneScope&) = delete;
+		ZoneScope& operator=(const ZoneScope&) = delete;
+	};
+
+	// write the statistics of all zones, summed over all threads, as text
+	// into buffer. returns the length of the report, which may be larger
+	// than size, in which case the report is truncated (like snprintf).
+	inline size_t report(char* buffer, size_t size) {
+		Registry& r = Registry::get();
+		size_t len = 0;
+		auto append = [&](int n) { if (n > 0) len += (size_t)n; };
+		auto rest = [&]() { return len < size ? size - len : 0; };
+		auto out = [&]() { return len < size ? buffer + len : nullptr; };
+
+		append(snprintf(out(), rest(), "%-24s %12s %14s %14s %14s (%s)\n",
+			"zone", "calls", "mean", "min", "max", tickUnit()));
+
+		unsigned numZones = r.numZones.load();
+		if (numZones > MAX_ZONES) numZones = MAX_ZONES;
+
+		while (r.retireLock.test_and_set(std::memory_order_acquire)) {}
+		for (unsigned i = 0; i < numZones; i++) {
+			const char* name = r.names[i].load(std::memory_order_acquire);
+			uint64_t calls = r.retired[i].calls.load();
+			uint64_t total = r.retired[i].total.load();
+			uint64_t min = r.retired[i].min.load();
+			uint64_t max = r.retired[i].max.load();
+			for (unsigned t = 0; t < MAX_THREADS; t++) {
+				ZoneStats* zones = r.threads[t].load();
+				if (!zones) continue;
+				calls += zones[i].calls.load(std::memory_order_relaxed);
+				total += zones[i].total.load(std::memory_order_relaxed);
+				uint64_t zmin = zones[i].min.load(std::memory_order_relaxed);
+				uint64_t zmax = zones[i].max.load(std::memory_order_relaxed);
+				if (zmin < min) min = zmin;
+				if (zmax > max) max = zmax;
+			}
+			if (!name || !calls) continue;
+			append(snprintf(out(), rest(), "%-24s %12llu %14.1f %14llu %14llu\n",
+				name, (unsigned long long)calls, (double)total / calls,
+				(unsigned long long)min, (unsigned long long)max));
+		}
+		r.retireLock.clear(std::memory_order_release);
+
+		return len;
+	}
+};
+};
+};
+
+#define SSP_PROFILE_CONCAT2(a, b) a##b
+#define SSP_PROFILE_CONCAT(a, b) SSP_PROFILE_CONCAT2(a, b)
+
+// name "" only compiles for a string literal: the registry keeps the
+// pointer, so the name must outlive the plugin's code
+#define SSP_PROFILE_ZONE(name) \
+	static const Percussa::SSP::Profile::Zone SSP_PROFILE_CONCAT(sspProfileZone_, __LINE__)(name ""); \
+	const Percussa::SSP::Profile::ZoneScope SSP_PROFILE_CONCAT(sspProfileScope_, __LINE__)(SSP_PROFILE_CONCAT(sspProfileZone_, __LINE__))
+
+#if SSP_BUNDLE
+// a bundle exports the report once, for all its plugins (see PercussaBundle.h)
+#define SSP_PROFILE_EXPORT()
+#else
+#define SSP_PROFILE_EXPORT() \
+	extern "C" __attribute__ ((visibility("default"))) \
+	size_t getProfileReport(char* buffer, size_t size) { \
+		return Percussa::SSP::Profile::report(buffer, size); \
+	}
+#endif
+
+#else
+
+#define SSP_PROFILE_ZONE(name)
+#define SSP_PROFILE_EXPORT()
+
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_SIMD_H_INCLUDED
+#define PERCUSSA_SIMD_H_INCLUDED
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PERCUSSA_SIMD_NEON 1
+#elif defined(__SSE__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PERCUSSA_SIMD_SSE 1
+#endif
+
+#include <cstdint>
+#include <cstring>
+
+namespace Percussa {
+namespace SSP {
+namespace Simd {
+
+	// a minimal wrapper around a 128 bit register of 4 floats, NEON on the
+	// SSP, SSE when building natively on a desktop, and plain scalar code
+	// elsewhere. loads and stores expect 16 byte aligned pointers, use the
+	// U variants for unaligned ones.
+	struct f4
+	{
+#if PERCUSSA_SIMD_NEON
+		float32x4_t v;
+#elif PERCUSSA_SIMD_SSE
+		__m128 v;
+#else
+		float v[4];
+#endif
+	};
+
+#if PERCUSSA_SIMD_NEON
+
+	inline f4 load(const float* p) { return f4{vld1q_f32(p)}; }
+	inline f4 loadU(const float* p) { return f4{vld1q_f32(p)}; }
+	inline void store(float* p, f4 a) { vst1q_f32(p, a.v); }
+	inline void storeU(float* p, f4 a) { vst1q_f32(p, a.v); }
+	inline f4 set1(float x) { return f4{vdupq_n_f32(x)}; }
+	inline f4 set(float a, float b, float c, float d) {
+		const float x[4] = {a, b, c, d};
+		return f4{vld1q_f32(x)};
+	}
+	inline f4 add(f4 a, f4 b) { return f4{vaddq_f32(a.v, b.v)}; }
+	inline f4 sub(f4 a, f4 b) { return f4{vsubq_f32(a.v, b.v)}; }
+	inline f4 mul(f4 a, f4 b) { return f4{vmulq_f32(a.v, b.v)}; }
+	// a * b + c
+	inline f4 madd(f4 a, f4 b, f4 c) { return f4{vmlaq_f32(c.v, a.v, b.v)}; }
+	inline f4 min(f4 a, f4 b) { return f4{vminq_f32(a.v, b.v)}; }
+	inline f4 max(f4 a, f4 b) { return f4{vmaxq_f32(a.v, b.v)}; }
+	// {a1, a0, a3, a2}
+	inline f4 swapPairs(f4 a) { return f4{vrev64q_f32(a.v)}; }
+	// {a3, a2, a1, a0}
+	inline f4 reverse(f4 a) { const float32x4_t r = vrev64q_f32(a.v); return f4{vextq_f32(r, r, 2)}; }
+	// even = {a0, a2, b0, b2}, odd = {a1, a3, b1, b3}
+	inline void unzip(f4 a, f4 b, f4& even, f4& odd) {
+		const float32x4x2_t u = vuzpq_f32(a.v, b.v);
+		even.v = u.val[0];
+		odd.v = u.val[1];
+	}
+
+	inline f4 abs(f4 a) { return f4{vabsq_f32(a.v)}; }
+	// the magnitude of a with the sign of b
+	inline f4 copySign(f4 a, f4 b) {
+		const uint32x4_t sign = vdupq_n_u32(0x80000000u);
+		return f4{vbslq_f32(sign, b.v, a.v)};
+	}
+	// a / b, from the reciprocal estimate refined by two Newton steps (~1 ulp)
+	inline f4 div(f4 a, f4 b) {
+		float32x4_t r = vrecpeq_f32(b.v);
+		r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+		r = vmulq_f32(r, vrecpsq_f32(b.v, r));
+		return f4{vmulq_f32(a.v, r)};
+	}
+	// |a| < 2^31
+	inline f4 floor(f4 a) {
+		float32x4_t t = vcvtq_f32_s32(vcvtq_s32_f32(a.v));
+		uint32x4_t greater = vcgtq_f32(t, a.v);
+		return f4{vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(greater, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))))};
+	}
+	// 2^n for whole numbers n in -126 ... 127
+	inline f4 pow2i(f4 n) {
+		int32x4_t e = vaddq_s32(vcvtq_s32_f32(n.v), vdupq_n_s32(127));
+		return f4{vreinterpretq_f32_s32(vshlq_n_s32(e, 23))};
+	}
+	// a = mantissa(a) * 2^exponent(a), mantissa in 1 ... 2, for normal a > 0
+	inline f4 exponent(f4 a) {
+		int32x4_t e = vshrq_n_s32(vreinterpretq_s32_f32(a.v), 23);
+		return f4{vcvtq_f32_s32(vsubq_s32(vandq_s32(e, vdupq_n_s32(0xff)), vdupq_n_s32(127)))};
+	}
+	inline f4 mantissa(f4 a) {
+		uint32x4_t m = vandq_u32(vreinterpretq_u32_f32(a.v), vdupq_n_u32(0x007fffffu));
+		return f4{vreinterpretq_f32_u32(vorrq_u32(m, vdupq_n_u32(0x3f800000u)))};
+	}
+
+	// transposes the 4x4 matrix held in the rows a, b, c, d
+	inline void transpose(f4& a, f4& b, f4& c, f4& d) {
+		float32x4x2_t ab = vtrnq_f32(a.v, b.v);
+		float32x4x2_t cd = vtrnq_f32(c.v, d.v);
+		a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+		b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+		c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+		d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+	}
+
+#elif PERCUSSA_SIMD_SSE
+
+	inline f4 load(const float* p) { return f4{_mm_load_ps(p)}; }
+	inline f4 loadU(const float* p) { return f4{_mm_loadu_ps(p)}; }
+	inline void store(float* p, f4 a) { _mm_store_ps(p, a.v); }
+	inline void storeU(float* p, f4 a) { _mm_storeu_ps(p, a.v); }
+	inline f4 set1(float x) { return f4{_mm_set1_ps(x)}; }
+	inline f4 set(float a, float b, float c, float d) { return f4{_mm_setr_ps(a, b, c, d)}; }
+	inline f4 add(f4 a, f4 b) { return f4{_mm_add_ps(a.v, b.v)}; }
+	inline f4 sub(f4 a, f4 b) { return f4{_mm_sub_ps(a.v, b.v)}; }
+	inline f4 mul(f4 a, f4 b) { return f4{_mm_mul_ps(a.v, b.v)}; }
+	inline f4 madd(f4 a, f4 b, f4 c) { return f4{_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+	inline f4 min(f4 a, f4 b) { return f4{_mm_min_ps(a.v, b.v)}; }
+	inline f4 max(f4 a, f4 b) { return f4{_mm_max_ps(a.v, b.v)}; }
+	inline f4 swapPairs(f4 a) { return f4{_mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(2, 3, 0, 1))}; }
+	inline f4 reverse(f4 a) { return f4{_mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(0, 1, 2, 3))}; }
+	inline void unzip(f4 a, f4 b, f4& even, f4& odd) {
+		even.v = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(2, 0, 2, 0));
+		odd.v = _mm_shuffle_ps(a.v, b.v, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+	inline f4 abs(f4 a) { return f4{_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+	inline f4 copySign(f4 a, f4 b) {
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		return f4{_mm_or_ps(_mm_andnot_ps(sign, a.v), _mm_and_ps(sign, b.v))};
+	}
+	inline f4 div(f4 a, f4 b) { return f4{_mm_div_ps(a.v, b.v)}; }
+	inline f4 floor(f4 a) {
+		__m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+		return f4{_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)))};
+	}
+	inline f4 pow2i(f4 n) {
+		__m128i e = _mm_add_epi32(_mm_cvttps_epi32(n.v), _mm_set1_epi32(127));
+		return f4{_mm_castsi128_ps(_mm_slli_epi32(e, 23))};
+	}
+	inline f4 exponent(f4 a) {
+		__m128i e = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(a.v), 23), _mm_set1_epi32(0xff));
+		return f4{_mm_cvtepi32_ps(_mm_sub_epi32(e, _mm_set1_epi32(127)))};
+	}
+	inline f4 mantissa(f4 a) {
+		__m128i m = _mm_and_si128(_mm_castps_si128(a.v), _mm_set1_epi32(0x007fffff));
+		return f4{_mm_castsi128_ps(_mm_or_si128(m, _mm_set1_epi32(0x3f800000)))};
+	}
+
+	inline void transpose(f4& a, f4& b, f4& c, f4& d) {
+		_MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v);
+	}
+
+#else
+
+	inline f4 load(const float* p) { return f4{{p[0], p[1], p[2], p[3]}}; }
+	inline f4 loadU(const float* p) { return load(p); }
+	inline void store(float* p, f4 a) { for (int i = 0; i < 4; i++) p[i] = a.v[i]; }
+	inline void storeU(float* p, f4 a) { store(p, a); }
+	inline f4 set1(float x) { return f4{{x, x, x, x}}; }
+	inline f4 set(float a, float b, float c, float d) { return f4{{a, b, c, d}}; }
+	inline f4 add(f4 a, f4 b) { return f4{{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+	inline f4 sub(f4 a, f4 b) { return f4{{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+	inline f4 mul(f4 a, f4 b) { return f4{{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+	inline f4 madd(f4 a, f4 b, f4 c) { return add(mul(a, b), c); }
+	inline f4 min(f4 a, f4 b) {
+		return f4{{a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1],
+			a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]}};
+	}
+	inline f4 max(f4 a, f4 b) {
+		return f4{{a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1],
+			a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]}};
+	}
+	inline f4 swapPairs(f4 a) { return f4{{a.v[1], a.v[0], a.v[3], a.v[2]}}; }
+	inline f4 reverse(f4 a) { return f4{{a.v[3], a.v[2], a.v[1], a.v[0]}}; }
+	inline void unzip(f4 a, f4 b, f4& even, f4& odd) {
+		even = f4{{a.v[0], a.v[2], b.v[0], b.v[2]}};
+		odd = f4{{a.v[1], a.v[3], b.v[1], b.v[3]}};
+	}
+
+	namespace Scalar {
+		inline uint32_t bits(float x) { uint32_t b; memcpy(&b, &x, 4); return b; }
+		inline float fromBits(uint32_t b) { float x; memcpy(&x, &b, 4); return x; }
+		inline float floor(float x) { float t = (float)(int32_t)x; return t > x ? t - 1.0f : t; }
+	};
+
+	inline f4 abs(f4 a) {
+		f4 r;
+		for (int i = 0; i < 4; i++) r.v[i] = Scalar::fromBits(Scalar::bits(a.v[i]) & 0x7fffffffu);
+		return r;
+	}
+	inline f4 copySign(f4 a, f4 b) {
+		f4 r;
+		for (int i = 0; i < 4; i++) {
+			r.v[i] = Scalar::fromBits((Scalar::bits(a.v[i]) & 0x7fffffffu) | (Scalar::bits(b.v[i]) & 0x80000000u));
+		}
+		return r;
+	}
+	inline f4 div(f4 a, f4 b) { return f4{{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]}}; }
+	inline f4 floor(f4 a) {
+		return f4{{Scalar::floor(a.v[0]), Scalar::floor(a.v[1]), Scalar::floor(a.v[2]), Scalar::floor(a.v[3])}};
+	}
+	inline f4 pow2i(f4 n) {
+		f4 r;
+		for (int i = 0; i < 4; i++) r.v[i] = Scalar::fromBits((uint32_t)((int32_t)n.v[i] + 127) << 23);
+		return r;
+	}
+	inline f4 exponent(f4 a) {
+		f4 r;
+		for (int i = 0; i < 4; i++) r.v[i] = (float)((int32_t)((Scalar::bits(a.v[i]) >> 23) & 0xff) - 127);
+		return r;
+	}
+	inline f4 mantissa(f4 a) {
+		f4 r;
+		for (int i = 0; i < 4; i++) r.v[i] = Scalar::fromBits((Scalar::bits(a.v[i]) & 0x007fffffu) | 0x3f800000u);
+		return r;
+	}
+
+	inline void transpose(f4& a, f4& b, f4& c, f4& d) {
+		f4 r[4] = {a, b, c, d};
+		a = f4{{r[0].v[0], r[1].v[0], r[2].v[0], r[3].v[0]}};
+		b = f4{{r[0].v[1], r[1].v[1], r[2].v[1], r[3].v[1]}};
+		c = f4{{r[0].v[2], r[1].v[2], r[2].v[2], r[3].v[2]}};
+		d = f4{{r[0].v[3], r[1].v[3], r[2].v[3], r[3].v[3]}};
+	}
+
+#endif
+
+};
+};
+};
+
+#endif
@@ -0,0 +1,316 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_SPECTRUM_H_INCLUDED
+#define PERCUSSA_SPECTRUM_H_INCLUDED
+
+#include "PercussaFft.h"
+#include "PercussaMath.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Percussa {
+namespace SSP {
+
+	// the last samples of a signal, written by the audio thread, and read by
+	// another thread without locking. the writer never waits: if it overwrites
+	// samples while they are read, read() fails, and the reader tries again
+	// on its next frame.
+	class SpectrumTap {
+	public:
+		// frameSize is the most read() copies
+		explicit SpectrumTap(int frameSize) {
+			size_t capacity = 1;
+			while (capacity < 2 * (size_t) frameSize) capacity *= 2;
+			mask_ = capacity - 1;
+			samples_.reset(new std::atomic<float>[capacity]);
+			for (size_t i = 0; i < capacity; i++) samples_[i].store(0.0f, std::memory_order_relaxed);
+		}
+
+		// audio thread. writing_ is published before the samples are stored,
+		// so a reader which copied any of them sees it afterwards (the fences
+		// pair up as in a seqlock)
+		void write(const float* in, int n) {
+			const uint64_t w = written_.load(std::memory_order_relaxed);
+			writing_.store(w + n, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			for (int i = 0; i < n; i++) samples_[(w + i) & mask_].store(in[i], std::memory_order_relaxed);
+			written_.store(w + n, std::memory_order_release);
+		}
+
+		// number of samples written so far
+		uint64_t written() const { return written_.load(std::memory_order_acquire); }
+
+		// copies the last n samples, oldest first, and sets end to written()
+		// at the time. false if fewer than n samples have been written, or
+		// the writer overwrote some while they were copied, including a
+		// write() still in progress when the copy ended.
+		bool read(float* out, int n, uint64_t& end) const {
+			const uint64_t e = written_.load(std::memory_order_acquire);
+			if (e < (uint64_t) n) return false;
+			const uint64_t start = e - n;
+			for (int i = 0; i < n; i++) out[i] = samples_[(start + i) & mask_].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (writing_.load(std::memory_order_relaxed) - start > mask_ + 1) return false;
+			end = e;
+			return true;
+		}
+
+		size_t memoryBytes() const { return sizeof(*this) + (mask_ + 1) * sizeof(float); }
+
+	private:
+		std::unique_ptr<std::atomic<float>[]> samples_;
+		size_t mask_ = 0;
+		std::atomic<uint64_t> written_{0};
+		// the end of the write() in progress, written_ between writes
+		std::atomic<uint64_t> writing_{0};
+	};
+
+	// spectra of one or more signals for display, computed on a background
+	// thread. the audio thread writes the signals with write(), the worker
+	// thread started by start() takes the last fftSize samples of each at
+	// the frame rate, windows them (Hann), and reduces the magnitudes of the
+	// fft to numBands logarithmically spaced bands from minHz to maxHz, in dB
+	// (a full scale sine is 0 dB). the UI thread reads them with read(), and
+	// only has to draw them. the bands fall at fallDbPerSecond, so that
+	// short peaks can be seen.
+	//
+	// the constructor allocates everything, nothing allocates after that,
+	// apart from the worker thread, started and stopped from the UI thread:
+	// run it only while the spectrum is shown, e.g. from onVisibilityChanged().
+	class SpectrumAnalyser {
+	public:
+		static constexpr float FLOOR_DB = -120.0f;
+
+		SpectrumAnalyser(int numChannels, int fftSize = 2048, int numBands = 64,
+			float minHz = 20.0f, float maxHz = 20000.0f)
+			: fft_(fftSize), numBands_(numBands), minHz_(minHz), maxHz_(maxHz) {
+			const int bins = fft_.numBins();
+			window_.resize(fftSize);
+			hannWindow(window_.data(), fftSize);
+			double sum = 0.0;
+			for (float w : window_) sum += w;
+			// a full scale sine has a magnitude of sum / 2
+			scale_ = (float) (4.0 / (sum * sum));
+			frame_.resize(fftSize);
+			re_.resize(bins + 3);
+			im_.resize(bins + 3);
+			power_.resize(bins + 3);
+			bands_.resize(numBands);
+			map_.resize(numBands);
+			for (int ch = 0; ch < numChannels; ch++) channels_.emplace_back(new Channel(fftSize, numBands));
+		}
+
+		~SpectrumAnalyser() { stop(); }
+
+		SpectrumAnalyser(const SpectrumAnalyser&) = delete;
+		SpectrumAnalyser& operator=(const SpectrumAnalyser&) = delete;
+
+		int numChannels() const { return (int) channels_.size(); }
+		int numBands() const { return numBands_; }
+		int fftSize() const { return fft_.size(); }
+
+		// any thread, e.g. prepareToPlay() or onReconfigure(). the worker maps
+		// the bins to the bands again on its next frame
+		void setSampleRate(double sampleRate) { sampleRate_.store((float) sampleRate, std::memory_order_relaxed); }
+
+		// centre frequency of a band
+		float bandHz(int band) const {
+			return minHz_ * std::pow(maxHz_ / minHz_, (band + 0.5f) / numBands_);
+		}
+
+		// audio thread, n samples of channel ch
+		void write(int ch, const float* in, int n) { channels_[ch]->tap.write(in, n); }
+
+		// UI thread, starts the worker, that computes framesPerSecond frames
+		void start(float framesPerSecond = 30.0f, float fallDbPerSecond = 60.0f) {
+			if (worker_.joinable()) return;
+			fallDb_ = fallDbPerSecond / framesPerSecond;
+			interval_ = std::chrono::microseconds((int64_t) (1e6f / framesPerSecond));
+			running_ = true;
+			worker_ = std::thread([this] { run(); });
+		}
+
+		// UI thread, waits for the worker to finish its frame
+		void stop() {
+			if (!worker_.joinable()) return;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				running_ = false;
+			}
+			wakeup_.notify_one();
+			worker_.join();
+		}
+
+		bool running() const { return worker_.joinable(); }
+
+		// UI thread, copies the latest bands of channel ch, numBands() values
+		// in dB. false, leaving bands as they are, if there is no new frame
+		// since the last read()
+		bool read(int ch, float* bands) {
+			Channel& c = *channels_[ch];
+			if ((c.middle.load(std::memory_order_acquire) & FRESH) == 0) return false;
+			c.front = c.middle.exchange(c.front, std::memory_order_acq_rel) & ~FRESH;
+			const float* src = c.slots.data() + c.front * numBands_;
+			for (int i = 0; i < numBands_; i++) bands[i] = src[i];
+			return true;
+		}
+
+		// one frame of every channel with new samples, as the worker does it
+		// (public for benchmarks, which call it without a worker running)
+		void analyse() {
+			using namespace Simd;
+			const float sampleRate = sampleRate_.load(std::memory_order_relaxed);
+			if (sampleRate != mappedRate_) mapBands(sampleRate);
+			const int n = fft_.size();
+			const int bins = fft_.numBins();
+			for (auto& channel : channels_) {
+				Channel& c = *channel;
+				uint64_t end;
+				if (!c.tap.read(frame_.data(), n, end) || end == c.analysed) continue;
+				c.analysed = end;
+
+				for (int i = 0; i < n; i += 4) {
+					storeU(frame_.data() + i, mul(loadU(frame_.data() + i), loadU(window_.data() + i)));
+				}
+				fft_.forward(frame_.data(), re_.data(), im_.data());
+				const f4 scale = set1(scale_);
+				for (int k = 0; k < bins; k += 4) {
+					const f4 r = loadU(re_.data() + k), i = loadU(im_.data() + k);
+					storeU(power_.data() + k, mul(madd(r, r, mul(i, i)), scale));
+				}
+
+				// the loudest bin of a band, or for bands narrower than a bin,
+				// the power interpolated at the band's centre
+				for (int b = 0; b < numBands_; b++) {
+					const BandMap& m = map_[b];
+					float p = 0.0f;
+					if (m.hi > m.lo) {
+						for (int k = m.lo; k < m.hi; k++) p = std::fmax(p, power_[k]);
+					} else {
+						p = power_[m.lo] + m.frac * (power_[m.lo + 1] - power_[m.lo]);
+					}
+					bands_[b] = std::fmax(p, 1e-12f);
+				}
+				// 10 log10(p) = 10 log10(2) log2(p)
+				Math::log2(bands_.data(), bands_.data(), numBands_);
+				float* out = c.slots.data() + c.back * numBands_;
+				for (int b = 0; b < numBands_; b++) {
+					const float db = std::fmax(bands_[b] * 3.0103000f, FLOOR_DB);
+					c.held[b] = std::fmax(db, c.held[b] - fallDb_);
+					out[b] = c.held[b];
+				}
+				c.back = c.middle.exchange(c.back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+			}
+		}
+
+		size_t memoryBytes() const {
+			size_t bytes = sizeof(*this) + fft_.memoryBytes() + map_.size() * sizeof(BandMap)
+				+ (window_.size() + frame_.size() + re_.size() + im_.size() + power_.size() + bands_.size()) * sizeof(float);
+			for (auto& c : channels_) bytes += sizeof(Channel) + c->tap.memoryBytes()
+				+ (c->slots.size() + c->held.size()) * sizeof(float);
+			return bytes;
+		}
+
+	private:
+		// the bands are triple buffered: the worker writes slot back, and
+		// exchanges it with middle, read() exchanges front with middle if the
+		// worker marked it FRESH
+		static constexpr int FRESH = 4;
+
+		struct Channel {
+			// FLOOR_DB is copied, a reference to it needs a definition before c++17
+			Channel(int fftSize, int numBands) : tap(fftSize), slots(3 * numBands, float(FLOOR_DB)), held(numBands, float(FLOOR_DB)) {}
+			SpectrumTap tap;
+			uint64_t analysed = 0;
+			std::vector<float> slots;
+			std::vector<float> held;
+			int back = 0;
+			std::atomic<int> middle{1};
+			int front = 2;
+		};
+
+		struct BandMap {
+			int lo, hi;     // bins in the band
+			float frac;     // position of the centre between lo and lo + 1, if hi = lo
+		};
+
+		void mapBands(float sampleRate) {
+			mappedRate_ = sampleRate;
+			const float binHz = sampleRate / fft_.size();
+			const int last = fft_.numBins() - 1;
+			for (int b = 0; b < numBands_; b++) {
+				const float lo = minHz_ * std::pow(maxHz_ / minHz_, (float) b / numBands_) / binHz;
+				const float hi = minHz_ * std::pow(maxHz_ / minHz_, (float) (b + 1) / numBands_) / binHz;
+				BandMap& m = map_[b];
+				m.lo = std::min((int) std::ceil(lo), last);
+				m.hi = std::min((int) std::ceil(hi), last + 1);
+				m.frac = 0.0f;
+				if (m.hi <= m.lo) {
+					const float centre = std::fmin(bandHz(b) / binHz, (float) last - 1.0f);
+					m.lo = (int) centre;
+					m.hi = m.lo;
+					m.frac = centre - m.lo;
+				}
+			}
+		}
+
+		void run() {
+			auto next = std::chrono::steady_clock::now();
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (running_) {
+				next = std::max(next + interval_, std::chrono::steady_clock::now());
+				if (wakeup_.wait_until(lock, next, [this] { return !running_; })) break;
+				lock.unlock();
+				analyse();
+				lock.lock();
+			}
+		}
+
+		Fft fft_;
+		int numBands_;
+		float minHz_, maxHz_;
+		std::atomic<float> sampleRate_{48000.0f};
+		std::vector<std::unique_ptr<Channel>> channels_;
+
+		// the worker's
+		float mappedRate_ = 0.0f;
+		float scale_;
+		float fallDb_ = 2.0f;
+		std::vector<BandMap> map_;
+		std::vector<float> window_, frame_, re_, im_, power_, bands_;
+
+		std::thread worker_;
+		std::mutex mutex_;
+		std::condition_variable wakeup_;
+		bool running_ = false;
+		std::chrono::microseconds interval_{33333};
+	};
+
+};
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_STATE_H_INCLUDED
+#define PERCUSSA_STATE_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace Percussa {
+namespace SSP {
+
+	// hands decoded state snapshots from the thread calling prepareState()
+	// over to the audio callback, see PluginInterface::prepareState().
+	//
+	//	bool prepareState(const void* buffer, size_t size) override {
+	//		MySnapshot snapshot;
+	//		if (!decode(buffer, size, snapshot)) return false;
+	//		staged_.stage(std::move(snapshot));
+	//		return true;
+	//	}
+	//
+	//	void process(float** channelData, int numChannels, int numSamples) override {
+	//		staged_.apply([this](const MySnapshot& s) { ... copy s into the DSP state ... });
+	//		...
+	//	}
+	//
+	// the audio callback never allocates or frees memory here: snapshots it
+	// has applied are put on a lock-free list, and freed by the next call to
+	// stage() or collect(), or by the destructor.
+	template <typename T>
+	class StagedState
+	{
+	public:
+		StagedState() {}
+
+		~StagedState() {
+			delete pending_.load();
+			collect();
+		}
+
+		// called from the background thread. a snapshot which is staged, but
+		// not applied yet, is replaced.
+		void stage(T&& snapshot) {
+			collect();
+			Node* node = new Node{std::move(snapshot), nullptr};
+			delete pending_.exchange(node, std::memory_order_acq_rel);
+		}
+
+		// called from the audio callback, at the start of a block. if a
+		// snapshot is pending, fn is called with it, and true is returned.
+		template <typename F>
+		bool apply(F fn) {
+			if (!pending_.load(std::memory_order_relaxed)) return false;
+			Node* node = pending_.exchange(nullptr, std::memory_order_acq_rel);
+			if (!node) return false;
+
+			fn(static_cast<const T&>(node->value));
+
+			Node* head = retired_.load(std::memory_order_relaxed);
+			do {
+				node->next = head;
+			} while (!retired_.compare_exchange_weak(head, node,
+				std::memory_order_release, std::memory_order_relaxed));
+			return true;
+		}
+
+		// true if a snapshot is waiting to be applied
+		bool pending() const { return pending_.load(std::memory_order_acquire) != nullptr; }
+
+		// frees applied snapshots, called from any thread except the audio callback.
+		void collect() {
+			Node* node = retired_.exchange(nullptr, std::memory_order_acquire);
+			while (node) {
+				Node* next = node->next;
+				delete node;
+				node = next;
+			}
+		}
+
+	private:
+		struct Node
+		{
+			T value;
+			Node* next;
+		};
+
+		std::atomic<Node*> pending_{nullptr};
+		std::atomic<Node*> retired_{nullptr};
+
+		StagedState(const StagedState&) = delete;
+		StagedState& operator=(const StagedState&) = delete;
+	};
+
+	// a delta of a state made of float values (see ValueVersions below):
+	// a header, followed by count records of the values that changed
+	struct ValueDeltaHeader
+	{
+		static constexpr uint32_t MAGIC = 0x314C4456; // "VDL1"
+		uint32_t magic;
+		uint32_t count;
+	};
+
+	struct ValueDeltaRecord
+	{
+		uint32_t index;
+		float value;
+	};
+
+	// stateVersion(), getStateDelta() and applyStateDelta() for plugins whose
+	// state is nothing but a number of float values, e.g. their parameters.
+	//
+	//	void parameterChanged(...) { versions_.changed(); }   // any thread
+	//	uint64_t stateVersion() override { return versions_.version(); }
+	//	void getState(void** buffer, size_t* size) override {
+	//		versions_.saved(getValue);
+	//		... serialise the values ...
+	//	}
+	//	bool getStateDelta(uint64_t since, void** buffer, size_t* size, uint64_t* version) override {
+	//		return versions_.delta(since, getValue, buffer, size, version);
+	//	}
+	//	bool applyStateDelta(const void* buffer, size_t size) override {
+	//		return versions_.apply(buffer, size, setValue);
+	//	}
+	//
+	// where getValue is a float(size_t index) and setValue a void(size_t index,
+	// float value) function. changed() can be called from any thread, the
+	// audio thread included, the rest from the UI thread.
+	//
+	// the version only counts changes, a delta compares the values with those
+	// of the last getState() or getStateDelta() (the baseline). so there only
+	// is a delta from the last version handed out, which is what a host saving
+	// periodically asks for, it falls back to getState() for older versions.
+	class ValueVersions
+	{
+	public:
+		explicit ValueVersions(size_t numValues) : baseline_(numValues) {}
+
+		size_t numValues() const { return baseline_.size(); }
+
+		// any thread, after a value was changed
+		void changed() { version_.fetch_add(1, std::memory_order_release); }
+
+		uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+		// UI thread, from getState(), before the values are serialised
+		template <typename F>
+		void saved(F getValue) {
+			baselineVersion_ = version();
+			for (size_t i = 0; i < baseline_.size(); i++) baseline_[i] = getValue(i);
+		}
+
+		// UI thread, the values which changed since version since, allocated
+		// with new char[...] as for getState(). false if since is not the
+		// version of the baseline.
+		template <typename F>
+		bool delta(uint64_t since, F getValue, void** buffer, size_t* size, uint64_t* version) {
+			if (since != baselineVersion_) return false;
+			// the version is read first, a change after it is seen again next time
+			const uint64_t now = this->version();
+			char* data = new char[sizeof(ValueDeltaHeader) + baseline_.size() * sizeof(ValueDeltaRecord)];
+			char* out = data + sizeof(ValueDeltaHeader);
+			uint32_t count = 0;
+			for (size_t i = 0; i < baseline_.size(); i++) {
+				const float value = getValue(i);
+				if (value == baseline_[i]) continue;
+				const ValueDeltaRecord record{(uint32_t) i, value};
+				memcpy(out, &record, sizeof(record));
+				out += sizeof(record);
+				baseline_[i] = value;
+				count++;
+			}
+			const ValueDeltaHeader header{ValueDeltaHeader::MAGIC, count};
+			memcpy(data, &header, sizeof(header));
+			*size = (size_t) (out - data);
+			baselineVersion_ = now;
+			*buffer = data;
+			*version = now;
+			return true;
+		}
+
+		// UI thread, calls setValue for each value of a delta. false, without
+		// calling it, if the delta is malformed or holds an unknown index.
+		template <typename F>
+		bool apply(const void* buffer, size_t size, F setValue) const {
+			ValueDeltaHeader header;
+			if (!buffer || size < sizeof(header)) return false;
+			memcpy(&header, buffer, sizeof(header));
+			if (header.magic != ValueDeltaHeader::MAGIC
+				|| size != sizeof(header) + (size_t) header.count * sizeof(ValueDeltaRecord)) {
+				return false;
+			}
+			const char* in = static_cast<const char*>(buffer) + sizeof(header);
+			for (uint32_t i = 0; i < header.count; i++) {
+				ValueDeltaRecord record;
+				memcpy(&record, in + i * sizeof(record), sizeof(record));
+				if (record.index >= baseline_.size()) return false;
+			}
+			for (uint32_t i = 0; i < header.count; i++) {
+				ValueDeltaRecord record;
+				memcpy(&record, in + i * sizeof(record), sizeof(record));
+				setValue((size_t) record.index, record.value);
+			}
+			return true;
+		}
+
+	private:
+		std::atomic<uint64_t> version_{1};
+		// UI thread
+		std::vector<float> baseline_;
+		uint64_t baselineVersion_ = 0;
+
+		ValueVersions(const ValueVersions&) = delete;
+		ValueVersions& operator=(const ValueVersions&) = delete;
+	};
+};
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PERCUSSA_STATS_H_INCLUDED
+#define PERCUSSA_STATS_H_INCLUDED
+
+#include <time.h>
+#include "Percussa.h"
+
+namespace Percussa {
+namespace SSP {
+
+	// helper which keeps the PluginStats counters of a plugin instance up to
+	// date. call prepare() from your prepare() implementation, and put a
+	// StatsRecorder::Scope on the stack at the top of process():
+	//
+	//	void process(float** channelData, int numChannels, int numSamples) override {
+	//		Percussa::SSP::StatsRecorder::Scope scope(stats_, numSamples);
+	//		...
+	//	}
+	//
+	//	Percussa::SSP::PluginStats* getStats() override { return stats_.stats(); }
+	//
+	// the audio thread writes the counters, so they are updated with plain
+	// atomic loads and stores, no read-modify-write operations are used. the
+	// one exception is the host restarting nsPerBlockMax with a 0 (see
+	// PluginStats in Percussa.h): a block ending at that moment may store its
+	// time over the 0, so the new maximum counts that block too.
+	//
+	// call skipped() for the samples process() did not compute on a fast path.
+	class StatsRecorder
+	{
+	public:
+		// the average is updated as avg += (t - avg) / 2^ewmaShift
+		static constexpr unsigned ewmaShift = 4;
+
+		// called from the UI thread, before process() starts being called,
+		// with the arguments of prepare(). the block size is not needed.
+		void prepare(double sampleRate, int) {
+			nsPerSample_ = sampleRate > 0.0 ? 1e9 / sampleRate : 0.0;
+		}
+
+		// called from the audio callback, when process() takes a fast path
+		// and numSamples samples did not have to be computed.
+		void skipped(int numSamples) {
+			stats_.samplesSkipped.store(
+				stats_.samplesSkipped.load(std::memory_order_relaxed) + numSamples,
+				std::memory_order_relaxed);
+		}
+
+		PluginStats* stats() { return &stats_; }
+
+		class Scope
+		{
+		public:
+			Scope(StatsRecorder& recorder, int numSamples)
+				: recorder_(recorder), numSamples_(numSamples), start_(now()) {}
+
+			~Scope() { recorder_.record(now() - start_, numSamples_); }
+
+		private:
+			StatsRecorder& recorder_;
+			int numSamples_;
+			uint64_t start_;
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		};
+
+		static uint64_t now() {
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+		}
+
+	private:
+		void record(uint64_t ns, int numSamples) {
+			const uint32_t t = ns > 0xffffffffull ? 0xffffffffu : (uint32_t)ns;
+			const std::memory_order relaxed = std::memory_order_relaxed;
+
+			int64_t avg = stats_.nsPerBlockAvg.load(relaxed);
+			if (stats_.blocksProcessed.load(relaxed) == 0) avg = t;
+			else avg += ((int64_t)t - avg) / (1 << ewmaShift);
+			stats_.nsPerBlockAvg.store((uint32_t)avg, relaxed);
+
+			if (t > stats_.nsPerBlockMax.load(relaxed)) stats_.nsPerBlockMax.store(t, relaxed);
+
+			if (nsPerSample_ > 0.0 && t > numSamples * nsPerSample_) {
+				stats_.overruns.store(stats_.overruns.load(relaxed) + 1, relaxed);
+			}
+
+			stats_.blocksProcessed.store(stats_.blocksProcessed.load(relaxed) + 1, relaxed);
+		}
+
+		PluginStats stats_;
+		double nsPerSample_ = 0.0;
+	};
+};
+};
+
+#endif
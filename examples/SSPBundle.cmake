@@ -0,0 +1,37 @@
+# plugins built on their own, and bundled into one shared object (see PercussaBundle.h)
+#
+#   include(SSPBundle.cmake)
+#   ssp_add_plugin(vco Source/Vco.cpp)
+#   ssp_add_plugin(vcf Source/Vcf.cpp)
+#   ssp_add_bundle(analog vco vcf)
+#
+# ssp_add_plugin(<name> <sources>...) adds the plugin as <name> (lib<name>.so), and
+# its objects for bundles as <name>_bundled, compiled with SSP_BUNDLE=1. set compile
+# options and libraries on both targets.
+# ssp_add_bundle(<name> <plugins>...) links the plugins' objects into lib<name>.so,
+# which exports them all (SSP_BUNDLE_EXPORT()), numbered in the order of their uids.
+# both are optimised according to SSP_LTO and SSP_PGO (see SSPOptimise.cmake).
+
+include(${CMAKE_CURRENT_LIST_DIR}/SSPOptimise.cmake)
+
+set(SSP_BUNDLE_SOURCE ${CMAKE_CURRENT_LIST_DIR}/SSPBundle.cpp)
+set(SSP_SDK_DIR ${CMAKE_CURRENT_LIST_DIR}/..)
+
+function(ssp_add_plugin name)
+    add_library(${name} SHARED ${ARGN})
+    add_library(${name}_bundled OBJECT ${ARGN})
+    target_include_directories(${name} PRIVATE ${SSP_SDK_DIR})
+    target_include_directories(${name}_bundled PRIVATE ${SSP_SDK_DIR})
+    set_target_properties(${name}_bundled PROPERTIES POSITION_INDEPENDENT_CODE ON)
+    target_compile_definitions(${name}_bundled PRIVATE SSP_BUNDLE=1)
+    ssp_optimise(${name} LIBRARIES ${name}_bundled)
+endfunction()
+
+function(ssp_add_bundle name)
+    add_library(${name} SHARED ${SSP_BUNDLE_SOURCE})
+    target_include_directories(${name} PRIVATE ${SSP_SDK_DIR})
+    foreach (plugin IN LISTS ARGN)
+        target_link_libraries(${name} PRIVATE ${plugin}_bundled)
+    endforeach ()
+    ssp_optimise(${name})
+endfunction()
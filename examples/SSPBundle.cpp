@@ -0,0 +1,5 @@
+// exports the plugins of a bundle, see SSPBundle.cmake
+
+#include <PercussaBundle.h>
+
+SSP_BUNDLE_EXPORT()
@@ -0,0 +1,107 @@
+# link time and profile guided optimisation of plugins
+#
+#   include(SSPOptimise.cmake)
+#   ssp_optimise(MyPlugin LIBRARIES MyPluginCode)
+#
+# ssp_optimise(<plugin> [LIBRARIES <targets>...]) compiles the plugin, and the
+# static libraries linked into it, according to these cache variables. the
+# sources of INTERFACE libraries, like ssp_adapter, are compiled into the
+# targets linking them, INTERFACE libraries themselves are skipped.
+#
+#   SSP_LTO=ON          link time optimisation, and -fno-semantic-interposition
+#                       (with SSP_PGO too), so calls within the plugin are not
+#                       made through the PLT, and can be inlined
+#   SSP_PGO=GENERATE    instrumented build, running it writes profiles into
+#                       SSP_PGO_DIR (clang: *.profraw, gcc: *.gcda)
+#   SSP_PGO=USE         optimised with the profiles of SSP_PGO_DIR (clang: merge
+#                       them into ssp.profdata with llvm-profdata first), and LTO
+#
+# the file of every plugin is listed in <build>/ssp-plugins/<plugin>.path, for
+# the workloads of pgo.sh, which runs the whole pipeline (see BUILDING.md).
+# plugins added with ssp_add_plugin() and ssp_add_bundle() are optimised already.
+
+include_guard(GLOBAL)
+
+option(SSP_LTO "link time optimisation of plugins" OFF)
+set(SSP_PGO OFF CACHE STRING "profile guided optimisation of plugins: OFF, GENERATE or USE")
+set_property(CACHE SSP_PGO PROPERTY STRINGS OFF GENERATE USE)
+set(SSP_PGO_DIR ${CMAKE_BINARY_DIR}/ssp-profile CACHE PATH "profiles of SSP_PGO builds")
+
+if (NOT SSP_PGO MATCHES "^(OFF|GENERATE|USE)$")
+    message(FATAL_ERROR "SSP_PGO must be OFF, GENERATE or USE, not ${SSP_PGO}")
+endif ()
+
+set(SSP_OPTIMISE_COMPILE)
+set(SSP_OPTIMISE_LINK)
+set(SSP_OPTIMISE_LTO ${SSP_LTO})
+
+# in the instrumented build too, gcc inlines differently with it, and the
+# profiles would not match the code of the USE build
+if (SSP_LTO OR NOT SSP_PGO STREQUAL "OFF")
+    list(APPEND SSP_OPTIMISE_COMPILE -fno-semantic-interposition)
+endif ()
+
+if (SSP_PGO STREQUAL "GENERATE")
+    file(MAKE_DIRECTORY ${SSP_PGO_DIR})
+    if (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        # %m merges the profiles of all runs of the same plugin
+        list(APPEND SSP_OPTIMISE_COMPILE -fprofile-generate=${SSP_PGO_DIR})
+        list(APPEND SSP_OPTIMISE_LINK -fprofile-generate=${SSP_PGO_DIR})
+    else ()
+        # the audio and UI threads update the counters at the same time. the
+        # profiles are named after the objects relative to the build directory,
+        # so the USE build, in another directory, finds them.
+        list(APPEND SSP_OPTIMISE_COMPILE -fprofile-generate=${SSP_PGO_DIR} -fprofile-update=atomic
+             -fprofile-prefix-path=${CMAKE_BINARY_DIR})
+        list(APPEND SSP_OPTIMISE_LINK -fprofile-generate=${SSP_PGO_DIR})
+    endif ()
+elseif (SSP_PGO STREQUAL "USE")
+    set(SSP_OPTIMISE_LTO ON)
+    if (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        if (NOT EXISTS ${SSP_PGO_DIR}/ssp.profdata)
+            message(FATAL_ERROR "no profile ${SSP_PGO_DIR}/ssp.profdata, run a SSP_PGO=GENERATE build, "
+                    "then llvm-profdata merge -output=${SSP_PGO_DIR}/ssp.profdata ${SSP_PGO_DIR}/*.profraw")
+        endif ()
+        list(APPEND SSP_OPTIMISE_COMPILE -fprofile-use=${SSP_PGO_DIR}/ssp.profdata -Wno-profile-instr-unprofiled)
+        list(APPEND SSP_OPTIMISE_LINK -fprofile-use=${SSP_PGO_DIR}/ssp.profdata)
+    else ()
+        # code the workloads did not run is still optimised for speed. code
+        # changed since the profiles were taken is optimised without them.
+        list(APPEND SSP_OPTIMISE_COMPILE -fprofile-use=${SSP_PGO_DIR} -fprofile-partial-training
+             -fprofile-prefix-path=${CMAKE_BINARY_DIR} -Wno-missing-profile -Wno-error=coverage-mismatch)
+        list(APPEND SSP_OPTIMISE_LINK -fprofile-use=${SSP_PGO_DIR})
+    endif ()
+endif ()
+
+if (SSP_OPTIMISE_LTO)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT SSP_IPO_SUPPORTED OUTPUT SSP_IPO_ERROR LANGUAGES CXX)
+    if (NOT SSP_IPO_SUPPORTED)
+        message(FATAL_ERROR "link time optimisation is not supported by the toolchain: ${SSP_IPO_ERROR}")
+    endif ()
+    if (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        # ThinLTO with the linker of the llvm installation, the system one may
+        # not load its plugin
+        get_filename_component(SSP_COMPILER_DIR ${CMAKE_CXX_COMPILER} DIRECTORY)
+        find_program(SSP_LLD ld.lld HINTS ${SSP_COMPILER_DIR})
+        if (SSP_LLD)
+            list(APPEND SSP_OPTIMISE_LINK -fuse-ld=lld)
+        endif ()
+    endif ()
+endif ()
+
+function(ssp_optimise plugin)
+    cmake_parse_arguments(ARG "" "" "LIBRARIES" ${ARGN})
+    foreach (target IN ITEMS ${plugin} ${ARG_LIBRARIES})
+        get_target_property(type ${target} TYPE)
+        if (type STREQUAL "INTERFACE_LIBRARY")
+            continue()
+        endif ()
+        target_compile_options(${target} PRIVATE ${SSP_OPTIMISE_COMPILE})
+        target_link_options(${target} PRIVATE ${SSP_OPTIMISE_LINK})
+        if (SSP_OPTIMISE_LTO)
+            set_target_properties(${target} PROPERTIES INTERPROCEDURAL_OPTIMIZATION ON)
+        endif ()
+    endforeach ()
+    file(GENERATE OUTPUT ${CMAKE_BINARY_DIR}/ssp-plugins/${plugin}.path CONTENT "$<TARGET_FILE:${plugin}>\n")
+endfunction()
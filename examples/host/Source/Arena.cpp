@@ -0,0 +1,45 @@
+// see header file for license
+
+#include "Arena.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+Arena::Arena(size_t capacity) : capacity_(capacity) {
+    void *p = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (p == MAP_FAILED) throw std::runtime_error("cannot map memory arena");
+    base_ = static_cast<char *>(p);
+
+    locked_ = mlock(base_, capacity_) == 0;
+    if (!locked_) fprintf(stderr, "warning: cannot lock memory arena, check ulimit -l\n");
+}
+
+Arena::~Arena() {
+    if (locked_) munlock(base_, capacity_);
+    munmap(base_, capacity_);
+}
+
+void *Arena::allocate(size_t size, size_t alignment) {
+    if (alignment < CACHE_LINE) alignment = CACHE_LINE;
+    if (alignment & (alignment - 1)) return nullptr;
+
+    // pad to whole cache lines, so blocks of different plugins never share one
+    size = (size + CACHE_LINE - 1) & ~(CACHE_LINE - 1);
+
+    size_t used = used_.load(std::memory_order_relaxed);
+    size_t offset;
+    do {
+        offset = (used + alignment - 1) & ~(alignment - 1);
+        if (offset + size > capacity_ || offset + size < offset) return nullptr;
+    } while (!used_.compare_exchange_weak(used, offset + size, std::memory_order_relaxed));
+
+    return base_ + offset;
+}
+
+void Arena::reset() {
+    memset(base_, 0, used_.load());
+    used_ = 0;
+}
@@ -0,0 +1,53 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <atomic>
+#include <cstddef>
+
+// reference implementation of Percussa::SSP::MemoryArena: a bump allocator
+// in one anonymous mapping, which is pre-faulted (MAP_POPULATE) and locked
+// in memory (mlock, if the memlock limit allows it).
+class Arena : public Percussa::SSP::MemoryArena {
+public:
+    static constexpr size_t CACHE_LINE = 64;
+
+    explicit Arena(size_t capacity);
+    ~Arena() override;
+
+    void *allocate(size_t size, size_t alignment = CACHE_LINE) override;
+
+    // frees all blocks at once, only call this when no plugin uses them anymore
+    void reset();
+
+    size_t capacity() const { return capacity_; }
+    size_t used() const { return used_.load(); }
+    bool locked() const { return locked_; }
+
+private:
+    char *base_ = nullptr;
+    size_t capacity_ = 0;
+    std::atomic<size_t> used_{0};
+    bool locked_ = false;
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+};
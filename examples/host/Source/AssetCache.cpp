@@ -0,0 +1,285 @@
+// see header file for license
+
+#include "AssetCache.h"
+#include "Trace.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+// two independent 64 bit lanes over alternate words, not cryptographic
+void hashContent(const void *data, size_t size, uint64_t hash[2]) {
+    const auto *p = static_cast<const unsigned char *>(data);
+    uint64_t a = 0x9e3779b97f4a7c15ull ^ size, b = 0xc2b2ae3d27d4eb4full + size;
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        uint64_t x, y;
+        memcpy(&x, p + i, 8);
+        memcpy(&y, p + i + 8, 8);
+        a = rotl(a ^ x, 29) * 0x9e3779b97f4a7c15ull;
+        b = rotl(b ^ y, 31) * 0xc2b2ae3d27d4eb4full;
+    }
+    uint64_t tail[2] = {0, 0};
+    memcpy(tail, p + i, size - i);
+    a = rotl(a ^ tail[0], 29) * 0x9e3779b97f4a7c15ull;
+    b = rotl(b ^ tail[1], 31) * 0xc2b2ae3d27d4eb4full;
+    hash[0] = mix(a);
+    hash[1] = mix(b ^ hash[0]);
+}
+
+// returns false unless size bytes could be read, e.g. the file was truncated
+bool readAll(int fd, void *data, size_t size) {
+    auto *p = static_cast<char *>(data);
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t) n;
+    }
+    return true;
+}
+
+}
+
+AssetCache::AssetCache() {
+    thread_ = std::thread(&AssetCache::run, this);
+}
+
+AssetCache::~AssetCache() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+
+    // references which were never released
+    for (Request *r: queue_) {
+        if (r->released) delete r;
+    }
+    for (auto &request: requests_) delete request.second;
+    for (auto &blob: blobs_) {
+        munmap(blob.second->data, blob.second->mapped);
+        delete blob.second;
+    }
+}
+
+const AssetCache::Asset *AssetCache::acquire(const char *path, const char *key, const Builder *builder) {
+    if (!path && !builder) return nullptr;
+    if (builder && (!builder->size || !builder->build)) return nullptr;
+
+    Identity identity(0, 0, -1, 0, key ? key : "");
+    if (path) {
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return nullptr;
+        const int64_t modified = (int64_t) st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        identity = Identity(st.st_dev, st.st_ino, st.st_size, modified, key ? key : "");
+    }
+
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = requests_.find(identity);
+    if (it != requests_.end()) {
+        it->second->references++;
+        return it->second;
+    }
+
+    auto *r = new Request;
+    r->identity = identity;
+    r->path = path ? path : "";
+    r->key = key ? key : "";
+    if (builder) {
+        r->builder = *builder;
+        r->hasBuilder = true;
+    }
+    r->references = 1;
+    requests_[identity] = r;
+    queue_.push_back(r);
+    wake_.notify_one();
+    return r;
+}
+
+void AssetCache::release(const Asset *asset) {
+    if (!asset) return;
+    auto *r = static_cast<Request *>(const_cast<Asset *>(asset));
+    std::lock_guard<std::mutex> lock(lock_);
+    if (--r->references > 0) return;
+
+    requests_.erase(r->identity);
+    if (r->status.load(std::memory_order_relaxed) == LOADING) {
+        // queued or being loaded, the loader deletes it
+        r->released = true;
+        return;
+    }
+    if (r->blob) unreference(r->blob);
+    delete r;
+}
+
+void AssetCache::unreference(Blob *blob) {
+    if (--blob->references > 0) return;
+    auto range = blobs_.equal_range(blob->hash[0]);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == blob) {
+            blobs_.erase(it);
+            break;
+        }
+    }
+    munmap(blob->data, blob->mapped);
+    delete blob;
+}
+
+void AssetCache::wait() {
+    std::unique_lock<std::mutex> lock(lock_);
+    idle_.wait(lock, [this] { return queue_.empty() && !loading_; });
+}
+
+int AssetCache::numAssets() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return (int) blobs_.size();
+}
+
+size_t AssetCache::mappedBytes() {
+    std::lock_guard<std::mutex> lock(lock_);
+    size_t bytes = 0;
+    for (auto &blob: blobs_) bytes += blob.second->size;
+    return bytes;
+}
+
+size_t AssetCache::referencedBytes() {
+    std::lock_guard<std::mutex> lock(lock_);
+    size_t bytes = 0;
+    for (auto &request: requests_) {
+        if (request.second->blob) bytes += request.second->references * request.second->blob->size;
+    }
+    return bytes;
+}
+
+void AssetCache::load(Request &r) {
+    // a copy of the file in an anonymous mapping, not a mapping of the file:
+    // rewriting the file would change an asset in use, and truncating it
+    // would make reading the asset fault (SIGBUS) on the audio thread
+    void *source = nullptr;
+    size_t sourceSize = 0;
+    uint64_t hash[2] = {0, 0};
+    bool ok = true;
+    if (!r.path.empty()) {
+        int fd = open(r.path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        ok = fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0;
+        if (ok) {
+            sourceSize = (size_t) st.st_size;
+            source = mmap(nullptr, sourceSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            ok = source != MAP_FAILED;
+            if (!ok) source = nullptr;
+        }
+        if (ok) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            ok = readAll(fd, source, sourceSize);
+        }
+        if (fd >= 0) close(fd);
+        if (ok) hashContent(source, sourceSize, hash);
+    }
+
+    // an asset with the same content and key
+    if (ok) {
+        std::lock_guard<std::mutex> lock(lock_);
+        auto range = blobs_.equal_range(hash[0]);
+        for (auto it = range.first; it != range.second && !r.released; ++it) {
+            Blob *b = it->second;
+            if (b->hash[1] != hash[1] || b->sourceSize != sourceSize || b->key != r.key) continue;
+            if (!r.hasBuilder && memcmp(b->data, source, sourceSize) != 0) continue;
+            b->references++;
+            r.blob = b;
+            r.data = b->data;
+            r.size = b->size;
+            r.status.store(READY, std::memory_order_release);
+            break;
+        }
+        if (r.blob || r.released) {
+            if (source) munmap(source, sourceSize);
+            if (r.released) delete &r;
+            return;
+        }
+    }
+
+    // a new one, the copy of the file, or built into a mapping of its own,
+    // read-only either way
+    auto *b = new Blob;
+    if (ok && !r.hasBuilder) {
+        mprotect(source, sourceSize, PROT_READ);
+        b->data = source;
+        b->size = b->mapped = sourceSize;
+        source = nullptr;
+    } else if (ok) {
+        const size_t size = r.builder.size(r.key.c_str(), source, sourceSize);
+        void *data = size ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                          : MAP_FAILED;
+        ok = data != MAP_FAILED && r.builder.build(r.key.c_str(), source, sourceSize, data, size);
+        if (data != MAP_FAILED) {
+            if (ok) mprotect(data, size, PROT_READ);
+            else munmap(data, size);
+        }
+        if (ok) {
+            b->data = data;
+            b->size = b->mapped = size;
+        }
+    }
+    if (source) munmap(source, sourceSize);
+
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!ok || r.released) {
+        if (b->data) munmap(b->data, b->mapped);
+        delete b;
+        if (r.released) delete &r;
+        else r.status.store(FAILED, std::memory_order_release);
+        return;
+    }
+    memcpy(b->hash, hash, sizeof(hash));
+    b->sourceSize = sourceSize;
+    b->key = r.key;
+    b->references = 1;
+    blobs_.insert({hash[0], b});
+    r.blob = b;
+    r.data = b->data;
+    r.size = b->size;
+    r.status.store(READY, std::memory_order_release);
+}
+
+void AssetCache::run() {
+    Trace::registerThread("assets");
+
+    std::unique_lock<std::mutex> lock(lock_);
+    for (;;) {
+        wake_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+        if (quit_) break;
+        Request *r = queue_.front();
+        queue_.pop_front();
+        if (r->released) {
+            delete r;
+        } else {
+            loading_ = true;
+            lock.unlock();
+            load(*r);
+            lock.lock();
+            loading_ = false;
+        }
+        if (queue_.empty()) idle_.notify_all();
+    }
+}
@@ -0,0 +1,105 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <tuple>
+
+// reference implementation of Percussa::SSP::AssetStore.
+// acquire() looks a request up by the identity of its file (device, inode,
+// size and modification time) and key, which needs only a stat(), and queues
+// new ones for the loader thread. the loader reads the file into an anonymous
+// mapping, hashes its content (128 bits) and looks the asset up by content
+// hash, size and key: the first request for it keeps that copy as the asset,
+// or builds the asset into an anonymous mapping of its own, either is made
+// read-only, later ones share it. so one asset can be referenced through
+// several requests (different paths to the same content), and is unmapped
+// with the last one. assets never map the file itself, rewriting or
+// truncating it does not change them.
+class AssetCache : public Percussa::SSP::AssetStore {
+public:
+    AssetCache();
+    ~AssetCache() override;
+
+    const Asset *acquire(const char *path, const char *key, const Builder *builder) override;
+    void release(const Asset *asset) override;
+
+    // blocks until every acquired asset is loaded (or failed)
+    void wait();
+
+    // the loader thread, e.g. to set its priority
+    std::thread &thread() { return thread_; }
+
+    // assets in memory, their size, and what all references would take if
+    // each had its own copy
+    int numAssets();
+    size_t mappedBytes();
+    size_t referencedBytes();
+
+private:
+    struct Blob {
+        uint64_t hash[2] = {0, 0};
+        size_t sourceSize = 0;
+        std::string key;
+        void *data = nullptr;
+        size_t size = 0;
+        size_t mapped = 0;
+        int references = 0;
+    };
+
+    // identity of a request, device, inode, size, modification time and key
+    using Identity = std::tuple<dev_t, ino_t, off_t, int64_t, std::string>;
+
+    struct Request : Asset {
+        Identity identity;
+        std::string path;
+        std::string key;
+        Builder builder = {nullptr, nullptr};
+        bool hasBuilder = false;
+        int references = 0;
+        bool released = false;
+        Blob *blob = nullptr;
+    };
+
+    void load(Request &r);
+    void unreference(Blob *blob);
+    void run();
+
+    std::mutex lock_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::map<Identity, Request *> requests_;
+    std::multimap<uint64_t, Blob *> blobs_;
+    std::deque<Request *> queue_;
+    bool loading_ = false;
+    bool quit_ = false;
+    std::thread thread_;
+
+    AssetCache(const AssetCache &) = delete;
+    AssetCache &operator=(const AssetCache &) = delete;
+};
@@ -0,0 +1,108 @@
+// see header file for license
+
+#include "AudioThread.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <cstdio>
+#include <pthread.h>
+
+void addNs(struct timespec &ts, uint64_t ns) {
+    ns += ts.tv_nsec;
+    ts.tv_sec += ns / 1000000000ull;
+    ts.tv_nsec = ns % 1000000000ull;
+}
+
+namespace {
+
+// a - b, 0 if a is earlier
+uint64_t diffNs(const struct timespec &a, const struct timespec &b) {
+    const int64_t ns = (int64_t) (a.tv_sec - b.tv_sec) * 1000000000ll + (a.tv_nsec - b.tv_nsec);
+    return ns > 0 ? (uint64_t) ns : 0;
+}
+
+}
+
+AudioThread::AudioThread(double sampleRate, int blockSize, std::vector<Module *> modules) :
+    sampleRate_(sampleRate), blockSize_(blockSize), modules_(std::move(modules)) {
+}
+
+AudioThread::~AudioThread() {
+    stop();
+}
+
+void AudioThread::start() {
+    if (running_) return;
+    running_ = true;
+    thread_ = std::thread(&AudioThread::run, this);
+}
+
+void AudioThread::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+}
+
+void AudioThread::run() {
+    Trace::registerThread("audio");
+
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        fprintf(stderr, "warning: cannot make audio thread real-time, running with default priority\n");
+    }
+
+    skip_.assign(modules_.size(), 0);
+    int blockSize = blockSize_;
+    uint64_t block = 0;
+    uint64_t position = 0;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (running_.load(std::memory_order_relaxed)) {
+        struct timespec woke = {0, 0};
+        if (timing_) clock_gettime(CLOCK_MONOTONIC, &woke);
+        const struct timespec due = next;
+        int n = blockSizes_.empty() ? blockSize_ : blockSizes_[block % blockSizes_.size()];
+        addNs(next, (uint64_t) (n * 1e9 / sampleRate_));
+        {
+            Trace::Scope scope("audioCallback");
+            if (n != blockSize) {
+                // every module still runs at the size it was prepared with
+                for (size_t k = 0; k < modules_.size(); k++) {
+                    skip_[k] = !modules_[k]->reconfigure(sampleRate_, n) && n != blockSize_;
+                    if (skip_[k]) refused_.fetch_add(1, std::memory_order_relaxed);
+                }
+                reconfigurations_.fetch_add(1, std::memory_order_relaxed);
+                blockSize = n;
+            }
+
+            if (callback_) callback_(block);
+
+            for (size_t k = 0; k < modules_.size(); k++) {
+                Module *m = modules_[k];
+                if (skip_[k]) continue;
+                // test signal, a different sine on each input
+                for (int ch = 0; ch < m->numInputs(); ch++) {
+                    float *data = m->channel(ch);
+                    double w = 2.0 * M_PI * 55.0 * (ch + 1) / sampleRate_;
+                    for (int i = 0; i < n; i++) {
+                        data[i] = (float) sin(w * (double) (position + i));
+                    }
+                }
+                m->process(n);
+            }
+        }
+        position += n;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (timing_) timing_(block, n, diffNs(woke, due), diffNs(now, due));
+        if (now.tv_sec > next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec)) {
+            xruns_.fetch_add(1, std::memory_order_relaxed);
+            next = now;
+        }
+        block++;
+        blocks_.store(block, std::memory_order_relaxed);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+    }
+}
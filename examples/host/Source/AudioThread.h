@@ -0,0 +1,86 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include "PluginHost.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+// simulated audio callback: a real-time thread (if permitted) which calls
+// process() on all modules once every blockSize / sampleRate seconds,
+// with a test signal on the module inputs. a block which finishes after its
+// deadline counts as an xrun.
+class AudioThread {
+public:
+    // called on the audio thread at the start of every block, before the
+    // modules are processed, e.g. to send encoder events.
+    using BlockCallback = std::function<void(uint64_t block)>;
+
+    AudioThread(double sampleRate, int blockSize, std::vector<Module *> modules);
+    ~AudioThread();
+
+    // called on the audio thread at the end of every block, with the times
+    // at which the thread woke up for it and finished it, relative to the
+    // time the block was due to start. it is late when doneNs is over
+    // numSamples / sampleRate. e.g. to record the jitter of the callback.
+    using TimingCallback = std::function<void(uint64_t block, int numSamples, uint64_t wakeNs, uint64_t doneNs)>;
+
+    void setBlockCallback(BlockCallback callback) { callback_ = std::move(callback); }
+    // call before start()
+    void setTimingCallback(TimingCallback callback) { timing_ = std::move(callback); }
+
+    // process blocks of these sizes (at most the blockSize the modules were
+    // prepared with) in turn, switching the modules with Module::reconfigure()
+    // between blocks. a module refusing a switch is not processed until the
+    // size is back at blockSize, a real host would have to stop it and prepare
+    // it again. call before start().
+    void setBlockSizes(std::vector<int> sizes) { blockSizes_ = std::move(sizes); }
+
+    void start();
+    void stop();
+
+    // the audio thread, e.g. to set its affinity, after start()
+    std::thread &thread() { return thread_; }
+
+    uint64_t blocks() const { return blocks_.load(); }
+    uint64_t xruns() const { return xruns_.load(); }
+    uint64_t reconfigurations() const { return reconfigurations_.load(); }
+    uint64_t refused() const { return refused_.load(); }
+
+private:
+    void run();
+
+    double sampleRate_;
+    int blockSize_;
+    std::vector<Module *> modules_;
+    BlockCallback callback_;
+    TimingCallback timing_;
+    std::vector<int> blockSizes_;
+    std::vector<char> skip_;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> xruns_{0};
+    std::atomic<uint64_t> reconfigurations_{0};
+    std::atomic<uint64_t> refused_{0};
+    std::thread thread_;
+};
+
+void addNs(struct timespec &ts, uint64_t ns);
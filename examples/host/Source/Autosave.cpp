@@ -0,0 +1,210 @@
+// see header file for license
+
+#include "Autosave.h"
+#include "PresetBank.h"
+#include "Trace.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace AutosaveFormat;
+
+namespace {
+
+uint32_t recordChecksum(const Record &record, const void *payload) {
+    Record r = record;
+    r.checksum = 0;
+    uint32_t crc = PresetBankFormat::crc32(&r, sizeof(r));
+    return PresetBankFormat::crc32(payload, record.size, crc);
+}
+
+void apply(std::map<int, Autosave::Recovered> &patch, const Record &record, std::vector<char> &payload) {
+    if (record.type == STATE) {
+        Autosave::Recovered &r = patch[record.module];
+        r.uid = record.uid;
+        r.state.swap(payload);
+        r.deltas.clear();
+    } else if (record.type == DELTA) {
+        patch[record.module].deltas.push_back(std::move(payload));
+    } else if (record.type == REMOVED) {
+        patch.erase(record.module);
+    }
+}
+
+void writeHeader(FILE *f) {
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    fwrite(&header, sizeof(header), 1, f);
+}
+
+}
+
+Autosave::Autosave(const std::string &path, size_t compactBytes) : path_(path), compactBytes_(compactBytes) {
+    open(path);
+}
+
+Autosave::~Autosave() {
+    if (file_) fclose(file_);
+}
+
+void Autosave::open(const std::string &path) {
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) throw std::runtime_error("cannot write autosave journal " + path);
+    writeHeader(file_);
+    sync(file_, path);
+    size_ = sizeof(Header);
+    saved_.clear();
+}
+
+void Autosave::append(FILE *f, RecordType type, int module, int uid,
+                      uint64_t stateVersion, const std::vector<char> &payload) {
+    Record record{};
+    record.type = type;
+    record.module = module;
+    record.uid = uid;
+    record.stateVersion = stateVersion;
+    record.size = payload.size();
+    record.checksum = recordChecksum(record, payload.data());
+    fwrite(&record, sizeof(record), 1, f);
+    if (!payload.empty()) fwrite(payload.data(), 1, payload.size(), f);
+    size_ += sizeof(record) + payload.size();
+}
+
+void Autosave::sync(FILE *f, const std::string &path) {
+    if (fflush(f) != 0 || ferror(f) || fdatasync(fileno(f)) != 0) {
+        throw std::runtime_error("cannot write autosave journal " + path);
+    }
+}
+
+Autosave::Result Autosave::save(const std::vector<Module *> &modules) {
+    Trace::Scope scope("autosave");
+    Result result;
+    if (size_ >= compactBytes_) {
+        compact(modules);
+        result.states = (int) modules.size();
+        result.bytes = size_;
+        result.compacted = true;
+        return result;
+    }
+
+    const size_t start = size_;
+    std::map<int, Saved> saved;
+    for (Module *m: modules) {
+        const int uid = m->descriptor().uid;
+        // read before the state, a change while it is saved shows next time
+        const uint64_t version = m->stateVersion();
+        auto it = saved_.find(m->id());
+        const bool known = it != saved_.end() && it->second.uid == uid && version != 0;
+        if (known && it->second.stateVersion == version) {
+            saved[m->id()] = it->second;
+            result.skipped++;
+            continue;
+        }
+        std::vector<char> delta;
+        uint64_t deltaVersion = 0;
+        if (known && m->getStateDelta(it->second.stateVersion, delta, deltaVersion)) {
+            append(file_, DELTA, m->id(), uid, deltaVersion, delta);
+            saved[m->id()] = Saved{uid, deltaVersion};
+            result.deltas++;
+        } else {
+            append(file_, STATE, m->id(), uid, version, m->getState());
+            saved[m->id()] = Saved{uid, version};
+            result.states++;
+        }
+    }
+    for (auto &s: saved_) {
+        if (!saved.count(s.first)) append(file_, REMOVED, s.first, s.second.uid, 0, {});
+    }
+    if (size_ != start) {
+        append(file_, END, 0, 0, 0, {});
+        sync(file_, path_);
+    }
+    saved_.swap(saved);
+    result.bytes = size_ - start;
+    return result;
+}
+
+void Autosave::compact(const std::vector<Module *> &modules) {
+    const std::string temp = path_ + ".tmp";
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot write autosave journal " + temp);
+    writeHeader(f);
+    size_ = sizeof(Header);
+    std::map<int, Saved> saved;
+    for (Module *m: modules) {
+        const int uid = m->descriptor().uid;
+        const uint64_t version = m->stateVersion();
+        append(f, STATE, m->id(), uid, version, m->getState());
+        saved[m->id()] = Saved{uid, version};
+    }
+    append(f, END, 0, 0, 0, {});
+    try {
+        sync(f, temp);
+    } catch (...) {
+        fclose(f);
+        unlink(temp.c_str());
+        throw;
+    }
+    if (rename(temp.c_str(), path_.c_str()) != 0) {
+        fclose(f);
+        unlink(temp.c_str());
+        throw std::runtime_error("cannot write autosave journal " + path_);
+    }
+    fclose(file_);
+    file_ = f;
+    saved_.swap(saved);
+}
+
+std::map<int, Autosave::Recovered> Autosave::recover(const std::string &path) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) throw std::runtime_error("cannot open autosave journal " + path);
+    Header header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        || header.version != VERSION) {
+        fclose(f);
+        throw std::runtime_error("not an autosave journal: " + path);
+    }
+
+    // the records of the save being read are applied to patch at its END.
+    // uids has the plugin of every module as of the last record read, to
+    // check that deltas apply to it.
+    std::map<int, Recovered> patch;
+    std::vector<std::pair<Record, std::vector<char>>> pending;
+    std::map<int, int> uids;
+    Record record;
+    while (fread(&record, sizeof(record), 1, f) == 1) {
+        // an absurd size is a damaged record too, fread() fails on a short one
+        if (record.size > (1ull << 32)) break;
+        std::vector<char> payload(record.size);
+        if (record.size && fread(payload.data(), 1, record.size, f) != record.size) break;
+        if (recordChecksum(record, payload.data()) != record.checksum) break;
+
+        if (record.type == STATE) {
+            uids[record.module] = record.uid;
+        } else if (record.type == DELTA) {
+            auto it = uids.find(record.module);
+            if (it == uids.end() || it->second != record.uid) break;
+        } else if (record.type == REMOVED) {
+            uids.erase(record.module);
+        } else if (record.type == END) {
+            for (auto &p: pending) apply(patch, p.first, p.second);
+            pending.clear();
+            continue;
+        } else {
+            break;
+        }
+        pending.emplace_back(record, std::move(payload));
+    }
+    fclose(f);
+    return patch;
+}
+
+bool Autosave::restore(Module &module, const Recovered &recovered) {
+    module.setState(recovered.state);
+    for (const auto &delta: recovered.deltas) {
+        if (!module.applyStateDelta(delta)) return false;
+    }
+    return true;
+}
@@ -0,0 +1,136 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include "PluginHost.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// periodic autosave of a patch into an append-only journal. save() asks
+// every module for its state version (API 3.14), skips the modules which did
+// not change since the last save, appends a delta for those which can give
+// one, and the whole state for the others (and for plugins without versions).
+// so saving a large patch where one parameter changed writes one small record.
+// once the journal has grown to compactBytes, save() writes a new one with
+// the whole states only, next to it, and renames it over the old one.
+//
+// file layout, little endian:
+//   Header
+//   records                   a Record, followed by size bytes of payload
+// each record is covered by its checksum, and every save ends with an END
+// record. recover() stops at the first record which is incomplete or
+// damaged, e.g. by a power cut during a save, and drops the records after
+// the last END, so the patch is recovered as of the last complete save.
+// errors are reported with std::runtime_error.
+namespace AutosaveFormat {
+
+static constexpr char MAGIC[8] = {'S', 'S', 'P', 'J', 'R', 'N', 'L', '\0'};
+static constexpr uint32_t VERSION = 2;
+
+enum RecordType : uint32_t {
+    STATE = 1,      // the whole state, from getState()
+    DELTA = 2,      // from getStateDelta(), applies to the records before it
+    REMOVED = 3,    // the module is no longer in the patch, no payload
+    END = 4,        // the save is complete, no payload or module
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct Record {
+    uint32_t type;
+    int32_t module;             // Module::id()
+    int32_t uid;                // of the plugin
+    uint32_t checksum;          // crc32 of the record (with this field 0) and payload
+    uint64_t stateVersion;      // the version the state is at after this record
+    uint64_t size;
+};
+
+static_assert(sizeof(Header) == 16, "journal header layout");
+static_assert(sizeof(Record) == 32, "journal record layout");
+
+}
+
+class Autosave {
+public:
+    // the state of a module, as recover() found it in a journal
+    struct Recovered {
+        int uid = 0;
+        std::vector<char> state;
+        std::vector<std::vector<char>> deltas;
+    };
+
+    struct Result {
+        int states = 0;         // whole states written
+        int deltas = 0;
+        int skipped = 0;        // modules which did not change
+        size_t bytes = 0;       // appended to the journal
+        bool compacted = false;
+    };
+
+    // starts a new journal at path, replacing one which is there, so
+    // recover() it first. throws if it cannot be written.
+    explicit Autosave(const std::string &path, size_t compactBytes = 1 << 20);
+    ~Autosave();
+
+    // UI thread, saves the modules of the patch. modules saved before, but
+    // not passed now, are recorded as removed. the journal is synced to disk
+    // before this returns. throws on write errors.
+    Result save(const std::vector<Module *> &modules);
+
+    size_t journalBytes() const { return size_; }
+
+    // the patch as of the last complete save in the journal at path, by
+    // module id. throws if the file cannot be read, or is no journal.
+    static std::map<int, Recovered> recover(const std::string &path);
+
+    // UI thread, sets a recovered state: setState(), then the deltas in order.
+    // returns false if the plugin could not apply a delta, the module has the
+    // state of the deltas before it then.
+    static bool restore(Module &module, const Recovered &recovered);
+
+private:
+    struct Saved {
+        int uid;
+        uint64_t stateVersion;
+    };
+
+    void open(const std::string &path);
+    void append(FILE *f, AutosaveFormat::RecordType type, int module, int uid,
+                uint64_t stateVersion, const std::vector<char> &payload);
+    void sync(FILE *f, const std::string &path);
+    void compact(const std::vector<Module *> &modules);
+
+    std::string path_;
+    size_t compactBytes_;
+    FILE *file_ = nullptr;
+    size_t size_ = 0;
+    std::map<int, Saved> saved_;
+
+    Autosave(const Autosave &) = delete;
+    Autosave &operator=(const Autosave &) = delete;
+};
@@ -0,0 +1,42 @@
+// see header file for license
+
+#include "EventQueue.h"
+
+EventQueue::EventQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    cells_.reset(new Cell[size]);
+    mask_ = size - 1;
+    for (size_t i = 0; i < size; i++) cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool EventQueue::push(const Entry &entry) {
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell &cell = cells_[pos & mask_];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t) seq - (intptr_t) pos;
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.entry = entry;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool EventQueue::pop(Entry &entry) {
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    Cell &cell = cells_[pos & mask_];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if ((intptr_t) seq - (intptr_t) (pos + 1) < 0) return false;
+    entry = cell.entry;
+    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+    dequeuePos_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+}
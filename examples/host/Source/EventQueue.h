@@ -0,0 +1,69 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// bounded queue of timestamped events for one module, any thread can push
+// (encoders, buttons, the UI), the audio thread pops. lock free, after
+// D. Vyukov's bounded MPMC queue, so pushing never blocks the audio thread.
+class EventQueue {
+public:
+    struct Entry {
+        uint64_t timeNs;
+        Percussa::SSP::Event event;
+    };
+
+    // capacity is rounded up to a power of two
+    explicit EventQueue(size_t capacity = 256);
+
+    // returns false if the queue is full, the event is dropped then
+    bool push(const Entry &entry);
+
+    // audio thread only
+    bool pop(Entry &entry);
+
+    size_t memoryBytes() const { return (mask_ + 1) * sizeof(Cell); }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Entry entry;
+    };
+
+    // the positions are a cache line apart from each other and from the rest
+    // (see CACHE_LINE in Percussa.h)
+    static constexpr size_t CACHE_LINE = Percussa::SSP::CACHE_LINE;
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    char pad0_[CACHE_LINE];
+    std::atomic<size_t> enqueuePos_{0};
+    char pad1_[CACHE_LINE];
+    std::atomic<size_t> dequeuePos_{0};
+    char pad2_[CACHE_LINE];
+
+    EventQueue(const EventQueue &) = delete;
+    EventQueue &operator=(const EventQueue &) = delete;
+};
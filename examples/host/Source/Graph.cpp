@@ -0,0 +1,291 @@
+// see header file for license
+
+#include "Graph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <PercussaLayout.h>
+
+namespace {
+
+// samples per buffer are rounded up to whole cache lines
+constexpr int FLOATS_PER_LINE = 64 / sizeof(float);
+
+}
+
+void Graph::add(Module *module) {
+    modules_.push_back(module);
+}
+
+int Graph::indexOf(Module *module) const {
+    auto it = std::find(modules_.begin(), modules_.end(), module);
+    if (it == modules_.end()) throw std::runtime_error("module is not part of the graph");
+    return (int) (it - modules_.begin());
+}
+
+void Graph::connect(Module *from, int output, Module *to, int input) {
+    Connection c{indexOf(from), output, indexOf(to), input, false};
+    if (output < 0 || output >= from->numOutputs() || input < 0 || input >= to->numInputs()) {
+        throw std::runtime_error("no such output or input");
+    }
+    for (const Connection &other: connections_) {
+        if (other.to == c.to && other.input == c.input) throw std::runtime_error("input is connected already");
+    }
+    connections_.push_back(c);
+}
+
+// topological order, in the order the modules were added where there is a
+// choice. when only modules in a cycle are left, the first of them is taken,
+// and its connections from modules which did not run yet become feedback.
+void Graph::schedule() {
+    const int n = (int) modules_.size();
+    std::vector<bool> done(n, false);
+    order_.clear();
+    for (Connection &c: connections_) c.feedback = false;
+
+    for (int scheduled = 0; scheduled < n; scheduled++) {
+        int next = -1;
+        for (int m = 0; m < n && next < 0; m++) {
+            if (done[m]) continue;
+            bool ready = true;
+            for (const Connection &c: connections_) {
+                if (c.to == m && !done[c.from]) ready = false;
+            }
+            if (ready) next = m;
+        }
+        if (next < 0) {
+            next = (int) (std::find(done.begin(), done.end(), false) - done.begin());
+            for (Connection &c: connections_) {
+                if (c.to == next && !done[c.from]) c.feedback = true;
+            }
+        }
+        done[next] = true;
+        order_.push_back(modules_[next]);
+    }
+}
+
+void Graph::routeFrames() {
+    const int n = (int) modules_.size();
+    framesFrom_.assign(n, -1);
+    convertOut_.assign(n, true);
+    for (int to = 0; to < n; to++) {
+        const Module *m = modules_[to];
+        if (m->layout() == Percussa::SSP::LAYOUT_PLANAR || m->numInputs() != m->numChannels()) continue;
+        int from = -1;
+        int matched = 0;
+        for (const Connection &c: connections_) {
+            if (c.to != to) continue;
+            if (c.feedback || c.output != c.input || (from >= 0 && c.from != from)) {
+                matched = -1;
+                break;
+            }
+            from = c.from;
+            matched++;
+        }
+        if (matched != m->numInputs()) continue;
+        const Module *source = modules_[from];
+        if (source->layout() == m->layout() && source->numChannels() == m->numChannels()) framesFrom_[to] = from;
+    }
+    // the output stays in frames() if every reader takes it from there
+    for (int from = 0; from < n; from++) {
+        bool read = false, framesOnly = true;
+        for (const Connection &c: connections_) {
+            if (c.from != from) continue;
+            read = true;
+            if (c.feedback || framesFrom_[c.to] != from) framesOnly = false;
+        }
+        convertOut_[from] = !(read && framesOnly);
+    }
+}
+
+void Graph::compile(int maxBlockSize, bool reuse) {
+    schedule();
+    stats_ = Stats();
+    ops_.clear();
+    if (reuse) compileShared(maxBlockSize);
+    else compileSeparate(maxBlockSize);
+}
+
+void Graph::compileSeparate(int maxBlockSize) {
+    for (Module *m: order_) {
+        m->resetChannels();
+        stats_.buffers += m->numChannels();
+    }
+    for (Module *m: order_) {
+        int to = indexOf(m);
+        for (int in = 0; in < m->numInputs(); in++) {
+            auto c = std::find_if(connections_.begin(), connections_.end(), [&](const Connection &c) {
+                return c.to == to && c.input == in;
+            });
+            if (c == connections_.end()) {
+                ops_.push_back(Op{Op::CLEAR, nullptr, m->channel(in), nullptr, true, true});
+                stats_.clears++;
+            } else {
+                // the source of a feedback connection has not run yet, so its
+                // buffer still holds the previous block
+                const float *src = modules_[c->from]->channel(c->output);
+                ops_.push_back(Op{Op::COPY, src, m->channel(in), nullptr, true, true});
+                stats_.copies++;
+                if (c->feedback) stats_.feedback++;
+            }
+        }
+        ops_.push_back(Op{Op::PROCESS, nullptr, nullptr, m, true, true});
+    }
+    stats_.bytes = (size_t) stats_.buffers * maxBlockSize * sizeof(float);
+}
+
+void Graph::compileShared(int maxBlockSize) {
+    // the schedule is built with buffer indices first, the pool is allocated
+    // once the number of buffers is known
+    struct PendingOp {
+        Op::Type type;
+        int src, dst;
+        Module *module;
+        Module *from;
+    };
+    routeFrames();
+    std::vector<PendingOp> pending;
+    std::vector<int> freeBuffers;
+    int numBuffers = 0;
+    auto allocate = [&]() {
+        // most recently freed first, it is most likely still in the cache
+        if (freeBuffers.empty()) return numBuffers++;
+        int b = freeBuffers.back();
+        freeBuffers.pop_back();
+        return b;
+    };
+
+    const int n = (int) modules_.size();
+    // buffer of each output while it is live, and the number of inputs still to read it
+    std::vector<std::vector<int>> outputBuffer(n), readers(n);
+    for (int m = 0; m < n; m++) {
+        outputBuffer[m].assign(modules_[m]->numOutputs(), -1);
+        readers[m].assign(modules_[m]->numOutputs(), 0);
+    }
+    std::vector<int> inputConnection;
+    std::vector<int> feedbackBuffer(connections_.size(), -1);
+    for (size_t i = 0; i < connections_.size(); i++) {
+        const Connection &c = connections_[i];
+        if (c.feedback) {
+            // lives across blocks, so it is never reused
+            feedbackBuffer[i] = allocate();
+            stats_.feedback++;
+        } else {
+            readers[c.from][c.output]++;
+        }
+    }
+
+    std::vector<std::vector<int>> channelBuffer(n);
+    for (Module *m: order_) {
+        const int to = indexOf(m);
+        inputConnection.assign(m->numInputs(), -1);
+        for (size_t i = 0; i < connections_.size(); i++) {
+            if (connections_[i].to == to) inputConnection[connections_[i].input] = (int) i;
+        }
+
+        std::vector<int> &channels = channelBuffer[to];
+        channels.assign(m->numChannels(), -1);
+        for (int ch = 0; ch < m->numChannels(); ch++) {
+            int ci = ch < m->numInputs() ? inputConnection[ch] : -1;
+            if (ci < 0) {
+                channels[ch] = allocate();
+                if (ch < m->numInputs()) {
+                    pending.push_back(PendingOp{Op::CLEAR, -1, channels[ch], nullptr, nullptr});
+                    stats_.clears++;
+                }
+            } else if (connections_[ci].feedback) {
+                channels[ch] = allocate();
+                pending.push_back(PendingOp{Op::COPY, feedbackBuffer[ci], channels[ch], nullptr, nullptr});
+                stats_.copies++;
+            } else {
+                const Connection &c = connections_[ci];
+                if (--readers[c.from][c.output] == 0) {
+                    // last reader, process in the source's buffer
+                    channels[ch] = outputBuffer[c.from][c.output];
+                    stats_.inPlace++;
+                } else {
+                    channels[ch] = allocate();
+                    // the input comes from frames(), the channel only takes the output
+                    if (framesFrom_[to] < 0) {
+                        const int src = outputBuffer[c.from][c.output];
+                        pending.push_back(PendingOp{Op::COPY, src, channels[ch], nullptr, nullptr});
+                        stats_.copies++;
+                    }
+                }
+            }
+        }
+
+        if (framesFrom_[to] >= 0) {
+            pending.push_back(PendingOp{Op::COPY_FRAMES, -1, -1, m, modules_[framesFrom_[to]]});
+            stats_.frameCopies++;
+        }
+        pending.push_back(PendingOp{Op::PROCESS, -1, -1, m, nullptr});
+
+        for (int ch = 0; ch < m->numChannels(); ch++) {
+            bool live = false;
+            if (ch < m->numOutputs()) {
+                for (size_t i = 0; i < connections_.size(); i++) {
+                    const Connection &c = connections_[i];
+                    if (c.feedback && c.from == to && c.output == ch) {
+                        pending.push_back(PendingOp{Op::COPY, channels[ch], feedbackBuffer[i], nullptr, nullptr});
+                        stats_.copies++;
+                    }
+                }
+                if (readers[to][ch] > 0) {
+                    outputBuffer[to][ch] = channels[ch];
+                    live = true;
+                }
+            }
+            if (!live) freeBuffers.push_back(channels[ch]);
+        }
+    }
+
+    const size_t stride = (size_t) (maxBlockSize + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE * FLOATS_PER_LINE;
+    storage_.assign((size_t) numBuffers * stride + FLOATS_PER_LINE, 0.0f);
+    float *base = (float *) (((uintptr_t) storage_.data() + 63) & ~(uintptr_t) 63);
+    auto buffer = [&](int b) { return b < 0 ? nullptr : base + (size_t) b * stride; };
+
+    for (int m = 0; m < n; m++) {
+        for (size_t ch = 0; ch < channelBuffer[m].size(); ch++) modules_[m]->setChannel((int) ch, buffer(channelBuffer[m][ch]));
+    }
+    for (const PendingOp &p: pending) {
+        Op op{p.type, buffer(p.src), buffer(p.dst), p.module, true, true};
+        if (p.type == Op::COPY_FRAMES) {
+            op.src = p.from->frames();
+            op.dst = p.module->frames();
+        } else if (p.type == Op::PROCESS) {
+            const int m = indexOf(p.module);
+            op.convertIn = framesFrom_[m] < 0;
+            op.convertOut = convertOut_[m];
+        }
+        ops_.push_back(op);
+    }
+
+    stats_.buffers = numBuffers;
+    stats_.bytes = (size_t) numBuffers * stride * sizeof(float);
+}
+
+void Graph::process(int numSamples) {
+    const size_t bytes = (size_t) numSamples * sizeof(float);
+    for (const Op &op: ops_) {
+        switch (op.type) {
+            case Op::COPY:
+                memcpy(op.dst, op.src, bytes);
+                break;
+            case Op::CLEAR:
+                memset(op.dst, 0, bytes);
+                break;
+            case Op::COPY_FRAMES: {
+                const Module &m = *op.module;
+                memcpy(op.dst, op.src, Percussa::SSP::layoutSize(m.layout(), m.numChannels(), numSamples) * sizeof(float));
+                break;
+            }
+            case Op::PROCESS:
+                op.module->process(numSamples, op.convertIn, op.convertOut);
+                break;
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include "PluginHost.h"
+
+#include <cstddef>
+#include <vector>
+
+// compiles a patch of modules into a schedule for the audio thread: the modules
+// in topological order, with their channels mapped onto a small pool of shared,
+// cache line aligned buffers.
+//
+// a module processes in place, output n is written into the buffer of channel n,
+// which held input n. a buffer is only live from the output writing it to the
+// last input reading it, after that it is reused for later modules. a module
+// which is the last reader of an output processes directly in its buffer (an
+// in-place chain), instead of copying it into a buffer of its own.
+//
+// connections which close a cycle are feedback connections, they deliver the
+// output of the previous block, through a buffer of their own.
+//
+// a module with a non-planar layout (see Module::layout()) whose inputs are all
+// the same outputs of a module with the same layout and number of channels,
+// e.g. the next of a chain of packed modules, gets the frames() of that module
+// copied into its own, instead of converting them to channels and back. the
+// first module converts its output only if it has other readers.
+class Graph {
+public:
+    struct Stats {
+        int buffers = 0;
+        size_t bytes = 0;
+        // per block
+        int copies = 0;
+        int clears = 0;
+        int inPlace = 0;
+        int feedback = 0;
+        // copies of frames() between modules with the same layout
+        int frameCopies = 0;
+    };
+
+    // the graph does not own the modules
+    void add(Module *module);
+
+    // output of from feeds input of to. an input takes one connection.
+    void connect(Module *from, int output, Module *to, int input);
+
+    // UI thread, after prepare() of all modules, and before process().
+    // with reuse false, every channel keeps the module's own buffer and every
+    // connection is copied, and converted between layouts, the way a host
+    // without a graph compiler works.
+    void compile(int maxBlockSize, bool reuse = true);
+
+    // audio thread
+    void process(int numSamples);
+
+    const std::vector<Module *> &order() const { return order_; }
+    const Stats &stats() const { return stats_; }
+
+private:
+    struct Connection {
+        int from, output, to, input;
+        bool feedback;
+    };
+
+    struct Op {
+        enum Type { COPY, CLEAR, COPY_FRAMES, PROCESS } type;
+        const float *src;
+        float *dst;
+        // processed, or whose frames() are copied from src
+        Module *module;
+        bool convertIn, convertOut;
+    };
+
+    int indexOf(Module *module) const;
+    void schedule();
+    // which modules take their input in frames() of another (framesFrom_),
+    // and which need their output in channels (convertOut_)
+    void routeFrames();
+    void compileShared(int maxBlockSize);
+    void compileSeparate(int maxBlockSize);
+
+    std::vector<Module *> modules_;
+    std::vector<Connection> connections_;
+    std::vector<Module *> order_;
+    std::vector<Op> ops_;
+    std::vector<int> framesFrom_;
+    std::vector<bool> convertOut_;
+    std::vector<float> storage_;
+    Stats stats_;
+};
@@ -0,0 +1,75 @@
+// see header file for license
+
+#include "InstancePool.h"
+#include "Trace.h"
+
+InstancePool::InstancePool(double sampleRate, int maxBlockSize, const Percussa::SSP::HostServices *services) :
+    sampleRate_(sampleRate), maxBlockSize_(maxBlockSize), services_(services) {
+}
+
+int InstancePool::reserve(const PluginLibrary &library, int index, int size) {
+    std::unique_ptr<Module> first(new Module(library, -1, index));
+    first->prepare(sampleRate_, maxBlockSize_, services_);
+    const int uid = first->descriptor().uid;
+
+    Pool &pool = pools_[uid];
+    pool.library = &library;
+    pool.index = index;
+    pool.size = size;
+    if ((int) pool.modules.size() < size) pool.modules.push_back(std::move(first));
+    while ((int) pool.modules.size() < size) pool.modules.push_back(create(pool));
+    return uid;
+}
+
+std::unique_ptr<Module> InstancePool::acquire(int uid, int id) {
+    auto it = pools_.find(uid);
+    if (it == pools_.end()) return nullptr;
+    Pool &pool = it->second;
+
+    std::unique_ptr<Module> module;
+    if (!pool.modules.empty()) {
+        module = std::move(pool.modules.back());
+        pool.modules.pop_back();
+    } else {
+        module = create(pool);
+    }
+    module->setId(id);
+    return module;
+}
+
+void InstancePool::release(std::unique_ptr<Module> module) {
+    if (!module) return;
+    auto it = pools_.find(module->descriptor().uid);
+    if (it == pools_.end()) return;
+    Pool &pool = it->second;
+    if ((int) pool.modules.size() >= pool.size) return;
+    // the editor stays with the instance, hidden, so it frees what it only needs for drawing
+    module->visibilityChanged(false);
+    if (!module->reset()) return;
+    module->setId(-1);
+    pool.modules.push_back(std::move(module));
+}
+
+int InstancePool::refill(int max) {
+    int created = 0;
+    for (auto &entry: pools_) {
+        Pool &pool = entry.second;
+        while (created < max && (int) pool.modules.size() < pool.size) {
+            pool.modules.push_back(create(pool));
+            created++;
+        }
+    }
+    return created;
+}
+
+int InstancePool::available(int uid) const {
+    auto it = pools_.find(uid);
+    return it == pools_.end() ? 0 : (int) it->second.modules.size();
+}
+
+std::unique_ptr<Module> InstancePool::create(const Pool &pool) {
+    Trace::Scope scope("poolInstance");
+    std::unique_ptr<Module> module(new Module(*pool.library, -1, pool.index));
+    module->prepare(sampleRate_, maxBlockSize_, services_);
+    return module;
+}
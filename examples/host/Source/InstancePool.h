@@ -0,0 +1,75 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include "PluginHost.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+// prepared plugin instances, so a module can be inserted into a running patch
+// without waiting for createInstance() and prepare(), which for a JUCE plugin
+// builds its whole parameter tree. the pool of a plugin (by uid) is filled
+// ahead of time, removed modules go back into it after a warm start (reset(),
+// API 3.13), and refill() tops the pools up when the UI thread has time.
+// all functions are called from the UI thread.
+class InstancePool {
+public:
+    // instances are prepared with these, services must outlive the pool
+    InstancePool(double sampleRate, int maxBlockSize, const Percussa::SSP::HostServices *services = nullptr);
+
+    // keep size prepared instances of plugin index of the library, creates
+    // them now. the library must outlive the pool. returns the plugin's uid.
+    int reserve(const PluginLibrary &library, int index, int size);
+
+    // a prepared module of the plugin, from the pool, or created and prepared
+    // now if the pool is empty. nullptr if the plugin was not reserved.
+    std::unique_ptr<Module> acquire(int uid, int id);
+
+    // a module taken out of the patch, no longer processed. its editor is
+    // hidden, and it is reset and kept if its pool is not full, and deleted
+    // otherwise.
+    void release(std::unique_ptr<Module> module);
+
+    // creates at most max instances for pools below their size, returns the
+    // number created. call when the UI thread is idle.
+    int refill(int max = 1);
+
+    // prepared instances in the pool of the plugin
+    int available(int uid) const;
+
+private:
+    struct Pool {
+        const PluginLibrary *library;
+        int index;
+        int size;
+        std::vector<std::unique_ptr<Module>> modules;
+    };
+
+    std::unique_ptr<Module> create(const Pool &pool);
+
+    double sampleRate_;
+    int maxBlockSize_;
+    const Percussa::SSP::HostServices *services_;
+    std::map<int, Pool> pools_;
+
+    InstancePool(const InstancePool &) = delete;
+    InstancePool &operator=(const InstancePool &) = delete;
+};
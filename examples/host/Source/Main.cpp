@@ -0,0 +1,276 @@
+// see PluginHost.h for license
+
+// ssphost: runs one or more plugins the way the SSP does, with a periodic
+// audio thread calling process() and a UI thread driving the editors,
+// optionally recording a timeline of all plugin calls.
+//
+// usage: ssphost [options] plugin.so [plugin.so ...]
+//   -r <rate>       sample rate (48000)
+//   -b <samples>    block size (128)
+//   --toggle <n>    alternate between -b and n samples every block, switching
+//                   the plugins with reconfigure() instead of prepare()
+//   -t <seconds>    run time (10)
+//   -n <count>      instances of each plugin, and of each plugin of a bundle (1)
+//   -s <seconds>    save and reload the state of a module every n seconds (0 = off)
+//   --editor        drive the plugin editors (renderToImage, draw), of the
+//                   plugins which have one. there is no OpenGLES context,
+//                   bench_editor measures what draw() renders
+//   --trace <file>  write a Chrome/Perfetto trace of all plugin calls
+
+#include "Arena.h"
+#include "AssetCache.h"
+#include "AudioThread.h"
+#include "PluginHost.h"
+#include "StateLoader.h"
+#include "Streamer.h"
+#include "ThreadPolicy.h"
+#include "Trace.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+struct Options {
+    double sampleRate = 48000.0;
+    int blockSize = 128;
+    int toggleSize = 0;
+    double seconds = 10.0;
+    int instances = 1;
+    double stateInterval = 0.0;
+    bool editor = false;
+    std::string traceFile;
+    std::vector<std::string> plugins;
+};
+
+void usage() {
+    fprintf(stderr,
+            "usage: ssphost [options] plugin.so [plugin.so ...]\n"
+            "  -r <rate>       sample rate (48000)\n"
+            "  -b <samples>    block size (128)\n"
+            "  --toggle <n>    alternate between -b and n samples every block\n"
+            "  -t <seconds>    run time (10)\n"
+            "  -n <count>      instances of each plugin (1)\n"
+            "  -s <seconds>    save and reload the state of a module every n seconds (0 = off)\n"
+            "  --editor        drive the plugin editors (renderToImage, draw)\n"
+            "  --trace <file>  write a Chrome/Perfetto trace of all plugin calls\n");
+    exit(1);
+}
+
+Options parseOptions(int argc, char **argv) {
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (a == "-r" && hasValue) o.sampleRate = atof(argv[++i]);
+        else if (a == "-b" && hasValue) o.blockSize = atoi(argv[++i]);
+        else if (a == "-t" && hasValue) o.seconds = atof(argv[++i]);
+        else if (a == "-n" && hasValue) o.instances = atoi(argv[++i]);
+        else if (a == "-s" && hasValue) o.stateInterval = atof(argv[++i]);
+        else if (a == "--toggle" && hasValue) o.toggleSize = atoi(argv[++i]);
+        else if (a == "--editor") o.editor = true;
+        else if (a == "--trace" && hasValue) o.traceFile = argv[++i];
+        else if (a[0] == '-') usage();
+        else o.plugins.push_back(a);
+    }
+    if (o.plugins.empty() || o.blockSize <= 0 || o.sampleRate <= 0.0 || o.instances <= 0) usage();
+    if (o.toggleSize < 0 || o.toggleSize > o.blockSize) usage();
+    return o;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options o = parseOptions(argc, argv);
+    if (!o.traceFile.empty()) Trace::enable(true);
+    Trace::registerThread("ui");
+
+    std::vector<std::unique_ptr<PluginLibrary>> libraries;
+    std::vector<std::unique_ptr<Module>> owned;
+    std::vector<Module *> modules;
+
+    try {
+        for (const std::string &path: o.plugins) {
+            libraries.emplace_back(new PluginLibrary(path));
+            // all plugins of a bundle
+            for (int p = 0; p < libraries.back()->pluginCount(); p++) {
+                for (int i = 0; i < o.instances; i++) {
+                    owned.emplace_back(new Module(*libraries.back(), (int) owned.size(), p));
+                    modules.push_back(owned.back().get());
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    // the audio thread and the DSP workers on all cores but the last, which
+    // is left to the threads of the plugins doing background work
+    ThreadPolicy threads;
+
+    // one worker per real-time core, the audio thread takes the remaining one
+    WorkerPool pool(threads.realtimeCores() - 1);
+    for (std::thread &t: pool.threads()) threads.apply(t.native_handle(), ThreadPolicy::THREAD_DSP);
+    Percussa::SSP::HostServices services;
+    services.taskPool = &pool;
+    services.threads = &threads;
+
+    // buffers of all plugins in one pre-faulted, locked region. freed after
+    // the modules (owned.clear() below).
+    Arena arena(64 << 20);
+    services.arena = &arena;
+
+    // samples streamed from disk by one I/O thread, on the background cores
+    Streamer streamer;
+    threads.apply(streamer.thread().native_handle(), ThreadPolicy::THREAD_IO);
+    services.streamer = &streamer;
+
+    // read-only assets shared by all instances, loaded on the background cores
+    AssetCache assets;
+    threads.apply(assets.thread().native_handle(), ThreadPolicy::THREAD_IO);
+    services.assets = &assets;
+
+    for (Module *m: modules) {
+        for (int i = 0; i < m->numInputs(); i++) m->plugin().inputEnabled(i, true);
+        for (int i = 0; i < m->numOutputs(); i++) m->plugin().outputEnabled(i, true);
+        m->prepare(o.sampleRate, o.blockSize, &services);
+    }
+
+    // the modules with an editor, when driving them
+    std::vector<Module *> editors;
+    if (o.editor) {
+        for (Module *m: modules) {
+            if (m->editor()) editors.push_back(m);
+        }
+    }
+
+    AudioThread audio(o.sampleRate, o.blockSize, modules);
+    if (o.toggleSize > 0) audio.setBlockSizes({o.blockSize, o.toggleSize});
+    audio.start();
+    threads.pinRealtime(audio.thread().native_handle());
+
+    StateLoader loader;
+
+    // UI thread, 60 frames per second. the visible module changes every 2 seconds.
+    static constexpr int width = 1600, height = 480;
+    std::vector<unsigned char> image(width * height * 4);
+    const uint64_t frameNs = 1000000000ull / 60;
+    const int frames = (int) (o.seconds * 60.0);
+    const int stateFrames = (int) (o.stateInterval * 60.0);
+    int visible = -1;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int frame = 0; frame < frames; frame++) {
+        addNs(next, frameNs);
+        Trace::Scope scope("frame");
+
+        if (!editors.empty()) {
+            int v = (frame / 120) % (int) editors.size();
+            if (v != visible) {
+                if (visible >= 0) editors[visible]->visibilityChanged(false);
+                editors[v]->visibilityChanged(true);
+                visible = v;
+            }
+            for (Module *m: editors) m->frameStart();
+            editors[visible]->renderToImage(image.data(), width, height);
+            // the SSP calls draw() after drawing the image on screen, so it is
+            // in the trace of every frame, its GL calls have no context here
+            editors[visible]->draw(width, height);
+            if (frame % 30 == 0) editors[visible]->buttonPressed((frame / 30) % 14, (frame / 30) % 2 == 0);
+        }
+
+        // encoder activity arrives independently of the audio blocks, the modules
+        // pass it to the plugins with the next block
+        if (frame % 20 == 0) {
+            for (Module *m: modules) m->encoderTurned((frame / 20) % 4, (frame / 80) % 2 ? -1 : 1);
+        }
+
+        if (stateFrames > 0 && frame % stateFrames == stateFrames - 1) {
+            Module *m = modules[(frame / stateFrames) % modules.size()];
+            loader.load(*m, m->getState());
+        }
+        loader.poll();
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+    }
+
+    loader.wait();
+    audio.stop();
+
+    printf("%-24s %10s %10s %12s %10s\n", "module", "avg us", "max us", "blocks", "overruns");
+    for (Module *m: modules) {
+        const Percussa::SSP::PluginStats *stats = m->stats();
+        std::string name = m->descriptor().name + "#" + std::to_string(m->id());
+        if (!stats) {
+            printf("%-24s %10s\n", name.c_str(), "n/a");
+            continue;
+        }
+        printf("%-24s %10.1f %10.1f %12llu %10u\n", name.c_str(),
+               stats->nsPerBlockAvg.load() / 1000.0,
+               stats->nsPerBlockMax.load() / 1000.0,
+               (unsigned long long) stats->blocksProcessed.load(),
+               stats->overruns.load());
+    }
+
+    // memory of the patch, memory shared by the instances of a plugin is counted once
+    printf("\n%-24s %10s %10s %10s\n", "module", "dsp kB", "ui kB", "host kB");
+    std::map<const PluginLibrary *, size_t> shared;
+    size_t total = 0;
+    for (Module *m: modules) {
+        Percussa::SSP::MemoryUsage usage;
+        std::string name = m->descriptor().name + "#" + std::to_string(m->id());
+        total += m->hostBytes();
+        if (!m->memoryUsage(usage)) {
+            printf("%-24s %10s %10s %10zu\n", name.c_str(), "n/a", "n/a", m->hostBytes() / 1024);
+            continue;
+        }
+        printf("%-24s %10zu %10zu %10zu\n", name.c_str(), usage.dspBytes / 1024, usage.uiBytes / 1024,
+               m->hostBytes() / 1024);
+        total += usage.dspBytes + usage.uiBytes;
+        size_t &s = shared[m->library()];
+        s = std::max(s, usage.sharedBytes);
+    }
+    size_t sharedTotal = 0;
+    for (auto &s: shared) sharedTotal += s.second;
+    total += sharedTotal;
+    printf("total: %zu kB, of which %zu kB shared between instances\n\n", total / 1024, sharedTotal / 1024);
+
+    printf("host xruns: %llu\n", (unsigned long long) audio.xruns());
+    if (o.toggleSize > 0) {
+        printf("block size switches: %llu, refused by a module: %llu\n",
+               (unsigned long long) audio.reconfigurations(), (unsigned long long) audio.refused());
+    }
+    printf("arena: %zu of %zu kB used%s\n", arena.used() / 1024, arena.capacity() / 1024,
+           arena.locked() ? "" : " (not locked, raise the memlock limit)");
+    printf("streaming: %.1f MB read, %llu underruns\n", streamer.bytesRead() / 1e6,
+           (unsigned long long) streamer.totalUnderruns());
+    printf("assets: %d, %.1f MB mapped, %.1f MB saved by sharing\n", assets.numAssets(), assets.mappedBytes() / 1e6,
+           (assets.referencedBytes() - assets.mappedBytes()) / 1e6);
+    printf("threads: %s; registered by plugins: %d dsp, %d compute, %d io\n", threads.describe().c_str(),
+           threads.registered(ThreadPolicy::THREAD_DSP), threads.registered(ThreadPolicy::THREAD_COMPUTE),
+           threads.registered(ThreadPolicy::THREAD_IO));
+
+    for (auto &library: libraries) {
+        std::string report = library->profileReport();
+        if (!report.empty()) printf("\nprofile of %s\n%s", library->path().c_str(), report.c_str());
+    }
+
+    owned.clear();
+
+    if (!o.traceFile.empty()) {
+        if (!Trace::writeJson(o.traceFile)) {
+            fprintf(stderr, "cannot write trace file %s\n", o.traceFile.c_str());
+            return 1;
+        }
+        printf("trace written to %s\n", o.traceFile.c_str());
+    }
+
+    return 0;
+}
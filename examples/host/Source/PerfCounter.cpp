@@ -0,0 +1,67 @@
+// see header file for license
+
+#include "PerfCounter.h"
+
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+PerfCounter::PerfCounter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+PerfCounter::PerfCounter(PerfCounter &&other) noexcept : fd_(other.fd_) {
+    other.fd_ = -1;
+}
+
+PerfCounter::~PerfCounter() {
+    if (fd_ >= 0) close(fd_);
+}
+
+PerfCounter PerfCounter::cycles() {
+    return PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+}
+
+PerfCounter PerfCounter::cacheMisses() {
+    return PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+}
+
+PerfCounter PerfCounter::llReads() {
+    return PerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                                           | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                           | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16));
+}
+
+PerfCounter PerfCounter::llReadMisses() {
+    return PerfCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL
+                                           | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                           | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+}
+
+void PerfCounter::reset() {
+    if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+}
+
+void PerfCounter::enable() {
+    if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+void PerfCounter::disable() {
+    if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+uint64_t PerfCounter::read() const {
+    uint64_t value = 0;
+    if (fd_ < 0 || ::read(fd_, &value, sizeof(value)) != sizeof(value)) return 0;
+    return value;
+}
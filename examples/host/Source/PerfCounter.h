@@ -0,0 +1,53 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// hardware event counter of the calling thread (perf_event_open), used by the
+// benchmarks. counters may be unavailable (no PMU in a VM, or
+// /proc/sys/kernel/perf_event_paranoid too strict), check valid().
+class PerfCounter {
+public:
+    PerfCounter(uint32_t type, uint64_t config);
+    ~PerfCounter();
+
+    // cpu cycles
+    static PerfCounter cycles();
+    // all cache misses, as counted by the cpu
+    static PerfCounter cacheMisses();
+    // last level (on the SSP: L2) cache read accesses and misses
+    static PerfCounter llReads();
+    static PerfCounter llReadMisses();
+
+    PerfCounter(PerfCounter &&other) noexcept;
+
+    bool valid() const { return fd_ >= 0; }
+
+    void reset();
+    void enable();
+    void disable();
+    uint64_t read() const;
+
+private:
+    int fd_ = -1;
+
+    PerfCounter(const PerfCounter &) = delete;
+    PerfCounter &operator=(const PerfCounter &) = delete;
+};
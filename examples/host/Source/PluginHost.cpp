@@ -0,0 +1,309 @@
+// see header file for license
+
+#include "PluginHost.h"
+#include "Trace.h"
+
+#include <PercussaLayout.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <dlfcn.h>
+
+using namespace Percussa::SSP;
+
+PluginLibrary::PluginLibrary(const std::string &path) : path_(path) {
+    handle_ = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle_) throw std::runtime_error(std::string("cannot load plugin: ") + dlerror());
+
+    descriptorFun_ = (DescriptorFun) dlsym(handle_, createDescriptorName);
+    instantiateFun_ = (InstantiateFun) dlsym(handle_, createInstanceName);
+    VersionFun versionFun = (VersionFun) dlsym(handle_, getApiVersionName);
+    profileReportFun_ = (ProfileReportFun) dlsym(handle_, getProfileReportName);
+
+    // a bundle, with more than one plugin
+    PluginCountFun countFun = (PluginCountFun) dlsym(handle_, getPluginCountName);
+    descriptorAtFun_ = (DescriptorAtFun) dlsym(handle_, createDescriptorAtName);
+    instantiateAtFun_ = (InstantiateAtFun) dlsym(handle_, createInstanceAtName);
+    if (countFun && descriptorAtFun_ && instantiateAtFun_) {
+        pluginCount_ = countFun();
+    } else {
+        descriptorAtFun_ = nullptr;
+        instantiateAtFun_ = nullptr;
+    }
+
+    if (!descriptorFun_ || !instantiateFun_ || !versionFun) {
+        dlclose(handle_);
+        throw std::runtime_error("not an SSP plugin: " + path);
+    }
+
+    versionFun(apiMajor_, apiMinor_);
+    if (apiMajor_ != API_MAJOR_VERSION) {
+        dlclose(handle_);
+        throw std::runtime_error("unsupported API major version in " + path);
+    }
+}
+
+PluginLibrary::~PluginLibrary() {
+    if (handle_) dlclose(handle_);
+}
+
+PluginDescriptor *PluginLibrary::createDescriptor(int index) const {
+    if (index < 0 || index >= pluginCount_) return nullptr;
+    return descriptorAtFun_ ? descriptorAtFun_(index) : descriptorFun_();
+}
+
+PluginInterface *PluginLibrary::createInstance(int index) const {
+    if (index < 0 || index >= pluginCount_) return nullptr;
+    return instantiateAtFun_ ? instantiateAtFun_(index) : instantiateFun_();
+}
+
+std::string PluginLibrary::profileReport() const {
+    if (!profileReportFun_) return std::string();
+    std::string report(profileReportFun_(nullptr, 0), '\0');
+    report.resize(profileReportFun_(&report[0], report.size() + 1));
+    return report;
+}
+
+
+Module::Module(const PluginLibrary &library, int id, int index) :
+    library_(&library), id_(id) {
+    Trace::Scope scope("createInstance", id_);
+    descriptor_.reset(library.createDescriptor(index));
+    plugin_.reset(library.createInstance(index));
+    if (!descriptor_ || !plugin_) throw std::runtime_error("cannot instantiate plugin " + library.path());
+    numChannels_ = std::max(numInputs(), numOutputs());
+    if (hasApi(3, 9)) layout_ = plugin_->getBufferLayout();
+    events_ = hasApi(3, 10) && layout_ == LAYOUT_PLANAR;
+    blockEvents_.reserve(256);
+}
+
+Module::Module(PluginDescriptor *descriptor, PluginInterface *plugin, int id) :
+    library_(nullptr), id_(id), descriptor_(descriptor), plugin_(plugin) {
+    if (!descriptor_ || !plugin_) throw std::runtime_error("cannot instantiate built-in plugin");
+    numChannels_ = std::max(numInputs(), numOutputs());
+    layout_ = plugin_->getBufferLayout();
+    events_ = layout_ == LAYOUT_PLANAR;
+    blockEvents_.reserve(256);
+}
+
+Module::~Module() {
+    Trace::Scope scope("deleteInstance", id_);
+    plugin_.reset();
+}
+
+void Module::prepare(double sampleRate, int maxBlockSize, const HostServices *services) {
+    Trace::Scope scope("prepare", id_);
+
+    maxBlockSize_ = maxBlockSize;
+    storage_.assign((size_t) numChannels_ * maxBlockSize, 0.0f);
+    resetChannels();
+
+    if (layout_ != LAYOUT_PLANAR) {
+        // processFrames() gets a 16 byte aligned buffer
+        frameStorage_.assign(layoutSize(layout_, numChannels_, maxBlockSize) + 4, 0.0f);
+        frames_ = (float *) (((uintptr_t) frameStorage_.data() + 15) & ~(uintptr_t) 15);
+    }
+
+    if (services && hasApi(3, 8)) plugin_->setHostServices(services);
+    plugin_->prepare(sampleRate, maxBlockSize);
+}
+
+void Module::resetChannels() {
+    channels_.resize(numChannels_);
+    for (int ch = 0; ch < numChannels_; ch++) channels_[ch] = storage_.data() + (size_t) ch * maxBlockSize_;
+}
+
+PluginEditorInterface *Module::editor() {
+    Trace::Scope scope("getEditor", id_);
+    return plugin_->getEditor();
+}
+
+void Module::frameStart() {
+    Trace::Scope scope("frameStart", id_);
+    plugin_->getEditor()->frameStart();
+}
+
+void Module::visibilityChanged(bool visible) {
+    Trace::Scope scope("visibilityChanged", id_);
+    plugin_->getEditor()->visibilityChanged(visible);
+}
+
+void Module::renderToImage(unsigned char *buffer, int width, int height) {
+    Trace::Scope scope("renderToImage", id_);
+    plugin_->getEditor()->renderToImage(buffer, width, height);
+}
+
+void Module::draw(int width, int height) {
+    Trace::Scope scope("draw", id_);
+    plugin_->getEditor()->draw(width, height);
+}
+
+void Module::buttonPressed(int n, bool val) {
+    Trace::Scope scope("buttonPressed", id_);
+    plugin_->buttonPressed(n, val);
+    postEvent(Event::BUTTON_PRESSED, n, val);
+}
+
+void Module::encoderPressed(int n, bool val) {
+    Trace::Scope scope("encoderPressed", id_);
+    plugin_->encoderPressed(n, val);
+    postEvent(Event::ENCODER_PRESSED, n, val);
+}
+
+std::vector<char> Module::getState() {
+    Trace::Scope scope("getState", id_);
+    void *buffer = nullptr;
+    size_t size = 0;
+    plugin_->getState(&buffer, &size);
+    std::vector<char> state((char *) buffer, (char *) buffer + (buffer ? size : 0));
+    delete[] (char *) buffer;
+    return state;
+}
+
+void Module::setState(const std::vector<char> &state) {
+    setState((void *) state.data(), state.size());
+}
+
+void Module::setState(void *data, size_t size) {
+    Trace::Scope scope("setState", id_);
+    plugin_->setState(data, size);
+}
+
+uint64_t Module::stateVersion() {
+    if (!hasApi(3, 14)) return 0;
+    return plugin_->stateVersion();
+}
+
+bool Module::getStateDelta(uint64_t since, std::vector<char> &delta, uint64_t &version) {
+    if (!hasApi(3, 14)) return false;
+    Trace::Scope scope("getStateDelta", id_);
+    void *buffer = nullptr;
+    size_t size = 0;
+    if (!plugin_->getStateDelta(since, &buffer, &size, &version)) return false;
+    delta.assign((char *) buffer, (char *) buffer + (buffer ? size : 0));
+    delete[] (char *) buffer;
+    return true;
+}
+
+bool Module::applyStateDelta(const std::vector<char> &delta) {
+    if (!hasApi(3, 14)) return false;
+    Trace::Scope scope("applyStateDelta", id_);
+    return plugin_->applyStateDelta(delta.data(), delta.size());
+}
+
+PluginStats *Module::stats() {
+    if (!hasApi(3, 6)) return nullptr;
+    return plugin_->getStats();
+}
+
+bool Module::memoryUsage(MemoryUsage &usage) {
+    usage = MemoryUsage();
+    if (!hasApi(3, 12)) return false;
+    Trace::Scope scope("getMemoryUsage", id_);
+    return plugin_->getMemoryUsage(usage);
+}
+
+size_t Module::hostBytes() const {
+    return storage_.capacity() * sizeof(float) + frameStorage_.capacity() * sizeof(float)
+           + channels_.capacity() * sizeof(float *) + blockEvents_.capacity() * sizeof(Event)
+           + eventQueue_.memoryBytes();
+}
+
+bool Module::reset() {
+    if (!hasApi(3, 13)) return false;
+    Trace::Scope scope("reset", id_);
+    if (!plugin_->reset()) return false;
+    EventQueue::Entry entry;
+    while (eventQueue_.pop(entry)) {}
+    blockEvents_.clear();
+    lastBlockNs_ = 0;
+    std::fill(storage_.begin(), storage_.end(), 0.0f);
+    std::fill(frameStorage_.begin(), frameStorage_.end(), 0.0f);
+    resetChannels();
+    return true;
+}
+
+bool Module::prepareState(const std::vector<char> &state) {
+    return prepareState(state.data(), state.size());
+}
+
+bool Module::prepareState(const void *data, size_t size) {
+    if (!hasApi(3, 7)) return false;
+    Trace::Scope scope("prepareState", id_);
+    return plugin_->prepareState(data, size);
+}
+
+void Module::postEvent(Event::Type type, int index, int value) {
+    EventQueue::Entry entry;
+    entry.timeNs = Trace::now();
+    entry.event.offset = 0;
+    entry.event.type = (uint16_t) type;
+    entry.event.index = (int16_t) index;
+    entry.event.value = value;
+    eventQueue_.push(entry);
+}
+
+void Module::encoderTurned(int n, int val) {
+    postEvent(Event::ENCODER_TURNED, n, val);
+}
+
+void Module::collectEvents(int numSamples) {
+    // events which arrived during the previous block get the same position in this one
+    const uint64_t now = Trace::now();
+    const uint64_t period = lastBlockNs_ ? now - lastBlockNs_ : 0;
+    blockEvents_.clear();
+    EventQueue::Entry entry;
+    while (blockEvents_.size() < blockEvents_.capacity() && eventQueue_.pop(entry)) {
+        uint64_t offset = 0;
+        if (period > 0 && entry.timeNs > lastBlockNs_) offset = (entry.timeNs - lastBlockNs_) * numSamples / period;
+        entry.event.offset = (uint32_t) std::min<uint64_t>(offset, numSamples > 0 ? numSamples - 1 : 0);
+        // the queue is in order of arrival, apart from races between threads
+        auto pos = blockEvents_.end();
+        while (pos != blockEvents_.begin() && (pos - 1)->offset > entry.event.offset) --pos;
+        blockEvents_.insert(pos, entry.event);
+    }
+    lastBlockNs_ = now;
+}
+
+bool Module::reconfigure(double sampleRate, int blockSize) {
+    if (blockSize <= 0 || blockSize > maxBlockSize_ || !hasApi(3, 11)) return false;
+    Trace::Scope scope("reconfigure", id_);
+    return plugin_->reconfigure(sampleRate, blockSize);
+}
+
+void Module::process(int numSamples, bool convertIn, bool convertOut) {
+    collectEvents(numSamples);
+    if (events_) {
+        Trace::Scope scope("process", id_);
+        plugin_->processEvents(channels_.data(), numChannels_, numSamples,
+                               blockEvents_.data(), (int) blockEvents_.size());
+        return;
+    }
+    // older plugins get the encoder turns at the start of the block, the
+    // other events have been passed to them on the UI thread already
+    for (const Event &e: blockEvents_) {
+        if (e.type != Event::ENCODER_TURNED) continue;
+        Trace::Scope scope("encoderTurned", id_);
+        plugin_->encoderTurned(e.index, e.value);
+    }
+    if (layout_ == LAYOUT_PLANAR) {
+        Trace::Scope scope("process", id_);
+        plugin_->process(channels_.data(), numChannels_, numSamples);
+        return;
+    }
+    if (convertIn) {
+        Trace::Scope scope("toLayout", id_);
+        toLayout(layout_, channels_.data(), numChannels_, numSamples, frames_);
+    }
+    processFrames(numSamples);
+    if (convertOut) {
+        Trace::Scope scope("fromLayout", id_);
+        fromLayout(layout_, frames_, numChannels_, numSamples, channels_.data());
+    }
+}
+
+void Module::processFrames(int numSamples) {
+    Trace::Scope scope("processFrames", id_);
+    plugin_->processFrames(frames_, numChannels_, numSamples);
+}
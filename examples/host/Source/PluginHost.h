@@ -0,0 +1,203 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include "EventQueue.h"
+
+#include <Percussa.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// minimal reference host, used to run plugins outside of the SSP software,
+// e.g. for soak tests, tracing and benchmarks. it loads plugin shared objects
+// the same way the SSP does, and calls the plugins from the same threads
+// as documented in Percussa.h.
+//
+// errors (e.g. a plugin which cannot be loaded) are reported by throwing
+// std::runtime_error.
+
+// a plugin shared object, loaded with dlopen()
+class PluginLibrary {
+public:
+    explicit PluginLibrary(const std::string &path);
+    ~PluginLibrary();
+
+    const std::string &path() const { return path_; }
+
+    // true if the plugin was built against API major.minor or later
+    bool hasApi(unsigned major, unsigned minor) const {
+        return apiMajor_ == major && apiMinor_ >= minor;
+    }
+
+    unsigned apiMajor() const { return apiMajor_; }
+    unsigned apiMinor() const { return apiMinor_; }
+
+    // number of plugins in the shared object, more than one for a bundle
+    // (see getPluginCount() in Percussa.h)
+    int pluginCount() const { return pluginCount_; }
+
+    Percussa::SSP::PluginDescriptor *createDescriptor(int index = 0) const;
+    Percussa::SSP::PluginInterface *createInstance(int index = 0) const;
+
+    // statistics of the plugin's profiling zones (see PercussaProfile.h),
+    // empty if the plugin was not built with SSP_PROFILING
+    std::string profileReport() const;
+
+private:
+    std::string path_;
+    void *handle_ = nullptr;
+    Percussa::SSP::DescriptorFun descriptorFun_ = nullptr;
+    Percussa::SSP::InstantiateFun instantiateFun_ = nullptr;
+    Percussa::SSP::DescriptorAtFun descriptorAtFun_ = nullptr;
+    Percussa::SSP::InstantiateAtFun instantiateAtFun_ = nullptr;
+    Percussa::SSP::ProfileReportFun profileReportFun_ = nullptr;
+    int pluginCount_ = 1;
+    unsigned apiMajor_ = 0;
+    unsigned apiMinor_ = 0;
+
+    PluginLibrary(const PluginLibrary &) = delete;
+    PluginLibrary &operator=(const PluginLibrary &) = delete;
+};
+
+
+// one plugin instance in a patch, owning its channel buffers.
+// all calls into the plugin go through this class, so they are traced.
+class Module {
+public:
+    // index selects the plugin of a bundle
+    Module(const PluginLibrary &library, int id, int index = 0);
+    // a plugin built into the host (e.g. in a benchmark), the module takes
+    // ownership of both, and assumes the plugin supports the current API.
+    Module(Percussa::SSP::PluginDescriptor *descriptor, Percussa::SSP::PluginInterface *plugin, int id);
+    ~Module();
+
+    int id() const { return id_; }
+    // e.g. when a pooled module is inserted into a patch again
+    void setId(int id) { id_ = id; }
+    // nullptr for built-in plugins
+    const PluginLibrary *library() const { return library_; }
+    bool hasApi(unsigned major, unsigned minor) const {
+        return library_ ? library_->hasApi(major, minor) : major == Percussa::SSP::API_MAJOR_VERSION;
+    }
+    const Percussa::SSP::PluginDescriptor &descriptor() const { return *descriptor_; }
+    Percussa::SSP::PluginInterface &plugin() { return *plugin_; }
+
+    int numInputs() const { return (int) descriptor_->inputChannelNames.size(); }
+    int numOutputs() const { return (int) descriptor_->outputChannelNames.size(); }
+    int numChannels() const { return numChannels_; }
+    float *channel(int ch) { return channels_[ch]; }
+    // use buffer (of at least maxBlockSize samples) for channel ch instead of the
+    // module's own, e.g. a buffer of a Graph's pool. call after prepare().
+    void setChannel(int ch, float *buffer) { channels_[ch] = buffer; }
+    // back to the module's own buffers
+    void resetChannels();
+
+    // the layout the plugin processes in (API 3.9, see BufferLayout). for the
+    // non-planar layouts, process() converts between channel() and frames().
+    int layout() const { return layout_; }
+    float *frames() { return frames_; }
+
+    // UI thread. services are passed to plugins supporting API 3.8,
+    // and must outlive the module.
+    void prepare(double sampleRate, int maxBlockSize, const Percussa::SSP::HostServices *services = nullptr);
+    Percussa::SSP::PluginEditorInterface *editor();
+    void frameStart();
+    void visibilityChanged(bool visible);
+    void renderToImage(unsigned char *buffer, int width, int height);
+    void draw(int width, int height);
+    void buttonPressed(int n, bool val);
+    void encoderPressed(int n, bool val);
+    std::vector<char> getState();
+    void setState(const std::vector<char> &state);
+    // without a copy, e.g. a state in a PresetBank. the plugin may write into data.
+    void setState(void *data, size_t size);
+
+    // UI thread, the version of the plugin's state (see stateVersion() in
+    // Percussa.h), 0 if the plugin does not support API 3.14, or does not
+    // version its state: getState() is the only way to know it then.
+    uint64_t stateVersion();
+    // UI thread, the changes of the state since version since, and the version
+    // they lead to. returns false if the plugin does not support API 3.14, or
+    // has no delta from that version, getState() has to be used then.
+    bool getStateDelta(uint64_t since, std::vector<char> &delta, uint64_t &version);
+    // UI thread, applies a delta after the state it was taken from was set
+    bool applyStateDelta(const std::vector<char> &delta);
+
+    // returns nullptr if the plugin does not support API 3.6
+    Percussa::SSP::PluginStats *stats();
+
+    // returns false if the plugin does not support API 3.12
+    bool memoryUsage(Percussa::SSP::MemoryUsage &usage);
+    // bytes the module holds for the plugin (channel buffers, events ...)
+    size_t hostBytes() const;
+
+    // UI thread, while process() is not called. puts the plugin back into
+    // the state of a new instance, keeping its prepare() (see reset() in
+    // Percussa.h), and drops pending events. returns false if the plugin does
+    // not support API 3.13 or cannot be reset, delete the module then.
+    bool reset();
+
+    // background thread, returns false if the plugin does not support
+    // API 3.7 or cannot stage this state, setState() has to be used then.
+    bool prepareState(const std::vector<char> &state);
+    bool prepareState(const void *data, size_t size);
+
+    // any thread. events are timestamped, and passed to plugins supporting
+    // API 3.10 with the next block (see processEvents() in Percussa.h).
+    // buttonPressed() and encoderPressed() post them too.
+    void postEvent(Percussa::SSP::Event::Type type, int index, int value);
+    // any thread, older plugins get encoderTurned() from process()
+    void encoderTurned(int n, int val);
+
+    // audio thread, between two blocks. returns false if the plugin does not
+    // support API 3.11, blockSize is larger than the one passed to prepare(),
+    // or the plugin needs a new prepare() for this configuration.
+    bool reconfigure(double sampleRate, int blockSize);
+
+    // audio thread, numSamples up to the block size passed to prepare(). for
+    // the non-planar layouts, with convertIn false the input samples are in
+    // frames() already, e.g. copied from a module with the same layout, and
+    // with convertOut false the output samples are only left in frames().
+    void process(int numSamples, bool convertIn = true, bool convertOut = true);
+
+private:
+    const PluginLibrary *library_;
+    int id_;
+    std::unique_ptr<Percussa::SSP::PluginDescriptor> descriptor_;
+    std::unique_ptr<Percussa::SSP::PluginInterface> plugin_;
+    int numChannels_ = 0;
+    int maxBlockSize_ = 0;
+    std::vector<float> storage_;
+    std::vector<float *> channels_;
+    int layout_ = Percussa::SSP::LAYOUT_PLANAR;
+    std::vector<float> frameStorage_;
+    float *frames_ = nullptr;
+    bool events_ = false;
+    EventQueue eventQueue_;
+    std::vector<Percussa::SSP::Event> blockEvents_;
+    uint64_t lastBlockNs_ = 0;
+
+    void collectEvents(int numSamples);
+    void processFrames(int numSamples);
+
+    Module(const Module &) = delete;
+    Module &operator=(const Module &) = delete;
+};
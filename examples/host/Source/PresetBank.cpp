@@ -0,0 +1,178 @@
+// see header file for license
+
+#include "PresetBank.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace PresetBankFormat;
+
+namespace {
+
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+uint32_t indexChecksum(const Header &header, const void *patches, const void *modules) {
+    Header h = header;
+    h.indexChecksum = 0;
+    uint32_t crc = crc32(&h, sizeof(h));
+    crc = crc32(patches, header.numPatches * sizeof(PatchEntry), crc);
+    return crc32(modules, header.numModules * sizeof(ModuleEntry), crc);
+}
+
+size_t align(size_t offset) {
+    return (offset + STATE_ALIGNMENT - 1) & ~(STATE_ALIGNMENT - 1);
+}
+
+}
+
+uint32_t PresetBankFormat::crc32(const void *data, size_t size, uint32_t crc) {
+    static const CrcTable table;
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table.entries[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+
+PresetBank::PresetBank(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open preset bank " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error("not a preset bank: " + path);
+    }
+    size_ = (size_t) st.st_size;
+    void *p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) throw std::runtime_error("cannot map preset bank " + path);
+    base_ = static_cast<char *>(p);
+    header_ = reinterpret_cast<const Header *>(base_);
+
+    const Header &h = *header_;
+    const uint64_t patchesEnd = h.patchesOffset + (uint64_t) h.numPatches * sizeof(PatchEntry);
+    const uint64_t modulesEnd = h.modulesOffset + (uint64_t) h.numModules * sizeof(ModuleEntry);
+    bool ok = memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION && h.fileSize == size_
+              && h.patchesOffset >= sizeof(Header) && patchesEnd <= size_ && h.modulesOffset >= patchesEnd
+              && modulesEnd <= size_ && h.patchesOffset % alignof(PatchEntry) == 0
+              && h.modulesOffset % alignof(ModuleEntry) == 0;
+    if (ok) {
+        patches_ = reinterpret_cast<const PatchEntry *>(base_ + h.patchesOffset);
+        modules_ = reinterpret_cast<const ModuleEntry *>(base_ + h.modulesOffset);
+        ok = indexChecksum(h, patches_, modules_) == h.indexChecksum;
+    }
+    for (uint32_t i = 0; ok && i < h.numPatches; i++) {
+        ok = (uint64_t) patches_[i].firstModule + patches_[i].numModules <= h.numModules;
+    }
+    for (uint32_t i = 0; ok && i < h.numModules; i++) {
+        ok = modules_[i].offset >= modulesEnd && modules_[i].offset <= size_
+             && modules_[i].size <= size_ - modules_[i].offset;
+    }
+    if (!ok) {
+        munmap(base_, size_);
+        throw std::runtime_error("damaged preset bank: " + path);
+    }
+}
+
+PresetBank::~PresetBank() {
+    munmap(base_, size_);
+}
+
+std::string PresetBank::patchName(int patch) const {
+    const char *name = patches_[patch].name;
+    return std::string(name, strnlen(name, NAME_SIZE));
+}
+
+PresetBank::State PresetBank::state(int patch, int m) const {
+    const ModuleEntry &e = modules_[patches_[patch].firstModule + m];
+    return State{e.uid, base_ + e.offset, (size_t) e.size};
+}
+
+bool PresetBank::verify() const {
+    for (uint32_t i = 0; i < header_->numModules; i++) {
+        const ModuleEntry &e = modules_[i];
+        if (crc32(base_ + e.offset, (size_t) e.size) != e.checksum) return false;
+    }
+    return true;
+}
+
+
+void PresetBankWriter::addPatch(const std::string &name, std::vector<Module> modules) {
+    patches_.push_back(Patch{name, std::move(modules)});
+}
+
+void PresetBankWriter::write(const std::string &path) const {
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.numPatches = (uint32_t) patches_.size();
+    header.patchesOffset = sizeof(Header);
+
+    std::vector<PatchEntry> patches(patches_.size());
+    std::vector<ModuleEntry> modules;
+    for (size_t i = 0; i < patches_.size(); i++) {
+        PatchEntry &p = patches[i];
+        memset(&p, 0, sizeof(p));
+        p.firstModule = (uint32_t) modules.size();
+        p.numModules = (uint32_t) patches_[i].modules.size();
+        strncpy(p.name, patches_[i].name.c_str(), NAME_SIZE);
+        for (const Module &m: patches_[i].modules) {
+            ModuleEntry e;
+            e.uid = m.uid;
+            e.checksum = crc32(m.state.data(), m.state.size());
+            e.offset = 0;
+            e.size = m.state.size();
+            modules.push_back(e);
+        }
+    }
+    header.numModules = (uint32_t) modules.size();
+    header.modulesOffset = header.patchesOffset + patches.size() * sizeof(PatchEntry);
+
+    size_t offset = align(header.modulesOffset + modules.size() * sizeof(ModuleEntry));
+    for (ModuleEntry &e: modules) {
+        e.offset = offset;
+        offset = align(offset + e.size);
+    }
+    header.fileSize = offset;
+    header.indexChecksum = indexChecksum(header, patches.data(), modules.data());
+
+    const std::string temp = path + ".tmp";
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot write preset bank " + temp);
+    static const char padding[STATE_ALIGNMENT] = {};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+              && fwrite(patches.data(), sizeof(PatchEntry), patches.size(), f) == patches.size()
+              && fwrite(modules.data(), sizeof(ModuleEntry), modules.size(), f) == modules.size();
+    size_t written = header.modulesOffset + modules.size() * sizeof(ModuleEntry);
+    size_t m = 0;
+    for (const Patch &p: patches_) {
+        for (const Module &module: p.modules) {
+            const ModuleEntry &e = modules[m++];
+            ok = ok && fwrite(padding, 1, e.offset - written, f) == e.offset - written
+                 && fwrite(module.state.data(), 1, module.state.size(), f) == module.state.size();
+            written = e.offset + e.size;
+        }
+    }
+    ok = ok && fwrite(padding, 1, header.fileSize - written, f) == header.fileSize - written;
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        remove(temp.c_str());
+        throw std::runtime_error("cannot write preset bank " + path);
+    }
+}
@@ -0,0 +1,138 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a bank of patches in one file, which is memory mapped, so switching to a
+// patch hands each module a pointer to its state inside the mapping, without
+// reading files or copying the states (see Module::setState()).
+//
+// file layout, little endian, all offsets from the start of the file:
+//   Header
+//   PatchEntry[numPatches]    a patch is a range of module entries
+//   ModuleEntry[numModules]   uid of the plugin, and where its state is
+//   state blobs               each aligned to STATE_ALIGNMENT
+// the header and both tables are covered by indexChecksum, which is checked
+// when the bank is opened, each state by the checksum in its entry, which
+// verify() checks (it touches every page of the file).
+//
+// the mapping is private and writable, so a plugin writing into the state
+// buffer passed to setState() only changes its own copy of that page, never
+// the file or the other patches. errors are reported with std::runtime_error.
+namespace PresetBankFormat {
+
+static constexpr char MAGIC[8] = {'S', 'S', 'P', 'B', 'A', 'N', 'K', '\0'};
+static constexpr uint32_t VERSION = 1;
+static constexpr size_t STATE_ALIGNMENT = 16;
+static constexpr size_t NAME_SIZE = 24;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t numPatches;
+    uint32_t numModules;
+    uint32_t indexChecksum;     // crc32 of header (with this field 0) and both tables
+    uint64_t patchesOffset;
+    uint64_t modulesOffset;
+    uint64_t fileSize;
+};
+
+struct PatchEntry {
+    uint32_t firstModule;
+    uint32_t numModules;
+    char name[NAME_SIZE];       // nul terminated, unless all NAME_SIZE bytes are used
+};
+
+struct ModuleEntry {
+    int32_t uid;
+    uint32_t checksum;          // crc32 of the state
+    uint64_t offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(Header) == 48, "bank header layout");
+static_assert(sizeof(PatchEntry) == 32, "bank patch entry layout");
+static_assert(sizeof(ModuleEntry) == 24, "bank module entry layout");
+
+uint32_t crc32(const void *data, size_t size, uint32_t crc = 0);
+
+}
+
+// read side, maps the whole file
+class PresetBank {
+public:
+    struct State {
+        int uid;
+        void *data;
+        size_t size;
+    };
+
+    // throws if the file cannot be mapped, or its index is damaged
+    explicit PresetBank(const std::string &path);
+    ~PresetBank();
+
+    int numPatches() const { return (int) header_->numPatches; }
+    std::string patchName(int patch) const;
+    int numModules(int patch) const { return (int) patches_[patch].numModules; }
+
+    // state of module m of the patch, valid while the bank is open
+    State state(int patch, int m) const;
+
+    // checks the states against their checksums, returns false if one is damaged
+    bool verify() const;
+
+    size_t fileSize() const { return size_; }
+
+private:
+    char *base_ = nullptr;
+    size_t size_ = 0;
+    const PresetBankFormat::Header *header_ = nullptr;
+    const PresetBankFormat::PatchEntry *patches_ = nullptr;
+    const PresetBankFormat::ModuleEntry *modules_ = nullptr;
+
+    PresetBank(const PresetBank &) = delete;
+    PresetBank &operator=(const PresetBank &) = delete;
+};
+
+// write side, collects the patches in memory
+class PresetBankWriter {
+public:
+    struct Module {
+        int uid;
+        std::vector<char> state;
+    };
+
+    void addPatch(const std::string &name, std::vector<Module> modules);
+
+    // writes a temporary file next to path, and renames it over path,
+    // so an open bank is never seen half written. throws on errors.
+    void write(const std::string &path) const;
+
+private:
+    struct Patch {
+        std::string name;
+        std::vector<Module> modules;
+    };
+
+    std::vector<Patch> patches_;
+};
@@ -0,0 +1,86 @@
+// see header file for license
+
+#include "StateLoader.h"
+#include "Trace.h"
+
+#include <algorithm>
+
+StateLoader::StateLoader() : thread_(&StateLoader::run, this) {
+}
+
+StateLoader::~StateLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        quit_ = true;
+    }
+    cond_.notify_all();
+    thread_.join();
+}
+
+void StateLoader::load(Module &module, std::vector<char> state) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // superseded by this one
+        fallback_.erase(std::remove_if(fallback_.begin(), fallback_.end(),
+                                       [&module](const Job &job) { return job.module == &module; }),
+                        fallback_.end());
+        queue_.push_back(Job{&module, std::move(state)});
+    }
+    cond_.notify_all();
+}
+
+void StateLoader::poll() {
+    std::deque<Job> fallback;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fallback_.empty()) return;
+        fallback.swap(fallback_);
+        applying_ = &fallback;
+    }
+    for (Job &job: fallback) job.module->setState(job.state);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        applying_ = nullptr;
+    }
+    cond_.notify_all();
+}
+
+bool StateLoader::queued(const Module *module) const {
+    return std::any_of(queue_.begin(), queue_.end(), [module](const Job &job) { return job.module == module; });
+}
+
+bool StateLoader::applying(const Module *module) const {
+    return applying_ && std::any_of(applying_->begin(), applying_->end(),
+                                    [module](const Job &job) { return job.module == module; });
+}
+
+void StateLoader::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return queue_.empty() && busy_ == 0; });
+    lock.unlock();
+    poll();
+}
+
+void StateLoader::run() {
+    Trace::registerThread("state loader");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        // not while poll() passes an earlier load of the module to setState()
+        cond_.wait(lock, [this] { return quit_ || (!queue_.empty() && !applying(queue_.front().module)); });
+        if (quit_) break;
+
+        Job job = std::move(queue_.front());
+        queue_.pop_front();
+        busy_++;
+        lock.unlock();
+
+        bool staged = job.module->prepareState(job.state);
+
+        lock.lock();
+        // unless a later load of the module supersedes it
+        if (!staged && !queued(job.module)) fallback_.push_back(std::move(job));
+        busy_--;
+        cond_.notify_all();
+    }
+}
@@ -0,0 +1,71 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include "PluginHost.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// loads plugin state without stalling the UI thread.
+// load() only queues the state, a background thread passes it to the
+// plugin's prepareState(), and the plugin swaps it in on the audio thread.
+// plugins without staged loads get their state through setState(), which
+// has to run on the UI thread, so poll() must be called once per frame.
+// the modules must outlive the loader, or at least their pending loads.
+// the loads of a module take effect in the order of load(): a load the plugin
+// could not stage is dropped once a later load of the module is queued, and
+// the plugin never gets prepareState() and setState() at the same time.
+class StateLoader {
+public:
+    StateLoader();
+    ~StateLoader();
+
+    // UI thread, returns immediately
+    void load(Module &module, std::vector<char> state);
+
+    // UI thread, calls setState() for loads the plugins could not stage
+    void poll();
+
+    // UI thread, blocks until all queued loads are done
+    void wait();
+
+private:
+    struct Job {
+        Module *module;
+        std::vector<char> state;
+    };
+
+    void run();
+    // with mutex_ taken
+    bool queued(const Module *module) const;
+    bool applying(const Module *module) const;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Job> queue_;
+    std::deque<Job> fallback_;
+    // the loads poll() passes to setState(), nullptr otherwise
+    const std::deque<Job> *applying_ = nullptr;
+    unsigned busy_ = 0;
+    bool quit_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,417 @@
+// see header file for license
+
+#include "Streamer.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+uint16_t le16(const unsigned char *p) {
+    return (uint16_t) (p[0] | p[1] << 8);
+}
+
+uint32_t le32(const unsigned char *p) {
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+}
+
+Streamer::Streamer() {
+    sem_init(&wake_, 0, 0);
+    thread_ = std::thread(&Streamer::run, this);
+}
+
+Streamer::~Streamer() {
+    quit_ = true;
+    sem_post(&wake_);
+    thread_.join();
+    sem_destroy(&wake_);
+    for (File &f: files_) {
+        if (f.fd >= 0) close(f.fd);
+    }
+}
+
+ssize_t Streamer::readFile(int fd, void *buffer, size_t bytes, off_t offset) {
+    return pread(fd, buffer, bytes, offset);
+}
+
+int Streamer::openFile(const char *path, int prefetchMs, FileInfo *info) {
+    File f;
+    f.fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (f.fd < 0) return -1;
+
+    // the chunks of a wav file, "fmt " has to come before "data"
+    bool ok = false, haveFormat = false;
+    unsigned char header[12];
+    off_t pos = 12;
+    if (pread(f.fd, header, 12, 0) == 12 && !memcmp(header, "RIFF", 4) && !memcmp(header + 8, "WAVE", 4)) {
+        unsigned char chunk[8];
+        while (pread(f.fd, chunk, 8, pos) == 8) {
+            const uint32_t size = le32(chunk + 4);
+            if (!memcmp(chunk, "fmt ", 4)) {
+                unsigned char fmt[40] = {};
+                if (pread(f.fd, fmt, std::min<uint32_t>(size, sizeof(fmt)), pos + 8) < 16) break;
+                uint16_t format = le16(fmt);
+                const int bits = le16(fmt + 14);
+                if (format == 0xfffe && size >= 26) format = le16(fmt + 24);  // WAVE_FORMAT_EXTENSIBLE
+                f.channels = le16(fmt + 2);
+                f.sampleRate = le32(fmt + 4);
+                if (format == 1 && bits == 16) f.format = PCM16;
+                else if (format == 1 && bits == 24) f.format = PCM24;
+                else if (format == 3 && bits == 32) f.format = FLOAT32;
+                else break;
+                f.bytesPerFrame = f.channels * bits / 8;
+                haveFormat = f.channels > 0;
+            } else if (!memcmp(chunk, "data", 4)) {
+                if (!haveFormat) break;
+                f.dataOffset = pos + 8;
+                struct stat st;
+                // files written without the final size have it at 0 or -1
+                uint64_t bytes = size;
+                if (fstat(f.fd, &st) == 0 && (bytes == 0 || bytes == 0xffffffffu || f.dataOffset + (off_t) bytes > st.st_size)) {
+                    bytes = (uint64_t) std::max<off_t>(st.st_size - f.dataOffset, 0);
+                }
+                f.frames = (int64_t) (bytes / f.bytesPerFrame);
+                ok = true;
+                break;
+            }
+            pos += 8 + size + (size & 1);
+        }
+    }
+    if (!ok) {
+        close(f.fd);
+        return -1;
+    }
+    posix_fadvise(f.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    f.prefetchFrames = std::min<int64_t>(f.frames, (int64_t) (f.sampleRate * std::max(prefetchMs, 0) / 1000.0));
+    if (f.prefetchFrames > 0) {
+        std::vector<char> data((size_t) (f.prefetchFrames * f.bytesPerFrame));
+        ssize_t n = pread(f.fd, data.data(), data.size(), f.dataOffset);
+        f.prefetchFrames = n > 0 ? n / f.bytesPerFrame : 0;
+        f.prefetch.resize((size_t) (f.prefetchFrames * f.channels));
+        convert(f, data.data(), f.prefetch.data(), f.prefetchFrames);
+    }
+
+    std::lock_guard<std::mutex> lock(lock_);
+    retire();
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (files_[i].fd >= 0) continue;
+        if (scratch_.size() < (size_t) CHUNK_FRAMES * f.bytesPerFrame) scratch_.resize((size_t) CHUNK_FRAMES * f.bytesPerFrame);
+        if (info) {
+            info->channels = f.channels;
+            info->frames = f.frames;
+            info->sampleRate = f.sampleRate;
+        }
+        files_[i] = std::move(f);
+        open_[i].store(true, std::memory_order_release);
+        return i;
+    }
+    close(f.fd);
+    return -1;
+}
+
+void Streamer::closeFile(int file) {
+    if (file < 0 || file >= MAX_FILES) return;
+    std::lock_guard<std::mutex> lock(lock_);
+    if (files_[file].fd < 0 || !open_[file].load(std::memory_order_relaxed)) return;
+    // pairs with start(), which announces the file before it checks open_
+    open_[file].store(false, std::memory_order_seq_cst);
+    retiring_++;
+    retire();
+}
+
+void Streamer::retire() {
+    if (retiring_ == 0) return;
+    for (int i = 0; i < MAX_FILES; i++) {
+        File &f = files_[i];
+        if (f.fd < 0 || open_[i].load(std::memory_order_relaxed)) continue;
+        bool played = false;
+        for (const Voice &v: voices_) {
+            // starting before playing: start() sets playingFile before it
+            // clears startingFile
+            if (v.startingFile.load(std::memory_order_seq_cst) == i ||
+                v.playingFile.load(std::memory_order_acquire) == i) {
+                played = true;
+                break;
+            }
+        }
+        if (played) continue;
+        close(f.fd);
+        f = File();
+        retiring_--;
+    }
+}
+
+int Streamer::createVoice(int channels, int ringFrames) {
+    if (channels <= 0 || ringFrames < 2) return -1;
+    std::lock_guard<std::mutex> lock(lock_);
+    for (int i = 0; i < MAX_VOICES; i++) {
+        Voice &v = voices_[i];
+        if (v.used) continue;
+        v.used = true;
+        v.channels = channels;
+        v.ringFrames = ringFrames;
+        v.ring.assign((size_t) ringFrames * channels, 0.0f);
+        v.file.store(-1, std::memory_order_relaxed);
+        v.consumed.store(tag(v.generation.load(std::memory_order_relaxed) + 1, 0), std::memory_order_relaxed);
+        v.underruns.store(0, std::memory_order_relaxed);
+        v.playingFile.store(-1, std::memory_order_relaxed);
+        v.startingFile.store(-1, std::memory_order_relaxed);
+        v.playing = false;
+        // the I/O thread sees a new generation, without a file
+        v.generation.fetch_add(1, std::memory_order_release);
+        return i;
+    }
+    return -1;
+}
+
+void Streamer::destroyVoice(int voice) {
+    if (voice < 0 || voice >= MAX_VOICES) return;
+    std::lock_guard<std::mutex> lock(lock_);
+    Voice &v = voices_[voice];
+    v.used = false;
+    v.playing = false;
+    v.playingFile.store(-1, std::memory_order_release);
+    std::vector<float>().swap(v.ring);
+}
+
+bool Streamer::start(int voice, int file, int64_t frame, bool loop) {
+    Voice &v = voices_[voice];
+    if (file < 0 || file >= MAX_FILES) return false;
+    // announced before open_ is checked, closeFile() clears open_ before it
+    // looks for voices of the file, so either this sees it closed, or it
+    // leaves the file to retire()
+    v.startingFile.store(file, std::memory_order_seq_cst);
+    const File &f = files_[file];
+    if (!open_[file].load(std::memory_order_seq_cst) || f.channels > v.channels) {
+        v.startingFile.store(-1, std::memory_order_release);
+        return false;
+    }
+    frame = std::min(std::max<int64_t>(frame, 0), f.frames);
+
+    v.file.store(file, std::memory_order_relaxed);
+    v.startFrame.store(frame, std::memory_order_relaxed);
+    v.loop.store(loop, std::memory_order_relaxed);
+    v.consumed.store(tag(v.generation.load(std::memory_order_relaxed) + 1, 0), std::memory_order_relaxed);
+    v.generation.fetch_add(1, std::memory_order_release);
+
+    v.playing = true;
+    v.position = 0;
+    v.prefetched = (uint64_t) prefetchedFrames(f, frame);
+    v.playingFile.store(file, std::memory_order_release);
+    v.startingFile.store(-1, std::memory_order_release);
+    if (sleeping_.exchange(false)) sem_post(&wake_);
+    return true;
+}
+
+void Streamer::stop(int voice) {
+    Voice &v = voices_[voice];
+    v.file.store(-1, std::memory_order_relaxed);
+    v.generation.fetch_add(1, std::memory_order_release);
+    v.playing = false;
+    v.playingFile.store(-1, std::memory_order_release);
+}
+
+int Streamer::read(int voice, float *buffer, int numFrames) {
+    Voice &v = voices_[voice];
+    if (!v.playing || numFrames <= 0) return 0;
+    const File &f = files_[v.file.load(std::memory_order_relaxed)];
+    const int ch = f.channels;
+    const int64_t start = v.startFrame.load(std::memory_order_relaxed);
+    const uint32_t generation = v.generation.load(std::memory_order_relaxed);
+
+    uint64_t n = (uint64_t) numFrames;
+    if (!v.loop.load(std::memory_order_relaxed)) {
+        const int64_t left = f.frames - start - (int64_t) v.position;
+        if (left <= 0) {
+            v.playing = false;
+            v.playingFile.store(-1, std::memory_order_release);
+            return 0;
+        }
+        n = std::min(n, (uint64_t) left);
+    }
+
+    uint64_t done = 0;
+    if (v.position < v.prefetched) {
+        done = std::min(n, v.prefetched - v.position);
+        memcpy(buffer, &f.prefetch[(size_t) (start + (int64_t) v.position) * ch], done * ch * sizeof(float));
+        v.position += done;
+        v.consumed.store(tag(generation, v.position), std::memory_order_release);
+    }
+    if (done == n) return (int) n;
+
+    // frames the I/O thread wrote for this start of the voice
+    const uint64_t filled = v.filled.load(std::memory_order_acquire);
+    const uint64_t ringPosition = v.position - v.prefetched;
+    const uint64_t written = tagged(filled, generation) ? filled & FRAMES_MASK : 0;
+    const uint64_t available = written > ringPosition ? written - ringPosition : 0;
+
+    const uint64_t k = std::min(n - done, available);
+    const uint64_t ringFrames = (uint64_t) v.ringFrames;
+    const uint64_t at = ringPosition % ringFrames;
+    const uint64_t first = std::min(k, ringFrames - at);
+    memcpy(buffer + done * ch, &v.ring[at * ch], first * ch * sizeof(float));
+    memcpy(buffer + (done + first) * ch, &v.ring[0], (k - first) * ch * sizeof(float));
+    done += k;
+    v.position += k;
+    v.consumed.store(tag(generation, v.position), std::memory_order_release);
+
+    if (done < n) {
+        memset(buffer + done * ch, 0, (n - done) * ch * sizeof(float));
+        v.underruns.fetch_add(1, std::memory_order_relaxed);
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // wake the I/O thread once there is room for a chunk
+    const uint64_t buffered = available - k;
+    if (ringFrames - buffered >= std::min<uint64_t>(CHUNK_FRAMES, ringFrames / 2) && sleeping_.exchange(false)) {
+        sem_post(&wake_);
+    }
+    return (int) n;
+}
+
+uint64_t Streamer::underruns(int voice) const {
+    return voices_[voice].underruns.load();
+}
+
+void Streamer::convert(const File &f, const char *data, float *out, int64_t frames) const {
+    const size_t samples = (size_t) (frames * f.channels);
+    const auto *p = reinterpret_cast<const unsigned char *>(data);
+    switch (f.format) {
+        case PCM16:
+            for (size_t i = 0; i < samples; i++) out[i] = (float) (int16_t) le16(p + 2 * i) * (1.0f / 32768.0f);
+            break;
+        case PCM24:
+            for (size_t i = 0; i < samples; i++) {
+                const int32_t x = (int32_t) ((uint32_t) p[3 * i] << 8 | (uint32_t) p[3 * i + 1] << 16 |
+                                             (uint32_t) p[3 * i + 2] << 24) >> 8;
+                out[i] = (float) x * (1.0f / 8388608.0f);
+            }
+            break;
+        case FLOAT32:
+            memcpy(out, data, samples * sizeof(float));
+            break;
+    }
+}
+
+bool Streamer::serveVoice() {
+    Voice *neediest = nullptr;
+    uint64_t least = ~0ull;
+    for (Voice &v: voices_) {
+        if (!v.used) continue;
+        const uint32_t generation = v.generation.load(std::memory_order_acquire);
+        if (generation != v.ioGeneration) {
+            // (re)started or stopped, continue after the prefetched frames
+            v.ioGeneration = generation;
+            v.ioFile = v.file.load(std::memory_order_relaxed);
+            v.ioLoop = v.loop.load(std::memory_order_relaxed);
+            v.ioWritten = 0;
+            v.ioPrefetched = 0;
+            v.ioDone = v.ioFile < 0 || files_[v.ioFile].fd < 0;
+            if (!v.ioDone) {
+                const File &f = files_[v.ioFile];
+                const int64_t start = v.startFrame.load(std::memory_order_relaxed);
+                v.ioPrefetched = (uint64_t) prefetchedFrames(f, start);
+                v.ioFrame = start + (int64_t) v.ioPrefetched;
+                if (v.ioFrame >= f.frames) {
+                    v.ioFrame = 0;
+                    v.ioDone = !v.ioLoop || f.frames == 0;
+                }
+            }
+            v.filled.store(tag(generation, 0), std::memory_order_release);
+        }
+        if (v.ioDone) continue;
+
+        const uint64_t inRing = buffered(v);
+        const uint64_t ringFrames = (uint64_t) v.ringFrames;
+        if (ringFrames - inRing < std::min<uint64_t>(CHUNK_FRAMES, ringFrames / 2)) continue;
+
+        // with the prefetched frames still to play
+        const uint64_t consumed = v.consumed.load(std::memory_order_relaxed) & FRAMES_MASK;
+        const uint64_t ahead = inRing + (consumed < v.ioPrefetched ? v.ioPrefetched - consumed : 0);
+        if (ahead < least) {
+            least = ahead;
+            neediest = &v;
+        }
+    }
+    if (!neediest) return false;
+    fill(*neediest);
+    return true;
+}
+
+void Streamer::fill(Voice &v) {
+    const File &f = files_[v.ioFile];
+    const int ch = f.channels;
+    const uint64_t ringFrames = (uint64_t) v.ringFrames;
+    int64_t frames = std::min<int64_t>({CHUNK_FRAMES, (int64_t) (ringFrames - buffered(v)), f.frames - v.ioFrame});
+    // restarted since the scan
+    if (frames <= 0) return;
+
+    ssize_t got = readFile(f.fd, scratch_.data(), (size_t) (frames * f.bytesPerFrame),
+                           f.dataOffset + (off_t) (v.ioFrame * f.bytesPerFrame));
+    if (got < f.bytesPerFrame) {
+        // read error, the voice underruns from here on
+        v.ioDone = true;
+        return;
+    }
+    bytesRead_.fetch_add((uint64_t) got, std::memory_order_relaxed);
+    frames = got / f.bytesPerFrame;
+
+    const uint64_t at = v.ioWritten % ringFrames;
+    const uint64_t first = std::min((uint64_t) frames, ringFrames - at);
+    convert(f, scratch_.data(), &v.ring[at * ch], (int64_t) first);
+    convert(f, scratch_.data() + first * f.bytesPerFrame, &v.ring[0], frames - (int64_t) first);
+
+    // restarted while reading, the next scan starts over
+    if (v.generation.load(std::memory_order_acquire) != v.ioGeneration) return;
+
+    v.ioWritten += (uint64_t) frames;
+    v.ioFrame += frames;
+    if (v.ioFrame >= f.frames) {
+        v.ioFrame = 0;
+        v.ioDone = !v.ioLoop;
+    }
+    v.filled.store(tag(v.ioGeneration, v.ioWritten), std::memory_order_release);
+}
+
+void Streamer::run() {
+    Trace::registerThread("streamer");
+
+    bool armed = false;
+    while (!quit_.load(std::memory_order_relaxed)) {
+        bool worked;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            retire();
+            worked = serveVoice();
+        }
+        if (worked) {
+            armed = false;
+            continue;
+        }
+        // look once more after announcing the sleep, read() may have freed
+        // room in between without waking us
+        if (!armed) {
+            sleeping_.store(true);
+            armed = true;
+            continue;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 50000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+        sem_timedwait(&wake_, &deadline);
+        sleeping_.store(false);
+        armed = false;
+    }
+}
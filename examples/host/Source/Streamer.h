@@ -0,0 +1,190 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <semaphore.h>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// reference implementation of Percussa::SSP::DiskStreamer. one I/O thread
+// serves all voices, always the one with the least frames buffered first, in
+// reads of up to CHUNK_FRAMES frames with pread(), converted to float into
+// the ring of the voice. a voice playing its prefetched frames counts them
+// as buffered. the rings are single producer (the I/O thread),
+// single consumer (the audio thread): the audio thread publishes the frames
+// it consumed, the I/O thread the frames it wrote, tagged with the generation
+// of the voice, which start() and stop() increment, so frames read for an
+// earlier start are never played. the I/O thread sleeps when all rings are
+// full, read() wakes it once space frees up.
+// the audio thread reads the prefetched start of a file straight from memory,
+// the I/O thread fills the ring with the frames after it.
+// closeFile() retires a file rather than freeing it: start() announces the
+// file it plays before it checks that the file is open, closeFile() marks
+// it closed before it checks that no voice plays it, so one of them sees
+// the other. a file still played is freed once its voices stopped, by the
+// I/O thread or the next openFile() or closeFile().
+class Streamer : public Percussa::SSP::DiskStreamer {
+public:
+    static constexpr int MAX_FILES = 256;
+    static constexpr int MAX_VOICES = 256;
+    static constexpr int CHUNK_FRAMES = 8192;
+
+    Streamer();
+    ~Streamer() override;
+
+    int openFile(const char *path, int prefetchMs, FileInfo *info) override;
+    void closeFile(int file) override;
+    int createVoice(int channels, int ringFrames) override;
+    void destroyVoice(int voice) override;
+
+    bool start(int voice, int file, int64_t frame, bool loop) override;
+    void stop(int voice) override;
+    int read(int voice, float *buffer, int numFrames) override;
+    uint64_t underruns(int voice) const override;
+
+    // the I/O thread, e.g. to set its priority
+    std::thread &thread() { return thread_; }
+
+    uint64_t bytesRead() const { return bytesRead_.load(); }
+    uint64_t totalUnderruns() const { return underruns_.load(); }
+
+protected:
+    // reads from the file for the I/O thread, a slow SD card can be simulated
+    // by overriding it
+    virtual ssize_t readFile(int fd, void *buffer, size_t bytes, off_t offset);
+
+private:
+    enum Format { PCM16, PCM24, FLOAT32 };
+
+    struct File {
+        int fd = -1;
+        Format format = PCM16;
+        int channels = 0;
+        int bytesPerFrame = 0;
+        int64_t frames = 0;
+        double sampleRate = 0.0;
+        off_t dataOffset = 0;
+        std::vector<float> prefetch;
+        int64_t prefetchFrames = 0;
+    };
+
+    // the voices are a cache line apart (see CACHE_LINE in Percussa.h)
+    struct Voice {
+        bool used = false;
+        int channels = 0;
+        int ringFrames = 0;
+        std::vector<float> ring;
+
+        // set by start() and stop(), before the generation changes
+        std::atomic<int> file{-1};
+        std::atomic<int64_t> startFrame{0};
+        std::atomic<bool> loop{false};
+        std::atomic<uint32_t> generation{0};
+
+        // frames played since start() by the audio thread, and frames of the
+        // ring written by the I/O thread, both tagged with the generation (see
+        // tag()), so neither thread takes the count of another start for its own
+        std::atomic<uint64_t> consumed{0};
+        std::atomic<uint64_t> filled{0};
+        std::atomic<uint64_t> underruns{0};
+        // the file the audio thread reads from, -1 once the voice stopped, and
+        // the file start() announces before it checks the file is open
+        std::atomic<int> playingFile{-1};
+        std::atomic<int> startingFile{-1};
+
+        // audio thread: frames played since start(), the first prefetched of
+        // them come from the file's prefetch buffer
+        bool playing = false;
+        uint64_t position = 0;
+        uint64_t prefetched = 0;
+
+        // I/O thread
+        uint32_t ioGeneration = 0;
+        int ioFile = -1;
+        bool ioLoop = false;
+        uint64_t ioPrefetched = 0;
+        uint64_t ioWritten = 0;
+        int64_t ioFrame = 0;
+        bool ioDone = true;
+
+        char pad_[Percussa::SSP::CACHE_LINE];
+    };
+
+    static constexpr uint64_t FRAMES_MASK = (1ull << 40) - 1;
+
+    static uint64_t tag(uint32_t generation, uint64_t frames) {
+        return (uint64_t) (generation & 0xffffff) << 40 | frames;
+    }
+
+    static bool tagged(uint64_t value, uint32_t generation) {
+        return value >> 40 == (generation & 0xffffff);
+    }
+
+    static int64_t prefetchedFrames(const File &f, int64_t frame) {
+        return frame < f.prefetchFrames ? f.prefetchFrames - frame : 0;
+    }
+
+    void convert(const File &f, const char *data, float *out, int64_t frames) const;
+    // frames of the ring the audio thread has not played yet, at most the
+    // ring. the whole ring once the voice is restarted: the I/O thread serves
+    // it again after it saw the new generation.
+    static uint64_t buffered(const Voice &v) {
+        const uint64_t value = v.consumed.load(std::memory_order_acquire);
+        const uint64_t ringFrames = (uint64_t) v.ringFrames;
+        if (!tagged(value, v.ioGeneration)) return ringFrames;
+        const uint64_t consumed = value & FRAMES_MASK;
+        const uint64_t played = consumed > v.ioPrefetched ? std::min(consumed - v.ioPrefetched, v.ioWritten) : 0;
+        return std::min(v.ioWritten - played, ringFrames);
+    }
+
+    // reads the next chunk for the voice closest to running out, false if no
+    // voice has room for one
+    bool serveVoice();
+    void fill(Voice &v);
+    // frees the closed files no voice plays anymore, with lock_ taken
+    void retire();
+    void run();
+
+    File files_[MAX_FILES];
+    // true from openFile() to closeFile(), start() plays open files only
+    std::atomic<bool> open_[MAX_FILES]{};
+    Voice voices_[MAX_VOICES];
+    // taken by the UI thread when it opens or closes files and voices, and by
+    // the I/O thread while it reads, never by the audio thread
+    std::mutex lock_;
+    // closed files not freed yet
+    int retiring_ = 0;
+
+    std::vector<char> scratch_;
+    sem_t wake_;
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> quit_{false};
+    std::atomic<uint64_t> bytesRead_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::thread thread_;
+
+    Streamer(const Streamer &) = delete;
+    Streamer &operator=(const Streamer &) = delete;
+};
@@ -0,0 +1,151 @@
+// see header file for license
+
+#include "ThreadPolicy.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using Percussa::SSP::ThreadRegistry;
+
+namespace {
+
+// what registerThread() did to the calling thread, undone by unregisterThread()
+struct Registration {
+    bool registered = false;
+    ThreadRegistry::Role role = ThreadRegistry::THREAD_IO;
+    void *lockedStack = nullptr;
+    size_t lockedBytes = 0;
+};
+
+thread_local Registration registration_;
+
+std::string describeCores(const cpu_set_t &set) {
+    std::string s;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &set)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) last++;
+        if (!s.empty()) s += ",";
+        s += std::to_string(cpu);
+        if (last > cpu) s += "-" + std::to_string(last);
+        cpu = last;
+    }
+    return s;
+}
+
+// locks the stack of the calling thread from LOCKED_STACK below the caller up
+// to its top, which faults the pages in, so the thread never faults on them
+bool lockStack(Registration &r) {
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) return false;
+    void *addr = nullptr;
+    size_t size = 0;
+    pthread_attr_getstack(&attr, &addr, &size);
+    pthread_attr_destroy(&attr);
+
+    const uintptr_t page = (uintptr_t) sysconf(_SC_PAGESIZE);
+    const uintptr_t low = (uintptr_t) addr, high = low + size;
+    char here;
+    uintptr_t start = (uintptr_t) &here > low + ThreadPolicy::LOCKED_STACK
+                      ? (uintptr_t) &here - ThreadPolicy::LOCKED_STACK : low;
+    start = (start + page - 1) & ~(page - 1);
+    if (start >= high || mlock((void *) start, high - start) != 0) return false;
+    r.lockedStack = (void *) start;
+    r.lockedBytes = high - start;
+    return true;
+}
+
+}
+
+ThreadPolicy::ThreadPolicy(int numCores, int backgroundCores) {
+    for (auto &n: registered_) n.store(0);
+    CPU_ZERO(&all_);
+    CPU_ZERO(&realtime_);
+    CPU_ZERO(&background_);
+
+    // the cores this process may use, in order
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        CPU_ZERO(&allowed);
+        for (int cpu = 0; cpu < std::max(1, numCores); cpu++) CPU_SET(cpu, &allowed);
+    }
+    int cores[CPU_SETSIZE];
+    int n = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && n < std::max(1, numCores); cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) cores[n++] = cpu;
+    }
+
+    // at least two real-time cores, for the audio thread and a worker
+    backgroundCores = std::min(std::max(backgroundCores, 0), n - 2);
+    split_ = backgroundCores > 0;
+    for (int i = 0; i < n; i++) {
+        CPU_SET(cores[i], &all_);
+        if (!split_ || i < n - backgroundCores) CPU_SET(cores[i], &realtime_);
+        if (!split_ || i >= n - backgroundCores) CPU_SET(cores[i], &background_);
+    }
+}
+
+bool ThreadPolicy::apply(pthread_t thread, Role role) {
+    struct sched_param param = {};
+    int policy = SCHED_OTHER;
+    switch (role) {
+        case THREAD_DSP:
+            policy = SCHED_FIFO;
+            param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 2;
+            break;
+        case THREAD_COMPUTE:
+            policy = SCHED_IDLE;
+            break;
+        default:
+            break;
+    }
+    bool ok = pthread_setschedparam(thread, policy, &param) == 0;
+    const cpu_set_t &cores = role == THREAD_DSP ? realtime_ : background_;
+    ok = pthread_setaffinity_np(thread, sizeof(cores), &cores) == 0 && ok;
+    return ok;
+}
+
+bool ThreadPolicy::pinRealtime(pthread_t thread) {
+    return pthread_setaffinity_np(thread, sizeof(realtime_), &realtime_) == 0;
+}
+
+bool ThreadPolicy::registerThread(Role role, const char *name) {
+    if ((int) role < 0 || (int) role >= NUM_ROLES) return false;
+    if (registration_.registered) unregisterThread();
+
+    if (name) {
+        // the kernel keeps 15 characters
+        char shortName[16] = {};
+        snprintf(shortName, sizeof(shortName), "%s", name);
+        pthread_setname_np(pthread_self(), shortName);
+        if (Trace::enabled()) Trace::registerThread(name);
+    }
+
+    bool ok = apply(pthread_self(), role);
+    if (role == THREAD_DSP) ok = lockStack(registration_) && ok;
+    registration_.registered = true;
+    registration_.role = role;
+    registered_[role].fetch_add(1);
+    return ok;
+}
+
+void ThreadPolicy::unregisterThread() {
+    Registration &r = registration_;
+    if (!r.registered) return;
+
+    struct sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    pthread_setaffinity_np(pthread_self(), sizeof(all_), &all_);
+    if (r.lockedBytes) munlock(r.lockedStack, r.lockedBytes);
+    registered_[r.role].fetch_sub(1);
+    r = Registration();
+}
+
+std::string ThreadPolicy::describe() const {
+    if (!split_) return "all threads on cores " + describeCores(all_);
+    return "real-time " + describeCores(realtime_) + ", background " + describeCores(background_);
+}
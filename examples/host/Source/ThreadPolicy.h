@@ -0,0 +1,82 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <atomic>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <thread>
+
+// reference implementation of Percussa::SSP::ThreadRegistry. the cores are
+// split in two sets: the real-time cores, for the audio thread, the host's
+// DSP workers and THREAD_DSP threads, and the background cores, for
+// THREAD_COMPUTE and THREAD_IO threads, so these never preempt real-time work
+// or pollute its caches. with fewer than 3 cores there is nothing to split,
+// all threads may run on all cores, and only their priorities differ.
+//
+//   role             scheduling            cores        locked in memory
+//   audio thread     SCHED_FIFO, max - 1   real-time    (set by AudioThread)
+//   THREAD_DSP       SCHED_FIFO, max - 2   real-time    256 kB of stack
+//   THREAD_IO        SCHED_OTHER           background
+//   THREAD_COMPUTE   SCHED_IDLE            background
+//
+// real-time priority needs CAP_SYS_NICE or an rtprio limit (ulimit -r),
+// locking a stack a memlock limit (ulimit -l) of at least its size.
+class ThreadPolicy : public Percussa::SSP::ThreadRegistry {
+public:
+    static constexpr size_t LOCKED_STACK = 256 * 1024;
+
+    // the last backgroundCores of numCores are the background cores
+    explicit ThreadPolicy(int numCores = (int) std::thread::hardware_concurrency(), int backgroundCores = 1);
+
+    bool registerThread(Role role, const char *name) override;
+    void unregisterThread() override;
+
+    // sets the scheduling and cores of the role for any thread, e.g. the
+    // host's DSP workers. does not name it, or lock its stack.
+    bool apply(pthread_t thread, Role role);
+
+    // keeps a thread on the real-time cores, without changing its
+    // scheduling, e.g. the audio thread
+    bool pinRealtime(pthread_t thread);
+
+    int realtimeCores() const { return CPU_COUNT(&realtime_); }
+    int backgroundCores() const { return split_ ? CPU_COUNT(&background_) : 0; }
+
+    // threads currently registered with the role
+    int registered(Role role) const { return registered_[role].load(); }
+
+    // e.g. "real-time 0-2, background 3"
+    std::string describe() const;
+
+private:
+    static constexpr int NUM_ROLES = 3;
+
+    cpu_set_t all_;
+    cpu_set_t realtime_;
+    cpu_set_t background_;
+    bool split_ = false;
+    std::atomic<int> registered_[NUM_ROLES];
+
+    ThreadPolicy(const ThreadPolicy &) = delete;
+    ThreadPolicy &operator=(const ThreadPolicy &) = delete;
+};
@@ -0,0 +1,209 @@
+// see header file for license
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sched.h>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace Trace {
+
+std::atomic<bool> enabled_{false};
+
+namespace {
+
+struct ThreadBuffer {
+    // taken over by another thread after the owner exited. name, tid, first
+    // and owner change with lock_ taken.
+    std::string name;
+    long tid = 0;
+    bool exited = false;
+    // the first event of the current owner, and the number of owners so far
+    uint64_t first = 0;
+    std::atomic<uint32_t> owner{0};
+    // number of events ever written, the ring slot is head % EVENTS_PER_THREAD
+    std::atomic<uint64_t> head{0};
+    Event events[EVENTS_PER_THREAD];
+};
+
+static_assert((EVENTS_PER_THREAD & (EVENTS_PER_THREAD - 1)) == 0, "ring size must be a power of two");
+
+std::mutex lock_;
+std::atomic<ThreadBuffer *> buffers_[MAX_THREADS];
+std::atomic<unsigned> numBuffers_{0};
+
+thread_local ThreadBuffer *current_ = nullptr;
+// events of the thread are dropped until it registers
+thread_local bool dropped_ = false;
+
+// hands the buffer of the thread on when it exits
+struct Release {
+    ~Release() {
+        if (!current_) return;
+        std::lock_guard<std::mutex> lock(lock_);
+        current_->exited = true;
+        current_ = nullptr;
+    }
+};
+
+thread_local Release release_;
+
+ThreadBuffer *threadBuffer(const char *name) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (current_) {
+        if (name) current_->name = name;
+        return current_;
+    }
+
+    ThreadBuffer *buffer = nullptr;
+    const unsigned n = numBuffers_.load(std::memory_order_relaxed);
+    for (unsigned i = 0; i < n && !buffer; i++) {
+        ThreadBuffer *b = buffers_[i].load(std::memory_order_relaxed);
+        if (b->exited) buffer = b;
+    }
+    if (!buffer) {
+        if (n >= MAX_THREADS) {
+            // out of buffers, events of this thread are dropped
+            dropped_ = true;
+            return nullptr;
+        }
+        buffer = new ThreadBuffer;
+        // faulted in now rather than by the first events, which may be
+        // recorded on a real-time thread
+        memset(buffer->events, 0, sizeof(buffer->events));
+        buffers_[n].store(buffer, std::memory_order_release);
+        numBuffers_.store(n + 1, std::memory_order_release);
+    }
+    buffer->tid = syscall(SYS_gettid);
+    buffer->name = name ? name : "thread " + std::to_string(buffer->tid);
+    buffer->exited = false;
+    buffer->first = buffer->head.load(std::memory_order_relaxed);
+    buffer->owner.fetch_add(1, std::memory_order_relaxed);
+    current_ = buffer;
+    dropped_ = false;
+    // odr-used, so it is constructed, and destroyed at the exit of the thread
+    (void) &release_;
+    return buffer;
+}
+
+bool realtime() {
+    const int policy = sched_getscheduler(0);
+    return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+void writeEscaped(FILE *f, const std::string &s) {
+    for (char c: s) {
+        if (c == '"' || c == '\\') fputc('\\', f);
+        if ((unsigned char) c >= 0x20) fputc(c, f);
+    }
+}
+
+}
+
+void enable(bool b) {
+    enabled_.store(b, std::memory_order_relaxed);
+}
+
+void registerThread(const char *name) {
+    threadBuffer(name);
+}
+
+void record(const char *name, int32_t id, uint64_t begin, uint64_t end) {
+    ThreadBuffer *buffer = current_;
+    if (!buffer) {
+        if (dropped_) return;
+        // a real-time thread which did not register, its events are dropped
+        // rather than allocating for them
+        if (realtime()) {
+            dropped_ = true;
+            return;
+        }
+        buffer = threadBuffer(nullptr);
+        if (!buffer) return;
+    }
+
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event &e = buffer->events[head & (EVENTS_PER_THREAD - 1)];
+    e.begin = begin;
+    e.end = end;
+    e.name = name;
+    e.id = id;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+bool writeJson(const std::string &path) {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) return false;
+
+    struct Copy {
+        std::string name;
+        long tid;
+        std::vector<Event> events;
+    };
+    std::vector<Copy> copies;
+    uint64_t t0 = UINT64_MAX;
+
+    unsigned n = std::min<unsigned>(numBuffers_.load(), MAX_THREADS);
+    for (unsigned i = 0; i < n; i++) {
+        const ThreadBuffer *buffer = buffers_[i].load(std::memory_order_acquire);
+        if (!buffer) continue;
+
+        Copy copy;
+        uint64_t first;
+        uint32_t owner;
+        {
+            std::lock_guard<std::mutex> lock(lock_);
+            copy.name = buffer->name;
+            copy.tid = buffer->tid;
+            first = buffer->first;
+            owner = buffer->owner.load(std::memory_order_relaxed);
+        }
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t start = std::max(head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0, first);
+        for (uint64_t j = start; j < head; j++) {
+            copy.events.push_back(buffer->events[j & (EVENTS_PER_THREAD - 1)]);
+        }
+
+        // drop the events the writer may have overwritten while we copied them
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = buffer->head.load(std::memory_order_relaxed);
+        if (after >= start + EVENTS_PER_THREAD) {
+            uint64_t lost = std::min<uint64_t>(after - EVENTS_PER_THREAD + 1 - start, copy.events.size());
+            copy.events.erase(copy.events.begin(), copy.events.begin() + lost);
+        }
+        // taken over by another thread while we copied, whose events these may be
+        if (buffer->owner.load(std::memory_order_relaxed) != owner) continue;
+
+        for (const Event &e: copy.events) t0 = std::min(t0, e.begin);
+        copies.push_back(std::move(copy));
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const Copy &copy: copies) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,\"args\":{\"name\":\"",
+                first ? "" : ",\n", copy.tid);
+        writeEscaped(f, copy.name);
+        fprintf(f, "\"}}");
+        first = false;
+
+        for (const Event &e: copy.events) {
+            fprintf(f, ",\n{\"name\":\"");
+            writeEscaped(f, e.name);
+            fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f",
+                    copy.tid, (e.begin - t0) / 1000.0, (e.end - e.begin) / 1000.0);
+            if (e.id >= 0) fprintf(f, ",\"args\":{\"module\":%d}", (int) e.id);
+            fprintf(f, "}");
+        }
+    }
+    fprintf(f, "\n]}\n");
+
+    return fclose(f) == 0;
+}
+
+}
@@ -0,0 +1,102 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <time.h>
+
+// timeline tracing for the host harness.
+// every thread writes into its own preallocated ring buffer, so recording an
+// event is a couple of stores without locks or allocations. when the ring is
+// full the oldest events are overwritten. the collected events can be written
+// out as Chrome trace JSON, which can be opened in chrome://tracing or in
+// the Perfetto UI (https://ui.perfetto.dev).
+//
+// threads which must not allocate (the audio thread!) call registerThread()
+// before they start their real-time work: events of real-time threads which
+// did not are dropped. other threads get a buffer on their first traced call.
+// the buffer of a thread is reused by another thread once it exited, its
+// events are written out until then.
+
+namespace Trace {
+
+static constexpr unsigned EVENTS_PER_THREAD = 1 << 16;
+static constexpr unsigned MAX_THREADS = 64;
+
+struct Event {
+    uint64_t begin;
+    uint64_t end;
+    const char *name;   // must be a string literal, only the pointer is stored
+    int32_t id;         // e.g. module index, -1 if not used
+};
+
+inline uint64_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+extern std::atomic<bool> enabled_;
+
+// globally switch recording on or off, off by default.
+void enable(bool b);
+
+inline bool enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+}
+
+// allocate the ring buffer of the calling thread, with its pages faulted in,
+// and give the thread a name, which is shown in the trace viewer.
+void registerThread(const char *name);
+
+// record a complete event, called from any thread.
+void record(const char *name, int32_t id, uint64_t begin, uint64_t end);
+
+// write all recorded events as Chrome trace JSON.
+// safe to call while other threads are still recording, events which get
+// overwritten while they are being copied are dropped, as are the events of
+// a thread whose buffer another thread takes over meanwhile.
+bool writeJson(const std::string &path);
+
+// the name is a string literal, as only the pointer is recorded. the
+// constructor takes an array, so a pointer to a temporary string does not compile.
+class Scope {
+public:
+    template<size_t N>
+    explicit Scope(const char (&name)[N], int32_t id = -1) :
+        name_(name), id_(id), begin_(enabled() ? now() : 0) {
+    }
+
+    ~Scope() {
+        if (begin_) record(name_, id_, begin_, now());
+    }
+
+private:
+    const char *name_;
+    int32_t id_;
+    uint64_t begin_;
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+};
+
+}
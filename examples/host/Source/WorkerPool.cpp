@@ -0,0 +1,127 @@
+// see header file for license
+
+#include "WorkerPool.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <time.h>
+
+namespace {
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__arm__) || defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}
+
+WorkerPool::WorkerPool(int numWorkers) {
+    sem_init(&wakeup_, 0, 0);
+    for (int i = 0; i < numWorkers; i++) threads_.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool() {
+    quit_ = true;
+    for (size_t i = 0; i < threads_.size(); i++) sem_post(&wakeup_);
+    for (auto &t: threads_) t.join();
+    sem_destroy(&wakeup_);
+}
+
+void WorkerPool::submit(Batch &batch) {
+    batch.done.store(0, std::memory_order_relaxed);
+    batch.slot = -1;
+    if (batch.count <= 0) return;
+
+    for (int i = 0; i < MAX_BATCHES; i++) {
+        Slot &s = slots_[i];
+        uint64_t t = s.ticket.load(std::memory_order_acquire);
+        uint32_t next = (uint32_t) t;
+        if (next == LOCKED || next < s.count.load(std::memory_order_relaxed)) continue;
+
+        // the slot is free, lock it while we fill it in
+        uint32_t generation = (uint32_t) (t >> 32) + 1;
+        if (!s.ticket.compare_exchange_strong(t, ((uint64_t) generation << 32) | LOCKED,
+                                              std::memory_order_acquire)) {
+            continue;
+        }
+        s.fun.store(batch.fun, std::memory_order_relaxed);
+        s.context.store(batch.context, std::memory_order_relaxed);
+        s.count.store((uint32_t) batch.count, std::memory_order_relaxed);
+        s.batch.store(&batch, std::memory_order_relaxed);
+        s.ticket.store((uint64_t) generation << 32, std::memory_order_release);
+
+        batch.slot = i;
+        batch.generation = generation;
+
+        // the caller of join() runs tasks as well, so wake one worker less
+        int wake = std::min(batch.count - 1, numWorkers());
+        for (int w = 0; w < wake; w++) sem_post(&wakeup_);
+        return;
+    }
+}
+
+void WorkerPool::join(Batch &batch) {
+    if (batch.slot < 0) {
+        // batch could not be submitted (or was empty), run it here
+        for (int i = batch.done.load(std::memory_order_relaxed); i < batch.count; i++) batch.fun(batch.context, i);
+        batch.done.store(batch.count, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot &s = slots_[batch.slot];
+    while (runTask(s, false, batch.generation)) {}
+    // all tasks are claimed, workers may still be running the last ones. spin
+    // for a few microseconds, then sleep, so a worker preempted by this thread
+    // (e.g. one running at a lower priority than the audio thread, on the
+    // same core) gets the cpu to finish its task.
+    for (int spins = 0; batch.done.load(std::memory_order_acquire) < batch.count; spins++) {
+        if (spins < SPIN_LIMIT) {
+            cpuRelax();
+        } else {
+            struct timespec ts = {0, SLEEP_NS};
+            nanosleep(&ts, nullptr);
+        }
+    }
+    batch.slot = -1;
+}
+
+bool WorkerPool::runTask(Slot &slot, bool anyGeneration, uint32_t generation) {
+    uint64_t t = slot.ticket.load(std::memory_order_acquire);
+    for (;;) {
+        uint32_t next = (uint32_t) t;
+        if (next == LOCKED) return false;
+        if (!anyGeneration && (uint32_t) (t >> 32) != generation) return false;
+        if (next >= slot.count.load(std::memory_order_relaxed)) return false;
+
+        TaskFun fun = slot.fun.load(std::memory_order_relaxed);
+        void *context = slot.context.load(std::memory_order_relaxed);
+        Batch *batch = slot.batch.load(std::memory_order_relaxed);
+
+        // if the slot was reused since we read the ticket, the generation
+        // differs and the compare-and-swap fails
+        if (slot.ticket.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            fun(context, (int) next);
+            // last access to the batch, join() may return right after this
+            batch->done.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+void WorkerPool::run() {
+    Trace::registerThread("worker");
+
+    while (!quit_.load(std::memory_order_relaxed)) {
+        sem_wait(&wakeup_);
+        bool worked;
+        do {
+            worked = false;
+            for (Slot &s: slots_) {
+                while (runTask(s, true, 0)) worked = true;
+            }
+        } while (worked);
+    }
+}
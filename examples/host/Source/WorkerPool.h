@@ -0,0 +1,76 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <semaphore.h>
+
+// reference implementation of Percussa::SSP::TaskPool.
+// submitted batches are put in one of a fixed number of slots, from which
+// the workers (and the thread calling join()) claim task indices with a
+// compare-and-swap on the slot's ticket (generation << 32 | next index).
+// the generation changes whenever a slot is reused, so a worker which read
+// an old batch can never claim a task of the new one. submit() and join()
+// do not lock or allocate, workers are woken with a semaphore.
+// when all slots are in use, join() runs the tasks of the batch itself.
+// join() runs the unclaimed tasks, then waits for the ones workers are
+// running, spinning for at most SPIN_LIMIT rounds before it sleeps. it is
+// only as real-time safe as the workers' scheduling: run them at real-time
+// priority (ThreadPolicy::THREAD_DSP), or the audio thread waits for them.
+class WorkerPool : public Percussa::SSP::TaskPool {
+public:
+    explicit WorkerPool(int numWorkers);
+    ~WorkerPool() override;
+
+    int numWorkers() const override { return (int) threads_.size(); }
+    void submit(Batch &batch) override;
+    void join(Batch &batch) override;
+
+    // threads of the pool, e.g. to set their priority or affinity
+    std::vector<std::thread> &threads() { return threads_; }
+
+private:
+    static constexpr int MAX_BATCHES = 64;
+    static constexpr uint32_t LOCKED = 0xffffffffu;
+    // join() waits for running tasks by spinning, and then by sleeping
+    static constexpr int SPIN_LIMIT = 4096;
+    static constexpr long SLEEP_NS = 20000;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> ticket{0};
+        std::atomic<TaskFun> fun{nullptr};
+        std::atomic<void *> context{nullptr};
+        std::atomic<uint32_t> count{0};
+        std::atomic<Batch *> batch{nullptr};
+    };
+
+    // claims and runs one task in the slot, returns false if there is none.
+    // with anyGeneration false, only tasks of the given generation are run.
+    bool runTask(Slot &slot, bool anyGeneration, uint32_t generation);
+    void run();
+
+    Slot slots_[MAX_BATCHES];
+    sem_t wakeup_;
+    std::atomic<bool> quit_{false};
+    std::vector<std::thread> threads_;
+};
@@ -0,0 +1,145 @@
+// see ../Source/PluginHost.h for license
+
+// cache misses per block of a patch of simple plugins, with their buffers
+// allocated with malloc (interleaved with other allocations, as happens when
+// many plugins are created one after another), or from the host arena.
+//
+// usage: bench_arena [-n plugins] [-b blocksize] [-c channels]
+
+#include "Bench.h"
+#include "Arena.h"
+#include "PerfCounter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct FakePlugin {
+    std::vector<float *> in;
+    std::vector<float *> out;
+    float *state = nullptr;
+};
+
+static constexpr int STATE_FLOATS = 256;
+
+// one block of a 'plugin': filter all inputs into the outputs
+void process(FakePlugin &p, int blockSize) {
+    for (size_t ch = 0; ch < p.in.size(); ch++) {
+        const float *x = p.in[ch];
+        float *y = p.out[ch];
+        float z = p.state[ch];
+        for (int i = 0; i < blockSize; i++) {
+            z += 0.1f * (x[i] - z);
+            y[i] = z;
+        }
+        p.state[ch] = z;
+    }
+}
+
+struct Result {
+    double nsPerBlock;
+    double missesPerBlock;
+    bool counted;
+};
+
+Result run(std::vector<FakePlugin> &plugins, int blockSize, int blocks) {
+    PerfCounter misses = PerfCounter::cacheMisses();
+    for (int b = 0; b < blocks / 10; b++) for (auto &p: plugins) process(p, blockSize);
+
+    misses.reset();
+    misses.enable();
+    uint64_t t0 = nowNs();
+    for (int b = 0; b < blocks; b++) {
+        // the host copies outputs into inputs, touching all buffers
+        for (size_t i = 0; i < plugins.size(); i++) {
+            FakePlugin &src = plugins[i];
+            FakePlugin &dst = plugins[(i + 1) % plugins.size()];
+            for (size_t ch = 0; ch < src.out.size(); ch++) memcpy(dst.in[ch], src.out[ch], blockSize * sizeof(float));
+        }
+        for (auto &p: plugins) process(p, blockSize);
+    }
+    uint64_t t = nowNs() - t0;
+    misses.disable();
+
+    return Result{(double) t / blocks, (double) misses.read() / blocks, misses.valid()};
+}
+
+}
+
+int main(int argc, char **argv) {
+    int numPlugins = 32;
+    int blockSize = 128;
+    int channels = 8;
+    const int blocks = 5000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "-n") numPlugins = atoi(argv[i + 1]);
+        else if (a == "-b") blockSize = atoi(argv[i + 1]);
+        else if (a == "-c") channels = atoi(argv[i + 1]);
+    }
+    if (numPlugins <= 0 || blockSize <= 0 || channels <= 0) {
+        fprintf(stderr, "usage: bench_arena [-n plugins] [-b blocksize] [-c channels]\n");
+        return 1;
+    }
+
+    const size_t bufferBytes = blockSize * sizeof(float);
+
+    // malloc: every plugin allocates its buffers between other allocations
+    // (editor components, strings, ...), some of which are freed again later.
+    std::mt19937 rng(1);
+    std::vector<void *> noise, keep;
+    auto allocNoise = [&]() {
+        for (int i = 0; i < 8; i++) noise.push_back(malloc(16 + rng() % 4096));
+    };
+    std::vector<FakePlugin> mallocPlugins(numPlugins);
+    for (auto &p: mallocPlugins) {
+        allocNoise();
+        for (int ch = 0; ch < channels; ch++) {
+            p.in.push_back((float *) calloc(1, bufferBytes));
+            allocNoise();
+            p.out.push_back((float *) calloc(1, bufferBytes));
+        }
+        allocNoise();
+        p.state = (float *) calloc(STATE_FLOATS, sizeof(float));
+    }
+    for (size_t i = 0; i < noise.size(); i++) {
+        if (i % 2) free(noise[i]);
+        else keep.push_back(noise[i]);
+    }
+
+    // arena: the same buffers, from one pre-faulted, locked region
+    size_t capacity = (size_t) numPlugins * (2 * channels * (bufferBytes + 64) + STATE_FLOATS * sizeof(float) + 64);
+    Arena arena(capacity + 4096);
+    std::vector<FakePlugin> arenaPlugins(numPlugins);
+    for (auto &p: arenaPlugins) {
+        for (int ch = 0; ch < channels; ch++) {
+            p.in.push_back((float *) arena.allocate(bufferBytes));
+            p.out.push_back((float *) arena.allocate(bufferBytes));
+        }
+        p.state = (float *) arena.allocate(STATE_FLOATS * sizeof(float));
+    }
+
+    Result m = run(mallocPlugins, blockSize, blocks);
+    Result a = run(arenaPlugins, blockSize, blocks);
+
+    printf("%d plugins, %d channels, block size %d, arena %zu kB%s\n", numPlugins, channels, blockSize,
+           arena.used() / 1024, arena.locked() ? " (locked)" : " (not locked)");
+    printf("%-10s %14s %22s\n", "", "ns / block", "cache misses / block");
+    printf("%-10s %14.0f %22.1f\n", "malloc", m.nsPerBlock, m.missesPerBlock);
+    printf("%-10s %14.0f %22.1f\n", "arena", a.nsPerBlock, a.missesPerBlock);
+    if (!m.counted) printf("note: hardware counters unavailable, cache misses not counted\n");
+
+    for (auto &p: mallocPlugins) {
+        for (float *b: p.in) free(b);
+        for (float *b: p.out) free(b);
+        free(p.state);
+    }
+    for (void *k: keep) free(k);
+    return 0;
+}
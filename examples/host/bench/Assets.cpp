@@ -0,0 +1,340 @@
+// see ../Source/PluginHost.h for license
+
+// a patch of many instances of a wavetable sampler, each using the same four
+// sample files and one wavetable file, from which it computes band limited
+// tables (10 octaves of each of 32 frames, from an fft of the frame). half
+// the instances load the files from a second directory holding copies of
+// them, as a preset copied from another card would.
+//
+// "private": every instance reads the files into its own memory and builds
+// its own tables in prepare(), what a plugin does without an asset store.
+// "shared": every instance acquires the files and tables from the host's
+// AssetCache (HostServices version 5) in prepare(), which loads and builds
+// each of them once, on its loader thread, and shares them by content.
+//
+// reports the time the UI thread spends creating and preparing the
+// instances, the time until all of them have their data, the growth of the
+// resident memory, and checks that both ways give the same tables.
+//
+// usage: bench_assets [-n instances]
+
+#include "Bench.h"
+#include "AssetCache.h"
+#include "PluginHost.h"
+
+#include <PercussaFft.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int NUM_SAMPLES = 4;
+static constexpr int SAMPLE_SECONDS = 10;
+static constexpr int CHANNELS = 2;
+static constexpr int FRAMES = 32;
+static constexpr int TABLE = 2048;
+static constexpr int LEVELS = 10;
+static constexpr const char *TABLES_KEY = "bench-tables-v1";
+
+// the band limited tables of a wavetable file of FRAMES raw float tables:
+// for each frame, LEVELS tables, level l with the harmonics below TABLE / 2 >> l
+size_t tablesSize(const char *, const void *, size_t sourceSize) {
+    if (sourceSize != (size_t) FRAMES * TABLE * sizeof(float)) return 0;
+    return (size_t) FRAMES * LEVELS * TABLE * sizeof(float);
+}
+
+bool buildTables(const char *, const void *source, size_t sourceSize, void *data, size_t size) {
+    if (sourceSize != (size_t) FRAMES * TABLE * sizeof(float) || size != tablesSize(nullptr, nullptr, sourceSize)) {
+        return false;
+    }
+    const auto *in = static_cast<const float *>(source);
+    auto *out = static_cast<float *>(data);
+    Fft fft(TABLE);
+    std::vector<float> re(fft.numBins()), im(fft.numBins()), cosine(TABLE);
+    for (int i = 0; i < TABLE; i++) cosine[i] = (float) std::cos(2.0 * M_PI * i / TABLE);
+
+    for (int f = 0; f < FRAMES; f++) {
+        fft.forward(in + f * TABLE, re.data(), im.data());
+        for (int l = 0; l < LEVELS; l++) {
+            float *table = out + ((size_t) f * LEVELS + l) * TABLE;
+            const int harmonics = (TABLE / 2 >> l) - 1;
+            // x[n] = 2 / N sum Re(X[h] e^(2 pi i h n / N)), without dc
+            for (int h = 1; h <= harmonics; h++) {
+                const float a = 2.0f * re[h] / TABLE, b = -2.0f * im[h] / TABLE;
+                for (int n = 0; n < TABLE; n++) {
+                    table[n] += a * cosine[(h * n) & (TABLE - 1)] +
+                                b * cosine[(h * n - TABLE / 4) & (TABLE - 1)];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+const AssetStore::Builder TABLES_BUILDER = {tablesSize, buildTables};
+
+bool readFile(const std::string &path, std::vector<char> &data) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    data.resize((size_t) st.st_size);
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = read(fd, data.data() + done, data.size() - done);
+        if (n <= 0) break;
+        done += (size_t) n;
+    }
+    close(fd);
+    return done == data.size();
+}
+
+bool writeFile(const std::string &path, const void *data, size_t size) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data, 1, size, f) == size;
+    return fclose(f) == 0 && ok;
+}
+
+// 16 bit stereo wav of noise
+std::vector<char> makeWav(int seed) {
+    const uint32_t frames = (uint32_t) (SAMPLE_RATE * SAMPLE_SECONDS);
+    const uint32_t bytes = frames * CHANNELS * 2;
+    std::vector<char> wav(44 + bytes);
+    auto *header = reinterpret_cast<unsigned char *>(wav.data());
+    auto put16 = [&](int at, uint32_t v) { header[at] = v & 0xff; header[at + 1] = (v >> 8) & 0xff; };
+    auto put32 = [&](int at, uint32_t v) { put16(at, v & 0xffff); put16(at + 2, v >> 16); };
+    memcpy(header, "RIFF", 4);
+    put32(4, 36 + bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(16, 16);
+    put16(20, 1);
+    put16(22, CHANNELS);
+    put32(24, (uint32_t) SAMPLE_RATE);
+    put32(28, (uint32_t) SAMPLE_RATE * CHANNELS * 2);
+    put16(32, CHANNELS * 2);
+    put16(34, 16);
+    memcpy(header + 36, "data", 4);
+    put32(40, bytes);
+    std::mt19937 random(seed);
+    auto *samples = reinterpret_cast<int16_t *>(wav.data() + 44);
+    for (uint32_t i = 0; i < frames * CHANNELS; i++) samples[i] = (int16_t) (random() % 20000 - 10000);
+    return wav;
+}
+
+// frames morphing from a sine to a saw
+std::vector<float> makeWavetable() {
+    std::vector<float> tables((size_t) FRAMES * TABLE);
+    for (int f = 0; f < FRAMES; f++) {
+        const float morph = (float) f / (FRAMES - 1);
+        for (int n = 0; n < TABLE; n++) {
+            const float phase = (float) n / TABLE;
+            tables[(size_t) f * TABLE + n] = (1.0f - morph) * std::sin(2.0f * (float) M_PI * phase) +
+                                              morph * (2.0f * phase - 1.0f);
+        }
+    }
+    return tables;
+}
+
+enum Mode { PRIVATE, SHARED };
+
+class WavetablePlugin : public PluginInterface {
+public:
+    WavetablePlugin(Mode mode, const std::vector<std::string> &samples, const std::string &wavetable) :
+            mode_(mode), samplePaths_(samples), wavetablePath_(wavetable) {}
+
+    ~WavetablePlugin() override {
+        if (!assets_) return;
+        for (const AssetStore::Asset *a: samples_) assets_->release(a);
+        assets_->release(tables_);
+    }
+
+    PluginEditorInterface *getEditor() override { return nullptr; }
+
+    void setHostServices(const HostServices *services) override {
+        assets_ = mode_ == SHARED && services && services->version >= 5 ? services->assets : nullptr;
+    }
+
+    void prepare(double, int) override {
+        if (prepared_) return;
+        prepared_ = true;
+        if (assets_) {
+            for (const std::string &path: samplePaths_) {
+                samples_.push_back(assets_->acquire(path.c_str(), nullptr, nullptr));
+            }
+            tables_ = assets_->acquire(wavetablePath_.c_str(), TABLES_KEY, &TABLES_BUILDER);
+            return;
+        }
+        ownSamples_.resize(samplePaths_.size());
+        for (size_t i = 0; i < samplePaths_.size(); i++) readFile(samplePaths_[i], ownSamples_[i]);
+        std::vector<char> wavetable;
+        if (readFile(wavetablePath_, wavetable)) {
+            ownTables_.assign(tablesSize(nullptr, nullptr, wavetable.size()) / sizeof(float), 0.0f);
+            buildTables(nullptr, wavetable.data(), wavetable.size(), ownTables_.data(),
+                        ownTables_.size() * sizeof(float));
+        }
+    }
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        for (int ch = 0; ch < numChannels; ch++) memset(channelData[ch], 0, numSamples * sizeof(float));
+    }
+
+    // the tables, nullptr while they are loading or if they failed
+    const float *tables() const {
+        if (!assets_) return ownTables_.empty() ? nullptr : ownTables_.data();
+        if (!tables_ || tables_->status.load(std::memory_order_acquire) != AssetStore::READY) return nullptr;
+        return static_cast<const float *>(tables_->data);
+    }
+
+    // the samples that are loaded
+    int samplesReady() const {
+        int n = 0;
+        if (!assets_) {
+            for (const std::vector<char> &s: ownSamples_) n += s.empty() ? 0 : 1;
+            return n;
+        }
+        for (const AssetStore::Asset *a: samples_) {
+            n += a && a->status.load(std::memory_order_acquire) == AssetStore::READY ? 1 : 0;
+        }
+        return n;
+    }
+
+private:
+    const Mode mode_;
+    const std::vector<std::string> samplePaths_;
+    const std::string wavetablePath_;
+    AssetStore *assets_ = nullptr;
+    bool prepared_ = false;
+    std::vector<const AssetStore::Asset *> samples_;
+    const AssetStore::Asset *tables_ = nullptr;
+    std::vector<std::vector<char>> ownSamples_;
+    std::vector<float> ownTables_;
+};
+
+struct Result {
+    double uiMs = 0.0;
+    double readyMs = 0.0;
+    double residentMB = 0.0;
+    double mappedMB = 0.0;
+    double referencedMB = 0.0;
+    bool complete = true;
+    double checksum = 0.0;
+};
+
+Result run(Mode mode, int instances, const std::vector<std::string> dirs[2]) {
+    Result r;
+    AssetCache cache;
+    HostServices services;
+    services.assets = &cache;
+
+    const size_t resident = residentBytes();
+    const uint64_t start = nowNs();
+    std::vector<std::unique_ptr<Module>> modules;
+    std::vector<WavetablePlugin *> plugins;
+    for (int i = 0; i < instances; i++) {
+        const std::vector<std::string> &paths = dirs[i % 2];
+        auto *desc = new PluginDescriptor;
+        desc->name = "WAVETABLE";
+        desc->uid = 0x57415654;
+        desc->outputChannelNames = {"Out L", "Out R"};
+        plugins.push_back(new WavetablePlugin(mode, {paths.begin(), paths.end() - 1}, paths.back()));
+        modules.emplace_back(new Module(desc, plugins.back(), i));
+        modules.back()->prepare(SAMPLE_RATE, 128, &services);
+    }
+    r.uiMs = (nowNs() - start) / 1e6;
+    cache.wait();
+    r.readyMs = (nowNs() - start) / 1e6;
+    r.residentMB = ((double) residentBytes() - (double) resident) / 1e6;
+    r.mappedMB = cache.mappedBytes() / 1e6;
+    r.referencedMB = cache.referencedBytes() / 1e6;
+
+    for (WavetablePlugin *p: plugins) {
+        if (!p->tables() || p->samplesReady() != NUM_SAMPLES) r.complete = false;
+    }
+    if (const float *tables = plugins[0]->tables()) {
+        for (size_t i = 0; i < (size_t) FRAMES * LEVELS * TABLE; i++) r.checksum += tables[i] * (double) (i % 7 + 1);
+    }
+    return r;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int instances = 16;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "-n") instances = atoi(argv[i + 1]);
+    }
+    if (instances <= 0) {
+        fprintf(stderr, "usage: bench_assets [-n instances]\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_assets_XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "cannot create a directory in /tmp\n");
+        return 1;
+    }
+    // the same content in two directories
+    std::vector<std::string> dirs[2];
+    std::vector<float> wavetable = makeWavetable();
+    bool ok = true;
+    for (int d = 0; d < 2 && ok; d++) {
+        const std::string sub = std::string(dir) + (d == 0 ? "/a" : "/b");
+        ok = mkdir(sub.c_str(), 0700) == 0;
+        for (int i = 0; i < NUM_SAMPLES && ok; i++) {
+            std::vector<char> wav = makeWav(i);
+            dirs[d].push_back(sub + "/sample" + std::to_string(i) + ".wav");
+            ok = writeFile(dirs[d].back(), wav.data(), wav.size());
+        }
+        dirs[d].push_back(sub + "/wavetable.raw");
+        ok = ok && writeFile(dirs[d].back(), wavetable.data(), wavetable.size() * sizeof(float));
+    }
+    if (!ok) {
+        fprintf(stderr, "cannot write the files in %s\n", dir);
+        return 1;
+    }
+
+    printf("%d instances, each with %d samples of %d s and %d band limited tables of %d frames\n\n", instances,
+           NUM_SAMPLES, SAMPLE_SECONDS, LEVELS, FRAMES);
+    Result results[2];
+    for (int m = PRIVATE; m <= SHARED; m++) results[m] = run((Mode) m, instances, dirs);
+
+    for (int d = 0; d < 2; d++) {
+        for (const std::string &path: dirs[d]) unlink(path.c_str());
+        rmdir(dirs[d].front().substr(0, dirs[d].front().rfind('/')).c_str());
+    }
+    rmdir(dir);
+
+    printf("%-28s %12s %12s\n", "", "private", "shared");
+    printf("%-28s %12.1f %12.1f\n", "ui thread, ms", results[0].uiMs, results[1].uiMs);
+    printf("%-28s %12.1f %12.1f\n", "all loaded, ms", results[0].readyMs, results[1].readyMs);
+    printf("%-28s %12.1f %12.1f\n", "resident memory, MB", results[0].residentMB, results[1].residentMB);
+    printf("%-28s %12s %12.1f\n", "asset store, MB", "-", results[1].mappedMB);
+    printf("%-28s %12s %12.1f\n", "saved by sharing, MB", "-", results[1].referencedMB - results[1].mappedMB);
+
+    if (!results[0].complete || !results[1].complete) {
+        fprintf(stderr, "\nan instance is missing data\n");
+        return 1;
+    }
+    if (std::fabs(results[0].checksum - results[1].checksum) > 1e-6 * std::fabs(results[0].checksum)) {
+        fprintf(stderr, "\ntables differ: %.6f private, %.6f shared\n", results[0].checksum, results[1].checksum);
+        return 1;
+    }
+    return 0;
+}
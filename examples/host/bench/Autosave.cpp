@@ -0,0 +1,232 @@
+// see ../Source/PluginHost.h for license
+
+// autosave of a large patch where one parameter changed between saves. the
+// full save asks every module for its whole state, and writes the patch file
+// again (to a temporary file, synced and renamed over the old one, as the SSP
+// software does). the journal (Autosave) skips the modules whose state
+// version did not change, and appends a delta for the one which did. the
+// plugins serialise their parameters to xml text, as JUCE plugins do. every
+// round one parameter of a random module changes. at the end the patch is
+// recovered from the journal into new modules, and compared with the original
+// (fails, exit code 1, if a state differs).
+//
+// usage: bench_autosave [-n modules] [-r rounds] [-p parameters]
+
+#include "Bench.h"
+#include "Autosave.h"
+#include "PluginHost.h"
+
+#include <PercussaState.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+// a plugin whose state is its parameters, versioned with ValueVersions
+class ParamPlugin : public PluginInterface {
+public:
+    explicit ParamPlugin(int numParams) : values_(numParams), versions_(numParams) {
+        for (int i = 0; i < numParams; i++) values_[i] = (float) i / numParams;
+    }
+
+    PluginEditorInterface *getEditor() override { return nullptr; }
+    void prepare(double, int) override {}
+    void process(float **, int, int) override {}
+
+    void setValue(size_t i, float value) {
+        values_[i] = value;
+        versions_.changed();
+    }
+
+    void getState(void **buffer, size_t *size) override {
+        versions_.saved(Value{values_});
+        std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<PARAMS>\n";
+        char line[96];
+        for (size_t i = 0; i < values_.size(); i++) {
+            snprintf(line, sizeof(line), "  <PARAM id=\"param%zu\" value=\"%.9g\"/>\n", i, values_[i]);
+            xml += line;
+        }
+        xml += "</PARAMS>\n";
+        char *data = new char[xml.size()];
+        memcpy(data, xml.data(), xml.size());
+        *buffer = data;
+        *size = xml.size();
+    }
+
+    void setState(void *buffer, size_t size) override {
+        const std::string xml((const char *) buffer, size);
+        size_t pos = 0;
+        for (size_t i = 0; i < values_.size(); i++) {
+            pos = xml.find("value=\"", pos);
+            if (pos == std::string::npos) break;
+            pos += 7;
+            values_[i] = strtof(xml.c_str() + pos, nullptr);
+        }
+        versions_.changed();
+    }
+
+    uint64_t stateVersion() override { return versions_.version(); }
+
+    bool getStateDelta(uint64_t since, void **buffer, size_t *size, uint64_t *version) override {
+        return versions_.delta(since, Value{values_}, buffer, size, version);
+    }
+
+    bool applyStateDelta(const void *buffer, size_t size) override {
+        return versions_.apply(buffer, size, [this](size_t i, float value) { setValue(i, value); });
+    }
+
+private:
+    struct Value {
+        const std::vector<float> &values;
+        float operator()(size_t i) const { return values[i]; }
+    };
+
+    std::vector<float> values_;
+    ValueVersions versions_;
+};
+
+Module *newModule(int id, int numParams) {
+    auto *desc = new PluginDescriptor;
+    desc->name = "PARAMS";
+    desc->uid = 0x50415241;
+    return new Module(desc, new ParamPlugin(numParams), id);
+}
+
+ParamPlugin &plugin(Module &module) {
+    return static_cast<ParamPlugin &>(module.plugin());
+}
+
+// what the SSP software does: every state into one file, replacing the old one
+size_t saveFull(const std::vector<Module *> &modules, const std::string &path) {
+    const std::string temp = path + ".tmp";
+    FILE *f = fopen(temp.c_str(), "wb");
+    if (!f) throw std::runtime_error("cannot write " + temp);
+    size_t bytes = 0;
+    for (Module *m: modules) {
+        std::vector<char> state = m->getState();
+        const uint64_t size = state.size();
+        fwrite(&size, sizeof(size), 1, f);
+        fwrite(state.data(), 1, state.size(), f);
+        bytes += sizeof(size) + state.size();
+    }
+    if (fflush(f) != 0 || fdatasync(fileno(f)) != 0 || rename(temp.c_str(), path.c_str()) != 0) {
+        fclose(f);
+        throw std::runtime_error("cannot write " + path);
+    }
+    fclose(f);
+    return bytes;
+}
+
+void report(const char *name, std::vector<uint64_t> &ns, size_t bytes, int rounds) {
+    std::sort(ns.begin(), ns.end());
+    uint64_t sum = 0;
+    for (uint64_t t: ns) sum += t;
+    printf("%-12s %10.1f %10.1f %10.1f %14zu\n", name, ns[ns.size() / 2] / 1000.0,
+           ns[ns.size() * 99 / 100] / 1000.0, sum / 1000.0 / ns.size(), bytes / rounds);
+}
+
+}
+
+int main(int argc, char **argv) {
+    int numModules = 128;
+    int rounds = 100;
+    int numParams = 64;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "-n") numModules = atoi(argv[i + 1]);
+        else if (a == "-r") rounds = atoi(argv[i + 1]);
+        else if (a == "-p") numParams = atoi(argv[i + 1]);
+    }
+    if (numModules <= 0 || rounds <= 0 || numParams <= 0) {
+        fprintf(stderr, "usage: bench_autosave [-n modules] [-r rounds] [-p parameters]\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_autosave.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    const std::string patchFile = std::string(dir) + "/patch";
+    const std::string journalFile = std::string(dir) + "/journal";
+
+    bool ok = true;
+    try {
+        std::vector<std::unique_ptr<Module>> owned;
+        std::vector<Module *> modules;
+        for (int i = 0; i < numModules; i++) {
+            owned.emplace_back(newModule(i, numParams));
+            modules.push_back(owned.back().get());
+        }
+
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> value(0.0f, 1.0f);
+        auto change = [&] {
+            plugin(*modules[rng() % numModules]).setValue(rng() % numParams, value(rng));
+        };
+
+        std::vector<uint64_t> fullNs, journalNs;
+        size_t fullBytes = 0, journalBytes = 0;
+        int states = 0, deltas = 0, skipped = 0, compactions = 0;
+        saveFull(modules, patchFile);
+        for (int r = 0; r < rounds; r++) {
+            change();
+            uint64_t t0 = nowNs();
+            fullBytes += saveFull(modules, patchFile);
+            fullNs.push_back(nowNs() - t0);
+        }
+
+        // the first save writes every state, as after loading a patch
+        Autosave autosave(journalFile);
+        autosave.save(modules);
+        for (int r = 0; r < rounds; r++) {
+            change();
+            uint64_t t0 = nowNs();
+            Autosave::Result result = autosave.save(modules);
+            journalNs.push_back(nowNs() - t0);
+            journalBytes += result.bytes;
+            states += result.states;
+            deltas += result.deltas;
+            skipped += result.skipped;
+            compactions += result.compacted;
+        }
+
+        printf("%d modules of %d parameters, %d saves, one parameter changed before each\n\n",
+               numModules, numParams, rounds);
+        printf("%-12s %10s %10s %10s %14s\n", "save", "median us", "p99 us", "mean us", "bytes/save");
+        report("full", fullNs, fullBytes, rounds);
+        report("journal", journalNs, journalBytes, rounds);
+        printf("\njournal: %d states, %d deltas, %d modules skipped, %d compactions, %zu bytes\n",
+               states, deltas, skipped, compactions, autosave.journalBytes());
+
+        // recover into new modules
+        auto patch = Autosave::recover(journalFile);
+        int mismatches = patch.size() == modules.size() ? 0 : 1;
+        for (Module *m: modules) {
+            auto it = patch.find(m->id());
+            if (it == patch.end()) continue;
+            std::unique_ptr<Module> restored(newModule(m->id(), numParams));
+            if (!Autosave::restore(*restored, it->second) || restored->getState() != m->getState()) mismatches++;
+        }
+        printf("recovered %zu modules, %d differ%s\n", patch.size(), mismatches, mismatches ? "  FAIL" : "");
+        ok = mismatches == 0;
+    } catch (const std::exception &e) {
+        fprintf(stderr, "error: %s\n", e.what());
+        ok = false;
+    }
+
+    unlink(patchFile.c_str());
+    unlink(journalFile.c_str());
+    rmdir(dir);
+    return ok ? 0 : 1;
+}
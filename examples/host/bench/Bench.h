@@ -0,0 +1,26 @@
+// see ../Source/PluginHost.h for license
+
+// helpers shared by the benchmarks
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <time.h>
+#include <unistd.h>
+
+inline uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+// resident memory of the process (from /proc/self/statm), 0 if unknown
+inline size_t residentBytes() {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return n == 2 ? (size_t) resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+}
@@ -0,0 +1,151 @@
+// see ../Source/PluginHost.h for license
+
+// the same plugin from two builds, e.g. a release build and a profile guided
+// one (see pgo.sh): startup, the time to load the shared object, create an
+// instance and prepare it, each measured in a fresh child process, and the
+// cost of process() per sample at block sizes of 32 and 128, with a slow sine
+// on the inputs. reports the medians of both, and the speed-ups of the second.
+//
+// usage: bench_builds [-r runs] [-n calls] base.so optimised.so
+
+#include "Bench.h"
+#include "PluginHost.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+static constexpr int BLOCK_SIZES[] = {32, 128};
+static constexpr int NUM_BLOCK_SIZES = sizeof(BLOCK_SIZES) / sizeof(BLOCK_SIZES[0]);
+
+struct Result {
+    uint64_t loadNs = 0;
+    uint64_t createNs = 0;
+    double nsPerSample[NUM_BLOCK_SIZES] = {};
+};
+
+Result measure(const std::string &path, int calls) {
+    Result r;
+    uint64_t t0 = nowNs();
+    PluginLibrary library(path);
+    uint64_t t1 = nowNs();
+    Module module(library, 0);
+    for (int i = 0; i < module.numInputs(); i++) module.plugin().inputEnabled(i, true);
+    for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+    module.prepare(48000.0, BLOCK_SIZES[NUM_BLOCK_SIZES - 1]);
+    uint64_t t2 = nowNs();
+    r.loadNs = t1 - t0;
+    r.createNs = t2 - t1;
+
+    std::vector<float *> channels;
+    for (int ch = 0; ch < module.numChannels(); ch++) channels.push_back(module.channel(ch));
+    auto &plugin = module.plugin();
+    for (int b = 0; b < NUM_BLOCK_SIZES; b++) {
+        const int blockSize = BLOCK_SIZES[b];
+        uint64_t t = 0, sample = 0;
+        for (int i = 0; i < calls + calls / 10; i++) {
+            for (float *data: channels) {
+                for (int s = 0; s < blockSize; s++) data[s] = std::sin(1e-4f * (float) (sample + s));
+            }
+            sample += blockSize;
+            uint64_t start = nowNs();
+            plugin.process(channels.data(), (int) channels.size(), blockSize);
+            if (i >= calls / 10) t += nowNs() - start;
+        }
+        r.nsPerSample[b] = (double) t / calls / blockSize;
+    }
+    return r;
+}
+
+// measure() in a child process, so the shared object is not loaded yet
+bool measureInChild(const std::string &path, int calls, Result &result) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Result r;
+        try {
+            r = measure(path, calls);
+        } catch (const std::exception &e) {
+            fprintf(stderr, "%s\n", e.what());
+            _exit(1);
+        }
+        bool ok = write(fds[1], &r, sizeof(r)) == (ssize_t) sizeof(r);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = read(fds[0], &result, sizeof(result)) == (ssize_t) sizeof(result);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+template<typename T, typename F>
+double median(const std::vector<T> &results, F value) {
+    std::vector<double> values;
+    for (const T &r: results) values.push_back(value(r));
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+}
+
+int main(int argc, char **argv) {
+    int runs = 11;
+    int calls = 20000;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-r" && i + 1 < argc) runs = atoi(argv[++i]);
+        else if (a == "-n" && i + 1 < argc) calls = atoi(argv[++i]);
+        else paths.push_back(a);
+    }
+    if (paths.size() != 2 || runs <= 0 || calls <= 0) {
+        fprintf(stderr, "usage: bench_builds [-r runs] [-n calls] base.so optimised.so\n");
+        return 1;
+    }
+
+    // the builds take turns, so both see the same conditions
+    std::vector<Result> results[2];
+    for (int run = 0; run < runs; run++) {
+        for (int b = 0; b < 2; b++) {
+            Result r;
+            if (!measureInChild(paths[b], calls, r)) {
+                fprintf(stderr, "measurement of %s failed\n", paths[b].c_str());
+                return 1;
+            }
+            results[b].push_back(r);
+        }
+    }
+
+    double load[2], create[2], process[2][NUM_BLOCK_SIZES];
+    for (int b = 0; b < 2; b++) {
+        load[b] = median(results[b], [](const Result &r) { return r.loadNs / 1e3; });
+        create[b] = median(results[b], [](const Result &r) { return r.createNs / 1e3; });
+        for (int s = 0; s < NUM_BLOCK_SIZES; s++) {
+            process[b][s] = median(results[b], [s](const Result &r) { return r.nsPerSample[s]; });
+        }
+    }
+
+    printf("%-24s %14s %14s %10s\n", "", "base", "optimised", "speed-up");
+    printf("%-24s %14.1f %14.1f %9.2fx\n", "load us", load[0], load[1], load[0] / load[1]);
+    printf("%-24s %14.1f %14.1f %9.2fx\n", "create + prepare us", create[0], create[1], create[0] / create[1]);
+    printf("%-24s %14.1f %14.1f %9.2fx\n", "startup us", load[0] + create[0], load[1] + create[1],
+           (load[0] + create[0]) / (load[1] + create[1]));
+    for (int s = 0; s < NUM_BLOCK_SIZES; s++) {
+        std::string name = "process ns/sample @" + std::to_string(BLOCK_SIZES[s]);
+        printf("%-24s %14.2f %14.2f %9.2fx\n", name.c_str(), process[0][s], process[1][s],
+               process[0][s] / process[1][s]);
+    }
+    return 0;
+}
@@ -0,0 +1,408 @@
+// see ../Source/PluginHost.h for license
+
+// frame times of a plugin's editor, as the SSP draws it: at 60 frames per
+// second, frameStart(), renderToImage() into the screen image, the upload of
+// the image into a texture and a full screen quad, then draw() for plugins
+// drawing with OpenGLES themselves. runs headless, with a surfaceless EGL
+// context (e.g. Mesa's llvmpipe) rendering into a framebuffer object. the
+// audio thread runs the plugin with a sine on each input, so scopes have
+// something to show, and encoder turns and presses and button presses are
+// sent between frames. the editor is created with the context current, as
+// the SSP does, so plugins can create their GL objects in its constructor.
+//
+// reports the distribution of the time of each step and of whole frames
+// (glFinish() included, so the rendering is counted), the frames over the
+// 16.7 ms budget, and the bytes uploaded per frame: the image, the part of
+// it which changed since the last frame, and what the plugin uploads with
+// glBufferData(), glBufferSubData(), glTexImage2D() and glTexSubImage2D().
+// the latter are counted by replacing these functions in this executable,
+// for plugins linking the GL library, getting them with eglGetProcAddress(),
+// or looking them up in the library they open (as libepoxy does).
+//
+// usage: bench_editor [-t seconds] [-w width] [-h height] plugin.so
+
+#include "Bench.h"
+#include "AudioThread.h"
+#include "PluginHost.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// bytes uploaded by the plugin, counted while countUploads is set
+bool countUploads = false;
+uint64_t pluginUploads = 0;
+
+size_t bytesPerPixel(GLenum format, GLenum type) {
+    switch (type) {
+        case GL_UNSIGNED_SHORT_5_6_5:
+        case GL_UNSIGNED_SHORT_4_4_4_4:
+        case GL_UNSIGNED_SHORT_5_5_5_1:
+            return 2;
+        case GL_UNSIGNED_INT_2_10_10_10_REV:
+        case GL_UNSIGNED_INT_10F_11F_11F_REV:
+        case GL_UNSIGNED_INT_5_9_9_9_REV:
+        case GL_UNSIGNED_INT_24_8:
+            return 4;
+        default:
+            break;
+    }
+    size_t components = 4;
+    switch (format) {
+        case GL_RED: case GL_RED_INTEGER: case GL_ALPHA: case GL_LUMINANCE: case GL_DEPTH_COMPONENT:
+            components = 1;
+            break;
+        case GL_RG: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA:
+            components = 2;
+            break;
+        case GL_RGB: case GL_RGB_INTEGER:
+            components = 3;
+            break;
+        default:
+            break;
+    }
+    switch (type) {
+        case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+            return components * 2;
+        case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT:
+            return components * 4;
+        default:
+            return components;
+    }
+}
+
+void countUpload(uint64_t bytes) {
+    if (countUploads) pluginUploads += bytes;
+}
+
+template<typename F>
+F real(const char *name) {
+    F f = (F) dlsym(RTLD_NEXT, name);
+    if (!f) {
+        fprintf(stderr, "no %s in the libraries\n", name);
+        abort();
+    }
+    return f;
+}
+
+}
+
+// the upload functions, for the plugins (this executable exports its symbols)
+extern "C" {
+
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    static auto f = real<void (*)(GLenum, GLsizeiptr, const void *, GLenum)>("glBufferData");
+    if (data) countUpload((uint64_t) size);
+    f(target, size, data, usage);
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    static auto f = real<void (*)(GLenum, GLintptr, GLsizeiptr, const void *)>("glBufferSubData");
+    countUpload((uint64_t) size);
+    f(target, offset, size, data);
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                  GLint border, GLenum format, GLenum type, const void *pixels) {
+    static auto f = real<void (*)(GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void *)>(
+            "glTexImage2D");
+    if (pixels) countUpload((uint64_t) width * height * bytesPerPixel(format, type));
+    f(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                     GLenum format, GLenum type, const void *pixels) {
+    static auto f = real<void (*)(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void *)>(
+            "glTexSubImage2D");
+    countUpload((uint64_t) width * height * bytesPerPixel(format, type));
+    f(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+// dlsym() on the library finds its own functions, dlsym() on the executable
+// finds those above first, then the library's
+void *dlopen(const char *file, int flags) {
+    static auto f = real<void *(*)(const char *, int)>("dlopen");
+    const char *name = file ? strrchr(file, '/') : nullptr;
+    name = name ? name + 1 : file;
+    if (name && !strncmp(name, "libGLESv2.so", strlen("libGLESv2.so"))) return f(nullptr, flags);
+    return f(file, flags);
+}
+
+__eglMustCastToProperFunctionPointerType eglGetProcAddress(const char *name) {
+    static auto f = real<__eglMustCastToProperFunctionPointerType (*)(const char *)>("eglGetProcAddress");
+    if (!strcmp(name, "glBufferData")) return (__eglMustCastToProperFunctionPointerType) &glBufferData;
+    if (!strcmp(name, "glBufferSubData")) return (__eglMustCastToProperFunctionPointerType) &glBufferSubData;
+    if (!strcmp(name, "glTexImage2D")) return (__eglMustCastToProperFunctionPointerType) &glTexImage2D;
+    if (!strcmp(name, "glTexSubImage2D")) return (__eglMustCastToProperFunctionPointerType) &glTexSubImage2D;
+    return f(name);
+}
+
+}
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int BLOCK_SIZE = 128;
+static constexpr uint64_t FRAME_NS = 1000000000ull / 60;
+
+// a surfaceless GLES 3 context, current on this thread, and a framebuffer
+// object of the size of the screen to draw into
+class HeadlessContext {
+public:
+    HeadlessContext(int width, int height) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) display_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display_ == EGL_NO_DISPLAY) display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        EGLint major, minor;
+        if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, &major, &minor)) {
+            throw std::runtime_error("cannot initialise EGL");
+        }
+        eglBindAPI(EGL_OPENGL_ES_API);
+        const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint numConfigs = 0;
+        eglChooseConfig(display_, configAttribs, &config, 1, &numConfigs);
+        const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE};
+        context_ = eglCreateContext(display_, numConfigs ? config : nullptr, EGL_NO_CONTEXT, contextAttribs);
+        if (context_ == EGL_NO_CONTEXT || !eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, context_)) {
+            eglTerminate(display_);
+            throw std::runtime_error("cannot create a surfaceless GLES 3 context");
+        }
+
+        glGenRenderbuffers(2, renderbuffers_);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers_[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers_[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glGenFramebuffers(1, &framebuffer_);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers_[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers_[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("cannot create the framebuffer");
+        }
+        glViewport(0, 0, width, height);
+    }
+
+    ~HeadlessContext() {
+        glDeleteFramebuffers(1, &framebuffer_);
+        glDeleteRenderbuffers(2, renderbuffers_);
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display_, context_);
+        eglTerminate(display_);
+    }
+
+    const char *renderer() const { return (const char *) glGetString(GL_RENDERER); }
+
+private:
+    EGLDisplay display_ = EGL_NO_DISPLAY;
+    EGLContext context_ = EGL_NO_CONTEXT;
+    GLuint framebuffer_ = 0;
+    GLuint renderbuffers_[2] = {};
+
+    HeadlessContext(const HeadlessContext &) = delete;
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+};
+
+// the host's part of a frame: the BGRA image of renderToImage() in a texture,
+// drawn onto the whole screen
+class ImageQuad {
+public:
+    ImageQuad(int width, int height) : width_(width), height_(height) {
+        static const char *vertexSource = R"(#version 300 es
+            out vec2 uv;
+            void main() {
+                vec2 p = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+                uv = vec2(p.x, 1.0 - p.y);
+                gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+            })";
+        static const char *fragmentSource = R"(#version 300 es
+            precision mediump float;
+            uniform sampler2D image;
+            in vec2 uv;
+            out vec4 colour;
+            void main() { colour = texture(image, uv).bgra; })";
+        program_ = glCreateProgram();
+        glAttachShader(program_, compile(GL_VERTEX_SHADER, vertexSource));
+        glAttachShader(program_, compile(GL_FRAGMENT_SHADER, fragmentSource));
+        glLinkProgram(program_);
+        GLint linked = 0;
+        glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+        if (!linked) throw std::runtime_error("cannot link the image shader");
+
+        glGenVertexArrays(1, &vao_);
+        glGenTextures(1, &texture_);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    }
+
+    ~ImageQuad() {
+        glDeleteTextures(1, &texture_);
+        glDeleteVertexArrays(1, &vao_);
+        glDeleteProgram(program_);
+    }
+
+    void draw(const unsigned char *image) {
+        glUseProgram(program_);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture_);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        glBindVertexArray(vao_);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glBindVertexArray(0);
+        glUseProgram(0);
+    }
+
+private:
+    static GLuint compile(GLenum type, const char *source) {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint compiled = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) throw std::runtime_error("cannot compile the image shader");
+        return shader;
+    }
+
+    int width_, height_;
+    GLuint program_ = 0;
+    GLuint vao_ = 0;
+    GLuint texture_ = 0;
+};
+
+enum Step { FRAME_START, RENDER_TO_IMAGE, IMAGE_QUAD, DRAW, FINISH, FRAME, NUM_STEPS };
+const char *stepNames[NUM_STEPS] = {"frameStart", "renderToImage", "image upload", "draw", "glFinish", "frame"};
+
+// bytes of the rows of image which differ from previous, which is updated
+size_t changedBytes(const std::vector<unsigned char> &image, std::vector<unsigned char> &previous, int width) {
+    const size_t row = (size_t) width * 4;
+    size_t changed = 0;
+    for (size_t offset = 0; offset < image.size(); offset += row) {
+        if (memcmp(image.data() + offset, previous.data() + offset, row) != 0) {
+            memcpy(previous.data() + offset, image.data() + offset, row);
+            changed += row;
+        }
+    }
+    return changed;
+}
+
+double percentile(std::vector<uint64_t> &ns, int p) {
+    return ns[std::min(ns.size() - 1, ns.size() * p / 100)] / 1000.0;
+}
+
+}
+
+int main(int argc, char **argv) {
+    double seconds = 10.0;
+    int width = 1600, height = 480;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-t" && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (a == "-w" && i + 1 < argc) width = atoi(argv[++i]);
+        else if (a == "-h" && i + 1 < argc) height = atoi(argv[++i]);
+        else path = a;
+    }
+    if (path.empty() || seconds <= 0.0 || width <= 0 || height <= 0) {
+        fprintf(stderr, "usage: bench_editor [-t seconds] [-w width] [-h height] plugin.so\n");
+        return 1;
+    }
+
+    try {
+        HeadlessContext context(width, height);
+        ImageQuad quad(width, height);
+
+        PluginLibrary library(path);
+        Module module(library, 0);
+        for (int i = 0; i < module.numInputs(); i++) module.plugin().inputEnabled(i, true);
+        for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+        module.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        if (!module.editor()) throw std::runtime_error(path + " has no editor");
+
+        AudioThread audio(SAMPLE_RATE, BLOCK_SIZE, {&module});
+        audio.start();
+
+        std::vector<unsigned char> image((size_t) width * height * 4), previous(image.size());
+        std::vector<uint64_t> ns[NUM_STEPS];
+        uint64_t changed = 0, uploads = 0;
+        const int frames = std::max(1, (int) (seconds * 60.0));
+        int late = 0;
+
+        module.visibilityChanged(true);
+        struct timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        for (int frame = 0; frame < frames; frame++) {
+            addNs(next, FRAME_NS);
+
+            // user input between frames: the encoders, their switches and the buttons
+            if (frame % 6 == 0) module.encoderTurned((frame / 6) % 4, (frame / 60) % 2 ? -1 : 1);
+            if (frame % 45 == 0) module.encoderPressed((frame / 45) % 4, true);
+            if (frame % 45 == 5) module.encoderPressed((frame / 45) % 4, false);
+            if (frame % 90 == 0) module.buttonPressed((frame / 90) % 14, true);
+            if (frame % 90 == 5) module.buttonPressed((frame / 90) % 14, false);
+
+            uint64_t t[NUM_STEPS + 1];
+            pluginUploads = 0;
+            countUploads = true;
+            t[0] = nowNs();
+            module.frameStart();
+            t[1] = nowNs();
+            module.renderToImage(image.data(), width, height);
+            t[2] = nowNs();
+            countUploads = false;
+            quad.draw(image.data());
+            countUploads = true;
+            t[3] = nowNs();
+            module.draw(width, height);
+            t[4] = nowNs();
+            countUploads = false;
+            glFinish();
+            t[5] = nowNs();
+
+            for (int s = 0; s < FINISH + 1; s++) ns[s].push_back(t[s + 1] - t[s]);
+            ns[FRAME].push_back(t[5] - t[0]);
+            if (t[5] - t[0] > FRAME_NS) late++;
+            changed += changedBytes(image, previous, width);
+            uploads += pluginUploads;
+
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        }
+        module.visibilityChanged(false);
+        audio.stop();
+
+        printf("%s, %d frames of %dx%d on %s\n\n", module.descriptor().name.c_str(), frames, width, height,
+               context.renderer());
+        printf("%-16s %10s %10s %10s %10s %10s\n", "us", "median", "p90", "p99", "max", "mean");
+        for (int s = 0; s < NUM_STEPS; s++) {
+            uint64_t sum = 0;
+            for (uint64_t v: ns[s]) sum += v;
+            std::sort(ns[s].begin(), ns[s].end());
+            printf("%-16s %10.1f %10.1f %10.1f %10.1f %10.1f\n", stepNames[s], percentile(ns[s], 50),
+                   percentile(ns[s], 90), percentile(ns[s], 99), ns[s].back() / 1000.0, sum / 1000.0 / frames);
+        }
+        printf("\nframes over 16.7 ms: %d (%.1f%%)\n", late, 100.0 * late / frames);
+        printf("upload per frame: image %zu bytes, of which %llu changed, plugin %llu bytes\n", image.size(),
+               (unsigned long long) (changed / frames), (unsigned long long) (uploads / frames));
+        printf("audio blocks: %llu, xruns: %llu\n", (unsigned long long) audio.blocks(),
+               (unsigned long long) audio.xruns());
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+// see ../Source/PluginHost.h for license
+
+// accuracy and throughput of the approximations in PercussaMath.h.
+// accuracy: the largest error against libm (in double precision) over a
+// dense sweep of the documented input range, fails (exit code 1) if one is
+// above the documented maximum. throughput: samples per cpu cycle on a
+// buffer in L1, for the approximation and the libm function per sample.
+// without a cycle counter (e.g. in a VM) samples per ns are reported.
+// -a only checks the accuracy, ctest runs it so.
+//
+// usage: bench_fastmath [-a] [-b blocksize]
+
+#include "Bench.h"
+#include "PerfCounter.h"
+
+#include <PercussaMath.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+volatile float sink = 0.0f;
+
+struct Function {
+    const char *name;
+    float lo, hi;           // sweep
+    bool relative;          // relative error, or absolute (relative above 1)
+    double maxError;        // as documented in PercussaMath.h
+    void (*fast)(const float *, float *, int);
+    double (*exact)(double);
+    float (*libm)(float);
+};
+
+void voltsToHz440(const float *in, float *out, int n) { Math::voltsToHz(in, out, n, 440.0f); }
+
+const Function functions[] = {
+    {"exp2", -126.0f, 127.0f, true, 2.5e-7, Math::exp2,
+        [](double x) { return std::exp2(x); }, [](float x) { return std::exp2(x); }},
+    {"log2", 1e-30f, 1e30f, false, 3e-7, Math::log2,
+        [](double x) { return std::log2(x); }, [](float x) { return std::log2(x); }},
+    {"tanh", -12.0f, 12.0f, false, 2e-7, Math::tanh,
+        [](double x) { return std::tanh(x); }, [](float x) { return std::tanh(x); }},
+    {"sin", -1000.0f, 1000.0f, false, 5e-7, Math::sin,
+        [](double x) { return std::sin(x); }, [](float x) { return std::sin(x); }},
+    {"cos", -1000.0f, 1000.0f, false, 5e-7, Math::cos,
+        [](double x) { return std::cos(x); }, [](float x) { return std::cos(x); }},
+    {"sinTurns", -1.0f, 1.0f, false, 2e-7, Math::sinTurns,
+        [](double x) { return std::sin(2.0 * M_PI * x); }, [](float x) { return std::sin(6.2831853f * x); }},
+    {"voltsToHz", -10.0f, 10.0f, true, 3e-7, voltsToHz440,
+        [](double x) { return 440.0 * std::exp2(x); }, [](float x) { return 440.0f * std::exp2(x); }},
+};
+
+// largest error over the sweep, log2 is swept logarithmically
+double maxError(const Function &f, float &worst) {
+    static constexpr int POINTS = 1 << 22;
+    std::vector<float> in(POINTS), out(POINTS);
+    const bool logSweep = f.lo > 0.0f;
+    for (int i = 0; i < POINTS; i++) {
+        double t = (double) i / (POINTS - 1);
+        in[i] = (float) (logSweep ? f.lo * std::pow((double) f.hi / f.lo, t) : f.lo + (f.hi - f.lo) * t);
+    }
+    f.fast(in.data(), out.data(), POINTS);
+    double max = 0.0;
+    for (int i = 0; i < POINTS; i++) {
+        double exact = f.exact(in[i]);
+        double e = std::fabs(out[i] - exact);
+        e /= f.relative ? std::fabs(exact) : std::max(1.0, std::fabs(exact));
+        if (e > max) {
+            max = e;
+            worst = in[i];
+        }
+    }
+    return max;
+}
+
+// samples per cycle (or per ns), best of a few runs
+template<typename F>
+double throughput(F f, int blockSize, PerfCounter &cycles) {
+    static constexpr int BLOCKS = 20000;
+    double best = 0.0;
+    for (int run = 0; run < 5; run++) {
+        cycles.reset();
+        cycles.enable();
+        uint64_t t0 = nowNs();
+        for (int b = 0; b < BLOCKS; b++) f();
+        uint64_t t1 = nowNs();
+        cycles.disable();
+        uint64_t units = cycles.valid() ? cycles.read() : t1 - t0;
+        double rate = units ? (double) BLOCKS * blockSize / units : 0.0;
+        if (rate > best) best = rate;
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int blockSize = 128;
+    bool accuracyOnly = false;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-b" && i + 1 < argc) blockSize = atoi(argv[++i]);
+        else if (a == "-a") accuracyOnly = true;
+        else blockSize = 0;
+    }
+    if (blockSize <= 0) {
+        fprintf(stderr, "usage: bench_fastmath [-a] [-b blocksize]\n");
+        return 1;
+    }
+
+    PerfCounter cycles = PerfCounter::cycles();
+    const char *unit = cycles.valid() ? "cycle" : "ns";
+    printf("%-10s %12s %12s %10s", "", "max error", "documented", "at");
+    if (!accuracyOnly) {
+        printf(" %16s %16s %8s", (std::string("fast /") + unit).c_str(), (std::string("libm /") + unit).c_str(),
+               "speedup");
+    }
+    printf("\n");
+
+    bool ok = true;
+    for (const Function &f: functions) {
+        float worst = 0.0f;
+        const double error = maxError(f, worst);
+        ok = ok && error <= f.maxError;
+        if (accuracyOnly) {
+            printf("%-10s %12.3g %12.3g %10.4g%s\n", f.name, error, f.maxError, worst,
+                   error <= f.maxError ? "" : "  FAIL");
+            continue;
+        }
+
+        // inputs spread over the range, as a module would see them
+        std::vector<float> in(blockSize), out(blockSize);
+        for (int i = 0; i < blockSize; i++) {
+            double t = (double) ((i * 37) % blockSize) / blockSize;
+            in[i] = (float) (f.lo > 0.0f ? f.lo * std::pow((double) f.hi / f.lo, t) : f.lo + (f.hi - f.lo) * t);
+        }
+        const double fast = throughput([&] {
+            f.fast(in.data(), out.data(), blockSize);
+            sink = sink + out[0];
+        }, blockSize, cycles);
+        const double libm = throughput([&] {
+            for (int i = 0; i < blockSize; i++) out[i] = f.libm(in[i]);
+            sink = sink + out[0];
+        }, blockSize, cycles);
+
+        printf("%-10s %12.3g %12.3g %10.4g %16.3f %16.3f %7.1fx%s\n", f.name, error, f.maxError, worst,
+               fast, libm, libm > 0.0 ? fast / libm : 0.0, error <= f.maxError ? "" : "  FAIL");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// see ../Source/PluginHost.h for license
+
+// throughput of the real fft of PercussaFft.h at sizes 256 ... 8192, against
+// a plain radix-2 complex fft of the same signal (bit reversal, one butterfly
+// at a time), as a module would write it. reports ns per fft and mflops
+// (2.5 N log2 N for a real fft), the largest error against a double precision
+// fft (fails, exit code 1, above 1e-6 of the largest magnitude), and the cost
+// of a SpectrumAnalyser frame of a number of channels: windowing, fft and
+// bands, as its worker thread computes it, in % of a core at 30 frames/s.
+//
+// usage: bench_fft [-c channels]
+
+#include "Bench.h"
+
+#include <PercussaFft.h>
+#include <PercussaSpectrum.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+volatile float sink = 0.0f;
+
+// the textbook fft, in place on real and imaginary parts, size a power of 2
+template<typename T>
+void radix2(std::vector<T> &re, std::vector<T> &im, const std::vector<T> &cos, const std::vector<T> &sin) {
+    const size_t n = re.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t step = n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                const size_t a = i + k, b = a + len / 2;
+                const T wr = cos[k * step], wi = -sin[k * step];
+                const T br = re[b] * wr - im[b] * wi;
+                const T bi = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - br;
+                im[b] = im[a] - bi;
+                re[a] += br;
+                im[a] += bi;
+            }
+        }
+    }
+}
+
+template<typename T>
+void twiddles(size_t n, std::vector<T> &cos, std::vector<T> &sin) {
+    cos.resize(n / 2);
+    sin.resize(n / 2);
+    for (size_t k = 0; k < n / 2; k++) {
+        cos[k] = (T) std::cos(2.0 * M_PI * k / n);
+        sin[k] = (T) std::sin(2.0 * M_PI * k / n);
+    }
+}
+
+// ns per call, best of a few runs
+template<typename F>
+double timeNs(F f, int calls) {
+    double best = 1e30;
+    for (int run = 0; run < 5; run++) {
+        uint64_t t0 = nowNs();
+        for (int i = 0; i < calls; i++) f();
+        uint64_t t1 = nowNs();
+        best = std::min(best, (double) (t1 - t0) / calls);
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int channels = 8;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-c" && i + 1 < argc) channels = atoi(argv[++i]);
+        else channels = 0;
+    }
+    if (channels <= 0) {
+        fprintf(stderr, "usage: bench_fft [-c channels]\n");
+        return 1;
+    }
+
+    printf("%6s %10s %12s %12s %12s %12s %8s %16s %10s\n", "size", "error", "fft ns", "fft mflops",
+           "radix-2 ns", "r-2 mflops", "speedup", "frame ns", "% at 30/s");
+
+    bool ok = true;
+    srand(1);
+    for (int size = 256; size <= 8192; size *= 2) {
+        std::vector<float> in(size), re(size / 2 + 1), im(size / 2 + 1);
+        for (float &x: in) x = (float) rand() / RAND_MAX * 2.0f - 1.0f;
+        Fft fft(size);
+
+        // accuracy
+        fft.forward(in.data(), re.data(), im.data());
+        std::vector<double> exactRe(in.begin(), in.end()), exactIm(size), cosD, sinD;
+        twiddles(size, cosD, sinD);
+        radix2(exactRe, exactIm, cosD, sinD);
+        double error = 0.0, largest = 0.0;
+        for (int k = 0; k <= size / 2; k++) {
+            error = std::max(error, std::hypot(exactRe[k] - re[k], exactIm[k] - im[k]));
+            largest = std::max(largest, std::hypot(exactRe[k], exactIm[k]));
+        }
+        error /= largest;
+        ok = ok && error <= 1e-6;
+
+        // about the same amount of work at every size
+        const int calls = std::max(100, (1 << 23) / size);
+        const double flops = 2.5 * size * std::log2((double) size);
+        const double fast = timeNs([&] {
+            fft.forward(in.data(), re.data(), im.data());
+            sink = sink + re[1];
+        }, calls);
+
+        std::vector<float> cosF, sinF, xr(size), xi(size);
+        twiddles(size, cosF, sinF);
+        const double plain = timeNs([&] {
+            std::copy(in.begin(), in.end(), xr.begin());
+            std::fill(xi.begin(), xi.end(), 0.0f);
+            radix2(xr, xi, cosF, sinF);
+            sink = sink + xr[1];
+        }, calls);
+
+        // a frame of the analyser, all channels have new samples
+        SpectrumAnalyser analyser(channels, size);
+        for (int ch = 0; ch < channels; ch++) analyser.write(ch, in.data(), size);
+        const double frame = timeNs([&] {
+            for (int ch = 0; ch < channels; ch++) analyser.write(ch, in.data(), 64);
+            analyser.analyse();
+        }, std::max(20, calls / channels));
+
+        printf("%6d %10.3g %12.0f %12.0f %12.0f %12.0f %7.1fx %16.0f %9.2f%%%s\n", size, error,
+               fast, flops / fast * 1e3, plain, flops / plain * 1e3, plain / fast,
+               frame, frame * 30.0 / 1e7, error <= 1e-6 ? "" : "  FAIL");
+    }
+    return ok ? 0 : 1;
+}
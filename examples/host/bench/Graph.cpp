@@ -0,0 +1,225 @@
+// see ../Source/PluginHost.h for license
+
+// a random patch of 8 channel modules, run with a buffer per channel and a copy
+// per connection, and as compiled by Graph (shared buffer pool, in-place chains).
+// reports the buffer memory, time per block and last level cache misses, and
+// fails if both do not compute the same. with -l the modules process in the
+// interleaved or packed4 layout, and every other one takes all its inputs from
+// the one before, which Graph passes on in that layout (ctest runs both).
+//
+// usage: bench_graph [-n modules] [-b blocksize] [-f feedback connections] [-l planar|interleaved|packed4]
+
+#include "Bench.h"
+#include "Graph.h"
+#include "PerfCounter.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+constexpr int CHANNELS = 8;
+
+// a one pole lowpass on every channel, or a sine on every output for the
+// source of the patch. the checksum of the outputs is used to check that
+// both ways of running the patch compute the same.
+class TestPlugin : public PluginInterface {
+public:
+    TestPlugin(bool source, int layout) : source_(source), layout_(layout) {}
+
+    PluginEditorInterface *getEditor() override { return nullptr; }
+    void prepare(double, int) override {}
+    int getBufferLayout() override { return layout_; }
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        run([channelData](int ch, int i) -> float & { return channelData[ch][i]; }, numChannels, numSamples);
+    }
+
+    void processFrames(float *data, int numChannels, int numSamples) override {
+        if (layout_ == LAYOUT_INTERLEAVED) {
+            run([=](int ch, int i) -> float & { return data[i * numChannels + ch]; }, numChannels, numSamples);
+        } else {
+            run([=](int ch, int i) -> float & { return data[(ch / 4 * numSamples + i) * 4 + ch % 4]; }, numChannels,
+                numSamples);
+        }
+    }
+
+    double checksum = 0.0;
+
+private:
+    // sample(ch, i) is sample i of channel ch
+    template<typename Sample>
+    void run(Sample sample, int numChannels, int numSamples) {
+        for (int ch = 0; ch < numChannels; ch++) {
+            float z = state_[ch];
+            if (source_) {
+                for (int i = 0; i < numSamples; i++) sample(ch, i) = sinf(0.01f * (ch + 1) * (float) (t_ + i));
+            } else {
+                for (int i = 0; i < numSamples; i++) {
+                    z += 0.2f * (sample(ch, i) - z);
+                    sample(ch, i) = z;
+                }
+            }
+            state_[ch] = z;
+            checksum += sample(ch, numSamples - 1);
+        }
+        t_ += numSamples;
+    }
+
+    bool source_;
+    int layout_;
+    float state_[CHANNELS] = {};
+    uint64_t t_ = 0;
+};
+
+PluginDescriptor *testDescriptor(bool source) {
+    auto *desc = new PluginDescriptor;
+    desc->name = source ? "SINE" : "FILTER";
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        if (!source) desc->inputChannelNames.push_back("In" + std::to_string(ch + 1));
+        desc->outputChannelNames.push_back("Out" + std::to_string(ch + 1));
+    }
+    return desc;
+}
+
+struct Patch {
+    std::vector<std::unique_ptr<Module>> modules;
+    Graph graph;
+};
+
+// the same random patch for the same seed: a sine source, and filters with each
+// input connected (with a probability of 3/4) to an output of one of the 8
+// modules before it. with a layout, every other filter is connected channel
+// for channel to the module before it instead.
+void buildPatch(Patch &patch, int numModules, int feedback, int blockSize, int layout) {
+    std::mt19937 rng(7);
+    for (int i = 0; i < numModules; i++) {
+        bool source = i == 0;
+        patch.modules.emplace_back(new Module(testDescriptor(source), new TestPlugin(source, layout), i));
+        patch.modules.back()->prepare(48000.0, blockSize);
+        patch.graph.add(patch.modules.back().get());
+    }
+    for (int i = 1; i < numModules; i++) {
+        if (layout != LAYOUT_PLANAR && i % 2 == 0) {
+            for (int ch = 0; ch < CHANNELS; ch++) {
+                patch.graph.connect(patch.modules[i - 1].get(), ch, patch.modules[i].get(), ch);
+            }
+            continue;
+        }
+        for (int in = 0; in < CHANNELS; in++) {
+            if (rng() % 4 == 0) continue;
+            int from = i - 1 - (int) (rng() % std::min(i, 8));
+            patch.graph.connect(patch.modules[from].get(), (int) (rng() % CHANNELS), patch.modules[i].get(), in);
+        }
+    }
+    // feedback from later modules into unconnected inputs of earlier ones
+    for (int f = 0; f < feedback && numModules > 2; f++) {
+        int to = 1 + (int) (rng() % (numModules - 2));
+        int from = to + 1 + (int) (rng() % (numModules - 1 - to));
+        for (int in = 0; in < CHANNELS; in++) {
+            try {
+                patch.graph.connect(patch.modules[from].get(), (int) (rng() % CHANNELS), patch.modules[to].get(), in);
+                break;
+            } catch (const std::exception &) {
+                // input taken, try the next one
+            }
+        }
+    }
+}
+
+struct Result {
+    double nsPerBlock;
+    double llReadsPerBlock;
+    double llMissesPerBlock;
+    bool counted;
+};
+
+Result run(Patch &patch, int blockSize, int blocks) {
+    for (int b = 0; b < blocks / 10; b++) patch.graph.process(blockSize);
+
+    PerfCounter reads = PerfCounter::llReads();
+    PerfCounter misses = PerfCounter::llReadMisses();
+    reads.enable();
+    misses.enable();
+    uint64_t t0 = nowNs();
+    for (int b = 0; b < blocks; b++) patch.graph.process(blockSize);
+    uint64_t t = nowNs() - t0;
+    reads.disable();
+    misses.disable();
+    return Result{(double) t / blocks, (double) reads.read() / blocks, (double) misses.read() / blocks,
+                  reads.valid() && misses.valid()};
+}
+
+void print(const char *name, const Graph::Stats &s, const Result &r) {
+    printf("%-10s %8d %10zu %8d %8d %8d %8d %12.0f", name, s.buffers, s.bytes / 1024, s.copies, s.clears, s.inPlace,
+           s.frameCopies, r.nsPerBlock);
+    if (r.counted) printf(" %12.0f %10.2f%%", r.llMissesPerBlock, 100.0 * r.llMissesPerBlock / std::max(1.0, r.llReadsPerBlock));
+    printf("\n");
+}
+
+}
+
+int main(int argc, char **argv) {
+    int numModules = 48;
+    int blockSize = 128;
+    int feedback = 2;
+    int layout = LAYOUT_PLANAR;
+    const int blocks = 4000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        std::string v = argv[i + 1];
+        if (a == "-n") numModules = atoi(argv[i + 1]);
+        else if (a == "-b") blockSize = atoi(argv[i + 1]);
+        else if (a == "-f") feedback = atoi(argv[i + 1]);
+        else if (a == "-l") layout = v == "planar" ? LAYOUT_PLANAR : v == "interleaved" ? LAYOUT_INTERLEAVED :
+                                     v == "packed4" ? LAYOUT_PACKED4 : -1;
+    }
+    if (numModules <= 0 || blockSize <= 0 || feedback < 0 || layout < 0) {
+        fprintf(stderr, "usage: bench_graph [-n modules] [-b blocksize] [-f feedback connections] "
+                        "[-l planar|interleaved|packed4]\n");
+        return 1;
+    }
+
+    try {
+        // two instances of the same patch, so both start from the same state
+        Patch separate, shared;
+        buildPatch(separate, numModules, feedback, blockSize, layout);
+        buildPatch(shared, numModules, feedback, blockSize, layout);
+        separate.graph.compile(blockSize, false);
+        shared.graph.compile(blockSize, true);
+
+        Result s = run(separate, blockSize, blocks);
+        Result r = run(shared, blockSize, blocks);
+
+        printf("%d modules, %d channels, block size %d, %d feedback connections\n", numModules, CHANNELS, blockSize,
+               shared.graph.stats().feedback);
+        printf("%-10s %8s %10s %8s %8s %8s %8s %12s", "", "buffers", "kB", "copies", "clears", "in place", "frames",
+               "ns / block");
+        if (s.counted) printf(" %12s %11s", "LL misses", "miss rate");
+        printf("\n");
+        print("separate", separate.graph.stats(), s);
+        print("graph", shared.graph.stats(), r);
+        if (!s.counted) printf("note: hardware counters unavailable, cache misses not counted\n");
+
+        // both have to compute the same thing
+        for (int m = 0; m < numModules; m++) {
+            auto &a = static_cast<TestPlugin &>(separate.modules[m]->plugin());
+            auto &b = static_cast<TestPlugin &>(shared.modules[m]->plugin());
+            if (a.checksum != b.checksum) {
+                fprintf(stderr, "error: outputs of module %d differ\n", m);
+                return 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// see ../Source/PluginHost.h for license
+
+// latency of inserting a module into a patch (what the user waits for after
+// picking a module), creating and preparing a new instance vs taking a
+// prepared one from an InstancePool. a module is inserted and removed again
+// in every round. with the pool, removed modules go back into it after a warm
+// start (reset(), API 3.13), or are deleted and replaced by refill(), which
+// the UI thread runs when it is idle. that time is reported separately.
+//
+// usage: bench_insert [-r rounds] [-p pool size] plugin.so
+
+#include "Bench.h"
+#include "InstancePool.h"
+#include "PluginHost.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int BLOCK_SIZE = 128;
+
+// the new module is connected to the patch
+void connect(Module &module) {
+    for (int i = 0; i < module.numInputs(); i++) module.plugin().inputEnabled(i, true);
+    for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+}
+
+void report(const char *name, std::vector<uint64_t> &ns) {
+    std::sort(ns.begin(), ns.end());
+    uint64_t sum = 0;
+    for (uint64_t t: ns) sum += t;
+    printf("%-24s %10.1f %10.1f %10.1f\n", name, ns[ns.size() / 2] / 1000.0,
+           ns[ns.size() * 99 / 100] / 1000.0, sum / 1000.0 / ns.size());
+}
+
+}
+
+int main(int argc, char **argv) {
+    int rounds = 200;
+    int poolSize = 2;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-r" && i + 1 < argc) rounds = atoi(argv[++i]);
+        else if (a == "-p" && i + 1 < argc) poolSize = atoi(argv[++i]);
+        else path = a;
+    }
+    if (path.empty() || rounds <= 0 || poolSize <= 0) {
+        fprintf(stderr, "usage: bench_insert [-r rounds] [-p pool size] plugin.so\n");
+        return 1;
+    }
+
+    try {
+        PluginLibrary library(path);
+        std::unique_ptr<Percussa::SSP::PluginDescriptor> descriptor(library.createDescriptor());
+        std::vector<uint64_t> fresh, pooled, idle;
+        int resets = 0;
+
+        for (int r = 0; r < rounds; r++) {
+            uint64_t t0 = nowNs();
+            std::unique_ptr<Module> module(new Module(library, r));
+            module->prepare(SAMPLE_RATE, BLOCK_SIZE);
+            connect(*module);
+            fresh.push_back(nowNs() - t0);
+            module->process(BLOCK_SIZE);
+        }
+
+        InstancePool pool(SAMPLE_RATE, BLOCK_SIZE);
+        const int uid = pool.reserve(library, 0, poolSize);
+        for (int r = 0; r < rounds; r++) {
+            uint64_t t0 = nowNs();
+            std::unique_ptr<Module> module = pool.acquire(uid, r);
+            connect(*module);
+            pooled.push_back(nowNs() - t0);
+            module->process(BLOCK_SIZE);
+
+            uint64_t t1 = nowNs();
+            const int before = pool.available(uid);
+            pool.release(std::move(module));
+            if (pool.available(uid) > before) resets++;
+            pool.refill(poolSize);
+            idle.push_back(nowNs() - t1);
+        }
+
+        printf("inserting %s, %d rounds, pool of %d, %d of %d removed instances reset\n",
+               descriptor->name.c_str(), rounds, poolSize, resets, rounds);
+        printf("%-24s %10s %10s %10s\n", "", "median us", "p99 us", "avg us");
+        report("new instance", fresh);
+        report("from pool", pooled);
+        report("pool release + refill", idle);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+// see ../Source/PluginHost.h for license
+
+// worst case audio timing while the UI side of the host is busy. a patch of
+// instances of the given plugins is processed by the audio thread (pinned
+// as ssphost pins it), first with nothing else running, then while UI
+// threads render the editors with frameStart() and renderToImage() as fast
+// as they can, and save and load the state of every instance every 4 frames
+// with getState() and setState().
+//
+// the plugin API has one UI thread, the default. with -u the instances are
+// spread over more of them, each instance driven by one, which is only valid
+// for plugins whose instances share nothing on the UI side: JUCE plugins share
+// the adapter's images, for one.
+//
+// reports for both runs the blocks which missed their deadline, the
+// distribution and a histogram of the wake up latency of the audio thread
+// (from the time a block was due to start) and of the time it finished the
+// block (in % of the block period), and what the UI threads got done.
+//
+// usage: bench_jitter [-n instances] [-t seconds] [-b blocksize] [-u ui threads] [-w width] [-h height]
+//                     plugin.so [plugin.so ...]
+
+#include "Bench.h"
+#include "AudioThread.h"
+#include "PluginHost.h"
+#include "ThreadPolicy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int STATE_EVERY = 4;
+
+// upper bounds of the histogram buckets, the last one is open
+static constexpr int NUM_BUCKETS = 8;
+static const double wakeBuckets[NUM_BUCKETS - 1] = {10, 20, 50, 100, 200, 500, 1000};
+static const double doneBuckets[NUM_BUCKETS - 1] = {25, 50, 75, 90, 100, 150, 200};
+
+struct Result {
+    uint64_t blocks = 0;
+    uint64_t misses = 0;
+    uint64_t xruns = 0;
+    std::vector<uint64_t> wakeNs;
+    std::vector<uint64_t> doneNs;
+    double periodNs = 0.0;
+    uint64_t frames = 0;
+    uint64_t states = 0;
+    uint64_t slowestFrameNs = 0;
+};
+
+// one UI thread: frames of the editors of its modules, and their states
+class UiLoad {
+public:
+    UiLoad(std::vector<Module *> modules, int width, int height) :
+            modules_(std::move(modules)), width_(width), height_(height) {}
+
+    void start() { thread_ = std::thread(&UiLoad::run, this); }
+
+    void stop() {
+        quit_ = true;
+        if (thread_.joinable()) thread_.join();
+    }
+
+    uint64_t frames() const { return frames_; }
+    uint64_t states() const { return states_; }
+    uint64_t slowestFrameNs() const { return slowest_; }
+
+private:
+    void run() {
+        std::vector<unsigned char> image((size_t) width_ * height_ * 4);
+        for (uint64_t pass = 0; !quit_.load(std::memory_order_relaxed); pass++) {
+            for (Module *m: modules_) {
+                const uint64_t t = nowNs();
+                if (m->editor()) {
+                    m->frameStart();
+                    m->renderToImage(image.data(), width_, height_);
+                    frames_++;
+                }
+                if (pass % STATE_EVERY == 0) {
+                    m->setState(m->getState());
+                    states_++;
+                }
+                slowest_ = std::max(slowest_, nowNs() - t);
+            }
+        }
+    }
+
+    std::vector<Module *> modules_;
+    const int width_, height_;
+    std::atomic<bool> quit_{false};
+    uint64_t frames_ = 0;
+    uint64_t states_ = 0;
+    uint64_t slowest_ = 0;
+    std::thread thread_;
+};
+
+Result run(const std::vector<Module *> &modules, ThreadPolicy &policy, double seconds, int blockSize,
+           int uiThreads, int width, int height) {
+    Result r;
+    r.periodNs = blockSize * 1e9 / SAMPLE_RATE;
+    // no allocation on the audio thread, blocks past the expected count are not recorded
+    const size_t capacity = (size_t) (seconds * SAMPLE_RATE / blockSize * 1.5) + 16;
+    r.wakeNs.resize(capacity);
+    r.doneNs.resize(capacity);
+    size_t recorded = 0;
+
+    std::vector<std::unique_ptr<UiLoad>> ui;
+    for (int u = 0; u < uiThreads; u++) {
+        std::vector<Module *> own;
+        for (size_t i = u; i < modules.size(); i += uiThreads) own.push_back(modules[i]);
+        ui.emplace_back(new UiLoad(own, width, height));
+    }
+
+    AudioThread audio(SAMPLE_RATE, blockSize, modules);
+    audio.setTimingCallback([&](uint64_t, int numSamples, uint64_t wakeNs, uint64_t doneNs) {
+        if (doneNs > numSamples * 1e9 / SAMPLE_RATE) r.misses++;
+        if (recorded < capacity) {
+            r.wakeNs[recorded] = wakeNs;
+            r.doneNs[recorded] = doneNs;
+            recorded++;
+        }
+    });
+    audio.start();
+    policy.pinRealtime(audio.thread().native_handle());
+    for (auto &u: ui) u->start();
+    usleep((useconds_t) (seconds * 1e6));
+    for (auto &u: ui) u->stop();
+    audio.stop();
+
+    r.blocks = audio.blocks();
+    r.xruns = audio.xruns();
+    r.wakeNs.resize(recorded);
+    r.doneNs.resize(recorded);
+    std::sort(r.wakeNs.begin(), r.wakeNs.end());
+    std::sort(r.doneNs.begin(), r.doneNs.end());
+    for (auto &u: ui) {
+        r.frames += u->frames();
+        r.states += u->states();
+        r.slowestFrameNs = std::max(r.slowestFrameNs, u->slowestFrameNs());
+    }
+    return r;
+}
+
+double percentile(const std::vector<uint64_t> &ns, double p) {
+    if (ns.empty()) return 0.0;
+    return ns[std::min(ns.size() - 1, (size_t) (ns.size() * p / 100.0))] / 1000.0;
+}
+
+std::vector<uint64_t> histogram(const std::vector<uint64_t> &ns, const double *bounds, double scale) {
+    std::vector<uint64_t> counts(NUM_BUCKETS, 0);
+    for (uint64_t v: ns) {
+        int b = 0;
+        while (b < NUM_BUCKETS - 1 && v * scale >= bounds[b]) b++;
+        counts[b]++;
+    }
+    return counts;
+}
+
+void printHistogram(const char *title, const char *unit, const double *bounds, const Result results[2],
+                    bool done) {
+    std::vector<uint64_t> counts[2];
+    for (int k = 0; k < 2; k++) {
+        counts[k] = histogram(done ? results[k].doneNs : results[k].wakeNs, bounds,
+                              done ? 100.0 / results[k].periodNs : 1e-3);
+    }
+    printf("\n%-20s %12s %12s\n", title, "quiet", "ui load");
+    for (int b = 0; b < NUM_BUCKETS; b++) {
+        char label[32];
+        if (b < NUM_BUCKETS - 1) snprintf(label, sizeof(label), "< %g %s", bounds[b], unit);
+        else snprintf(label, sizeof(label), ">= %g %s", bounds[b - 1], unit);
+        printf("%-20s %12llu %12llu\n", label, (unsigned long long) counts[0][b], (unsigned long long) counts[1][b]);
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    int instances = 8;
+    double seconds = 10.0;
+    int blockSize = 64;
+    int uiThreads = 1;
+    int width = 1600, height = 480;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-n" && i + 1 < argc) instances = atoi(argv[++i]);
+        else if (a == "-t" && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (a == "-b" && i + 1 < argc) blockSize = atoi(argv[++i]);
+        else if (a == "-u" && i + 1 < argc) uiThreads = atoi(argv[++i]);
+        else if (a == "-w" && i + 1 < argc) width = atoi(argv[++i]);
+        else if (a == "-h" && i + 1 < argc) height = atoi(argv[++i]);
+        else paths.push_back(a);
+    }
+    if (paths.empty() || instances <= 0 || seconds <= 0.0 || blockSize <= 0 || uiThreads <= 0 || width <= 0 ||
+        height <= 0) {
+        fprintf(stderr, "usage: bench_jitter [-n instances] [-t seconds] [-b blocksize] [-u ui threads] "
+                        "[-w width] [-h height]\n                    plugin.so [plugin.so ...]\n");
+        return 1;
+    }
+
+    try {
+        std::vector<std::unique_ptr<PluginLibrary>> libraries;
+        std::vector<std::unique_ptr<Module>> owned;
+        std::vector<Module *> modules;
+        for (const std::string &path: paths) {
+            libraries.emplace_back(new PluginLibrary(path));
+            for (int i = 0; i < instances; i++) {
+                owned.emplace_back(new Module(*libraries.back(), (int) owned.size()));
+                modules.push_back(owned.back().get());
+            }
+        }
+        int editors = 0;
+        for (Module *m: modules) {
+            for (int i = 0; i < m->numInputs(); i++) m->plugin().inputEnabled(i, true);
+            for (int i = 0; i < m->numOutputs(); i++) m->plugin().outputEnabled(i, true);
+            m->prepare(SAMPLE_RATE, blockSize);
+            if (m->editor()) {
+                m->visibilityChanged(true);
+                editors++;
+            }
+        }
+        uiThreads = std::min(uiThreads, (int) modules.size());
+
+        ThreadPolicy policy;
+        Result results[2];
+        results[0] = run(modules, policy, seconds, blockSize, 0, width, height);
+        results[1] = run(modules, policy, seconds, blockSize, uiThreads, width, height);
+        for (Module *m: modules) {
+            if (m->editor()) m->visibilityChanged(false);
+        }
+        owned.clear();
+
+        printf("%zu instances (%d with an editor), block size %d (%.0f us), %d ui threads rendering %dx%d, "
+               "%.0f s per run\nthreads: %s\n\n", modules.size(), editors, blockSize, results[0].periodNs / 1e3,
+               uiThreads, width, height, seconds, policy.describe().c_str());
+        printf("%-20s %12s %12s\n", "", "quiet", "ui load");
+        printf("%-20s %12llu %12llu\n", "blocks", (unsigned long long) results[0].blocks,
+               (unsigned long long) results[1].blocks);
+        printf("%-20s %12llu %12llu\n", "deadline misses", (unsigned long long) results[0].misses,
+               (unsigned long long) results[1].misses);
+        printf("%-20s %12llu %12llu\n", "xruns", (unsigned long long) results[0].xruns,
+               (unsigned long long) results[1].xruns);
+        const double ps[] = {50.0, 99.0, 99.9, 100.0};
+        const char *names[] = {"p50", "p99", "p99.9", "max"};
+        for (int i = 0; i < 4; i++) {
+            printf("%-20s %12.1f %12.1f\n", (std::string("wake up us, ") + names[i]).c_str(),
+                   percentile(results[0].wakeNs, ps[i]), percentile(results[1].wakeNs, ps[i]));
+        }
+        for (int i = 0; i < 4; i++) {
+            printf("%-20s %12.1f %12.1f\n", (std::string("done us, ") + names[i]).c_str(),
+                   percentile(results[0].doneNs, ps[i]), percentile(results[1].doneNs, ps[i]));
+        }
+        printf("%-20s %12s %12llu\n", "ui frames", "-", (unsigned long long) results[1].frames);
+        printf("%-20s %12s %12llu\n", "state save+loads", "-", (unsigned long long) results[1].states);
+        printf("%-20s %12s %12.1f\n", "slowest ui call ms", "-", results[1].slowestFrameNs / 1e6);
+
+        printHistogram("wake up latency", "us", wakeBuckets, results, false);
+        printHistogram("block done", "% of period", doneBuckets, results, true);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
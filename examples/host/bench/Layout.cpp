@@ -0,0 +1,214 @@
+// see ../Source/PluginHost.h for license
+
+// cost of converting between the planar, interleaved and packed buffer
+// layouts (PercussaLayout.h) compared with plain loops, and the qvca
+// multiply/gain stage written for planar and for packed data.
+// -t checks instead that the kernels match the plain loops, and convert
+// back to the same samples, for 1 to 9 channels and block sizes which are not
+// a multiple of 4 too, without writing past the buffers (ctest runs it).
+//
+// usage: bench_layout [-t] [-b blocksize] [-c channels]
+
+#include "Bench.h"
+
+#include <PercussaLayout.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+volatile float sink = 0.0f;
+
+// runs f repeatedly, returns ns per call
+template<typename F>
+double measure(F f, int calls) {
+    for (int i = 0; i < calls / 10; i++) f();
+    uint64_t t0 = nowNs();
+    for (int i = 0; i < calls; i++) f();
+    return (double) (nowNs() - t0) / calls;
+}
+
+void plainInterleave(const float *const *planar, int numChannels, int numSamples, float *data) {
+    for (int i = 0; i < numSamples; i++) {
+        for (int ch = 0; ch < numChannels; ch++) data[i * numChannels + ch] = planar[ch][i];
+    }
+}
+
+void plainDeinterleave(const float *data, int numChannels, int numSamples, float *const *planar) {
+    for (int i = 0; i < numSamples; i++) {
+        for (int ch = 0; ch < numChannels; ch++) planar[ch][i] = data[i * numChannels + ch];
+    }
+}
+
+void plainPack4(const float *const *planar, int numChannels, int numSamples, float *data) {
+    for (int ch = 0; ch < numChannels; ch++) {
+        float *out = data + (ch / 4) * numSamples * 4 + ch % 4;
+        for (int i = 0; i < numSamples; i++) out[i * 4] = planar[ch][i];
+    }
+}
+
+void plainUnpack4(const float *data, int numChannels, int numSamples, float *const *planar) {
+    for (int ch = 0; ch < numChannels; ch++) {
+        const float *in = data + (ch / 4) * numSamples * 4 + ch % 4;
+        for (int i = 0; i < numSamples; i++) planar[ch][i] = in[i * 4];
+    }
+}
+
+// qvca: out[2k] = in[2k] * in[2k + 1] * gain[k], out[2k + 1] = -out[2k], as in its processBlock()
+void qvcaPlanar(float *const *ch, int numSamples, const float *gain) {
+    for (int i = 0; i < numSamples; i++) {
+        for (int k = 0; k < 4; k++) {
+            float p = ch[2 * k][i] * ch[2 * k + 1][i];
+            ch[2 * k][i] = p;
+            ch[2 * k + 1][i] = -p;
+        }
+    }
+    for (int k = 0; k < 8; k++) {
+        float g = gain[k / 2];
+        for (int i = 0; i < numSamples; i++) ch[k][i] *= g;
+    }
+}
+
+// the same on packed data: a frame of 4 channels {a, b, c, d} becomes
+// {a * b * g1, -a * b * g1, c * d * g2, -c * d * g2} with one shuffle and two multiplies
+void qvcaPacked(float *data, int numSamples, const float *gain) {
+    using namespace Simd;
+    for (int g = 0; g < 2; g++) {
+        f4 gv = set(gain[2 * g], -gain[2 * g], gain[2 * g + 1], -gain[2 * g + 1]);
+        float *frames = data + g * numSamples * 4;
+        for (int i = 0; i < numSamples; i++) {
+            f4 x = load(frames + i * 4);
+            store(frames + i * 4, mul(mul(x, swapPairs(x)), gv));
+        }
+    }
+}
+
+// the round trip of a layout, false if it is not exact. planar buffers are
+// misaligned on purpose, every buffer is followed by guard samples. nothing
+// is converted for LAYOUT_PLANAR, so nothing may be written.
+bool checkLayout(int layout, int channels, int numSamples, std::mt19937 &rng) {
+    const int guard = 8;
+    const float canary = -12345.0f;
+    const size_t stride = (size_t) numSamples + 1 + guard;
+    std::vector<float> in((size_t) channels * stride, canary), out(in.size(), canary);
+    std::vector<float *> inPlanar, outPlanar;
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (int ch = 0; ch < channels; ch++) {
+        inPlanar.push_back(&in[ch * stride + 1]);
+        outPlanar.push_back(&out[ch * stride + 1]);
+        for (int i = 0; i < numSamples; i++) inPlanar[ch][i] = dist(rng);
+    }
+
+    const size_t size = layoutSize(layout, channels, numSamples);
+    std::vector<float> storage(size + guard + 4, canary), plain(size, 0.0f);
+    float *frames = (float *) (((uintptr_t) storage.data() + 15) & ~(uintptr_t) 15);
+    toLayout(layout, inPlanar.data(), channels, numSamples, frames);
+    fromLayout(layout, frames, channels, numSamples, outPlanar.data());
+    if (layout == LAYOUT_PLANAR) {
+        bool untouched = true;
+        for (float x: storage) untouched = untouched && x == canary;
+        for (float x: out) untouched = untouched && x == canary;
+        return untouched;
+    }
+    if (layout == LAYOUT_INTERLEAVED) plainInterleave(inPlanar.data(), channels, numSamples, plain.data());
+    else plainPack4(inPlanar.data(), channels, numSamples, plain.data());
+
+    // the padding channels of packed4 are silent, like the zeroed plain buffer
+    bool ok = memcmp(frames, plain.data(), size * sizeof(float)) == 0;
+    for (int i = 0; i < guard; i++) ok = ok && frames[size + i] == canary;
+    for (int ch = 0; ch < channels; ch++) {
+        ok = ok && memcmp(inPlanar[ch], outPlanar[ch], (size_t) numSamples * sizeof(float)) == 0;
+        ok = ok && outPlanar[ch][-1] == canary;
+        for (int i = 0; i < guard; i++) ok = ok && outPlanar[ch][numSamples + i] == canary;
+    }
+    return ok;
+}
+
+int check() {
+    const int sizes[] = {1, 2, 3, 4, 5, 7, 8, 13, 64, 67, 128, 131};
+    std::mt19937 rng(3);
+    int failed = 0;
+    const char *names[] = {"planar", "interleaved", "packed4"};
+    for (int layout: {LAYOUT_PLANAR, LAYOUT_INTERLEAVED, LAYOUT_PACKED4}) {
+        for (int channels = 1; channels <= 9; channels++) {
+            for (int numSamples: sizes) {
+                if (checkLayout(layout, channels, numSamples, rng)) continue;
+                printf("FAILED: %s, %d channels, %d samples\n", names[layout], channels, numSamples);
+                failed++;
+            }
+        }
+    }
+    printf("layout round trips: %s\n", failed ? "FAILED" : "ok");
+    return failed ? 1 : 0;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int blockSize = 128;
+    int channels = 8;
+    const int calls = 200000;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-t") return check();
+        if (a == "-b" && i + 1 < argc) blockSize = atoi(argv[++i]);
+        else if (a == "-c" && i + 1 < argc) channels = atoi(argv[++i]);
+    }
+    if (blockSize <= 0 || channels <= 0) {
+        fprintf(stderr, "usage: bench_layout [-t] [-b blocksize] [-c channels]\n");
+        return 1;
+    }
+
+    std::vector<float> planarStorage((size_t) channels * blockSize);
+    std::vector<float *> planar;
+    for (int ch = 0; ch < channels; ch++) planar.push_back(&planarStorage[(size_t) ch * blockSize]);
+    for (size_t i = 0; i < planarStorage.size(); i++) planarStorage[i] = (float) (i % 97) / 97.0f;
+
+    std::vector<float> frameStorage(layoutSize(LAYOUT_PACKED4, channels, blockSize) + 4);
+    float *frames = (float *) (((uintptr_t) frameStorage.data() + 15) & ~(uintptr_t) 15);
+
+    printf("%d channels, block size %d, ns per block\n", channels, blockSize);
+    printf("%-24s %12s %12s\n", "", "plain loop", "simd kernel");
+    printf("%-24s %12.1f %12.1f\n", "planar -> interleaved",
+           measure([&]() { plainInterleave(planar.data(), channels, blockSize, frames); }, calls),
+           measure([&]() { interleave(planar.data(), channels, blockSize, frames); }, calls));
+    printf("%-24s %12.1f %12.1f\n", "interleaved -> planar",
+           measure([&]() { plainDeinterleave(frames, channels, blockSize, planar.data()); }, calls),
+           measure([&]() { deinterleave(frames, channels, blockSize, planar.data()); }, calls));
+    printf("%-24s %12.1f %12.1f\n", "planar -> packed4",
+           measure([&]() { plainPack4(planar.data(), channels, blockSize, frames); }, calls),
+           measure([&]() { pack4(planar.data(), channels, blockSize, frames); }, calls));
+    printf("%-24s %12.1f %12.1f\n", "packed4 -> planar",
+           measure([&]() { plainUnpack4(frames, channels, blockSize, planar.data()); }, calls),
+           measure([&]() { unpack4(frames, channels, blockSize, planar.data()); }, calls));
+
+    if (channels == 8) {
+        const float gain[4] = {0.5f, 0.75f, 1.0f, 1.25f};
+        double planarNs = measure([&]() {
+            qvcaPlanar(planar.data(), blockSize, gain);
+            sink = sink + planar[0][0];
+        }, calls);
+        double packedNs = measure([&]() {
+            qvcaPacked(frames, blockSize, gain);
+            sink = sink + frames[0];
+        }, calls);
+        double convertedNs = measure([&]() {
+            pack4(planar.data(), channels, blockSize, frames);
+            qvcaPacked(frames, blockSize, gain);
+            unpack4(frames, channels, blockSize, planar.data());
+            sink = sink + planar[0][0];
+        }, calls);
+        printf("\nqvca multiply and gain, ns per block\n");
+        printf("%-40s %12.1f\n", "planar", planarNs);
+        printf("%-40s %12.1f\n", "packed4", packedNs);
+        printf("%-40s %12.1f\n", "packed4, converted from/to planar", convertedNs);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// see ../Source/PluginHost.h for license
+
+// memory of a patch with many instances of a plugin, after every editor has
+// been shown once (what a patch costs when editors keep their resources), and
+// after hiding all editors but one (plugins releasing their editor resources
+// when hidden, see PluginEditorInterface::visibilityChanged()). reports the
+// resident memory of the process, and the memory the plugins report
+// themselves (getMemoryUsage(), API 3.12).
+//
+// usage: bench_memory [-n instances] plugin.so
+
+#include "Bench.h"
+#include "PluginHost.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+static constexpr int WIDTH = 1600, HEIGHT = 480;
+
+void report(const char *state, std::vector<Module *> &modules, size_t baseline) {
+    Percussa::SSP::MemoryUsage total;
+    size_t host = 0;
+    bool known = true;
+    for (Module *m: modules) {
+        Percussa::SSP::MemoryUsage usage;
+        known = m->memoryUsage(usage) && known;
+        total.dspBytes += usage.dspBytes;
+        total.uiBytes += usage.uiBytes;
+        total.sharedBytes = std::max(total.sharedBytes, usage.sharedBytes);
+        host += m->hostBytes();
+    }
+#ifdef __GLIBC__
+    // glibc keeps freed heap memory for later allocations, hand it back as
+    // the system would reclaim it from a long running host
+    malloc_trim(0);
+#endif
+    size_t rss = residentBytes();
+    printf("%-28s %12.1f", state, (rss > baseline ? rss - baseline : 0) / 1048576.0);
+    if (known) {
+        printf(" %12.1f %12.1f %12.1f", total.dspBytes / 1048576.0, total.uiBytes / 1048576.0,
+               total.sharedBytes / 1048576.0);
+    } else {
+        printf(" %12s %12s %12s", "n/a", "n/a", "n/a");
+    }
+    printf(" %12.1f\n", host / 1048576.0);
+}
+
+}
+
+int main(int argc, char **argv) {
+    int instances = 32;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-n" && i + 1 < argc) instances = atoi(argv[++i]);
+        else path = a;
+    }
+    if (path.empty() || instances <= 0) {
+        fprintf(stderr, "usage: bench_memory [-n instances] plugin.so\n");
+        return 1;
+    }
+
+    try {
+        PluginLibrary library(path);
+        std::vector<unsigned char> image(WIDTH * HEIGHT * 4);
+        const size_t baseline = residentBytes();
+
+        std::vector<std::unique_ptr<Module>> owned;
+        std::vector<Module *> modules;
+        for (int i = 0; i < instances; i++) {
+            owned.emplace_back(new Module(library, i));
+            modules.push_back(owned.back().get());
+            modules.back()->prepare(48000.0, 128);
+            modules.back()->editor();
+        }
+
+        printf("%d instances of %s, MB\n", instances, modules[0]->descriptor().name.c_str());
+        printf("%-28s %12s %12s %12s %12s %12s\n", "", "resident", "dsp", "ui", "shared", "host");
+        report("prepared", modules, baseline);
+
+        // every editor is shown, and none hidden: what the patch costs once the user
+        // has paged through all modules, if plugins keep their editor resources
+        for (size_t i = 0; i < modules.size(); i++) {
+            Module *m = modules[i];
+            m->visibilityChanged(true);
+            m->frameStart();
+            m->renderToImage(image.data(), WIDTH, HEIGHT);
+        }
+        report("all editors shown", modules, baseline);
+
+        for (size_t i = 0; i + 1 < modules.size(); i++) modules[i]->visibilityChanged(false);
+        report("one editor visible", modules, baseline);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+// see ../Source/PluginHost.h for license
+
+// reading the gains of the qvca example per block: four heap allocated
+// parameter objects, read with getValue() and converted with
+// convertFrom0to1() through virtual calls (as juce::RangedAudioParameter
+// does), vs a ParamTable snapshot (PercussaParams.h) with ParamRamp gain
+// ramps. a second thread keeps changing the gains, as an editor would.
+// reports the time per block for the parameter reads alone and for the whole
+// gain stage, and the largest gain step between two samples (zipper noise).
+//
+// usage: bench_params [-b blocksize] [-n blocks]
+
+#include "Bench.h"
+
+#include <PercussaParams.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+static constexpr int CHANNELS = 8;
+static constexpr int GAINS = 4;
+static constexpr double SAMPLE_RATE = 48000.0;
+
+volatile float sink = 0.0f;
+
+// stand-in for juce::NormalisableRange and juce::RangedAudioParameter
+struct LegacyRange {
+    float start = 0.0f, end = 1.0f, skew = 1.0f;
+    std::function<float(float, float, float)> convertFrom0to1Function;
+
+    float convertFrom0to1(float x) const {
+        x = x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x;
+        if (convertFrom0to1Function) return convertFrom0to1Function(start, end, x);
+        if (skew != 1.0f && x > 0.0f) x = std::exp(std::log(x) / skew);
+        return start + (end - start) * x;
+    }
+};
+
+class LegacyParameter {
+public:
+    LegacyParameter(float min, float max, float def) {
+        range_.start = min;
+        range_.end = max;
+        value_ = (def - min) / (max - min);
+    }
+    virtual ~LegacyParameter() {}
+    virtual float getValue() const { return value_.load(std::memory_order_relaxed); }
+    virtual void setValue(float v) { value_.store(v, std::memory_order_relaxed); }
+    virtual float convertFrom0to1(float v) const { return range_.convertFrom0to1(v); }
+
+private:
+    std::atomic<float> value_;
+    LegacyRange range_;
+    std::string name_ = "Gain";
+};
+
+enum { GAIN1, GAIN2, GAIN3, GAIN4, NUM_PARAMS };
+
+static constexpr ParamSpec paramSpecs[NUM_PARAMS] = {
+    {"gain1", "Gain 1", -2.0f, 2.0f, 1.0f, CURVE_LINEAR, 10.0f},
+    {"gain2", "Gain 2", -2.0f, 2.0f, 1.0f, CURVE_LINEAR, 10.0f},
+    {"gain3", "Gain 3", -2.0f, 2.0f, 1.0f, CURVE_LINEAR, 10.0f},
+    {"gain4", "Gain 4", -2.0f, 2.0f, 1.0f, CURVE_LINEAR, 10.0f},
+};
+
+void multiply(float *data, int numSamples, const float *gain) {
+    using namespace Simd;
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4) storeU(data + i, mul(loadU(data + i), loadU(gain + i)));
+    for (; i < numSamples; i++) data[i] *= gain[i];
+}
+
+void multiply(float *data, int numSamples, float gain) {
+    using namespace Simd;
+    const f4 g = set1(gain);
+    int i = 0;
+    for (; i + 4 <= numSamples; i += 4) storeU(data + i, mul(loadU(data + i), g));
+    for (; i < numSamples; i++) data[i] *= gain;
+}
+
+struct Result {
+    double readNs = 0.0;
+    double blockNs = 0.0;
+    float maxStep = 0.0f;
+};
+
+void print(const char *name, const Result &r) {
+    printf("%-20s %12.1f %12.1f %14.4f\n", name, r.readNs, r.blockNs, r.maxStep);
+}
+
+}
+
+int main(int argc, char **argv) {
+    int blockSize = 128;
+    int blocks = 200000;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-b" && i + 1 < argc) blockSize = atoi(argv[++i]);
+        else if (a == "-n" && i + 1 < argc) blocks = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: bench_params [-b blocksize] [-n blocks]\n");
+            return 1;
+        }
+    }
+    if (blockSize <= 0 || blocks <= 0) {
+        fprintf(stderr, "usage: bench_params [-b blocksize] [-n blocks]\n");
+        return 1;
+    }
+
+    std::vector<std::vector<float>> storage(CHANNELS, std::vector<float>(blockSize, 0.5f));
+    std::vector<float> gainBuffer(blockSize);
+
+    // the parameters are allocated between other objects, as they are in a plugin
+    std::vector<std::unique_ptr<LegacyParameter>> legacy;
+    std::vector<std::unique_ptr<char[]>> clutter;
+    for (int k = 0; k < GAINS; k++) {
+        legacy.emplace_back(new LegacyParameter(-2.0f, 2.0f, 1.0f));
+        clutter.emplace_back(new char[256]);
+    }
+    ParamTable<NUM_PARAMS> table(paramSpecs);
+
+    // the "editor": a gain jumps between two values every millisecond
+    std::atomic<bool> quit{false};
+    std::thread editor([&] {
+        for (int n = 0; !quit.load(); n++) {
+            const int k = n % GAINS;
+            const float g = (n / GAINS) % 2 ? 1.5f : -0.5f;
+            legacy[k]->setValue((g + 2.0f) / 4.0f);
+            table.set(k, g);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    // the current path, the gain jumps at the start of a block
+    Result before;
+    {
+        float last[GAINS] = {1.0f, 1.0f, 1.0f, 1.0f};
+        uint64_t readNs = 0;
+        uint64_t t0 = nowNs();
+        for (int b = 0; b < blocks; b++) {
+            uint64_t r0 = nowNs();
+            float g[GAINS];
+            for (int k = 0; k < GAINS; k++) g[k] = legacy[k]->convertFrom0to1(legacy[k]->getValue());
+            readNs += nowNs() - r0;
+            for (int ch = 0; ch < CHANNELS; ch++) multiply(storage[ch].data(), blockSize, g[ch / 2]);
+            for (int k = 0; k < GAINS; k++) {
+                before.maxStep = std::max(before.maxStep, std::fabs(g[k] - last[k]));
+                last[k] = g[k];
+            }
+        }
+        before.blockNs = (double) (nowNs() - t0) / blocks;
+        before.readNs = (double) readNs / blocks;
+    }
+
+    // snapshot and ramps
+    Result after;
+    {
+        ParamTable<NUM_PARAMS>::Snapshot snapshot;
+        ParamRamp ramps[GAINS];
+        for (int k = 0; k < GAINS; k++) {
+            ramps[k].prepare(SAMPLE_RATE, paramSpecs[k].smoothingMs);
+            ramps[k].reset(table.get(k));
+        }
+        float last[GAINS] = {ramps[0].current(), ramps[1].current(), ramps[2].current(), ramps[3].current()};
+        uint64_t readNs = 0;
+        uint64_t t0 = nowNs();
+        for (int b = 0; b < blocks; b++) {
+            uint64_t r0 = nowNs();
+            if (table.update(snapshot)) {
+                for (int k = 0; k < GAINS; k++) ramps[k].setTarget(snapshot.values[k]);
+            }
+            readNs += nowNs() - r0;
+            for (int k = 0; k < GAINS; k++) {
+                if (ramps[k].ramping()) {
+                    ramps[k].fill(gainBuffer.data(), blockSize);
+                    multiply(storage[2 * k].data(), blockSize, gainBuffer.data());
+                    multiply(storage[2 * k + 1].data(), blockSize, gainBuffer.data());
+                    for (int i = 0; i < blockSize; i++) {
+                        after.maxStep = std::max(after.maxStep, std::fabs(gainBuffer[i] - last[k]));
+                        last[k] = gainBuffer[i];
+                    }
+                } else {
+                    ramps[k].apply(storage[2 * k].data(), blockSize);
+                    multiply(storage[2 * k + 1].data(), blockSize, ramps[k].current());
+                    after.maxStep = std::max(after.maxStep, std::fabs(ramps[k].current() - last[k]));
+                    last[k] = ramps[k].current();
+                }
+            }
+        }
+        after.blockNs = (double) (nowNs() - t0) / blocks;
+        after.readNs = (double) readNs / blocks;
+    }
+
+    quit = true;
+    editor.join();
+    for (auto &ch: storage) sink = sink + ch[0];
+
+    printf("%d blocks of %d samples, %d channels, gains changing every ms\n", blocks, blockSize, CHANNELS);
+    printf("%-20s %12s %12s %14s\n", "", "read ns", "block ns", "max gain step");
+    print("getValue+convert", before);
+    print("snapshot+ramp", after);
+    return 0;
+}
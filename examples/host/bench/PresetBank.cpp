@@ -0,0 +1,149 @@
+// see ../Source/PluginHost.h for license
+
+// switching through the patches of a bank: every module of a patch gets its
+// state from a file of its own (read into a heap buffer, the way presets are
+// recalled without a bank) vs from a memory mapped PresetBank (setState() gets
+// a pointer into the mapping). the states are the plugin's own, saved once.
+// also reports how long opening and verifying the bank takes.
+//
+// usage: bench_presetbank [-p patches] [-m modules per patch] [-r rounds] plugin.so
+
+#include "Bench.h"
+#include "PluginHost.h"
+#include "PresetBank.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+std::vector<char> readFile(const std::string &path) {
+    std::vector<char> data;
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return data;
+    fseek(f, 0, SEEK_END);
+    data.resize((size_t) ftell(f));
+    fseek(f, 0, SEEK_SET);
+    if (fread(data.data(), 1, data.size(), f) != data.size()) data.clear();
+    fclose(f);
+    return data;
+}
+
+bool writeFile(const std::string &path, const std::vector<char> &data) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+void report(const char *name, std::vector<uint64_t> &ns, size_t copiedPerPatch) {
+    std::sort(ns.begin(), ns.end());
+    uint64_t sum = 0;
+    for (uint64_t t: ns) sum += t;
+    printf("%-16s %10.1f %10.1f %10.1f %12zu\n", name, ns[ns.size() / 2] / 1000.0,
+           ns[ns.size() * 99 / 100] / 1000.0, sum / 1000.0 / ns.size(), copiedPerPatch);
+}
+
+}
+
+int main(int argc, char **argv) {
+    int patches = 500;
+    int modulesPerPatch = 8;
+    int rounds = 4;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-p" && i + 1 < argc) patches = atoi(argv[++i]);
+        else if (a == "-m" && i + 1 < argc) modulesPerPatch = atoi(argv[++i]);
+        else if (a == "-r" && i + 1 < argc) rounds = atoi(argv[++i]);
+        else path = a;
+    }
+    if (path.empty() || patches <= 0 || modulesPerPatch <= 0 || rounds <= 0) {
+        fprintf(stderr, "usage: bench_presetbank [-p patches] [-m modules per patch] [-r rounds] plugin.so\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_presetbank.XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "cannot create %s\n", dir);
+        return 1;
+    }
+    auto stateFile = [&](int p, int m) {
+        return std::string(dir) + "/" + std::to_string(p) + "_" + std::to_string(m) + ".state";
+    };
+    const std::string bankFile = std::string(dir) + "/bank.sspbank";
+
+    int result = 0;
+    try {
+        PluginLibrary library(path);
+        std::vector<std::unique_ptr<Module>> modules;
+        for (int m = 0; m < modulesPerPatch; m++) {
+            modules.emplace_back(new Module(library, m));
+            modules.back()->prepare(48000.0, 128);
+        }
+
+        // the same states in separate files, and in one bank
+        PresetBankWriter writer;
+        size_t stateBytes = 0;
+        for (int p = 0; p < patches; p++) {
+            std::vector<PresetBankWriter::Module> states;
+            for (int m = 0; m < modulesPerPatch; m++) {
+                std::vector<char> state = modules[m]->getState();
+                stateBytes += state.size();
+                if (!writeFile(stateFile(p, m), state)) throw std::runtime_error("cannot write state files");
+                states.push_back(PresetBankWriter::Module{modules[m]->descriptor().uid, std::move(state)});
+            }
+            writer.addPatch("PATCH " + std::to_string(p), std::move(states));
+        }
+        writer.write(bankFile);
+
+        std::vector<uint64_t> files, mapped;
+        for (int r = 0; r < rounds; r++) {
+            for (int p = 0; p < patches; p++) {
+                uint64_t t0 = nowNs();
+                for (int m = 0; m < modulesPerPatch; m++) modules[m]->setState(readFile(stateFile(p, m)));
+                files.push_back(nowNs() - t0);
+            }
+        }
+
+        uint64_t t0 = nowNs();
+        PresetBank bank(bankFile);
+        uint64_t t1 = nowNs();
+        bool valid = bank.verify();
+        uint64_t t2 = nowNs();
+        for (int r = 0; r < rounds; r++) {
+            for (int p = 0; p < bank.numPatches(); p++) {
+                uint64_t t = nowNs();
+                for (int m = 0; m < bank.numModules(p); m++) {
+                    PresetBank::State state = bank.state(p, m);
+                    modules[m]->setState(state.data, state.size);
+                }
+                mapped.push_back(nowNs() - t);
+            }
+        }
+
+        printf("%d patches of %d modules (%s), %.1f kB of state, bank %.1f kB\n", patches, modulesPerPatch,
+               modules[0]->descriptor().name.c_str(), stateBytes / 1024.0, bank.fileSize() / 1024.0);
+        printf("bank open %.1f us, verify %.1f us (%s)\n", (t1 - t0) / 1000.0, (t2 - t1) / 1000.0,
+               valid ? "ok" : "DAMAGED");
+        printf("%-16s %10s %10s %10s %12s\n", "patch switch", "median us", "p99 us", "avg us", "copied B");
+        report("state files", files, stateBytes / patches);
+        report("preset bank", mapped, 0);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        result = 1;
+    }
+
+    for (int p = 0; p < patches; p++) {
+        for (int m = 0; m < modulesPerPatch; m++) unlink(stateFile(p, m).c_str());
+    }
+    unlink(bankFile.c_str());
+    rmdir(dir);
+    return result;
+}
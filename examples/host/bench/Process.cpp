@@ -0,0 +1,93 @@
+// see ../Source/PluginHost.h for license
+
+// cost of a process() call with small blocks, where the work done around the
+// plugin's dsp (the JUCE adapter, stats, staged state ...) dominates. also
+// counts heap allocations made during process(), which should be zero.
+//
+// usage: bench_process [-n calls] plugin.so [plugin.so ...]
+
+#include "Bench.h"
+#include "PluginHost.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// malloc, calloc and realloc of the whole process (including the plugins, this
+// executable exports its symbols) go through here, and are counted while
+// countAllocations is set on the calling thread.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+namespace {
+thread_local bool countAllocations = false;
+std::atomic<uint64_t> allocations{0};
+}
+
+extern "C" void *malloc(size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_realloc(p, size);
+}
+
+int main(int argc, char **argv) {
+    int calls = 100000;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-n" && i + 1 < argc) calls = atoi(argv[++i]);
+        else paths.push_back(a);
+    }
+    if (paths.empty() || calls <= 0) {
+        fprintf(stderr, "usage: bench_process [-n calls] plugin.so [plugin.so ...]\n");
+        return 1;
+    }
+
+    static constexpr int MAX_BLOCK = 128;
+    static constexpr int blockSizes[] = {1, 8, 32, 128};
+
+    printf("%-32s %8s %12s %12s %14s\n", "plugin", "block", "ns / call", "ns / sample", "allocs / call");
+    try {
+        for (const std::string &path: paths) {
+            PluginLibrary library(path);
+            Module module(library, 0);
+            for (int i = 0; i < module.numInputs(); i++) module.plugin().inputEnabled(i, true);
+            for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+            module.prepare(48000.0, MAX_BLOCK);
+
+            std::vector<float *> channels;
+            for (int ch = 0; ch < module.numChannels(); ch++) channels.push_back(module.channel(ch));
+            auto &plugin = module.plugin();
+
+            for (int blockSize: blockSizes) {
+                for (int i = 0; i < calls / 10; i++) plugin.process(channels.data(), (int) channels.size(), blockSize);
+
+                allocations = 0;
+                countAllocations = true;
+                uint64_t t0 = nowNs();
+                for (int i = 0; i < calls; i++) plugin.process(channels.data(), (int) channels.size(), blockSize);
+                uint64_t t = nowNs() - t0;
+                countAllocations = false;
+
+                printf("%-32s %8d %12.1f %12.2f %14.3f\n", module.descriptor().name.c_str(), blockSize,
+                       (double) t / calls, (double) t / calls / blockSize, (double) allocations.load() / calls);
+            }
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+// see ../Source/PluginHost.h for license
+
+// switches the block size on every block, with reconfigure() between the
+// blocks (API 3.11), and checks that the output matches the same signal
+// processed in fixed size blocks. also compares the cost and heap allocations
+// of a switch with reconfigure() vs a new prepare(). a built-in filter plugin
+// is always run, plugins given on the command line are run as well. fails if
+// the output differs, or if the blocks with a switch allocate (ctest runs it).
+//
+// usage: bench_reconfigure [-s seconds] [plugin.so ...]
+
+#include "Bench.h"
+#include "PluginHost.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// malloc, calloc and realloc of the whole process (including the plugins, this
+// executable exports its symbols) go through here, and are counted while
+// countAllocations is set on the calling thread.
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+namespace {
+thread_local bool countAllocations = false;
+std::atomic<uint64_t> allocations{0};
+}
+
+extern "C" void *malloc(size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size) {
+    if (countAllocations) allocations++;
+    return __libc_realloc(p, size);
+}
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int MAX_BLOCK = 128;
+
+// two channel one pole lowpass at 1kHz, keeping a copy of the last block
+// (e.g. for a scope) in a buffer sized in prepare()
+class FilterPlugin : public Percussa::SSP::PluginInterface {
+public:
+    static constexpr int CHANNELS = 2;
+
+    Percussa::SSP::PluginEditorInterface *getEditor() override { return nullptr; }
+
+    void prepare(double sampleRate, int samplesPerBlock) override {
+        lastBlock_.assign(CHANNELS * samplesPerBlock, 0.0f);
+        maxBlockSize_ = samplesPerBlock;
+        setSampleRate(sampleRate);
+    }
+
+    bool reconfigure(double sampleRate, int samplesPerBlock) override {
+        if (samplesPerBlock > maxBlockSize_) return false;
+        setSampleRate(sampleRate);
+        return true;
+    }
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        numChannels = std::min(numChannels, (int) CHANNELS);
+        for (int ch = 0; ch < numChannels; ch++) {
+            float *data = channelData[ch];
+            float z = z_[ch];
+            for (int i = 0; i < numSamples; i++) {
+                z += a_ * (data[i] - z);
+                data[i] = z;
+            }
+            z_[ch] = z;
+            std::copy(data, data + numSamples, &lastBlock_[ch * maxBlockSize_]);
+        }
+    }
+
+private:
+    void setSampleRate(double sampleRate) {
+        a_ = (float) (1.0 - exp(-2.0 * M_PI * 1000.0 / sampleRate));
+    }
+
+    std::vector<float> lastBlock_;
+    int maxBlockSize_ = 0;
+    float a_ = 0.0f;
+    float z_[CHANNELS]{};
+};
+
+Module *builtIn(int id) {
+    auto *desc = new Percussa::SSP::PluginDescriptor;
+    desc->name = "filter (built-in)";
+    desc->inputChannelNames = {"in1", "in2"};
+    desc->outputChannelNames = {"out1", "out2"};
+    return new Module(desc, new FilterPlugin, id);
+}
+
+struct Run {
+    // the output channels, one after the other
+    std::vector<float> output;
+    uint64_t ns = 0;
+    uint64_t allocations = 0;
+    uint64_t switches = 0;
+    uint64_t refused = 0;
+};
+
+// runs the module over numSamples samples, in blocks of the given sizes in turn
+Run run(Module &module, const std::vector<int> &sizes, int numSamples) {
+    Run r;
+    r.output.resize((size_t) module.numOutputs() * numSamples);
+    int current = MAX_BLOCK;
+    int position = 0;
+    for (size_t b = 0; position < numSamples; b++) {
+        int n = std::min(sizes[b % sizes.size()], numSamples - position);
+        for (int ch = 0; ch < module.numInputs(); ch++) {
+            float *data = module.channel(ch);
+            for (int i = 0; i < n; i++) data[i] = (float) sin(0.01 * (ch + 1) * (position + i));
+        }
+
+        allocations = 0;
+        countAllocations = true;
+        uint64_t t0 = nowNs();
+        if (n != current) {
+            if (!module.reconfigure(SAMPLE_RATE, n)) r.refused++;
+            r.switches++;
+            current = n;
+        }
+        module.process(n);
+        r.ns += nowNs() - t0;
+        countAllocations = false;
+        r.allocations += allocations.load();
+
+        for (int ch = 0; ch < module.numOutputs(); ch++) {
+            std::copy(module.channel(ch), module.channel(ch) + n, &r.output[(size_t) ch * numSamples + position]);
+        }
+        position += n;
+    }
+    return r;
+}
+
+void prepareModule(Module &module) {
+    for (int i = 0; i < module.numInputs(); i++) module.plugin().inputEnabled(i, true);
+    for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+    module.prepare(SAMPLE_RATE, MAX_BLOCK);
+}
+
+// average time and allocations of a switch with prepare(), as a host
+// without reconfigure() has to do it (on the UI thread, with audio stopped)
+void measurePrepare(Module &module, double &ns, double &allocs) {
+    const int switches = 200;
+    allocations = 0;
+    countAllocations = true;
+    uint64_t t0 = nowNs();
+    for (int i = 0; i < switches; i++) module.prepare(SAMPLE_RATE, i % 2 ? MAX_BLOCK : MAX_BLOCK / 4);
+    ns = (double) (nowNs() - t0) / switches;
+    countAllocations = false;
+    allocs = (double) allocations.load() / switches;
+}
+
+// average time and allocations of a reconfigure() switch
+void measureReconfigure(Module &module, double &ns, double &allocs) {
+    const int switches = 10000;
+    allocations = 0;
+    countAllocations = true;
+    uint64_t t0 = nowNs();
+    for (int i = 0; i < switches; i++) module.reconfigure(SAMPLE_RATE, i % 2 ? MAX_BLOCK : MAX_BLOCK / 4);
+    ns = (double) (nowNs() - t0) / switches;
+    countAllocations = false;
+    allocs = (double) allocations.load() / switches;
+}
+
+// false if the output differs from the fixed size blocks, or the blocks allocated
+bool report(Module *fixed, Module *toggled, Module *switched, int numSamples) {
+    // a different size on every block, including odd ones
+    std::mt19937 rng(1);
+    std::vector<int> sizes;
+    for (int i = 0; i < 997; i++) sizes.push_back(i % 2 ? MAX_BLOCK : 1 + (int) (rng() % MAX_BLOCK));
+
+    for (Module *m: {fixed, toggled, switched}) prepareModule(*m);
+    Run reference = run(*fixed, {MAX_BLOCK}, numSamples);
+    Run r = run(*toggled, sizes, numSamples);
+
+    float diff = 0.0f;
+    for (size_t i = 0; i < r.output.size(); i++) diff = std::max(diff, std::fabs(r.output[i] - reference.output[i]));
+
+    double prepareNs, prepareAllocs, reconfigureNs, reconfigureAllocs;
+    measurePrepare(*switched, prepareNs, prepareAllocs);
+    measureReconfigure(*switched, reconfigureNs, reconfigureAllocs);
+
+    printf("%s\n", fixed->descriptor().name.c_str());
+    printf("  %-28s %12.2f ns / sample\n", "fixed blocks", (double) reference.ns / numSamples);
+    printf("  %-28s %12.2f ns / sample, %llu allocations, %llu of %llu switches refused\n", "block size toggled",
+           (double) r.ns / numSamples, (unsigned long long) r.allocations, (unsigned long long) r.refused,
+           (unsigned long long) r.switches);
+    printf("  %-28s %12g\n", "max difference in output", diff);
+    printf("  %-28s %12.0f ns, %.1f allocations\n", "switch with prepare()", prepareNs, prepareAllocs);
+    printf("  %-28s %12.0f ns, %.1f allocations\n", "switch with reconfigure()", reconfigureNs, reconfigureAllocs);
+    if (diff != 0.0f) printf("  FAILED: the output differs from the one of fixed size blocks\n");
+    if (r.allocations) printf("  FAILED: blocks switching sizes allocated\n");
+    return diff == 0.0f && r.allocations == 0;
+}
+
+}
+
+int main(int argc, char **argv) {
+    double seconds = 10.0;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-s" && i + 1 < argc) seconds = atof(argv[++i]);
+        else paths.push_back(a);
+    }
+    if (seconds <= 0.0) {
+        fprintf(stderr, "usage: bench_reconfigure [-s seconds] [plugin.so ...]\n");
+        return 1;
+    }
+    const int numSamples = (int) (seconds * SAMPLE_RATE);
+
+    std::unique_ptr<Module> fixed(builtIn(0)), toggled(builtIn(1)), switched(builtIn(2));
+    bool ok = report(fixed.get(), toggled.get(), switched.get(), numSamples);
+
+    try {
+        for (const std::string &path: paths) {
+            PluginLibrary library(path);
+            Module a(library, 0), b(library, 1), c(library, 2);
+            ok = report(&a, &b, &c, numSamples) && ok;
+        }
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
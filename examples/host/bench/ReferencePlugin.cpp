@@ -0,0 +1,220 @@
+// see ../Source/PluginHost.h for license
+
+// a module with the kind of dsp SSP modules are made of, for the benchmarks
+// taking a plugin.so, and to try profile guided builds (see pgo.sh) without
+// JUCE: per channel an oscillator with a choice of waveforms, a state variable
+// filter with a choice of modes, a waveshaper and an envelope follower. the
+// encoders select the waveform, filter mode, cutoff and drive, the buttons
+// turn channels on and off, the editor draws the envelopes as bars, and the
+// state is saved as text.
+
+#include <PercussaBundle.h>
+#include <PercussaStats.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace {
+
+constexpr int CHANNELS = 8;
+constexpr float PI = 3.14159265f;
+
+enum Wave { SINE, SAW, SQUARE, TRIANGLE, NUM_WAVES };
+enum Mode { LOWPASS, BANDPASS, HIGHPASS, NOTCH, NUM_MODES };
+
+// band limited step, smooths the discontinuities of saw and square
+float polyBlep(float t, float dt) {
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0f;
+    }
+    if (t > 1.0f - dt) {
+        t = (t - 1.0f) / dt;
+        return t * t + t + t + 1.0f;
+    }
+    return 0.0f;
+}
+
+struct Voice {
+    bool on = true;
+    int wave = SINE;
+    int mode = LOWPASS;
+    float cutoff = 0.5f;        // 0 ... 1, 20 Hz ... 20 kHz
+    float drive = 1.0f;
+    float phase = 0.0f;
+    float low = 0.0f, band = 0.0f;
+    float envelope = 0.0f;
+};
+
+// a bar per channel, its height the envelope, published by process()
+class ReferenceEditor : public Percussa::SSP::PluginEditorInterface {
+public:
+    std::atomic<float> levels[CHANNELS];
+
+    ReferenceEditor() {
+        for (auto &level: levels) level.store(0.0f, std::memory_order_relaxed);
+    }
+
+    void renderToImage(unsigned char *buffer, int width, int height) override {
+        const int barWidth = width / CHANNELS;
+        for (int y = 0; y < height; y++) {
+            unsigned char *row = buffer + (size_t) y * width * 4;
+            for (int ch = 0; ch < CHANNELS; ch++) {
+                const float level = levels[ch].load(std::memory_order_relaxed);
+                const bool lit = (float) (height - y) < level * (float) height;
+                const unsigned char value = lit ? (unsigned char) (64 + 24 * ch) : 0;
+                for (int x = ch * barWidth; x < (ch + 1) * barWidth - 2; x++) {
+                    row[x * 4 + 0] = value;
+                    row[x * 4 + 1] = lit ? 200 : 0;
+                    row[x * 4 + 2] = value;
+                    row[x * 4 + 3] = 255;
+                }
+            }
+        }
+    }
+};
+
+class ReferencePlugin : public Percussa::SSP::PluginInterface {
+public:
+    Percussa::SSP::PluginEditorInterface *getEditor() override { return &editor_; }
+
+    void prepare(double sampleRate, int samplesPerBlock) override {
+        sampleRate_ = (float) sampleRate;
+        stats_.prepare(sampleRate, samplesPerBlock);
+        attack_ = 1.0f - std::exp(-1.0f / (0.001f * sampleRate_));
+        release_ = 1.0f - std::exp(-1.0f / (0.1f * sampleRate_));
+    }
+
+    Percussa::SSP::PluginStats *getStats() override { return stats_.stats(); }
+
+    void encoderTurned(int n, int val) override {
+        for (Voice &v: voices_) {
+            switch (n) {
+                case 0: v.wave = ((v.wave + val) % NUM_WAVES + NUM_WAVES) % NUM_WAVES; break;
+                case 1: v.mode = ((v.mode + val) % NUM_MODES + NUM_MODES) % NUM_MODES; break;
+                case 2: v.cutoff = std::fmin(std::fmax(v.cutoff + 0.01f * val, 0.0f), 1.0f); break;
+                case 3: v.drive = std::fmin(std::fmax(v.drive + 0.1f * val, 0.1f), 10.0f); break;
+                default: break;
+            }
+        }
+    }
+
+    void buttonPressed(int n, bool val) override {
+        if (val && n < CHANNELS) voices_[n].on = !voices_[n].on;
+    }
+
+    void getState(void **buffer, size_t *size) override {
+        std::string state;
+        char line[128];
+        for (const Voice &v: voices_) {
+            snprintf(line, sizeof(line), "%d %d %d %.9g %.9g\n", v.on, v.wave, v.mode, v.cutoff, v.drive);
+            state += line;
+        }
+        char *data = new char[state.size()];
+        memcpy(data, state.data(), state.size());
+        *buffer = data;
+        *size = state.size();
+    }
+
+    void setState(void *buffer, size_t size) override {
+        std::string state((const char *) buffer, size);
+        const char *p = state.c_str();
+        for (Voice &v: voices_) {
+            int on, wave, mode, n = 0;
+            float cutoff, drive;
+            if (sscanf(p, "%d %d %d %g %g%n", &on, &wave, &mode, &cutoff, &drive, &n) != 5) break;
+            p += n;
+            v.on = on != 0;
+            v.wave = wave % NUM_WAVES;
+            v.mode = mode % NUM_MODES;
+            v.cutoff = cutoff;
+            v.drive = drive;
+        }
+    }
+
+    // channel ch is the input of voice ch (its pitch, 1 V/oct around 110 Hz)
+    // and its output
+    void process(float **channelData, int numChannels, int numSamples) override {
+        Percussa::SSP::StatsRecorder::Scope scope(stats_, numSamples);
+        SSP_PROFILE_ZONE("voices");
+        for (int ch = 0; ch < numChannels && ch < CHANNELS; ch++) {
+            Voice &v = voices_[ch];
+            float *data = channelData[ch];
+            if (!v.on) {
+                memset(data, 0, numSamples * sizeof(float));
+                continue;
+            }
+            const float hz = 20.0f * std::pow(1000.0f, v.cutoff);
+            const float f = 2.0f * std::sin(PI * std::fmin(hz, 0.2f * sampleRate_) / sampleRate_);
+            const float q = 0.5f;
+            for (int i = 0; i < numSamples; i++) {
+                const float dt = std::fmin(110.0f * std::exp2(data[i]) / sampleRate_, 0.5f);
+                float x;
+                switch (v.wave) {
+                    case SINE: x = std::sin(2.0f * PI * v.phase); break;
+                    case SAW: x = 2.0f * v.phase - 1.0f - polyBlep(v.phase, dt); break;
+                    case SQUARE: {
+                        float t = v.phase + 0.5f;
+                        if (t >= 1.0f) t -= 1.0f;
+                        x = (v.phase < 0.5f ? 1.0f : -1.0f) + polyBlep(v.phase, dt) - polyBlep(t, dt);
+                        break;
+                    }
+                    default: x = 1.0f - 4.0f * std::fabs(v.phase - 0.5f); break;
+                }
+                v.phase += dt;
+                if (v.phase >= 1.0f) v.phase -= 1.0f;
+
+                const float high = x - v.low - q * v.band;
+                v.band += f * high;
+                v.low += f * v.band;
+                float y;
+                switch (v.mode) {
+                    case LOWPASS: y = v.low; break;
+                    case BANDPASS: y = v.band; break;
+                    case HIGHPASS: y = high; break;
+                    default: y = high + v.low; break;
+                }
+
+                y = std::tanh(v.drive * y);
+                const float level = std::fabs(y);
+                v.envelope += (level > v.envelope ? attack_ : release_) * (level - v.envelope);
+                data[i] = v.envelope > 1e-4f ? y : 0.0f;
+            }
+            editor_.levels[ch].store(v.envelope, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    Voice voices_[CHANNELS];
+    ReferenceEditor editor_;
+    float sampleRate_ = 48000.0f;
+    float attack_ = 0.0f, release_ = 0.0f;
+    Percussa::SSP::StatsRecorder stats_;
+};
+
+Percussa::SSP::PluginDescriptor *createReferenceDescriptor() {
+    auto desc = new Percussa::SSP::PluginDescriptor;
+    desc->name = "REFERENCE";
+    desc->descriptiveName = "reference dsp for benchmarks";
+    desc->manufacturerName = "percussa";
+    desc->version = "1.0.0";
+    desc->uid = 0x52454631;
+    for (int ch = 0; ch < CHANNELS; ch++) {
+        desc->inputChannelNames.push_back("Pitch " + std::to_string(ch + 1));
+        desc->outputChannelNames.push_back("Out " + std::to_string(ch + 1));
+    }
+    return desc;
+}
+
+Percussa::SSP::PluginInterface *createReferenceInstance() {
+    return new ReferencePlugin();
+}
+
+}
+
+SSP_PLUGIN_EXPORT(createReferenceDescriptor, createReferenceInstance)
+
+SSP_PROFILE_EXPORT()
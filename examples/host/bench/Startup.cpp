@@ -0,0 +1,164 @@
+// see ../Source/PluginHost.h for license
+
+// host startup with every plugin in its own shared object vs the same plugins
+// in one bundle (see PercussaBundle.h): time to load the shared objects and
+// create a descriptor and an instance of every plugin, and the memory this
+// adds to the process. private dirty memory is what cannot be shared with
+// other processes mapping the same files, mostly pages the dynamic linker
+// wrote relocations into. every measurement runs in a fresh child process.
+// without plugins, the startup plugins built next to this benchmark are used
+// (configure with -DSSP_STARTUP_PLUGINS=ON to build them).
+//
+// usage: bench_startup [-r runs] [-b bundle.so plugin.so ...]
+
+#include "Bench.h"
+#include "PluginHost.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct Memory {
+    size_t rss = 0;
+    size_t pss = 0;
+    size_t privateDirty = 0;
+};
+
+// totals of all mappings of the process, in bytes
+Memory memory() {
+    Memory m;
+    FILE *f = fopen("/proc/self/smaps_rollup", "r");
+    if (!f) return m;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long kb = 0;
+        if (sscanf(line, "Rss: %lu kB", &kb) == 1) m.rss = kb * 1024;
+        else if (sscanf(line, "Pss: %lu kB", &kb) == 1) m.pss = kb * 1024;
+        else if (sscanf(line, "Private_Dirty: %lu kB", &kb) == 1) m.privateDirty = kb * 1024;
+    }
+    fclose(f);
+    return m;
+}
+
+struct Result {
+    int plugins = 0;
+    uint64_t loadNs = 0;
+    uint64_t createNs = 0;
+    Memory memory;
+};
+
+// loads the shared objects, and creates every plugin once
+Result measure(const std::vector<std::string> &paths) {
+    Result r;
+    Memory before = memory();
+    std::vector<std::unique_ptr<PluginLibrary>> libraries;
+
+    uint64_t t0 = nowNs();
+    for (const std::string &path: paths) libraries.emplace_back(new PluginLibrary(path));
+    uint64_t t1 = nowNs();
+    for (auto &library: libraries) {
+        for (int i = 0; i < library->pluginCount(); i++) {
+            Module module(*library, r.plugins++, i);
+        }
+    }
+    uint64_t t2 = nowNs();
+
+    Memory after = memory();
+    r.loadNs = t1 - t0;
+    r.createNs = t2 - t1;
+    r.memory.rss = after.rss - before.rss;
+    r.memory.pss = after.pss - before.pss;
+    r.memory.privateDirty = after.privateDirty - before.privateDirty;
+    return r;
+}
+
+// measure() in a child process, so no shared object is loaded yet
+bool measureInChild(const std::vector<std::string> &paths, Result &result) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Result r;
+        try {
+            r = measure(paths);
+        } catch (const std::exception &e) {
+            fprintf(stderr, "%s\n", e.what());
+            _exit(1);
+        }
+        bool ok = write(fds[1], &r, sizeof(r)) == (ssize_t) sizeof(r);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    bool ok = read(fds[0], &result, sizeof(result)) == (ssize_t) sizeof(result);
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// median of the runs (by total time)
+bool run(const char *name, const std::vector<std::string> &paths, int runs) {
+    std::vector<Result> results(runs);
+    for (Result &r: results) {
+        if (!measureInChild(paths, r)) return false;
+    }
+    std::sort(results.begin(), results.end(), [](const Result &a, const Result &b) {
+        return a.loadNs + a.createNs < b.loadNs + b.createNs;
+    });
+    const Result &r = results[runs / 2];
+    printf("%-20s %8d %8zu %10.2f %10.2f %10zu %10zu %12zu\n", name, r.plugins, paths.size(),
+           r.loadNs / 1e6, r.createNs / 1e6, r.memory.rss / 1024, r.memory.pss / 1024,
+           r.memory.privateDirty / 1024);
+    return true;
+}
+
+std::string executableDir() {
+    char path[4096];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) return ".";
+    path[n] = '\0';
+    char *slash = strrchr(path, '/');
+    if (slash) *slash = '\0';
+    return path;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int runs = 11;
+    std::string bundle;
+    std::vector<std::string> plugins;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-r" && i + 1 < argc) runs = atoi(argv[++i]);
+        else if (a == "-b" && i + 1 < argc) bundle = argv[++i];
+        else plugins.push_back(a);
+    }
+    if (runs <= 0 || bundle.empty() != plugins.empty()) {
+        fprintf(stderr, "usage: bench_startup [-r runs] [-b bundle.so plugin.so ...]\n");
+        return 1;
+    }
+    if (bundle.empty()) {
+        std::string dir = executableDir();
+        bundle = dir + "/libstartup_bundle.so";
+        for (int i = 0; i < 8; i++) plugins.push_back(dir + "/libstartup" + std::to_string(i) + ".so");
+    }
+
+    printf("%-20s %8s %8s %10s %10s %10s %10s %12s\n", "", "plugins", "files", "load ms", "create ms",
+           "rss kB", "pss kB", "private kB");
+    if (!run("separate", plugins, runs) || !run("bundle", {bundle}, runs)) {
+        fprintf(stderr, "measurement failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+// see ../Source/PluginHost.h for license
+
+// plugin for bench_startup, built once for every PLUGIN_INDEX. the framework
+// namespace stands in for a statically linked library such as JUCE: many
+// classes with vtables, which the dynamic linker has to relocate when the
+// plugin is loaded. built on its own, every plugin has a copy of it, in a
+// bundle the plugins share one.
+
+#include <PercussaBundle.h>
+
+#include <string>
+
+namespace framework {
+
+static constexpr int DEPTH = 400;
+
+template<int Tag, int N>
+struct Component : Component<Tag, N - 1> {
+    int id() const override { return N; }
+    int width() const override { return N * 2 + Tag; }
+    int height() const override { return N * 3 + Tag; }
+    void paint(float *pixels) const override { pixels[N % 16] += (float) this->width(); }
+    void resized() override { Component<Tag, N - 1>::resized(); }
+    bool hitTest(int x, int y) const override { return x < this->width() && y < this->height(); }
+};
+
+template<int Tag>
+struct Component<Tag, 0> {
+    virtual ~Component() {}
+    virtual int id() const { return 0; }
+    virtual int width() const { return 0; }
+    virtual int height() const { return 0; }
+    virtual void paint(float *) const {}
+    virtual void resized() {}
+    virtual bool hitTest(int, int) const { return false; }
+};
+
+// instantiates all classes of the framework
+struct Application {
+    Component<0, DEPTH> a;
+    Component<1, DEPTH> b;
+    Component<2, DEPTH> c;
+    Component<3, DEPTH> d;
+};
+
+}
+
+namespace {
+
+class StartupPlugin : public Percussa::SSP::PluginInterface {
+public:
+    Percussa::SSP::PluginEditorInterface *getEditor() override { return nullptr; }
+
+    void prepare(double sampleRate, int samplesPerBlock) override {}
+
+    void process(float **channelData, int numChannels, int numSamples) override {}
+
+private:
+    framework::Application app_;
+};
+
+Percussa::SSP::PluginDescriptor *createStartupDescriptor() {
+    auto desc = new Percussa::SSP::PluginDescriptor;
+    desc->name = "STARTUP" + std::to_string(PLUGIN_INDEX);
+    desc->uid = 0x53540000 + PLUGIN_INDEX;
+    desc->inputChannelNames = {"In 1", "In 2"};
+    desc->outputChannelNames = {"Out 1", "Out 2"};
+    return desc;
+}
+
+Percussa::SSP::PluginInterface *createStartupInstance() {
+    return new StartupPlugin();
+}
+
+}
+
+SSP_PLUGIN_EXPORT(createStartupDescriptor, createStartupInstance)
@@ -0,0 +1,108 @@
+// see ../Source/PluginHost.h for license
+
+// measures how long the UI thread stalls when a patch is recalled,
+// comparing setState() on the UI thread with staged loads (prepareState()
+// on a background thread, applied by the plugin on the audio thread).
+//
+// usage: bench_staterecall [-n instances] [-r rounds] plugin.so
+
+#include "Bench.h"
+#include "AudioThread.h"
+#include "PluginHost.h"
+#include "StateLoader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// worst process() time of all modules since the last call
+double worstProcessUs(std::vector<Module *> &modules) {
+    uint32_t worst = 0;
+    for (Module *m: modules) {
+        auto *stats = m->stats();
+        if (!stats) continue;
+        worst = std::max(worst, stats->nsPerBlockMax.exchange(0));
+    }
+    return worst / 1000.0;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int instances = 32;
+    int rounds = 20;
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "-n" && i + 1 < argc) instances = atoi(argv[++i]);
+        else if (a == "-r" && i + 1 < argc) rounds = atoi(argv[++i]);
+        else path = a;
+    }
+    if (path.empty() || instances <= 0 || rounds <= 0) {
+        fprintf(stderr, "usage: bench_staterecall [-n instances] [-r rounds] plugin.so\n");
+        return 1;
+    }
+
+    try {
+        PluginLibrary library(path);
+        std::vector<std::unique_ptr<Module>> owned;
+        std::vector<Module *> modules;
+        for (int i = 0; i < instances; i++) {
+            owned.emplace_back(new Module(library, i));
+            modules.push_back(owned.back().get());
+            modules.back()->prepare(48000.0, 128);
+        }
+
+        std::vector<std::vector<char>> states;
+        for (Module *m: modules) states.push_back(m->getState());
+
+        AudioThread audio(48000.0, 128, modules);
+        audio.start();
+        StateLoader loader;
+
+        double syncTotal = 0.0, syncMax = 0.0, syncProcess = 0.0;
+        double stagedTotal = 0.0, stagedMax = 0.0, stagedDone = 0.0, stagedProcess = 0.0;
+        worstProcessUs(modules);
+
+        for (int r = 0; r < rounds; r++) {
+            // recall on the UI thread
+            uint64_t t0 = nowNs();
+            for (int i = 0; i < instances; i++) modules[i]->setState(states[i]);
+            double t = (nowNs() - t0) / 1e6;
+            syncTotal += t;
+            syncMax = std::max(syncMax, t);
+            struct timespec pause = {0, 20000000};
+            nanosleep(&pause, nullptr);
+            syncProcess = std::max(syncProcess, worstProcessUs(modules));
+
+            // staged recall, the UI thread only queues the states
+            t0 = nowNs();
+            for (int i = 0; i < instances; i++) loader.load(*modules[i], states[i]);
+            t = (nowNs() - t0) / 1e6;
+            stagedTotal += t;
+            stagedMax = std::max(stagedMax, t);
+            loader.wait();
+            stagedDone += (nowNs() - t0) / 1e6;
+            nanosleep(&pause, nullptr);
+            stagedProcess = std::max(stagedProcess, worstProcessUs(modules));
+        }
+
+        audio.stop();
+
+        printf("%d instances of %s, %d recalls\n", instances, path.c_str(), rounds);
+        printf("%-28s %12s %12s %14s %16s\n", "", "ui avg ms", "ui max ms", "complete ms", "max process us");
+        printf("%-28s %12.3f %12.3f %14.3f %16.1f\n", "setState (ui thread)",
+               syncTotal / rounds, syncMax, syncTotal / rounds, syncProcess);
+        printf("%-28s %12.3f %12.3f %14.3f %16.1f\n", "staged (prepareState)",
+               stagedTotal / rounds, stagedMax, stagedDone / rounds, stagedProcess);
+        if (!library.hasApi(3, 7)) printf("note: plugin does not support staged loads (API 3.7), setState() was used\n");
+        printf("xruns: %llu\n", (unsigned long long) audio.xruns());
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
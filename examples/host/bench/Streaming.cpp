@@ -0,0 +1,325 @@
+// see ../Source/PluginHost.h for license
+
+// many sampler voices streamed from a simulated slow SD card, where every
+// read costs a fixed access time plus its size at the card's throughput. a
+// sampler plugin retriggers its voices at random times, mostly at the start
+// of one of a set of wav files, sometimes in the middle (as a slicer would).
+// the voices read in three ways: with pread() in process() ("direct", what a
+// plugin has to do without a streaming service), through the host's Streamer
+// (HostServices version 4), and through the Streamer with the first 500 ms of
+// every file prefetched.
+//
+// reports the xruns of the audio thread, the voice reads which came short
+// because the card was too slow (underruns), the data read and how busy the
+// card was.
+//
+// usage: bench_streaming [-v voices] [-t seconds] [-b blocksize] [-a access ms] [-m MB/s]
+
+#include "Bench.h"
+#include "AudioThread.h"
+#include "PluginHost.h"
+#include "Streamer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int NUM_FILES = 8;
+static constexpr int FILE_SECONDS = 20;
+static constexpr int CHANNELS = 2;
+static constexpr int WAV_HEADER = 44;
+static constexpr int RING_FRAMES = 32768;
+static constexpr int PREFETCH_MS = 500;
+
+// reads take accessMs plus their size at mbPerSecond, one at a time
+class SlowCard {
+public:
+    SlowCard(double accessMs, double mbPerSecond) : accessMs_(accessMs), mbPerSecond_(mbPerSecond) {}
+
+    ssize_t read(int fd, void *buffer, size_t bytes, off_t offset) {
+        const uint64_t ns = (uint64_t) (accessMs_ * 1e6 + (double) bytes / mbPerSecond_ * 1e3);
+        struct timespec ts = {(time_t) (ns / 1000000000ull), (long) (ns % 1000000000ull)};
+        nanosleep(&ts, nullptr);
+        busyNs_.fetch_add(ns, std::memory_order_relaxed);
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        return pread(fd, buffer, bytes, offset);
+    }
+
+    uint64_t busyNs() const { return busyNs_.load(); }
+    uint64_t bytes() const { return bytes_.load(); }
+
+private:
+    const double accessMs_;
+    const double mbPerSecond_;
+    std::atomic<uint64_t> busyNs_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+class SlowStreamer : public Streamer {
+public:
+    explicit SlowStreamer(SlowCard &card) : card_(card) {}
+
+protected:
+    ssize_t readFile(int fd, void *buffer, size_t bytes, off_t offset) override {
+        return card_.read(fd, buffer, bytes, offset);
+    }
+
+private:
+    SlowCard &card_;
+};
+
+bool writeWav(const std::string &path, int seed) {
+    const uint32_t frames = (uint32_t) (SAMPLE_RATE * FILE_SECONDS);
+    const uint32_t bytes = frames * CHANNELS * 2;
+    unsigned char header[WAV_HEADER];
+    auto put16 = [&](int at, uint32_t v) { header[at] = v & 0xff; header[at + 1] = (v >> 8) & 0xff; };
+    auto put32 = [&](int at, uint32_t v) { put16(at, v & 0xffff); put16(at + 2, v >> 16); };
+    memcpy(header, "RIFF", 4);
+    put32(4, 36 + bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(16, 16);
+    put16(20, 1);
+    put16(22, CHANNELS);
+    put32(24, (uint32_t) SAMPLE_RATE);
+    put32(28, (uint32_t) SAMPLE_RATE * CHANNELS * 2);
+    put16(32, CHANNELS * 2);
+    put16(34, 16);
+    memcpy(header + 36, "data", 4);
+    put32(40, bytes);
+
+    std::vector<int16_t> samples((size_t) frames * CHANNELS);
+    std::mt19937 random(seed);
+    for (int16_t &s: samples) s = (int16_t) (random() % 20000 - 10000);
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1 &&
+              fwrite(samples.data(), sizeof(int16_t), samples.size(), f) == samples.size();
+    return fclose(f) == 0 && ok;
+}
+
+enum Mode { DIRECT, STREAMED, PREFETCHED };
+
+// voices retriggered every 0.5 ... 2 seconds, at the start of a file, or one
+// time in four somewhere in it, mixed into outputs 1 and 2
+class SamplerPlugin : public PluginInterface {
+public:
+    SamplerPlugin(Mode mode, SlowCard &card, const std::vector<std::string> &paths, int voices) :
+            mode_(mode), card_(card), paths_(paths), voices_(voices), random_(1) {}
+
+    ~SamplerPlugin() override {
+        for (Voice &v: voices_) {
+            if (streamer_ && v.id >= 0) streamer_->destroyVoice(v.id);
+        }
+        for (int file: files_) {
+            if (streamer_) streamer_->closeFile(file);
+            else close(file);
+        }
+    }
+
+    PluginEditorInterface *getEditor() override { return nullptr; }
+
+    void setHostServices(const HostServices *services) override {
+        streamer_ = mode_ != DIRECT && services && services->version >= 4 ? services->streamer : nullptr;
+    }
+
+    void prepare(double sampleRate, int samplesPerBlock) override {
+        if (!files_.empty()) return;
+        for (const std::string &path: paths_) {
+            int file;
+            if (streamer_) {
+                DiskStreamer::FileInfo info;
+                file = streamer_->openFile(path.c_str(), mode_ == PREFETCHED ? PREFETCH_MS : 0, &info);
+            } else {
+                file = open(path.c_str(), O_RDONLY);
+            }
+            if (file >= 0) files_.push_back(file);
+        }
+        for (Voice &v: voices_) {
+            if (streamer_) v.id = streamer_->createVoice(CHANNELS, RING_FRAMES);
+            v.nextTrigger = random_() % (uint64_t) (2.0 * sampleRate);
+        }
+        frames_.assign((size_t) samplesPerBlock * CHANNELS, 0.0f);
+        samples_.assign((size_t) samplesPerBlock * CHANNELS, 0);
+    }
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        for (int ch = 0; ch < numChannels; ch++) memset(channelData[ch], 0, numSamples * sizeof(float));
+        if (files_.empty()) return;
+        const int64_t fileFrames = (int64_t) (SAMPLE_RATE * FILE_SECONDS);
+
+        for (Voice &v: voices_) {
+            if (position_ >= v.nextTrigger) {
+                v.file = files_[random_() % files_.size()];
+                v.frame = random_() % 4 == 0 ? (int64_t) (random_() % (uint64_t) (fileFrames / 2)) : 0;
+                v.nextTrigger = position_ + (uint64_t) (SAMPLE_RATE * (0.5 + 1.5 * (random_() % 1000) / 1000.0));
+                if (streamer_) streamer_->start(v.id, v.file, v.frame, false);
+                retriggers_++;
+            }
+
+            int n;
+            if (streamer_) {
+                n = streamer_->read(v.id, frames_.data(), numSamples);
+            } else {
+                // blocks the audio thread for as long as the card takes
+                n = (int) std::min<int64_t>(numSamples, fileFrames - v.frame);
+                ssize_t got = card_.read(v.file, samples_.data(), (size_t) n * CHANNELS * sizeof(int16_t),
+                                         WAV_HEADER + (off_t) v.frame * CHANNELS * sizeof(int16_t));
+                n = got > 0 ? (int) (got / (CHANNELS * sizeof(int16_t))) : 0;
+                for (int i = 0; i < n * CHANNELS; i++) frames_[i] = samples_[i] * (1.0f / 32768.0f);
+                v.frame += n;
+            }
+            for (int ch = 0; ch < CHANNELS && ch < numChannels; ch++) {
+                for (int i = 0; i < n; i++) channelData[ch][i] += 0.1f * frames_[i * CHANNELS + ch];
+            }
+        }
+        position_ += (uint64_t) numSamples;
+    }
+
+    uint64_t underruns() const {
+        uint64_t n = 0;
+        for (const Voice &v: voices_) {
+            if (streamer_ && v.id >= 0) n += streamer_->underruns(v.id);
+        }
+        return n;
+    }
+
+    uint64_t retriggers() const { return retriggers_; }
+
+private:
+    struct Voice {
+        int id = -1;
+        int file = -1;
+        int64_t frame = 0;
+        uint64_t nextTrigger = 0;
+    };
+
+    const Mode mode_;
+    SlowCard &card_;
+    const std::vector<std::string> paths_;
+    DiskStreamer *streamer_ = nullptr;
+    std::vector<int> files_;
+    std::vector<Voice> voices_;
+    std::vector<float> frames_;
+    std::vector<int16_t> samples_;
+    std::minstd_rand random_;
+    uint64_t position_ = 0;
+    uint64_t retriggers_ = 0;
+};
+
+struct Result {
+    uint64_t blocks = 0;
+    uint64_t xruns = 0;
+    uint64_t underruns = 0;
+    uint64_t retriggers = 0;
+    double megabytes = 0.0;
+    double busy = 0.0;
+};
+
+Result run(Mode mode, const std::vector<std::string> &paths, int voices, double seconds, int blockSize,
+           double accessMs, double mbPerSecond) {
+    SlowCard card(accessMs, mbPerSecond);
+    SlowStreamer streamer(card);
+    HostServices services;
+    services.streamer = &streamer;
+
+    auto *desc = new PluginDescriptor;
+    desc->name = "SAMPLER";
+    desc->uid = 0x53414d50;
+    desc->outputChannelNames = {"Out L", "Out R"};
+    auto *plugin = new SamplerPlugin(mode, card, paths, voices);
+    Module module(desc, plugin, 0);
+    for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+    module.prepare(SAMPLE_RATE, blockSize, &services);
+
+    // opening the files and prefetching is not part of the measurement
+    const uint64_t busy = card.busyNs();
+    const uint64_t bytes = card.bytes();
+    AudioThread audio(SAMPLE_RATE, blockSize, {&module});
+    const uint64_t start = nowNs();
+    audio.start();
+    usleep((useconds_t) (seconds * 1e6));
+    audio.stop();
+    const double elapsed = (nowNs() - start) / 1e9;
+
+    Result r;
+    r.blocks = audio.blocks();
+    r.xruns = audio.xruns();
+    r.underruns = plugin->underruns();
+    r.retriggers = plugin->retriggers();
+    r.megabytes = (card.bytes() - bytes) / 1e6;
+    r.busy = (card.busyNs() - busy) / 1e9 / elapsed;
+    return r;
+}
+
+}
+
+int main(int argc, char **argv) {
+    int voices = 32;
+    double seconds = 10.0;
+    int blockSize = 64;
+    double accessMs = 2.0;
+    double mbPerSecond = 20.0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "-v") voices = atoi(argv[i + 1]);
+        else if (a == "-t") seconds = atof(argv[i + 1]);
+        else if (a == "-b") blockSize = atoi(argv[i + 1]);
+        else if (a == "-a") accessMs = atof(argv[i + 1]);
+        else if (a == "-m") mbPerSecond = atof(argv[i + 1]);
+    }
+    if (voices <= 0 || seconds <= 0.0 || blockSize <= 0 || accessMs < 0.0 || mbPerSecond <= 0.0) {
+        fprintf(stderr, "usage: bench_streaming [-v voices] [-t seconds] [-b blocksize] [-a access ms] [-m MB/s]\n");
+        return 1;
+    }
+
+    char dir[] = "/tmp/bench_streaming_XXXXXX";
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "cannot create a directory in /tmp\n");
+        return 1;
+    }
+    std::vector<std::string> paths;
+    for (int i = 0; i < NUM_FILES; i++) {
+        paths.push_back(std::string(dir) + "/sample" + std::to_string(i) + ".wav");
+        if (!writeWav(paths.back(), i)) {
+            fprintf(stderr, "cannot write %s\n", paths.back().c_str());
+            return 1;
+        }
+    }
+
+    printf("%d voices, %d files of %d s, block size %d, card: %.1f ms per read, %.0f MB/s, %.0f s per run\n\n",
+           voices, NUM_FILES, FILE_SECONDS, blockSize, accessMs, mbPerSecond, seconds);
+    Result results[3];
+    for (int m = DIRECT; m <= PREFETCHED; m++) {
+        results[m] = run((Mode) m, paths, voices, seconds, blockSize, accessMs, mbPerSecond);
+    }
+
+    for (const std::string &path: paths) unlink(path.c_str());
+    rmdir(dir);
+
+    printf("%-20s %12s %12s %12s\n", "", "direct", "streamed", "prefetched");
+    printf("%-20s %12llu %12llu %12llu\n", "blocks", (unsigned long long) results[0].blocks,
+           (unsigned long long) results[1].blocks, (unsigned long long) results[2].blocks);
+    printf("%-20s %12llu %12llu %12llu\n", "retriggers", (unsigned long long) results[0].retriggers,
+           (unsigned long long) results[1].retriggers, (unsigned long long) results[2].retriggers);
+    printf("%-20s %12llu %12llu %12llu\n", "audio xruns", (unsigned long long) results[0].xruns,
+           (unsigned long long) results[1].xruns, (unsigned long long) results[2].xruns);
+    printf("%-20s %12llu %12llu %12llu\n", "voice underruns", (unsigned long long) results[0].underruns,
+           (unsigned long long) results[1].underruns, (unsigned long long) results[2].underruns);
+    printf("%-20s %12.1f %12.1f %12.1f\n", "MB read", results[0].megabytes, results[1].megabytes,
+           results[2].megabytes);
+    printf("%-20s %11.0f%% %11.0f%% %11.0f%%\n", "card busy", 100.0 * results[0].busy, 100.0 * results[1].busy,
+           100.0 * results[2].busy);
+    return 0;
+}
@@ -0,0 +1,146 @@
+// see ../Source/PluginHost.h for license
+
+// a heavy 8 channel plugin, processing its channels one after the other,
+// or split across tasks of the host's task pool (HostServices::taskPool).
+//
+// usage: bench_taskpool [-w workers] [-b blocksize] [-s stages]
+
+#include "Bench.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// a cascade of saturating one pole filters on every channel
+class HeavyPlugin : public Percussa::SSP::PluginInterface {
+public:
+    static constexpr int CHANNELS = 8;
+
+    HeavyPlugin(int stages, bool parallel) : stages_(stages), parallel_(parallel) {
+        state_.assign(CHANNELS * stages_, 0.0f);
+        batch_.fun = &HeavyPlugin::channelTask;
+        batch_.context = this;
+    }
+
+    Percussa::SSP::PluginEditorInterface *getEditor() override { return nullptr; }
+
+    void setHostServices(const Percussa::SSP::HostServices *services) override {
+        services_ = services;
+    }
+
+    void prepare(double, int) override {}
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        channelData_ = channelData;
+        numSamples_ = numSamples;
+        numChannels = std::min(numChannels, (int) CHANNELS);
+
+        Percussa::SSP::TaskPool *pool = services_ ? services_->taskPool : nullptr;
+        if (parallel_ && pool) {
+            batch_.count = numChannels;
+            pool->submit(batch_);
+            pool->join(batch_);
+        } else {
+            for (int ch = 0; ch < numChannels; ch++) processChannel(ch);
+        }
+    }
+
+private:
+    static void channelTask(void *context, int index) {
+        static_cast<HeavyPlugin *>(context)->processChannel(index);
+    }
+
+    void processChannel(int ch) {
+        float *data = channelData_[ch];
+        float *z = &state_[ch * stages_];
+        for (int i = 0; i < numSamples_; i++) {
+            float x = data[i];
+            for (int s = 0; s < stages_; s++) {
+                z[s] += 0.3f * (tanhf(x) - z[s]);
+                x = z[s];
+            }
+            data[i] = x;
+        }
+    }
+
+    int stages_;
+    bool parallel_;
+    std::vector<float> state_;
+    const Percussa::SSP::HostServices *services_ = nullptr;
+    Percussa::SSP::TaskPool::Batch batch_;
+    float **channelData_ = nullptr;
+    int numSamples_ = 0;
+};
+
+struct Result {
+    double avgUs;
+    double maxUs;
+};
+
+Result measure(HeavyPlugin &plugin, std::vector<float *> &channels, int blockSize, int blocks) {
+    double total = 0.0, worst = 0.0;
+    for (int b = 0; b < blocks; b++) {
+        for (float *c: channels) {
+            for (int i = 0; i < blockSize; i++) c[i] = sinf(0.01f * (b * blockSize + i));
+        }
+        uint64_t t0 = nowNs();
+        plugin.process(channels.data(), (int) channels.size(), blockSize);
+        double t = (nowNs() - t0) / 1000.0;
+        total += t;
+        worst = std::max(worst, t);
+    }
+    return Result{total / blocks, worst};
+}
+
+}
+
+int main(int argc, char **argv) {
+    int workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    int blockSize = 128;
+    int stages = 16;
+    const int blocks = 4000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "-w") workers = atoi(argv[i + 1]);
+        else if (a == "-b") blockSize = atoi(argv[i + 1]);
+        else if (a == "-s") stages = atoi(argv[i + 1]);
+    }
+    if (blockSize <= 0 || stages <= 0 || workers < 0) {
+        fprintf(stderr, "usage: bench_taskpool [-w workers] [-b blocksize] [-s stages]\n");
+        return 1;
+    }
+
+    std::vector<float> storage(HeavyPlugin::CHANNELS * blockSize);
+    std::vector<float *> channels;
+    for (int ch = 0; ch < HeavyPlugin::CHANNELS; ch++) channels.push_back(&storage[ch * blockSize]);
+
+    WorkerPool pool(workers);
+    Percussa::SSP::HostServices services;
+    services.taskPool = &pool;
+
+    HeavyPlugin sequential(stages, false);
+    HeavyPlugin parallel(stages, true);
+    for (HeavyPlugin *p: {&sequential, &parallel}) {
+        p->setHostServices(&services);
+        p->prepare(48000.0, blockSize);
+        measure(*p, channels, blockSize, blocks / 10); // warm up
+    }
+
+    Result s = measure(sequential, channels, blockSize, blocks);
+    Result p = measure(parallel, channels, blockSize, blocks);
+
+    printf("%d channels, %d stages, block size %d, %d workers + calling thread\n",
+           HeavyPlugin::CHANNELS, stages, blockSize, workers);
+    printf("%-12s %12s %12s\n", "", "avg us", "max us");
+    printf("%-12s %12.1f %12.1f\n", "sequential", s.avgUs, s.maxUs);
+    printf("%-12s %12.1f %12.1f\n", "task pool", p.avgUs, p.maxUs);
+    printf("speed-up: %.2fx\n", s.avgUs / p.avgUs);
+    return 0;
+}
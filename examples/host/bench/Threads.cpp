@@ -0,0 +1,359 @@
+// see ../Source/PluginHost.h for license
+
+// isolation of the audio from the threads plugins start themselves. a plugin
+// runs three kinds of them, as a sampler or a granular module would: a DSP
+// helper rendering the next block while the audio thread plays the current
+// one, a disk streaming thread filling a ring buffer from a file, and compute
+// threads busy with background analysis. first as plain threads, then
+// registered with the host's ThreadPolicy (HostServices version 3), which
+// puts the helper at real-time priority on the real-time cores, and the
+// others on the background cores, the compute threads at the lowest priority.
+//
+// reports the xruns of the audio thread, the blocks the helper had not
+// rendered in time and the blocks the stream had not read in time, the wake
+// up latency of the helper, and the progress of the background analysis
+// (passes over its buffer per second), which only gets the time left over.
+//
+// usage: bench_threads [-t seconds] [-b blocksize] [-c compute threads] [-p partials]
+
+#include "Bench.h"
+#include "AudioThread.h"
+#include "PluginHost.h"
+#include "ThreadPolicy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <semaphore.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace Percussa::SSP;
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int RENDERED = 4;      // outputs 0 ... 3 come from the helper
+static constexpr int STREAMED = 4;      // outputs 4 ... 7 from the file
+static constexpr int RING_BLOCKS = 8;
+static constexpr size_t ANALYSIS_FLOATS = 1 << 18;
+
+class StreamPlugin : public PluginInterface {
+public:
+    StreamPlugin(int fd, size_t fileFloats, int computeThreads, int partials, size_t maxBlocks) :
+            fd_(fd), fileFloats_(fileFloats), computeThreads_(computeThreads), partials_(partials) {
+        sem_init(&dspWake_, 0, 0);
+        sem_init(&ioWake_, 0, 0);
+        latencies_.resize(maxBlocks);
+    }
+
+    ~StreamPlugin() override {
+        quit_ = true;
+        sem_post(&dspWake_);
+        sem_post(&ioWake_);
+        for (auto &t: threads_) t.join();
+        sem_destroy(&dspWake_);
+        sem_destroy(&ioWake_);
+    }
+
+    PluginEditorInterface *getEditor() override { return nullptr; }
+
+    void setHostServices(const HostServices *services) override {
+        registry_ = services && services->version >= 3 ? services->threads : nullptr;
+    }
+
+    void prepare(double, int samplesPerBlock) override {
+        if (!threads_.empty()) return;
+        blockSize_ = samplesPerBlock;
+        for (auto &buffer: ahead_) buffer.assign((size_t) RENDERED * samplesPerBlock, 0.0f);
+        ring_.assign((size_t) RING_BLOCKS * samplesPerBlock, 0.0f);
+        phases_.assign((size_t) RENDERED * partials_, 0.0f);
+
+        // the start of the file is read ahead, as when a sample is loaded
+        ssize_t n = pread(fd_, ring_.data(), ring_.size() * sizeof(float), 0);
+        streamed_ = n > 0 ? (size_t) n / sizeof(float) : 0;
+        written_.store(streamed_);
+
+        threads_.emplace_back(&StreamPlugin::renderAhead, this);
+        threads_.emplace_back(&StreamPlugin::stream, this);
+        for (int i = 0; i < computeThreads_; i++) threads_.emplace_back(&StreamPlugin::analyse, this);
+    }
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        // the helper rendered this block during the previous one
+        const uint64_t block = block_;
+        if (rendered_.load(std::memory_order_acquire) == block) {
+            const float *ahead = ahead_[block % 2].data();
+            for (int ch = 0; ch < RENDERED && ch < numChannels; ch++) {
+                memcpy(channelData[ch], ahead + (size_t) ch * blockSize_, numSamples * sizeof(float));
+            }
+        } else {
+            dspLate_++;
+        }
+
+        // the stream has to be at least a block ahead
+        const uint64_t written = written_.load(std::memory_order_acquire);
+        if (written - read_ >= (uint64_t) numSamples) {
+            for (int i = 0; i < numSamples; i++) {
+                const float x = ring_[(read_ + i) % ring_.size()];
+                for (int ch = RENDERED; ch < RENDERED + STREAMED && ch < numChannels; ch++) channelData[ch][i] = x;
+            }
+            read_ += numSamples;
+            readShared_.store(read_, std::memory_order_release);
+        } else {
+            streamLate_++;
+        }
+        sem_post(&ioWake_);
+
+        block_ = block + 1;
+        requested_.store(block + 1, std::memory_order_relaxed);
+        postNs_.store(nowNs(), std::memory_order_release);
+        sem_post(&dspWake_);
+    }
+
+    uint64_t dspLate() const { return dspLate_; }
+    uint64_t streamLate() const { return streamLate_; }
+    uint64_t analysisPasses() const { return passes_.load(); }
+
+    // wake up latencies of the helper in us, sorted
+    std::vector<double> latencies() const {
+        std::vector<double> us;
+        const size_t n = std::min(numLatencies_.load(), latencies_.size());
+        for (size_t i = 0; i < n; i++) us.push_back(latencies_[i] / 1e3);
+        std::sort(us.begin(), us.end());
+        return us;
+    }
+
+private:
+    void registerThread(ThreadRegistry::Role role, const char *name) {
+        if (registry_) registry_->registerThread(role, name);
+    }
+
+    void unregisterThread() {
+        if (registry_) registry_->unregisterThread();
+    }
+
+    // additive voices, partials_ sines each
+    void renderAhead() {
+        registerThread(ThreadRegistry::THREAD_DSP, "stream dsp");
+        uint64_t done = 0;
+        while (!quit_.load(std::memory_order_relaxed)) {
+            sem_wait(&dspWake_);
+            const uint64_t block = requested_.load(std::memory_order_relaxed);
+            if (block == done) continue;
+            const uint64_t latency = nowNs() - postNs_.load(std::memory_order_acquire);
+            const size_t n = numLatencies_.load(std::memory_order_relaxed);
+            if (n < latencies_.size()) {
+                latencies_[n] = latency;
+                numLatencies_.store(n + 1, std::memory_order_release);
+            }
+
+            float *ahead = ahead_[block % 2].data();
+            for (int ch = 0; ch < RENDERED; ch++) {
+                float *out = ahead + (size_t) ch * blockSize_;
+                float *phases = &phases_[(size_t) ch * partials_];
+                memset(out, 0, blockSize_ * sizeof(float));
+                for (int p = 0; p < partials_; p++) {
+                    const float dphi = (float) (2.0 * M_PI * 110.0 * (ch + 1) * (p + 1) / SAMPLE_RATE);
+                    float phi = phases[p];
+                    for (int i = 0; i < blockSize_; i++) {
+                        out[i] += std::sin(phi) / (float) (p + 1);
+                        phi += dphi;
+                    }
+                    phases[p] = std::fmod(phi, (float) (2.0 * M_PI));
+                }
+            }
+            done = block;
+            rendered_.store(block, std::memory_order_release);
+        }
+        unregisterThread();
+    }
+
+    // keeps the ring full, reading a block at a time from the file
+    void stream() {
+        registerThread(ThreadRegistry::THREAD_IO, "stream io");
+        std::vector<float> chunk(blockSize_);
+        uint64_t written = streamed_;
+        size_t position = streamed_ % fileFloats_;
+        while (!quit_.load(std::memory_order_relaxed)) {
+            sem_wait(&ioWake_);
+            while (written + blockSize_ - readShared_.load(std::memory_order_acquire) <= ring_.size()) {
+                const size_t floats = std::min((size_t) blockSize_, fileFloats_ - position);
+                ssize_t n = pread(fd_, chunk.data(), floats * sizeof(float), (off_t) (position * sizeof(float)));
+                if (n <= 0) break;
+                const size_t got = (size_t) n / sizeof(float);
+                for (size_t i = 0; i < got; i++) ring_[(written + i) % ring_.size()] = chunk[i];
+                written += got;
+                position = (position + got) % fileFloats_;
+                written_.store(written, std::memory_order_release);
+            }
+        }
+        unregisterThread();
+    }
+
+    // passes over a buffer larger than the caches, as an analysis would
+    void analyse() {
+        registerThread(ThreadRegistry::THREAD_COMPUTE, "stream analysis");
+        std::vector<float> data(ANALYSIS_FLOATS, 0.5f);
+        float state = 0.0f;
+        while (!quit_.load(std::memory_order_relaxed)) {
+            for (float &x: data) {
+                state = 0.999f * state + x;
+                x = std::sqrt(std::fabs(state)) * 0.01f + 0.5f;
+            }
+            passes_.fetch_add(1, std::memory_order_relaxed);
+        }
+        unregisterThread();
+    }
+
+    const int fd_;
+    const size_t fileFloats_;
+    const int computeThreads_;
+    const int partials_;
+    ThreadRegistry *registry_ = nullptr;
+    int blockSize_ = 0;
+    size_t streamed_ = 0;
+
+    std::vector<std::thread> threads_;
+    std::atomic<bool> quit_{false};
+
+    // audio thread
+    uint64_t block_ = 0;
+    uint64_t read_ = 0;
+    uint64_t dspLate_ = 0;
+    uint64_t streamLate_ = 0;
+
+    // helper
+    sem_t dspWake_;
+    std::vector<float> ahead_[2];
+    std::vector<float> phases_;
+    std::atomic<uint64_t> requested_{0};
+    std::atomic<uint64_t> rendered_{0};
+    std::atomic<uint64_t> postNs_{0};
+    std::vector<uint64_t> latencies_;
+    std::atomic<size_t> numLatencies_{0};
+
+    // stream
+    sem_t ioWake_;
+    std::vector<float> ring_;
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> readShared_{0};
+
+    std::atomic<uint64_t> passes_{0};
+};
+
+struct Result {
+    uint64_t blocks = 0;
+    uint64_t xruns = 0;
+    uint64_t dspLate = 0;
+    uint64_t streamLate = 0;
+    std::vector<double> latencies;
+    double passesPerSecond = 0.0;
+};
+
+Result run(ThreadPolicy *policy, int fd, size_t fileFloats, double seconds, int blockSize, int computeThreads,
+           int partials) {
+    HostServices services;
+    services.threads = policy;
+
+    auto *desc = new PluginDescriptor;
+    desc->name = "STREAM";
+    desc->uid = 0x5354524d;
+    for (int ch = 0; ch < RENDERED + STREAMED; ch++) desc->outputChannelNames.push_back("Out " + std::to_string(ch + 1));
+    const size_t maxBlocks = (size_t) (seconds * SAMPLE_RATE / blockSize) + 1000;
+    auto *plugin = new StreamPlugin(fd, fileFloats, computeThreads, partials, maxBlocks);
+    Module module(desc, plugin, 0);
+    for (int i = 0; i < module.numOutputs(); i++) module.plugin().outputEnabled(i, true);
+    module.prepare(SAMPLE_RATE, blockSize, &services);
+
+    AudioThread audio(SAMPLE_RATE, blockSize, {&module});
+    audio.start();
+    if (policy) policy->pinRealtime(audio.thread().native_handle());
+    // let the threads start
+    usleep(200000);
+    const uint64_t passes = plugin->analysisPasses();
+    const uint64_t start = nowNs();
+    usleep((useconds_t) (seconds * 1e6));
+    Result r;
+    r.passesPerSecond = (double) (plugin->analysisPasses() - passes) / ((nowNs() - start) / 1e9);
+    audio.stop();
+
+    r.blocks = audio.blocks();
+    r.xruns = audio.xruns();
+    r.dspLate = plugin->dspLate();
+    r.streamLate = plugin->streamLate();
+    r.latencies = plugin->latencies();
+    return r;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    return sorted[std::min(sorted.size() - 1, (size_t) (p * (double) sorted.size()))];
+}
+
+}
+
+int main(int argc, char **argv) {
+    double seconds = 10.0;
+    int blockSize = 64;
+    int computeThreads = 2 * (int) std::max(1u, std::thread::hardware_concurrency());
+    int partials = 16;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string a = argv[i];
+        if (a == "-t") seconds = atof(argv[i + 1]);
+        else if (a == "-b") blockSize = atoi(argv[i + 1]);
+        else if (a == "-c") computeThreads = atoi(argv[i + 1]);
+        else if (a == "-p") partials = atoi(argv[i + 1]);
+    }
+    if (seconds <= 0.0 || blockSize <= 0 || computeThreads < 0 || partials <= 0) {
+        fprintf(stderr, "usage: bench_threads [-t seconds] [-b blocksize] [-c compute threads] [-p partials]\n");
+        return 1;
+    }
+
+    // the streamed file, 4 MB of noise, in the page cache after the first pass
+    char path[] = "/tmp/bench_threads_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "cannot create %s\n", path);
+        return 1;
+    }
+    unlink(path);
+    std::vector<float> noise(1 << 20);
+    for (float &x: noise) x = (float) rand() / (float) RAND_MAX - 0.5f;
+    if (write(fd, noise.data(), noise.size() * sizeof(float)) != (ssize_t) (noise.size() * sizeof(float))) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+
+    ThreadPolicy policy;
+    printf("%d compute threads, block size %d, %.0f s per run, cores: %s\n\n", computeThreads, blockSize, seconds,
+           policy.describe().c_str());
+
+    Result results[2];
+    results[0] = run(nullptr, fd, noise.size(), seconds, blockSize, computeThreads, partials);
+    results[1] = run(&policy, fd, noise.size(), seconds, blockSize, computeThreads, partials);
+    close(fd);
+
+    printf("%-28s %14s %14s\n", "", "plain", "registered");
+    printf("%-28s %14llu %14llu\n", "blocks", (unsigned long long) results[0].blocks,
+           (unsigned long long) results[1].blocks);
+    printf("%-28s %14llu %14llu\n", "audio xruns", (unsigned long long) results[0].xruns,
+           (unsigned long long) results[1].xruns);
+    printf("%-28s %14llu %14llu\n", "dsp helper late blocks", (unsigned long long) results[0].dspLate,
+           (unsigned long long) results[1].dspLate);
+    printf("%-28s %14llu %14llu\n", "stream late blocks", (unsigned long long) results[0].streamLate,
+           (unsigned long long) results[1].streamLate);
+    const struct { const char *name; double p; } rows[] = {
+            {"helper wake up us p50", 0.5}, {"helper wake up us p99", 0.99}, {"helper wake up us max", 1.0}};
+    for (const auto &row: rows) {
+        printf("%-28s %14.1f %14.1f\n", row.name, percentile(results[0].latencies, row.p),
+               percentile(results[1].latencies, row.p));
+    }
+    printf("%-28s %14.1f %14.1f\n", "analysis passes/s", results[0].passesPerSecond, results[1].passesPerSecond);
+    return 0;
+}
@@ -0,0 +1,122 @@
+#!/usr/bin/env bash
+# profile guided, link time optimised build of the plugins of a cmake project
+# (these examples by default), see "profile guided builds" in BUILDING.md.
+#
+#   1. builds the host harness (host/ssphost, host/bench_builds), and a plain
+#      release build of the plugins to compare with
+#   2. builds the plugins instrumented (SSP_PGO=GENERATE)
+#   3. runs workloads through ssphost with every plugin: audio, encoders, state
+#      saves and loads, changing block sizes, and the editor. cross compiled,
+#      they run under qemu-arm user mode
+#   4. merges the profiles (clang), and builds the plugins again with them,
+#      and link time optimisation (SSP_PGO=USE)
+#   5. compares the startup and process() time of both builds of every plugin
+#
+# usage: pgo.sh [-S source] [-B build] [-T toolchain.cmake] [-t seconds]
+#   -S <dir>        cmake project of the plugins (the directory of this script)
+#   -B <dir>        build directory (build-pgo), for the builds of every step,
+#                   the profiles are in <dir>/profile
+#   -T <file>       toolchain file to cross compile with, e.g. xcSSP.cmake
+#   -t <seconds>    length of each workload (20)
+#
+# environment: QEMU, the command running cross compiled programs (qemu-arm -L
+# with the sysroot of xcSSP.cmake), LLVM_PROFDATA (llvm-profdata), and JOBS,
+# the number of parallel build jobs (all cores).
+
+set -euo pipefail
+
+here=$(cd "$(dirname "$0")" && pwd)
+source_dir=$here
+build_dir=$PWD/build-pgo
+toolchain=
+seconds=20
+
+usage() {
+    sed -n '/^# usage:/,/^# *-t/p' "$0" | sed 's/^# \{0,1\}//' >&2
+    exit 1
+}
+
+while getopts "S:B:T:t:h" opt; do
+    case $opt in
+        S) source_dir=$(cd "$OPTARG" && pwd) ;;
+        B) build_dir=$OPTARG ;;
+        T) toolchain=$(cd "$(dirname "$OPTARG")" && pwd)/$(basename "$OPTARG") ;;
+        t) seconds=$OPTARG ;;
+        *) usage ;;
+    esac
+done
+shift $((OPTIND - 1))
+[ $# -eq 0 ] || usage
+
+mkdir -p "$build_dir"
+build_dir=$(cd "$build_dir" && pwd)
+profile_dir=$build_dir/profile
+jobs=${JOBS:-$(nproc 2>/dev/null || echo 4)}
+
+cmake_args=(-DCMAKE_BUILD_TYPE=Release)
+run=()
+if [ -n "$toolchain" ]; then
+    cmake_args+=(-DCMAKE_TOOLCHAIN_FILE="$toolchain")
+    buildroot=${BUILDROOT:-$HOME/buildroot/arm-rockchip-linux-gnueabihf_sdk-buildroot}
+    read -r -a run <<< "${QEMU:-qemu-arm -L $buildroot/arm-rockchip-linux-gnueabihf/sysroot}"
+fi
+
+step() {
+    echo
+    echo "== $*"
+}
+
+build() {
+    local dir=$1
+    shift
+    cmake -S "$source_dir" -B "$build_dir/$dir" "${cmake_args[@]}" -DSSP_PGO_DIR="$profile_dir" "$@" > /dev/null
+    cmake --build "$build_dir/$dir" -j "$jobs"
+}
+
+# the plugins of a build, listed by ssp_optimise()
+plugins() {
+    cat "$build_dir/$1"/ssp-plugins/*.path 2> /dev/null
+}
+
+step "host harness"
+cmake -S "$here/host" -B "$build_dir/host" "${cmake_args[@]}" > /dev/null
+cmake --build "$build_dir/host" -j "$jobs" --target ssphost bench_builds
+host=$build_dir/host/ssphost
+
+step "release build"
+build base -DSSP_PGO=OFF -DSSP_LTO=OFF
+
+step "instrumented build"
+rm -rf "$profile_dir"
+build generate -DSSP_PGO=GENERATE -DSSP_LTO=OFF
+if [ -z "$(plugins generate)" ]; then
+    echo "no plugins in $source_dir, add them with ssp_add_plugin() or ssp_optimise()" >&2
+    exit 1
+fi
+
+step "workloads"
+for plugin in $(plugins generate); do
+    echo "$plugin"
+    ${run[@]+"${run[@]}"} "$host" -t "$seconds" -n 2 -s 1 "$plugin" > /dev/null
+    ${run[@]+"${run[@]}"} "$host" -t "$seconds" -b 256 --toggle 32 "$plugin" > /dev/null
+    ${run[@]+"${run[@]}"} "$host" -t "$seconds" --editor "$plugin" > /dev/null \
+        || echo "warning: the editor of $plugin failed, its profile only covers the dsp" >&2
+done
+
+if ls "$profile_dir"/*.profraw > /dev/null 2>&1; then
+    "${LLVM_PROFDATA:-llvm-profdata}" merge -output="$profile_dir/ssp.profdata" "$profile_dir"/*.profraw
+elif [ -z "$(find "$profile_dir" -name '*.gcda' -print -quit)" ]; then
+    echo "the workloads wrote no profiles into $profile_dir" >&2
+    exit 1
+fi
+
+step "profile guided build"
+build use -DSSP_PGO=USE
+
+step "speed-ups"
+for path in "$build_dir"/use/ssp-plugins/*.path; do
+    echo
+    echo "$(basename "$path" .path)"
+    ${run[@]+"${run[@]}"} "$build_dir/host/bench_builds" \
+        "$(cat "$build_dir/base/ssp-plugins/$(basename "$path")")" "$(cat "$path")"
+done
@@ -0,0 +1,148 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC. 
+
+	This software is part of the Percussa SSP's software development kit (SDK). 
+	For more info about Percussa or the SSP visit http://www.percussa.com/ 
+	and our forum at http://forum.percussa.com/ 
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <Percussa.h>
+
+#include <atomic>
+#include <thread>
+
+// interfaces between a JUCE plugin and the ssp_adapter library (SSPApi.cpp).
+// the adapter creates the processor with createPluginFilter(), and the editor
+// with AudioProcessor::createEditor(). the processor can implement SSPProcessor,
+// and the editor SSPEditor, to receive the SSP specific calls.
+
+// the function the adapter creates the processor with. every plugin of a
+// bundle (see PercussaBundle.h) needs its own, so define the processor's as
+// SSP_PLUGIN_FILTER(), and give it a name per plugin in the bundled build:
+//   target_compile_definitions(MyPlugin_bundled PRIVATE SSP_PLUGIN_FILTER=createMyPluginFilter)
+// otherwise it is JUCE's createPluginFilter().
+#ifndef SSP_PLUGIN_FILTER
+#define SSP_PLUGIN_FILTER createPluginFilter
+#endif
+
+enum SSPButtons {
+    SSP_Soft_1,
+    SSP_Soft_2,
+    SSP_Soft_3,
+    SSP_Soft_4,
+    SSP_Soft_5,
+    SSP_Soft_6,
+    SSP_Soft_7,
+    SSP_Soft_8,
+    SSP_Left,
+    SSP_Right,
+    SSP_Up,
+    SSP_Down,
+    SSP_Shift_L,
+    SSP_Shift_R,
+    SSP_LastBtn
+};
+
+class SSPProcessor {
+public:
+    virtual ~SSPProcessor() = default;
+
+    // true on the thread the adapter calls processBlock() from. the adapter
+    // changes parameters there too, with the listeners notified (encoder
+    // turns, staged states), listeners must not wait for other threads then.
+    bool isAudioThread() const {
+        return audioThread_.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+    // audio thread, from processBlock(): numSamples samples were not computed,
+    // because the processor took a fast path (e.g. no outputs enabled). the
+    // adapter adds them to samplesSkipped in the plugin's stats.
+    void skipped(int numSamples) { skipped_ += numSamples; }
+
+    // patch connections of the inputs and outputs, called from the UI thread
+    virtual void onInputChanged(int, bool) {}
+    virtual void onOutputChanged(int, bool) {}
+
+    // host owned memory (HostServices version 2), set before prepareToPlay(),
+    // nullptr if the host does not provide it
+    virtual void setMemoryArena(Percussa::SSP::MemoryArena *) {}
+
+    // host scheduling of the threads the processor starts itself (HostServices
+    // version 3), set before prepareToPlay(), nullptr if the host does not
+    // provide it. call registerThread() at the start of their run().
+    virtual void setThreadRegistry(Percussa::SSP::ThreadRegistry *) {}
+
+    // the host's disk streaming (HostServices version 4), set before
+    // prepareToPlay(), nullptr if the host does not provide it
+    virtual void setDiskStreamer(Percussa::SSP::DiskStreamer *) {}
+
+    // the host's shared asset store (HostServices version 5), set before
+    // prepareToPlay(), nullptr if the host does not provide it
+    virtual void setAssetStore(Percussa::SSP::AssetStore *) {}
+
+    // audio thread, between two blocks: the host switches to another sample rate
+    // without calling prepareToPlay() (see reconfigure() in Percussa.h). the block
+    // size is at most the one passed to prepareToPlay(). return true if the
+    // processor adopted the new rate without allocating, false if it needs a
+    // new prepareToPlay(). block size changes alone do not call this.
+    virtual bool onReconfigure(double, int) { return false; }
+
+    // UI thread, bytes held for process() (see MemoryUsage in Percussa.h)
+    virtual size_t memoryBytes() const { return 0; }
+
+    // UI thread, the host reuses the instance for a new module (see reset() in
+    // Percussa.h). the adapter has set the parameters to their defaults, with
+    // the listeners notified, and called AudioProcessor::reset() already. reset
+    // anything else the processor keeps, and return true, or false if it
+    // cannot be reused.
+    virtual bool onReset() { return false; }
+
+    // return true if getStateInformation() saves the parameter values, and
+    // nothing else. the adapter then versions the state by counting parameter
+    // changes, and hands the host deltas of the changed parameters for its
+    // autosaves (see stateVersion() in Percussa.h).
+    virtual bool parametersAreState() const { return false; }
+
+private:
+    friend class SSP_PluginInterface;
+    std::atomic<std::thread::id> audioThread_{};
+    // audio thread, since the end of the last block
+    int skipped_ = 0;
+};
+
+class SSPEditor {
+public:
+    virtual ~SSPEditor() = default;
+
+    // button calls come from the UI thread, onButton() gets SSP_Soft_1 .. SSP_Soft_8
+    virtual void onButton(int, bool) {}
+    virtual void onLeftButton(bool) {}
+    virtual void onRightButton(bool) {}
+    virtual void onUpButton(bool) {}
+    virtual void onDownButton(bool) {}
+    virtual void onLeftShiftButton(bool) {}
+    virtual void onRightShiftButton(bool) {}
+
+    // onEncoder() is called from the audio callback, like encoderTurned()
+    virtual void onEncoder(int, float) {}
+    virtual void onEncoderSwitch(int, bool) {}
+
+    // UI thread. the editor is created with the instance, and gets the buttons
+    // and encoders while it is hidden: create the resources only needed for
+    // drawing when it becomes visible, and release them when it is hidden.
+    virtual void onVisibilityChanged(bool) {}
+    // UI thread, bytes held by the editor, not counting the adapter's image
+    virtual size_t memoryBytes() const { return 0; }
+};
@@ -0,0 +1,434 @@
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <Percussa.h>
+#include <PercussaBundle.h>
+#include <PercussaEvents.h>
+#include <PercussaStats.h>
+#include <PercussaProfile.h>
+#include <PercussaState.h>
+
+#include "SSPAdapter.h"
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// implements the Percussa.h plugin api for a JUCE plugin, it is built into every
+// plugin linking the ssp_adapter target (see ../CMakeLists.txt).
+// the plugin is only seen through AudioProcessor/AudioProcessorEditor, and the
+// SSPProcessor/SSPEditor interfaces, so do not add plugin specific code here.
+// the classes are the same for every plugin, the parts depending on the plugin
+// are in the anonymous namespace at the end, exported with SSP_PLUGIN_EXPORT(),
+// so several JUCE plugins can share a bundle (see PercussaBundle.h).
+
+// defined by the plugin, as for any JUCE plugin format (see SSP_PLUGIN_FILTER)
+AudioProcessor *JUCE_CALLTYPE SSP_PLUGIN_FILTER();
+
+//SSPHASH
+#define SSP_IMAGECACHE_HASHCODE 0x53535048415348
+
+
+// the images the editors are drawn into, by hash code. only one editor is
+// visible at a time, so the visible instances share one, which is freed when
+// the last of them is hidden. JUCE's ImageCache can only release all of its
+// unused images at once, which would drop the images of other code too.
+// UI thread.
+class SSP_SharedImages {
+public:
+    static Image get(int64 hashCode, int width, int height) {
+        Image &image = images()[hashCode];
+        if (image.getWidth() != width || image.getHeight() != height) image = Image(Image::ARGB, width, height, true);
+        return image;
+    }
+
+    // frees the image if no instance holds it any more
+    static void release(int64 hashCode) {
+        auto it = images().find(hashCode);
+        if (it != images().end() && it->second.getReferenceCount() <= 1) images().erase(it);
+    }
+
+private:
+    static std::map<int64, Image> &images() {
+        static std::map<int64, Image> images;
+        return images;
+    }
+};
+
+
+// button dispatch, indexed by SSPButtons
+using ButtonHandler = void (*)(SSPEditor &, int, bool);
+
+static void softButton(SSPEditor &e, int n, bool val) { e.onButton(n, val); }
+
+template<void (SSPEditor::*F)(bool)>
+static void navButton(SSPEditor &e, int, bool val) { (e.*F)(val); }
+
+static const ButtonHandler buttonHandlers[SSP_LastBtn] = {
+    softButton, softButton, softButton, softButton,
+    softButton, softButton, softButton, softButton,
+    navButton<&SSPEditor::onLeftButton>,
+    navButton<&SSPEditor::onRightButton>,
+    navButton<&SSPEditor::onUpButton>,
+    navButton<&SSPEditor::onDownButton>,
+    navButton<&SSPEditor::onLeftShiftButton>,
+    navButton<&SSPEditor::onRightShiftButton>,
+};
+
+
+class SSP_PluginEditorInterface : public Percussa::SSP::PluginEditorInterface {
+public:
+    // the editor is created with the instance, so buttons and encoders reach it
+    // before it is first shown. only its drawing resources wait for that.
+    explicit SSP_PluginEditorInterface(AudioProcessor *processor) :
+        editor_(processor->createEditor()), ssp_(dynamic_cast<SSPEditor *>(editor_)) {
+    }
+
+    ~SSP_PluginEditorInterface() override {
+        if (editor_) delete editor_;
+    }
+
+    void frameStart() override {
+        PluginEditorInterface::frameStart();
+    }
+
+    void visibilityChanged(bool b) override {
+        if (!b) {
+            image_ = Image();
+            SSP_SharedImages::release(SSP_IMAGECACHE_HASHCODE);
+            if (editor_) editor_->setVisible(false);
+        }
+        if (ssp_) ssp_->onVisibilityChanged(b);
+    }
+
+    void renderToImage(unsigned char *buffer, int width, int height) override {
+        if (image_.getWidth() != width || image_.getHeight() != height) {
+            image_ = SSP_SharedImages::get(SSP_IMAGECACHE_HASHCODE, width, height);
+        }
+
+        if (!editor_->isVisible()) {
+            editor_->setBounds(Rectangle<int>(0, 0, width, height));
+            editor_->setOpaque(true);
+            editor_->setVisible(true);
+        }
+
+        // draw editor component onto image.
+        Graphics g(image_);
+        editor_->paintEntireComponent(g, true);
+        Image::BitmapData bitmap(image_, Image::BitmapData::readOnly);
+        memcpy(buffer, bitmap.data, width * height * 4);
+    }
+
+    void buttonPressed(int n, bool val) {
+        if (ssp_ && n >= 0 && n < SSP_LastBtn) buttonHandlers[n](*ssp_, n, val);
+    }
+
+    void encoderPressed(int n, bool val) {
+        if (ssp_) ssp_->onEncoderSwitch(n, val);
+    }
+
+    // audio thread
+    void encoderTurned(int n, int val) {
+        if (ssp_) ssp_->onEncoder(n, (float) val);
+    }
+
+    void memoryUsage(Percussa::SSP::MemoryUsage &usage) const {
+        if (ssp_) usage.uiBytes += ssp_->memoryBytes();
+        if (image_.isValid()) usage.sharedBytes += (size_t) image_.getWidth() * image_.getHeight() * 4;
+    }
+
+private:
+    AudioProcessorEditor *editor_;
+    SSPEditor *ssp_;
+    // shared with the other instances (see SSP_SharedImages), kept here to
+    // skip the lookup on every frame. only held while visible.
+    Image image_;
+};
+
+
+
+class SSP_PluginInterface : public Percussa::SSP::PluginInterface,
+                            private AudioProcessorParameter::Listener {
+public:
+    SSP_PluginInterface(AudioProcessor *p) :
+        editor_(new SSP_PluginEditorInterface(p)), processor_(p), ssp_(dynamic_cast<SSPProcessor *>(p)) {
+        for (auto *param: processor_->getParameters()) {
+            auto *ranged = dynamic_cast<RangedAudioParameter *>(param);
+            if (ranged) parameters_[ranged->paramID] = ranged;
+        }
+        if (ssp_ && ssp_->parametersAreState()) {
+            versions_.reset(new Percussa::SSP::ValueVersions(processor_->getParameters().size()));
+            for (auto *param: processor_->getParameters()) param->addListener(this);
+        }
+    }
+
+    ~SSP_PluginInterface() {
+        if (versions_) {
+            for (auto *param: processor_->getParameters()) param->removeListener(this);
+        }
+        if(editor_) delete editor_;
+        if(processor_) delete processor_;
+    }
+
+
+    Percussa::SSP::PluginEditorInterface *getEditor() override {
+        return editor_;
+    }
+
+    void buttonPressed(int n, bool val) override {
+        editor_->buttonPressed(n, val);
+    }
+
+    void encoderPressed(int n, bool val) override {
+        editor_->encoderPressed(n, val);
+    }
+
+    // audio thread, older hosts call this before process()
+    void encoderTurned(int n, int val) override {
+        enterAudioThread();
+        editor_->encoderTurned(n, val);
+    }
+
+    void inputEnabled(int n, bool val) override {
+        if (ssp_) ssp_->onInputChanged(n, val);
+    }
+
+    void outputEnabled(int n, bool val) override {
+        if (ssp_) ssp_->onOutputChanged(n, val);
+    }
+
+    void getState(void **buffer, size_t *size) override {
+        // getStateInformation() expects an empty block, and the host deletes the
+        // buffer with delete[], so this copy stays. it is on the UI thread.
+        MemoryBlock state;
+        if (versions_) versions_->saved(ParameterValue{processor_->getParameters()});
+        processor_->getStateInformation(state);
+        *size = state.getSize();
+        *buffer = new char[*size];
+        state.copyTo(*buffer, 0, *size);
+    }
+
+    void setState(void *buffer, size_t size) override {
+        processor_->setStateInformation(buffer, (int) size);
+        if (versions_) versions_->changed();
+    }
+
+    bool prepareState(const void *buffer, size_t size) override {
+        // decode on the calling (background) thread, the audio thread
+        // applies the parameter values at the start of the next block.
+        std::unique_ptr<XmlElement> xml(AudioProcessor::getXmlFromBinary(buffer, (int) size));
+        ParameterValues values;
+        if (!xml || !decodeParameters(*xml, values) || values.empty()) return false;
+        staged_.stage(std::move(values));
+        return true;
+    }
+
+    void setHostServices(const Percussa::SSP::HostServices *services) override {
+        if (!ssp_) return;
+        ssp_->setMemoryArena(services && services->version >= 2 ? services->arena : nullptr);
+        ssp_->setThreadRegistry(services && services->version >= 3 ? services->threads : nullptr);
+        ssp_->setDiskStreamer(services && services->version >= 4 ? services->streamer : nullptr);
+        ssp_->setAssetStore(services && services->version >= 5 ? services->assets : nullptr);
+    }
+
+    void prepare(double sampleRate, int samplesPerBlock) override {
+        unsigned numIn = processor_->getBusCount(true);
+        unsigned numOut = processor_->getBusCount(false);
+        processor_->setPlayConfigDetails(
+            numIn,
+            numOut,
+            sampleRate,
+            samplesPerBlock);
+
+        processor_->prepareToPlay(sampleRate, samplesPerBlock);
+        stats_.prepare(sampleRate, samplesPerBlock);
+        maxBlockSize_ = samplesPerBlock;
+    }
+
+    bool reconfigure(double sampleRate, int samplesPerBlock) override {
+        // JUCE processors accept any block size up to the prepared one already,
+        // a new sample rate needs the processor's consent
+        if (samplesPerBlock > maxBlockSize_) return false;
+        if (sampleRate != processor_->getSampleRate()
+            && !(ssp_ && ssp_->onReconfigure(sampleRate, samplesPerBlock))) {
+            return false;
+        }
+        processor_->setRateAndBufferSizeDetails(sampleRate, samplesPerBlock);
+        stats_.prepare(sampleRate, samplesPerBlock);
+        return true;
+    }
+
+    void process(float **channelData, int numChannels, int numSamples) override {
+        processEvents(channelData, numChannels, numSamples, nullptr, 0);
+    }
+
+    void processEvents(float **channelData, int numChannels, int numSamples,
+                       const Percussa::SSP::Event *events, int numEvents) override {
+        Percussa::SSP::StatsRecorder::Scope scope(stats_, numSamples);
+        SSP_PROFILE_ZONE("process");
+        enterAudioThread();
+        // notifies the listeners, so the processor sees the new values, and
+        // they are in the processor's next getStateInformation()
+        staged_.apply([](const ParameterValues &values) {
+            for (auto &v: values) v.first->setValueNotifyingHost(v.second);
+        });
+        // encoder turns take effect at their offset in the block, the block is
+        // split there (in steps of EVENT_GRANULARITY samples).
+        // both wrappers are reused, referring to the host's channels does not
+        // allocate (up to 32 channels), and clear() keeps the midi buffer's storage
+        Percussa::SSP::splitBlock(channelData, numChannels, numSamples, events, numEvents,
+            [this](const Percussa::SSP::Event &e) {
+                if (e.type == Percussa::SSP::Event::ENCODER_TURNED) encoderTurned(e.index, e.value);
+            },
+            [this](float **data, int channels, int samples) {
+                buffer_.setDataToReferTo(data, channels, samples);
+                midiBuffer_.clear();
+                processor_->processBlock(buffer_, midiBuffer_);
+            },
+            EVENT_GRANULARITY);
+        if (ssp_ && ssp_->skipped_) {
+            stats_.skipped(ssp_->skipped_);
+            ssp_->skipped_ = 0;
+        }
+    }
+
+    Percussa::SSP::PluginStats *getStats() override {
+        return stats_.stats();
+    }
+
+    bool getMemoryUsage(Percussa::SSP::MemoryUsage &usage) override {
+        usage = Percussa::SSP::MemoryUsage();
+        if (ssp_) usage.dspBytes = ssp_->memoryBytes();
+        editor_->memoryUsage(usage);
+        return true;
+    }
+
+    bool reset() override {
+        // drop a state staged for the previous module, it would be applied to the next
+        staged_.apply([](const ParameterValues &) {});
+        staged_.collect();
+        for (auto *param: processor_->getParameters()) param->setValueNotifyingHost(param->getDefaultValue());
+        processor_->reset();
+        return ssp_ && ssp_->onReset();
+    }
+
+    uint64_t stateVersion() override {
+        return versions_ ? versions_->version() : 0;
+    }
+
+    bool getStateDelta(uint64_t since, void **buffer, size_t *size, uint64_t *version) override {
+        return versions_ && versions_->delta(since, ParameterValue{processor_->getParameters()}, buffer, size, version);
+    }
+
+    bool applyStateDelta(const void *buffer, size_t size) override {
+        auto &params = processor_->getParameters();
+        // notifies the listeners, as a change from the editor would
+        return versions_ && versions_->apply(buffer, size, [&params](size_t i, float value) {
+            params[(int) i]->setValueNotifyingHost(value);
+        });
+    }
+
+private:
+    static constexpr int EVENT_GRANULARITY = 16;
+
+    // the normalised value of a parameter, by index, as versions_ stores them
+    struct ParameterValue {
+        const Array<AudioProcessorParameter *> &params;
+        float operator()(size_t i) const { return params[(int) i]->getValue(); }
+    };
+
+    // the host may move processing to another thread, e.g. a new audio device
+    void enterAudioThread() {
+        if (ssp_) ssp_->audioThread_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    }
+
+    // any thread, parameter changes of plugins versioning their state
+    void parameterValueChanged(int, float) override { versions_->changed(); }
+    void parameterGestureChanged(int, bool) override {}
+
+    using ParameterValues = std::vector<std::pair<RangedAudioParameter *, float>>;
+
+    // collects the normalised parameter values from an AudioProcessorValueTreeState
+    // state (<PARAM id="..." value="..."/> elements). returns false if the state
+    // contains anything else, a staged load would lose that, so setState() is
+    // used for it instead.
+    bool decodeParameters(const XmlElement &xml, ParameterValues &values) {
+        for (int i = 0; i < xml.getNumChildElements(); i++) {
+            const XmlElement *e = xml.getChildElement(i);
+            if (e->hasTagName("PARAM")) {
+                auto it = parameters_.find(e->getStringAttribute("id"));
+                if (it == parameters_.end() || !e->hasAttribute("value")) return false;
+                auto *param = it->second;
+                values.emplace_back(param, param->convertTo0to1((float) e->getDoubleAttribute("value")));
+            } else if (e->getNumChildElements() > 0) {
+                if (!decodeParameters(*e, values)) return false;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    SSP_PluginEditorInterface *editor_ = nullptr;
+    AudioProcessor *processor_ = nullptr;
+    SSPProcessor *ssp_ = nullptr;
+    AudioSampleBuffer buffer_;
+    MidiBuffer midiBuffer_;
+    int maxBlockSize_ = 0;
+    std::map<String, RangedAudioParameter *> parameters_;
+    Percussa::SSP::StagedState<ParameterValues> staged_;
+    // only for plugins whose parameters are their state
+    std::unique_ptr<Percussa::SSP::ValueVersions> versions_;
+    Percussa::SSP::StatsRecorder stats_;
+};
+
+
+namespace {
+
+// bus names of the plugin. they come from an instance of the processor,
+// so one is created on first use, and the names are kept for later calls.
+struct BusNames {
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+
+    BusNames() {
+        std::unique_ptr<AudioProcessor> processor(SSP_PLUGIN_FILTER());
+        for (int i = 0; i < processor->getBusCount(true); i++) {
+            inputs.push_back(processor->getBus(true, i)->getName().toStdString());
+        }
+        for (int i = 0; i < processor->getBusCount(false); i++) {
+            outputs.push_back(processor->getBus(false, i)->getName().toStdString());
+        }
+    }
+};
+
+
+Percussa::SSP::PluginDescriptor *createJuceDescriptor() {
+    static const BusNames busNames;
+
+    auto desc = new Percussa::SSP::PluginDescriptor;
+
+    desc->name = JucePlugin_Name;
+    desc->descriptiveName = JucePlugin_Desc;
+    desc->manufacturerName = JucePlugin_Manufacturer;
+    desc->version = JucePlugin_VersionString;
+    desc->uid = (int) JucePlugin_VSTUniqueID;
+    desc->inputChannelNames = busNames.inputs;
+    desc->outputChannelNames = busNames.outputs;
+
+    return desc;
+}
+
+
+Percussa::SSP::PluginInterface *createJuceInstance() {
+    return new SSP_PluginInterface(SSP_PLUGIN_FILTER());
+}
+
+}
+
+
+SSP_PLUGIN_EXPORT(createJuceDescriptor, createJuceInstance)
+
+SSP_PROFILE_EXPORT()
@@ -0,0 +1,804 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC.
+
+	This software is part of the Percussa SSP's software development kit (SDK).
+	For more info about Percussa or the SSP visit http://www.percussa.com/
+	and our forum at http://forum.percussa.com/
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+// stand-in for the JUCE headers, for the checks of the adapter (see
+// ../CMakeLists.txt), with the same signatures as JUCE. it only defines what
+// the adapter, the check plugin and qvca use: parameters hold a value and call
+// their listeners, buffers refer to the host's channels or own their samples,
+// the value tree state saves the parameters as <PARAM id="..." value="..."/>
+// elements, and images hold pixels. lines and rectangles are drawn without
+// anti-aliasing, text is not drawn, and timers never fire.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define JUCE_CALLTYPE
+#define jassert(expression) assert(expression)
+#define juce_UseDebuggingNewOperator
+#define JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(className) \
+    className(const className &) = delete;                        \
+    className &operator=(const className &) = delete;
+
+namespace juce {
+
+using uint8 = uint8_t;
+using int64 = int64_t;
+
+// core
+
+class String {
+public:
+    String() = default;
+    String(const char *s) : s_(s ? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    explicit String(int value) : s_(std::to_string(value)) {}
+
+    const char *toRawUTF8() const { return s_.c_str(); }
+    std::string toStdString() const { return s_; }
+    double getDoubleValue() const { return std::strtod(s_.c_str(), nullptr); }
+
+    friend String operator+(const String &a, const String &b) { return a.s_ + b.s_; }
+    friend bool operator==(const String &a, const String &b) { return a.s_ == b.s_; }
+    friend bool operator<(const String &a, const String &b) { return a.s_ < b.s_; }
+
+private:
+    std::string s_;
+};
+
+template<typename T>
+class Array {
+public:
+    void add(const T &v) { items_.push_back(v); }
+    int size() const { return (int) items_.size(); }
+    T operator[](int i) const { return items_[(size_t) i]; }
+    typename std::vector<T>::const_iterator begin() const { return items_.begin(); }
+    typename std::vector<T>::const_iterator end() const { return items_.end(); }
+
+private:
+    std::vector<T> items_;
+};
+
+class MemoryBlock {
+public:
+    size_t getSize() const { return data_.size(); }
+    void append(const void *data, size_t size) {
+        const char *p = static_cast<const char *>(data);
+        data_.insert(data_.end(), p, p + size);
+    }
+    void copyTo(void *dest, int sourceOffset, size_t size) const {
+        jassert(sourceOffset >= 0 && sourceOffset + size <= data_.size());
+        memcpy(dest, data_.data() + sourceOffset, size);
+    }
+
+private:
+    std::vector<char> data_;
+};
+
+class XmlElement {
+public:
+    explicit XmlElement(const String &tagName) : tag_(tagName) {}
+    XmlElement(const XmlElement &other) : tag_(other.tag_), attributes_(other.attributes_) {
+        for (auto &c: other.children_) children_.emplace_back(new XmlElement(*c));
+    }
+
+    const String &getTagName() const { return tag_; }
+    bool hasTagName(const String &name) const { return tag_ == name; }
+
+    int getNumChildElements() const { return (int) children_.size(); }
+    XmlElement *getChildElement(int i) const { return children_[(size_t) i].get(); }
+    XmlElement *getChildByName(const String &name) const {
+        for (auto &c: children_) {
+            if (c->hasTagName(name)) return c.get();
+        }
+        return nullptr;
+    }
+    void addChildElement(XmlElement *child) { children_.emplace_back(child); }
+    XmlElement *createNewChildElement(const String &name) {
+        addChildElement(new XmlElement(name));
+        return children_.back().get();
+    }
+
+    bool hasAttribute(const String &name) const { return find(name) != nullptr; }
+    String getStringAttribute(const String &name) const {
+        const String *v = find(name);
+        return v ? *v : String();
+    }
+    double getDoubleAttribute(const String &name, double defaultValue = 0.0) const {
+        const String *v = find(name);
+        return v ? v->getDoubleValue() : defaultValue;
+    }
+    void setAttribute(const String &name, const String &value) { attributes_.emplace_back(name, value); }
+    void setAttribute(const String &name, double value) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.9g", value);
+        setAttribute(name, String(text));
+    }
+
+private:
+    friend class AudioProcessor;
+
+    const String *find(const String &name) const {
+        for (auto &a: attributes_) {
+            if (a.first == name) return &a.second;
+        }
+        return nullptr;
+    }
+
+    // counts and length prefixed strings, not JUCE's xml text: the adapter
+    // only relies on AudioProcessor::getXmlFromBinary() reading it back
+    static void write(uint32_t n, MemoryBlock &out) { out.append(&n, sizeof(n)); }
+    static void write(const String &s, MemoryBlock &out) {
+        write((uint32_t) strlen(s.toRawUTF8()), out);
+        out.append(s.toRawUTF8(), strlen(s.toRawUTF8()));
+    }
+    void write(MemoryBlock &out) const {
+        write(tag_, out);
+        write((uint32_t) attributes_.size(), out);
+        for (auto &a: attributes_) {
+            write(a.first, out);
+            write(a.second, out);
+        }
+        write((uint32_t) children_.size(), out);
+        for (auto &c: children_) c->write(out);
+    }
+
+    static bool read(const char *&p, const char *end, uint32_t &n) {
+        if ((size_t) (end - p) < sizeof(n)) return false;
+        memcpy(&n, p, sizeof(n));
+        p += sizeof(n);
+        return true;
+    }
+    static bool read(const char *&p, const char *end, String &s) {
+        uint32_t size;
+        if (!read(p, end, size) || (size_t) (end - p) < size) return false;
+        s = std::string(p, size);
+        p += size;
+        return true;
+    }
+    static XmlElement *read(const char *&p, const char *end) {
+        String tag, name, value;
+        uint32_t count;
+        if (!read(p, end, tag) || !read(p, end, count)) return nullptr;
+        std::unique_ptr<XmlElement> e(new XmlElement(tag));
+        for (; count > 0; count--) {
+            if (!read(p, end, name) || !read(p, end, value)) return nullptr;
+            e->setAttribute(name, value);
+        }
+        if (!read(p, end, count)) return nullptr;
+        for (; count > 0; count--) {
+            XmlElement *child = read(p, end);
+            if (!child) return nullptr;
+            e->addChildElement(child);
+        }
+        return e.release();
+    }
+
+    String tag_;
+    std::vector<std::pair<String, String>> attributes_;
+    std::vector<std::unique_ptr<XmlElement>> children_;
+};
+
+// audio basics
+
+template<typename T>
+class AudioBuffer {
+public:
+    int getNumChannels() const { return numChannels_; }
+    int getNumSamples() const { return numSamples_; }
+
+    // without allocating, into space for the channels like JUCE's
+    void setDataToReferTo(T *const *data, int numChannels, int numSamples) {
+        jassert(numChannels >= 0 && numChannels <= MAX_CHANNELS && numSamples >= 0);
+        std::copy(data, data + numChannels, channels_);
+        numChannels_ = numChannels;
+        numSamples_ = numSamples;
+    }
+
+    void clear() {
+        for (int ch = 0; ch < numChannels_; ch++) std::fill(channels_[ch], channels_[ch] + numSamples_, T());
+    }
+
+    T *getWritePointer(int ch) { return channels_[(size_t) ch]; }
+    const T *getReadPointer(int ch) const { return channels_[(size_t) ch]; }
+
+    // owns its samples from here on, the content is not kept
+    void setSize(int numChannels, int numSamples, bool = false, bool clearExtraSpace = false,
+                 bool avoidReallocating = false) {
+        jassert(numChannels >= 0 && numChannels <= MAX_CHANNELS && numSamples >= 0);
+        const size_t size = (size_t) numChannels * numSamples;
+        if (!avoidReallocating || storage_.size() < size) storage_.resize(size);
+        if (clearExtraSpace) std::fill(storage_.begin(), storage_.end(), T());
+        for (int ch = 0; ch < numChannels; ch++) channels_[ch] = storage_.data() + (size_t) ch * numSamples;
+        numChannels_ = numChannels;
+        numSamples_ = numSamples;
+    }
+
+    T getSample(int ch, int i) const { return channels_[ch][i]; }
+    void setSample(int ch, int i, T value) { channels_[ch][i] = value; }
+
+    void copyFrom(int destChannel, int destStart, const AudioBuffer &source, int sourceChannel, int sourceStart,
+                  int numSamples) {
+        jassert(destStart >= 0 && destStart + numSamples <= numSamples_);
+        jassert(sourceStart >= 0 && sourceStart + numSamples <= source.numSamples_);
+        const T *src = source.channels_[sourceChannel] + sourceStart;
+        std::copy(src, src + numSamples, channels_[destChannel] + destStart);
+    }
+
+    void applyGain(int ch, int start, int numSamples, T gain) {
+        for (int i = start; i < start + numSamples; i++) channels_[ch][i] *= gain;
+    }
+
+private:
+    static constexpr int MAX_CHANNELS = 32;
+    T *channels_[MAX_CHANNELS]{};
+    std::vector<T> storage_;
+    int numChannels_ = 0;
+    int numSamples_ = 0;
+};
+
+using AudioSampleBuffer = AudioBuffer<float>;
+
+class MidiBuffer {
+public:
+    void clear() {}
+};
+
+class AudioChannelSet {
+public:
+    static AudioChannelSet mono() { return AudioChannelSet(); }
+};
+
+// parameters
+
+class AudioProcessorParameter {
+public:
+    virtual ~AudioProcessorParameter() = default;
+
+    // normalised, 0 .. 1
+    virtual float getValue() const = 0;
+    virtual void setValue(float newValue) = 0;
+    virtual float getDefaultValue() const = 0;
+    virtual String getCurrentValueAsText() const = 0;
+
+    void setValueNotifyingHost(float newValue) {
+        setValue(newValue);
+        for (Listener *l: listeners_) l->parameterValueChanged(index_, newValue);
+    }
+    void beginChangeGesture() {
+        for (Listener *l: listeners_) l->parameterGestureChanged(index_, true);
+    }
+    void endChangeGesture() {
+        for (Listener *l: listeners_) l->parameterGestureChanged(index_, false);
+    }
+
+    struct Listener {
+        virtual ~Listener() = default;
+        virtual void parameterValueChanged(int parameterIndex, float newValue) = 0;
+        virtual void parameterGestureChanged(int parameterIndex, bool gestureIsStarting) = 0;
+    };
+
+    int getParameterIndex() const { return index_; }
+
+    void addListener(Listener *l) { listeners_.push_back(l); }
+    void removeListener(Listener *l) { listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), l), listeners_.end()); }
+
+private:
+    friend class AudioProcessor;
+    int index_ = -1;
+    std::vector<Listener *> listeners_;
+};
+
+class RangedAudioParameter : public AudioProcessorParameter {
+public:
+    RangedAudioParameter(const String &parameterID, float minValue, float maxValue) :
+        paramID(parameterID), min_(minValue), max_(maxValue) {}
+
+    float convertTo0to1(float v) const { return (std::min(max_, std::max(min_, v)) - min_) / (max_ - min_); }
+    float convertFrom0to1(float v) const { return min_ + std::min(1.0f, std::max(0.0f, v)) * (max_ - min_); }
+
+    const String paramID;
+
+private:
+    const float min_, max_;
+};
+
+class AudioParameterFloat : public RangedAudioParameter {
+public:
+    AudioParameterFloat(const String &parameterID, const String &, float minValue, float maxValue,
+                        float defaultValue) :
+        RangedAudioParameter(parameterID, minValue, maxValue),
+        value_(defaultValue), default_(convertTo0to1(defaultValue)) {}
+
+    float get() const { return value_.load(std::memory_order_relaxed); }
+    float getValue() const override { return convertTo0to1(get()); }
+    void setValue(float newValue) override { value_.store(convertFrom0to1(newValue), std::memory_order_relaxed); }
+    float getDefaultValue() const override { return default_; }
+    String getCurrentValueAsText() const override { return std::to_string(get()); }
+
+private:
+    std::atomic<float> value_;
+    const float default_;
+};
+
+// processor and editor
+
+class AudioProcessorEditor;
+
+class AudioProcessor {
+public:
+    struct BusesProperties {
+        std::vector<String> inputs;
+        std::vector<String> outputs;
+
+        void addBus(bool isInput, const String &name, const AudioChannelSet &, bool = true) {
+            (isInput ? inputs : outputs).push_back(name);
+        }
+    };
+
+    class Bus {
+    public:
+        explicit Bus(const String &name) : name_(name) {}
+        const String &getName() const { return name_; }
+
+    private:
+        String name_;
+    };
+
+    explicit AudioProcessor(const BusesProperties &props) {
+        for (auto &name: props.inputs) inputs_.emplace_back(new Bus(name));
+        for (auto &name: props.outputs) outputs_.emplace_back(new Bus(name));
+    }
+    virtual ~AudioProcessor() {
+        for (auto *p: parameters_) delete p;
+    }
+
+    virtual const String getName() const = 0;
+    virtual void prepareToPlay(double sampleRate, int maximumExpectedSamplesPerBlock) = 0;
+    virtual void releaseResources() = 0;
+    virtual void processBlock(AudioBuffer<float> &buffer, MidiBuffer &midiMessages) = 0;
+    virtual void reset() {}
+    virtual AudioProcessorEditor *createEditor() = 0;
+    virtual bool hasEditor() const = 0;
+    virtual bool acceptsMidi() const = 0;
+    virtual bool producesMidi() const = 0;
+    virtual bool silenceInProducesSilenceOut() const { return false; }
+    virtual double getTailLengthSeconds() const = 0;
+    virtual int getNumPrograms() = 0;
+    virtual int getCurrentProgram() = 0;
+    virtual void setCurrentProgram(int index) = 0;
+    virtual const String getProgramName(int index) = 0;
+    virtual void changeProgramName(int index, const String &newName) = 0;
+    virtual void getStateInformation(MemoryBlock &destData) = 0;
+    virtual void setStateInformation(const void *data, int sizeInBytes) = 0;
+
+    int getBusCount(bool isInput) const { return (int) (isInput ? inputs_ : outputs_).size(); }
+    Bus *getBus(bool isInput, int index) const { return (isInput ? inputs_ : outputs_)[(size_t) index].get(); }
+
+    void setPlayConfigDetails(int, int, double sampleRate, int blockSize) {
+        setRateAndBufferSizeDetails(sampleRate, blockSize);
+    }
+    void setRateAndBufferSizeDetails(double sampleRate, int) { sampleRate_ = sampleRate; }
+    double getSampleRate() const { return sampleRate_; }
+
+    void addParameter(AudioProcessorParameter *p) {
+        p->index_ = parameters_.size();
+        parameters_.add(p);
+    }
+    const Array<AudioProcessorParameter *> &getParameters() const { return parameters_; }
+
+    static void copyXmlToBinary(const XmlElement &xml, MemoryBlock &destData) { xml.write(destData); }
+    static std::unique_ptr<XmlElement> getXmlFromBinary(const void *data, int sizeInBytes) {
+        const char *p = static_cast<const char *>(data);
+        return std::unique_ptr<XmlElement>(p ? XmlElement::read(p, p + sizeInBytes) : nullptr);
+    }
+
+private:
+    std::vector<std::unique_ptr<Bus>> inputs_;
+    std::vector<std::unique_ptr<Bus>> outputs_;
+    Array<AudioProcessorParameter *> parameters_;
+    double sampleRate_ = 0.0;
+
+    AudioProcessor(const AudioProcessor &) = delete;
+    AudioProcessor &operator=(const AudioProcessor &) = delete;
+};
+
+// graphics, nothing is drawn
+
+template<typename T>
+class Rectangle {
+public:
+    Rectangle() = default;
+    Rectangle(T x, T y, T w, T h) : x_(x), y_(y), w_(w), h_(h) {}
+    T getX() const { return x_; }
+    T getY() const { return y_; }
+    T getWidth() const { return w_; }
+    T getHeight() const { return h_; }
+
+private:
+    T x_ = 0, y_ = 0, w_ = 0, h_ = 0;
+};
+
+// ARGB pixels, shared by the copies of an image as in JUCE
+class Image {
+public:
+    enum PixelFormat { UnknownFormat, RGB, ARGB, SingleChannel };
+
+    Image() = default;
+    Image(PixelFormat, int width, int height, bool) :
+        pixels_(std::make_shared<std::vector<uint8>>((size_t) width * height * 4, 0)), width_(width), height_(height) {}
+
+    bool isValid() const { return pixels_ != nullptr; }
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    int getReferenceCount() const { return (int) pixels_.use_count(); }
+
+    class BitmapData {
+    public:
+        enum ReadWriteMode { readOnly, writeOnly, readWrite };
+        BitmapData(const Image &image, ReadWriteMode) : data(image.pixels_ ? image.pixels_->data() : nullptr) {}
+        uint8 *data;
+    };
+
+private:
+    std::shared_ptr<std::vector<uint8>> pixels_;
+    int width_ = 0, height_ = 0;
+};
+
+class Colour {
+public:
+    Colour() = default;
+    Colour(uint8 r, uint8 g, uint8 b) : argb_(0xff000000u | (uint32_t) r << 16 | (uint32_t) g << 8 | b) {}
+    uint32_t getARGB() const { return argb_; }
+
+private:
+    uint32_t argb_ = 0;
+};
+
+namespace Colours {
+static const Colour black(0, 0, 0), grey(128, 128, 128), red(255, 0, 0), white(255, 255, 255);
+}
+
+class Font {
+public:
+    enum FontStyleFlags { plain = 0 };
+    Font(const String &, float, int) {}
+    static const String getDefaultMonospacedFontName() { return "monospace"; }
+};
+
+class Justification {
+public:
+    enum Flags { centred = 36 };
+    Justification(int) {}
+};
+
+// draws into the pixels of an image, one pixel wide, in whole pixels
+class Graphics {
+public:
+    explicit Graphics(const Image &image) :
+        pixels_(Image::BitmapData(image, Image::BitmapData::readWrite).data), width_(image.getWidth()) {
+        state_.clip = Rectangle<int>(0, 0, image.getWidth(), image.getHeight());
+    }
+
+    void saveState() { saved_.push_back(state_); }
+    void restoreState() {
+        state_ = saved_.back();
+        saved_.pop_back();
+    }
+    void setOrigin(int x, int y) {
+        state_.x += x;
+        state_.y += y;
+    }
+    void reduceClipRegion(int x, int y, int w, int h) {
+        const Rectangle<int> &c = state_.clip;
+        const int x0 = std::max(c.getX(), state_.x + x), y0 = std::max(c.getY(), state_.y + y);
+        const int x1 = std::min(c.getX() + c.getWidth(), state_.x + x + w);
+        const int y1 = std::min(c.getY() + c.getHeight(), state_.y + y + h);
+        state_.clip = Rectangle<int>(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+    }
+
+    void setColour(const Colour &colour) { state_.colour = colour; }
+    void setFont(const Font &) {}
+
+    void fillAll(const Colour &colour) {
+        const Colour current = state_.colour;
+        state_.colour = colour;
+        fill(state_.clip.getX(), state_.clip.getY(), state_.clip.getWidth(), state_.clip.getHeight());
+        state_.colour = current;
+    }
+    void fillRect(float x, float y, float w, float h) {
+        fill(state_.x + (int) x, state_.y + (int) y, (int) w, (int) h);
+    }
+    void drawRect(float x, float y, float w, float h, float = 1.0f) {
+        fillRect(x, y, w, 1.0f);
+        fillRect(x, y + h - 1.0f, w, 1.0f);
+        fillRect(x, y, 1.0f, h);
+        fillRect(x + w - 1.0f, y, 1.0f, h);
+    }
+    void drawLine(float x1, float y1, float x2, float y2, float) {
+        const int steps = std::max(1, (int) std::max(std::abs(x2 - x1), std::abs(y2 - y1)));
+        for (int i = 0; i <= steps; i++) {
+            fillRect(x1 + (x2 - x1) * i / steps, y1 + (y2 - y1) * i / steps, 1.0f, 1.0f);
+        }
+    }
+
+    // text is not drawn
+    void drawText(const String &, int, int, int, int, Justification, bool = true) {}
+    void drawFittedText(const String &, int, int, int, int, Justification, int, float = 0.0f) {}
+    void drawMultiLineText(const String &, int, int, int) {}
+
+private:
+    struct State {
+        int x = 0, y = 0;
+        Rectangle<int> clip;
+        Colour colour;
+    };
+
+    void fill(int x, int y, int w, int h) {
+        const Rectangle<int> &c = state_.clip;
+        const int x0 = std::max(x, c.getX()), x1 = std::min(x + w, c.getX() + c.getWidth());
+        const int y0 = std::max(y, c.getY()), y1 = std::min(y + h, c.getY() + c.getHeight());
+        const uint32_t argb = state_.colour.getARGB();
+        for (int py = y0; py < y1; py++) {
+            for (int px = x0; px < x1; px++) memcpy(pixels_ + ((size_t) py * width_ + px) * 4, &argb, 4);
+        }
+    }
+
+    uint8 *pixels_;
+    int width_;
+    State state_;
+    std::vector<State> saved_;
+};
+
+class Component {
+public:
+    Component() = default;
+    virtual ~Component() = default;
+
+    virtual void paint(Graphics &) {}
+    virtual void resized() {}
+
+    void setBounds(Rectangle<int> r) {
+        bounds_ = r;
+        resized();
+    }
+    int getWidth() const { return bounds_.getWidth(); }
+    int getHeight() const { return bounds_.getHeight(); }
+    void setVisible(bool visible) { visible_ = visible; }
+    bool isVisible() const { return visible_; }
+    void setOpaque(bool) {}
+    void paintEntireComponent(Graphics &g, bool) {
+        paint(g);
+        for (Component *c: children_) {
+            if (!c->isVisible()) continue;
+            g.saveState();
+            g.setOrigin(c->bounds_.getX(), c->bounds_.getY());
+            g.reduceClipRegion(0, 0, c->getWidth(), c->getHeight());
+            c->paintEntireComponent(g, true);
+            g.restoreState();
+        }
+    }
+
+    void setBounds(int x, int y, int width, int height) { setBounds(Rectangle<int>(x, y, width, height)); }
+    void setSize(int width, int height) { setBounds(bounds_.getX(), bounds_.getY(), width, height); }
+    Rectangle<int> getBounds() const { return bounds_; }
+    // the host renders the editor every frame anyway
+    void repaint() {}
+    // the children are not owned
+    void addChildComponent(Component *child) { children_.push_back(child); }
+    void addAndMakeVisible(Component *child) {
+        addChildComponent(child);
+        child->setVisible(true);
+    }
+
+private:
+    Rectangle<int> bounds_;
+    bool visible_ = false;
+    std::vector<Component *> children_;
+
+    Component(const Component &) = delete;
+    Component &operator=(const Component &) = delete;
+};
+
+class AudioProcessorEditor : public Component {
+public:
+    explicit AudioProcessorEditor(AudioProcessor *) {}
+};
+
+// the rest of what qvca uses
+
+template<typename T>
+class OwnedArray {
+public:
+    T *add(T *item) {
+        items_.emplace_back(item);
+        return item;
+    }
+    int size() const { return (int) items_.size(); }
+    T *operator[](int i) const { return items_[(size_t) i].get(); }
+
+private:
+    std::vector<std::unique_ptr<T>> items_;
+};
+
+struct FloatVectorOperations {
+    static void multiply(float *dest, const float *src, int num) {
+        for (int i = 0; i < num; i++) dest[i] *= src[i];
+    }
+};
+
+// recursive, as JUCE's
+class CriticalSection {
+public:
+    void enter() const { mutex_.lock(); }
+    bool tryEnter() const { return mutex_.try_lock(); }
+    void exit() const { mutex_.unlock(); }
+
+private:
+    mutable std::recursive_mutex mutex_;
+};
+
+class ScopedLock {
+public:
+    explicit ScopedLock(const CriticalSection &lock) : lock_(lock) { lock_.enter(); }
+    ~ScopedLock() { lock_.exit(); }
+
+private:
+    const CriticalSection &lock_;
+
+    ScopedLock(const ScopedLock &) = delete;
+    ScopedLock &operator=(const ScopedLock &) = delete;
+};
+
+class UndoManager;
+
+class Identifier {
+public:
+    Identifier(const char *name) : name_(name) {}
+    Identifier(const String &name) : name_(name) {}
+    operator String() const { return name_; }
+
+private:
+    String name_;
+};
+
+// kept as the xml it converts to
+class ValueTree {
+public:
+    ValueTree() = default;
+    explicit ValueTree(const Identifier &type) : xml_(std::make_shared<XmlElement>(type)) {}
+
+    Identifier getType() const { return xml_ ? xml_->getTagName() : String(); }
+    std::unique_ptr<XmlElement> createXml() const {
+        return std::unique_ptr<XmlElement>(xml_ ? new XmlElement(*xml_) : nullptr);
+    }
+    static ValueTree fromXml(const XmlElement &xml) {
+        ValueTree tree;
+        tree.xml_ = std::make_shared<XmlElement>(xml);
+        return tree;
+    }
+
+private:
+    std::shared_ptr<XmlElement> xml_;
+};
+
+// the parameters are the state: copyState() saves their values, and
+// replaceState() sets them, notifying the host. the processor owns them.
+class AudioProcessorValueTreeState : private AudioProcessorParameter::Listener {
+public:
+    struct Listener {
+        virtual ~Listener() = default;
+        virtual void parameterChanged(const String &parameterID, float newValue) = 0;
+    };
+
+    class ParameterLayout {
+    public:
+        template<typename Param>
+        void add(std::unique_ptr<Param> param) { params_.emplace_back(std::move(param)); }
+
+    private:
+        friend class AudioProcessorValueTreeState;
+        std::vector<std::unique_ptr<RangedAudioParameter>> params_;
+    };
+
+    AudioProcessorValueTreeState(AudioProcessor &processor, UndoManager *, const Identifier &valueTreeType,
+                                 ParameterLayout layout) : state(valueTreeType) {
+        for (auto &p: layout.params_) {
+            p->addListener(this);
+            params_.push_back(p.get());
+            processor.addParameter(p.release());
+        }
+    }
+    ~AudioProcessorValueTreeState() override {
+        for (auto *p: params_) p->removeListener(this);
+    }
+
+    RangedAudioParameter *getParameter(const String &parameterID) const {
+        for (auto *p: params_) {
+            if (p->paramID == parameterID) return p;
+        }
+        return nullptr;
+    }
+
+    void addParameterListener(const String &parameterID, Listener *l) { listeners_.emplace_back(parameterID, l); }
+    void removeParameterListener(const String &parameterID, Listener *l) {
+        listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), std::make_pair(parameterID, l)),
+                         listeners_.end());
+    }
+
+    ValueTree copyState() {
+        XmlElement xml(state.getType());
+        for (auto *p: params_) {
+            XmlElement *param = xml.createNewChildElement("PARAM");
+            param->setAttribute("id", p->paramID);
+            param->setAttribute("value", p->convertFrom0to1(p->getValue()));
+        }
+        return ValueTree::fromXml(xml);
+    }
+
+    void replaceState(const ValueTree &tree) {
+        std::unique_ptr<XmlElement> xml = tree.createXml();
+        for (int i = 0; xml && i < xml->getNumChildElements(); i++) {
+            const XmlElement *e = xml->getChildElement(i);
+            RangedAudioParameter *p = getParameter(e->getStringAttribute("id"));
+            if (e->hasTagName("PARAM") && p && e->hasAttribute("value")) {
+                p->setValueNotifyingHost(p->convertTo0to1((float) e->getDoubleAttribute("value")));
+            }
+        }
+    }
+
+    // only its type, copyState() has the values
+    ValueTree state;
+
+private:
+    void parameterValueChanged(int parameterIndex, float newValue) override {
+        for (auto *p: params_) {
+            if (p->getParameterIndex() != parameterIndex) continue;
+            for (auto &l: listeners_) {
+                if (l.first == p->paramID) l.second->parameterChanged(p->paramID, p->convertFrom0to1(newValue));
+            }
+        }
+    }
+    void parameterGestureChanged(int, bool) override {}
+
+    std::vector<RangedAudioParameter *> params_;
+    std::vector<std::pair<String, Listener *>> listeners_;
+};
+
+class Timer {
+public:
+    virtual ~Timer() = default;
+    virtual void timerCallback() = 0;
+    void startTimer(int) {}
+    void stopTimer() {}
+};
+
+}
+
+using namespace juce;
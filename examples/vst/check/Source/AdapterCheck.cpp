@@ -0,0 +1,290 @@
+// see ../JuceLibraryCode/JuceHeader.h for license
+
+// runs the check plugin (CheckPlugin.cpp) through the JUCE adapter, built
+// against the JUCE stubs (see ../CMakeLists.txt), with the reference host's
+// Module: the calls a host makes, and what the adapter has to do for them to
+// reach the plugin. with all inputs at 0.5, the first output is 0.5 times the
+// gain. the bundle holds two builds of the check plugin (see ../CMakeLists.txt).
+// qvca runs through it too, where the first output is the product of the
+// first two inputs times the first gain.
+//
+// usage: check_adapter libcheck.so [libcheck_bundle.so [libqvca_check.so]]
+
+#include "InstancePool.h"
+#include "PluginHost.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+static constexpr double SAMPLE_RATE = 48000.0;
+static constexpr int BLOCK_SIZE = 64;
+// long enough for the gain ramps (10 ms) to settle
+static constexpr int SETTLE_BLOCKS = 16;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    printf("%s: %s\n", ok ? "ok" : "FAILED", what);
+    if (!ok) failures++;
+}
+
+bool near(float a, float b) { return std::fabs(a - b) < 1e-4f; }
+
+// processes blocks with all inputs at 0.5, returns the last sample of the first output
+float run(Module &m, int blocks) {
+    for (int b = 0; b < blocks; b++) {
+        for (int ch = 0; ch < m.numChannels(); ch++) {
+            std::fill(m.channel(ch), m.channel(ch) + BLOCK_SIZE, 0.5f);
+        }
+        m.process(BLOCK_SIZE);
+    }
+    return m.channel(0)[BLOCK_SIZE - 1];
+}
+
+void connect(Module &m) {
+    for (int i = 0; i < m.numInputs(); i++) m.plugin().inputEnabled(i, true);
+    for (int i = 0; i < m.numOutputs(); i++) m.plugin().outputEnabled(i, true);
+}
+
+// qvca's editor, 1600x480: the input scopes are in a row from y = 25, the
+// output scopes below them, each 200 pixels wide and 165 high
+static constexpr int WIDTH = 1600, HEIGHT = 480;
+static constexpr int SCOPE_WIDTH = 200, SCOPE_HEIGHT = 165, SCOPE_TOP = 25;
+// the colours of the inputs and outputs, ARGB
+static constexpr uint32_t WHITE = 0xffffffff, RED = 0xffff0000;
+
+uint32_t pixel(const std::vector<unsigned char> &image, int x, int y) {
+    uint32_t argb;
+    memcpy(&argb, image.data() + ((size_t) y * WIDTH + x) * 4, 4);
+    return argb;
+}
+
+// the row of the first pixel of a colour in column x from y to y + height, or -1
+int rowOf(const std::vector<unsigned char> &image, uint32_t argb, int x, int y, int height) {
+    for (int row = y; row < y + height; row++) {
+        if (pixel(image, x, row) == argb) return row;
+    }
+    return -1;
+}
+
+void checkQvca(const char *path) {
+    static constexpr float OUT = 0.25f;
+    PluginLibrary library(path);
+    std::vector<unsigned char> image((size_t) WIDTH * HEIGHT * 4);
+
+    // hosts other than the SSP never report the connections
+    Module m(library, 10);
+    check(m.numInputs() == 8 && m.numOutputs() == 8, "qvca has 8 inputs and outputs");
+    m.prepare(SAMPLE_RATE, BLOCK_SIZE);
+    check(near(run(m, 1), OUT), "qvca computes its outputs before the host reports connections");
+    for (int i = 0; i < m.numInputs(); i++) m.plugin().inputEnabled(i, true);
+    for (int i = 0; i < m.numOutputs(); i++) m.plugin().outputEnabled(i, false);
+    check(run(m, 4) == 0.0f && m.stats() && m.stats()->samplesSkipped.load() == 4 * BLOCK_SIZE,
+          "qvca skips the samples without connected outputs");
+    connect(m);
+    check(near(run(m, 1), OUT), "qvca computes its outputs once they are connected");
+
+    // the gains are read from the ParamTable on the audio thread
+    m.encoderTurned(0, 1);
+    check(near(run(m, SETTLE_BLOCKS), 1.1f * OUT), "qvca encoder turn changes the gain");
+    const std::vector<char> state = m.getState();
+    Module restored(library, 11);
+    connect(restored);
+    restored.prepare(SAMPLE_RATE, BLOCK_SIZE);
+    restored.setState(state);
+    check(near(run(restored, SETTLE_BLOCKS), 1.1f * OUT), "qvca state restores the gain");
+    Module staged(library, 12);
+    connect(staged);
+    staged.prepare(SAMPLE_RATE, BLOCK_SIZE);
+    check(staged.prepareState(state), "qvca state staged");
+    check(near(run(staged, SETTLE_BLOCKS), 1.1f * OUT), "qvca staged load changes the gain");
+    check(m.reset(), "qvca reset");
+    connect(m);
+    check(near(run(m, 1), OUT), "qvca reset restores the default gain");
+
+    // a gain ramp in flight carries on at the new sample rate
+    m.encoderTurned(0, 1);
+    const float ramping = run(m, 1);
+    check(m.reconfigure(2.0 * SAMPLE_RATE, BLOCK_SIZE), "qvca reconfigure to a new sample rate");
+    const float reconfigured = run(m, 1);
+    check(ramping > OUT && reconfigured > ramping && reconfigured < 1.1f * OUT - 1e-3f,
+          "qvca reconfigure keeps the gain ramp");
+
+    // the parts of a block split at an encoder turn go one after the other
+    // into the scopes: In1 is 1 before the turn, and -1 after it
+    Module scoped(library, 13);
+    connect(scoped);
+    scoped.prepare(SAMPLE_RATE, BLOCK_SIZE);
+    scoped.visibilityChanged(true);
+    std::vector<float *> channels;
+    for (int ch = 0; ch < scoped.numChannels(); ch++) {
+        channels.push_back(scoped.channel(ch));
+        std::fill(scoped.channel(ch), scoped.channel(ch) + BLOCK_SIZE, 0.5f);
+    }
+    std::fill(scoped.channel(0), scoped.channel(0) + BLOCK_SIZE / 2, 1.0f);
+    std::fill(scoped.channel(0) + BLOCK_SIZE / 2, scoped.channel(0) + BLOCK_SIZE, -1.0f);
+    // encoder 8 is not used by qvca, it only splits the block
+    const Percussa::SSP::Event turn{BLOCK_SIZE / 2, Percussa::SSP::Event::ENCODER_TURNED, 7, 1};
+    scoped.plugin().processEvents(channels.data(), scoped.numChannels(), BLOCK_SIZE, &turn, 1);
+    scoped.frameStart();
+    scoped.renderToImage(image.data(), WIDTH, HEIGHT);
+    const int before = rowOf(image, WHITE, SCOPE_WIDTH / 4, SCOPE_TOP, SCOPE_HEIGHT);
+    const int after = rowOf(image, WHITE, 3 * SCOPE_WIDTH / 4, SCOPE_TOP, SCOPE_HEIGHT);
+    check(before >= 0 && after >= 0 && before < SCOPE_TOP + SCOPE_HEIGHT / 2 && after > SCOPE_TOP + SCOPE_HEIGHT / 2,
+          "qvca scopes hold both parts of a split block");
+
+    // soft button 1 shows the spectrum of Out1, which the analyser's worker
+    // computes from what the audio thread hands it
+    scoped.buttonPressed(0, true);
+    const int spectrumTop = SCOPE_TOP + SCOPE_HEIGHT;
+    bool drawn = false;
+    for (int i = 0; i < 200 && !drawn; i++) {
+        run(scoped, 1);
+        scoped.frameStart();
+        scoped.renderToImage(image.data(), WIDTH, HEIGHT);
+        for (int x = 1; x < SCOPE_WIDTH - 1 && !drawn; x++) drawn = rowOf(image, RED, x, spectrumTop, SCOPE_HEIGHT) >= 0;
+        if (!drawn) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    check(drawn, "qvca spectrum drawn from the audio thread's samples");
+
+    // hiding the editor takes the analyser back from the audio thread, and frees it
+    Percussa::SSP::MemoryUsage shown, hidden;
+    scoped.memoryUsage(shown);
+    scoped.visibilityChanged(false);
+    scoped.memoryUsage(hidden);
+    check(hidden.dspBytes < shown.dspBytes && hidden.uiBytes < shown.uiBytes && hidden.sharedBytes == 0,
+          "hiding the qvca editor frees the spectrum analyser");
+    check(near(run(scoped, 1), OUT), "qvca processes after the analyser is freed");
+}
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "usage: check_adapter libcheck.so [libcheck_bundle.so [libqvca_check.so]]\n");
+        return 1;
+    }
+
+    try {
+        PluginLibrary library(argv[1]);
+        check(library.hasApi(Percussa::SSP::API_MAJOR_VERSION, Percussa::SSP::API_MINOR_VERSION),
+              "built against the current api");
+
+        Module m(library, 0);
+        check(m.descriptor().name == "check", "descriptor name");
+        check(m.numInputs() == 2 && m.numOutputs() == 2, "bus names are the channels");
+        connect(m);
+        m.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        check(near(run(m, 1), 0.5f), "default gain");
+        check(near(m.channel(1)[BLOCK_SIZE - 1], -0.5f), "inverted output");
+
+        // the editor is created with the instance, encoder turns reach it before it is shown
+        m.encoderTurned(0, 1);
+        check(near(run(m, SETTLE_BLOCKS), 0.55f), "encoder turn changes the gain");
+        std::vector<unsigned char> image(1600 * 480 * 4);
+        m.visibilityChanged(true);
+        m.frameStart();
+        m.renderToImage(image.data(), 1600, 480);
+        check(near(run(m, 1), 0.55f), "showing the editor keeps the gain");
+
+        const std::vector<char> state = m.getState();
+        check(!state.empty(), "state saved");
+        Module restored(library, 1);
+        connect(restored);
+        restored.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        restored.setState(state);
+        check(near(run(restored, SETTLE_BLOCKS), 0.55f), "state restores the gain");
+
+        // the audio thread applies a staged state at the start of the next block
+        Module staged(library, 2);
+        connect(staged);
+        staged.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        check(near(run(staged, 1), 0.5f), "default gain before a staged load");
+        check(staged.prepareState(state), "state staged");
+        check(near(run(staged, SETTLE_BLOCKS), 0.55f), "staged load changes the gain");
+        Module resaved(library, 3);
+        connect(resaved);
+        resaved.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        resaved.setState(staged.getState());
+        check(near(run(resaved, SETTLE_BLOCKS), 0.55f), "state saved after a staged load");
+
+        // the image and the editor's waveform are only held while the editor is visible
+        Percussa::SSP::MemoryUsage shown, hidden;
+        m.memoryUsage(shown);
+        m.visibilityChanged(false);
+        m.memoryUsage(hidden);
+        check(shown.sharedBytes > 0 && hidden.sharedBytes == 0, "hiding the editor releases the image");
+        check(hidden.uiBytes < shown.uiBytes, "hiding the editor releases its drawing resources");
+
+        // a pooled instance starts over with the defaults, without ramping to them
+        check(m.reset(), "reset");
+        connect(m);
+        check(near(run(m, 1), 0.5f), "reset restores the default gain");
+
+        // the pool hides the editor of a module it takes back
+        InstancePool pool(SAMPLE_RATE, BLOCK_SIZE);
+        const int uid = pool.reserve(library, 0, 1);
+        std::unique_ptr<Module> pooled = pool.acquire(uid, 8);
+        pooled->visibilityChanged(true);
+        pooled->renderToImage(image.data(), 1600, 480);
+        pool.release(std::move(pooled));
+        pooled = pool.acquire(uid, 9);
+        Percussa::SSP::MemoryUsage released;
+        pooled->memoryUsage(released);
+        check(released.sharedBytes == 0 && released.uiBytes == hidden.uiBytes,
+              "releasing a module to the pool hides its editor");
+
+        // a new sample rate keeps a gain ramp in flight, without a jump to its target
+        Module ramped(library, 5);
+        connect(ramped);
+        ramped.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        run(ramped, 1);
+        ramped.encoderTurned(0, 1);
+        const float ramping = run(ramped, 1);
+        check(ramped.reconfigure(2.0 * SAMPLE_RATE, BLOCK_SIZE), "reconfigure to a new sample rate");
+        const float reconfigured = run(ramped, 1);
+        check(ramping > 0.5f && reconfigured > ramping && reconfigured < 0.55f - 1e-3f,
+              "reconfigure keeps the gain ramp");
+
+        // without connected outputs there is nothing to compute
+        Module idle(library, 4);
+        for (int i = 0; i < idle.numInputs(); i++) idle.plugin().inputEnabled(i, true);
+        idle.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        check(run(idle, 4) == 0.0f, "outputs are silent without connected outputs");
+        check(idle.stats() && idle.stats()->samplesSkipped.load() == 4 * BLOCK_SIZE,
+              "samples without connected outputs are skipped");
+        check(m.stats() && m.stats()->samplesSkipped.load() == 0, "no samples skipped with connected outputs");
+
+        // JUCE plugins in a bundle, numbered by uid rather than the order they were linked in
+        if (argc >= 3) {
+            PluginLibrary bundle(argv[2]);
+            check(bundle.pluginCount() == 2, "bundle of two plugins");
+            Module first(bundle, 6, 0);
+            Module second(bundle, 7, 1);
+            check(first.descriptor().uid < second.descriptor().uid, "bundled plugins are numbered by uid");
+            check(first.descriptor().name == "check0" && second.descriptor().name == "check",
+                  "bundled plugins have their own descriptors");
+            connect(first);
+            connect(second);
+            first.prepare(SAMPLE_RATE, BLOCK_SIZE);
+            second.prepare(SAMPLE_RATE, BLOCK_SIZE);
+            check(near(run(first, 1), 0.5f) && near(run(second, 1), 0.5f), "bundled plugins process");
+        }
+
+        if (argc == 4) checkQvca(argv[3]);
+    } catch (const std::exception &e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    if (failures) fprintf(stderr, "%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
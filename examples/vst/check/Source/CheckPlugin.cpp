@@ -0,0 +1,150 @@
+// see ../JuceLibraryCode/JuceHeader.h for license
+
+// the smallest JUCE plugin check_adapter needs to run the adapter: the first
+// output is the first input times the gain parameter, the second output is
+// its inverse. gain changes ramp (see ParamRamp in PercussaParams.h), and the
+// state is the <PARAM id="..." value="..."/> element an
+// AudioProcessorValueTreeState would save. encoder 1 turns the gain in steps
+// of 0.1, and the editor holds a waveform buffer while it is visible, the way
+// qvca's scopes do.
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+#include <PercussaParams.h>
+
+#include "SSPAdapter.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+
+static constexpr float SMOOTHING_MS = 10.0f;
+static constexpr int WAVEFORM_SAMPLES = 4096;
+
+class CheckProcessor : public AudioProcessor, public SSPProcessor {
+public:
+    CheckProcessor() : AudioProcessor(buses()), gain_(new AudioParameterFloat("gain", "Gain", -2.0f, 2.0f, 1.0f)) {
+        addParameter(gain_);
+    }
+
+    AudioParameterFloat &gain() { return *gain_; }
+
+    const String getName() const override { return JucePlugin_Name; }
+
+    void prepareToPlay(double sampleRate, int) override {
+        ramp_.prepare(sampleRate, SMOOTHING_MS);
+        ramp_.reset(gain_->get());
+    }
+
+    void processBlock(AudioSampleBuffer &buffer, MidiBuffer &) override {
+        const int n = buffer.getNumSamples();
+        ramp_.setTarget(gain_->get());
+        if (!outputEnabled_[0].load(std::memory_order_relaxed) && !outputEnabled_[1].load(std::memory_order_relaxed)) {
+            skipped(n);
+            ramp_.skip(n);
+            buffer.clear();
+            return;
+        }
+        float *out = buffer.getWritePointer(0);
+        float *inverted = buffer.getWritePointer(1);
+        ramp_.apply(out, n);
+        for (int i = 0; i < n; i++) inverted[i] = -out[i];
+    }
+
+    void releaseResources() override {}
+    AudioProcessorEditor *createEditor() override;
+    bool hasEditor() const override { return true; }
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+    double getTailLengthSeconds() const override { return 0.0; }
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram(int) override {}
+    const String getProgramName(int) override { return String(); }
+    void changeProgramName(int, const String &) override {}
+
+    void getStateInformation(MemoryBlock &destData) override {
+        XmlElement state("state");
+        XmlElement *param = state.createNewChildElement("PARAM");
+        param->setAttribute("id", gain_->paramID);
+        param->setAttribute("value", gain_->get());
+        copyXmlToBinary(state, destData);
+    }
+
+    void setStateInformation(const void *data, int sizeInBytes) override {
+        std::unique_ptr<XmlElement> state(getXmlFromBinary(data, sizeInBytes));
+        if (!state || !state->hasTagName("state")) return;
+        for (int i = 0; i < state->getNumChildElements(); i++) {
+            const XmlElement *param = state->getChildElement(i);
+            if (param->hasTagName("PARAM") && param->getStringAttribute("id") == gain_->paramID) {
+                gain_->setValueNotifyingHost(gain_->convertTo0to1((float) param->getDoubleAttribute("value")));
+            }
+        }
+    }
+
+    void onOutputChanged(int i, bool v) override {
+        if (i < 2) outputEnabled_[i].store(v, std::memory_order_relaxed);
+    }
+
+    bool onReconfigure(double sampleRate, int) override {
+        ramp_.setSampleRate(sampleRate, SMOOTHING_MS);
+        return true;
+    }
+
+    bool onReset() override {
+        for (auto &enabled: outputEnabled_) enabled.store(false, std::memory_order_relaxed);
+        ramp_.reset(gain_->get());
+        return true;
+    }
+
+    bool parametersAreState() const override { return true; }
+
+private:
+    static BusesProperties buses() {
+        BusesProperties props;
+        props.addBus(true, "In1", AudioChannelSet::mono());
+        props.addBus(true, "In2", AudioChannelSet::mono());
+        props.addBus(false, "Out1", AudioChannelSet::mono());
+        props.addBus(false, "Out2", AudioChannelSet::mono());
+        return props;
+    }
+
+    // owned by the AudioProcessor
+    AudioParameterFloat *gain_;
+    Percussa::SSP::ParamRamp ramp_;
+    std::atomic<bool> outputEnabled_[2]{};
+};
+
+class CheckEditor : public AudioProcessorEditor, public SSPEditor {
+public:
+    explicit CheckEditor(CheckProcessor &p) : AudioProcessorEditor(&p), processor_(p) {}
+
+    void onEncoder(int n, float v) override {
+        if (n != 0) return;
+        AudioParameterFloat &gain = processor_.gain();
+        gain.setValueNotifyingHost(gain.convertTo0to1(gain.get() + (v > 0.0f ? 0.1f : -0.1f)));
+    }
+
+    void onVisibilityChanged(bool visible) override {
+        if (visible) waveform_.assign(WAVEFORM_SAMPLES, 0.0f);
+        else std::vector<float>().swap(waveform_);
+    }
+
+    size_t memoryBytes() const override { return sizeof(*this) + waveform_.capacity() * sizeof(float); }
+
+private:
+    CheckProcessor &processor_;
+    std::vector<float> waveform_;
+};
+
+AudioProcessorEditor *CheckProcessor::createEditor() {
+    return new CheckEditor(*this);
+}
+
+}
+
+AudioProcessor *JUCE_CALLTYPE SSP_PLUGIN_FILTER() {
+    return new CheckProcessor();
+}
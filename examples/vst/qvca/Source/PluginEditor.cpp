@@ -31,11 +31,37 @@ PluginEditor::PluginEditor(PluginProcessor &p)
     out[6]->setInfo(String("Out7=In7*In8"));
     out[7]->setInfo(String("Out8=-In7*In8"));
 
+    // hidden until switched to, in place of the output scopes
+    for (int i = 0; i < nScopes; i++) {
+        Spectrum *s = new Spectrum(i);
+        s->setInfo(String("Out") + String(i + 1) + String(" dB"));
+        s->setInfoCol(Colours::red);
+        addChildComponent(s);
+        spectra.add(s);
+    }
+
     setSize(1600, 480);
-    startTimer(50);
 }
 
 PluginEditor::~PluginEditor() {
+    processor.showScopes(false);
+}
+
+void PluginEditor::onVisibilityChanged(bool visible) {
+    // the scopes only run while they can be seen, and the spectrum analyser
+    // only exists then: the spectra draw it while it does
+    for (int i = 0; i < nScopes; i++) spectra[i]->setAnalyser(nullptr);
+    processor.showScopes(visible);
+    for (int i = 0; i < nScopes; i++) spectra[i]->setAnalyser(processor.spectrum());
+    if (visible) startTimer(50);
+    else stopTimer();
+}
+
+size_t PluginEditor::memoryBytes() const {
+    // the fonts are cached by JUCE, and shared with the other instances
+    size_t bytes = sizeof(*this) + (size_t) (in.size() + out.size()) * sizeof(Oscilloscope);
+    for (int i = 0; i < nScopes; i++) bytes += spectra[i]->memoryBytes();
+    return bytes;
 }
 
 void PluginEditor::timerCallback() {
@@ -45,6 +71,7 @@ void PluginEditor::timerCallback() {
 
     for (int i = 0; i < nScopes; i++) {
         out[i]->repaint();
+        spectra[i]->repaint();
     }
 
     // repaint our own canvas as well
@@ -125,6 +152,7 @@ void PluginEditor::resized() {
             25 + scopeHeight,
             scopeWidth,
             scopeHeight);
+        spectra[col]->setBounds(o->getBounds());
     }
 }
 
@@ -154,6 +182,14 @@ void setP(juce::RangedAudioParameter &p, float v) {
     }
 }
 
+void PluginEditor::onButton(int i, bool v) {
+    if (v && i >= SSP_Soft_1 && i < SSP_Soft_1 + nScopes) {
+        bool spectrum = !spectra[i]->isVisible();
+        spectra[i]->setVisible(spectrum);
+        out[i]->setVisible(!spectrum);
+    }
+}
+
 void PluginEditor::onEncoder(int i, float v) {
     float inc = (v > 0.5 ? 0.1 : (v < 0.5 ? -0.1 : 0.0f));
     switch (i) {
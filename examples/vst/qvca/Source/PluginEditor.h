@@ -21,10 +21,12 @@
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "PluginProcessor.h"
 #include "Oscilloscope.h"
+#include "Spectrum.h"
 #include "Percussa.h"
+#include "SSPAdapter.h"
 
 class PluginEditor :
-    public AudioProcessorEditor, public Timer {
+    public AudioProcessorEditor, public Timer, public SSPEditor {
 public:
     static const int nScopes = 8;
     static const int keepout = 100;
@@ -36,22 +38,18 @@ public:
     void resized() override;
     void timerCallback() override;
 
-    // SSP interface
-    void onButton(int, bool) {}
-    void onLeftButton(bool) {}
-    void onRightButton(bool) {}
-    void onUpButton(bool) {}
-    void onDownButton(bool) {}
-    void onLeftShiftButton(bool) {}
-    void onRightShiftButton(bool) {}
-
-    void onEncoder(int,float);
-    void onEncoderSwitch(int,bool);
+    // SSP interface, soft buttons 1 .. 8 switch an output between scope and spectrum
+    void onButton(int,bool) override;
+    void onEncoder(int,float) override;
+    void onEncoderSwitch(int,bool) override;
+    void onVisibilityChanged(bool) override;
+    size_t memoryBytes() const override;
 
 private:
     PluginProcessor &processor;
     OwnedArray<Oscilloscope> in;
     OwnedArray<Oscilloscope> out;
+    OwnedArray<Spectrum> spectra;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginEditor)
 };
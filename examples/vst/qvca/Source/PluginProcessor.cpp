@@ -3,6 +3,9 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "Percussa.h"
+#include "PercussaProfile.h"
+
+#include <thread>
 
 
 PluginProcessor::PluginProcessor() :
@@ -14,9 +17,20 @@ PluginProcessor::PluginProcessor() :
     for (int i = 0; i < I_MAX; i++) inputEnabled_[i] = true;
     for (int i = 0; i < O_MAX; i++) outputEnabled_[i] = true;
 #endif
+    for (auto &spec: paramSpecs) apvts_.addParameterListener(spec.id, this);
 }
 
 PluginProcessor::~PluginProcessor() {
+    for (auto &spec: paramSpecs) apvts_.removeParameterListener(spec.id, this);
+}
+
+// called from whichever thread changes the parameter (editor, state recall ...),
+// the audio thread changes them for encoder turns and staged states
+void PluginProcessor::parameterChanged(const String &parameterID, float newValue) {
+    int i = gains_.indexOf(parameterID.toRawUTF8());
+    if (i < 0) return;
+    if (isAudioThread()) gains_.setFromAudio(i, newValue);
+    else gains_.set(i, newValue);
 }
 
 const String PluginProcessor::getInputBusName(int channelIndex) {
@@ -42,8 +56,101 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock) {
     // allocate space in the input/output buffers for visualisation here, to make sure
     // processBlock() does not do any allocations. make sure buffers are cleared at
     // the same time (clearExtraSpace)
-    inBuffer.setSize(I_MAX, samplesPerBlock, false, true, false);
-    outBuffer.setSize(O_MAX, samplesPerBlock, false, true, false);
+    // with a host arena, the buffers are allocated from it instead, next to the
+    // buffers of the other modules in the patch.
+    if (arena_ && samplesPerBlock <= arenaSamples_) {
+        inBuffer.setDataToReferTo(inChannels_, I_MAX, samplesPerBlock);
+        outBuffer.setDataToReferTo(outChannels_, O_MAX, samplesPerBlock);
+        inBuffer.clear();
+        outBuffer.clear();
+    } else if (arena_ && allocateChannels(inChannels_, I_MAX, samplesPerBlock)
+               && allocateChannels(outChannels_, O_MAX, samplesPerBlock)) {
+        // arena memory cannot be freed, it is reused while the block size does not grow
+        arenaSamples_ = samplesPerBlock;
+        inBuffer.setDataToReferTo(inChannels_, I_MAX, samplesPerBlock);
+        outBuffer.setDataToReferTo(outChannels_, O_MAX, samplesPerBlock);
+    } else {
+        // keeps the allocation when the block size does not grow
+        arenaSamples_ = 0;
+        inBuffer.setSize(I_MAX, samplesPerBlock, false, true, true);
+        outBuffer.setSize(O_MAX, samplesPerBlock, false, true, true);
+    }
+
+    scopePos_ = 0;
+    rampBuffer_.resize(samplesPerBlock);
+    for (int k = 0; k < NUM_PARAMS; k++) {
+        ramps_[k].prepare(sampleRate, paramSpecs[k].smoothingMs);
+        ramps_[k].reset(gains_.get(k));
+    }
+    sampleRate_.store(sampleRate);
+    if (spectrum_) spectrum_->setSampleRate(sampleRate);
+}
+
+bool PluginProcessor::onReconfigure(double sampleRate, int) {
+    for (int k = 0; k < NUM_PARAMS; k++) ramps_[k].setSampleRate(sampleRate, paramSpecs[k].smoothingMs);
+    sampleRate_.store(sampleRate);
+    if (auto *s = acquireSpectrum()) s->setSampleRate(sampleRate);
+    releaseSpectrum();
+    return true;
+}
+
+Percussa::SSP::SpectrumAnalyser *PluginProcessor::acquireSpectrum() {
+    auto *s = spectrumOut_.load();
+    spectrumInUse_.store(s);
+    // showScopes(false) took it back in between, and may be about to free it
+    if (spectrumOut_.load() != s) {
+        spectrumInUse_.store(nullptr);
+        return nullptr;
+    }
+    return s;
+}
+
+void PluginProcessor::showScopes(bool show) {
+    showScopes_.store(show, std::memory_order_relaxed);
+    if (show && !spectrum_) {
+        // the ffts are computed on the analyser's worker thread, not the UI thread
+        spectrum_.reset(new Percussa::SSP::SpectrumAnalyser(O_MAX, 2048, 48));
+        spectrum_->start();
+        spectrumOut_.store(spectrum_.get());
+        // after publishing it, onReconfigure() sets the rate from here on
+        if (sampleRate_.load() > 0.0) spectrum_->setSampleRate(sampleRate_.load());
+    } else if (!show && spectrum_) {
+        spectrum_->stop();
+        spectrumOut_.store(nullptr);
+        // the audio thread may still be writing a block to it
+        while (spectrumInUse_.load() == spectrum_.get()) std::this_thread::yield();
+        spectrum_.reset();
+    }
+}
+
+bool PluginProcessor::allocateChannels(float **channels, int numChannels, int numSamples) {
+    for (int ch = 0; ch < numChannels; ch++) {
+        channels[ch] = static_cast<float *>(arena_->allocate(numSamples * sizeof(float)));
+        if (!channels[ch]) return false;
+    }
+    return true;
+}
+
+size_t PluginProcessor::memoryBytes() const {
+    // the scope buffers, whether they come from the arena or not, and the
+    // spectrum analyser while the scopes are shown
+    return (size_t) (inBuffer.getNumChannels() + outBuffer.getNumChannels()) * inBuffer.getNumSamples() * sizeof(float)
+           + (spectrum_ ? spectrum_->memoryBytes() : 0);
+}
+
+bool PluginProcessor::onReset() {
+    const ScopedLock sl(lock);
+    inBuffer.clear();
+    outBuffer.clear();
+    scopePos_ = 0;
+    // the host enables the connected inputs and outputs again
+#ifndef __APPLE__
+    for (int i = 0; i < I_MAX; i++) inputEnabled_[i] = false;
+    for (int i = 0; i < O_MAX; i++) outputEnabled_[i] = false;
+#endif
+    // the adapter has set the parameters to their defaults, no ramp to them
+    for (int k = 0; k < NUM_PARAMS; k++) ramps_[k].reset(gains_.get(k));
+    return true;
 }
 
 void PluginProcessor::releaseResources() {
@@ -58,12 +165,24 @@ void PluginProcessor::processBlock(AudioSampleBuffer &buffer, MidiBuffer &midiMe
     // if you don't want to do audio rate modulation you'd process the changes at a lower
     // control rate.
 
+    auto n = buffer.getNumSamples();
+
+    // nothing to copy while the scopes are hidden
+    const bool scopes = showScopes_.load(std::memory_order_relaxed);
+
+    // the adapter splits the host's blocks at encoder turns, so this may be
+    // a part of one: the parts are copied one after the other, and from the
+    // start of the scope buffers again when they are full
+    if (scopePos_ + n > inBuffer.getNumSamples()) scopePos_ = 0;
+    const int pos = scopePos_;
+    scopePos_ += n;
+
     // try to get lock and copy input buffer
-    if (lock.tryEnter()) {
+    if (scopes && lock.tryEnter()) {
         for (int ch = 0; ch < I_MAX; ch++) {
             if (inputEnabled_[ch]) {
                 // we only need to copy the input IF an input is connected
-                inBuffer.copyFrom(ch, 0, buffer, ch, 0, buffer.getNumSamples());
+                inBuffer.copyFrom(ch, pos, buffer, ch, 0, n);
             }
         }
         lock.exit();
@@ -71,53 +190,72 @@ void PluginProcessor::processBlock(AudioSampleBuffer &buffer, MidiBuffer &midiMe
 
     // process signals
 
-
-    // here do we use outputEnabled?
-    // if we don't produce the output it wont appear on the SSP scopes
-    // but on the other hand we do save values DSP time!
-
-    auto n = buffer.getNumSamples();
-
-    for (int i = 0; i < n; i++) {
-
-        // multiply side by side channels
-        float out1 = buffer.getSample(0, i) * buffer.getSample(1, i);
-        float out2 = buffer.getSample(2, i) * buffer.getSample(3, i);
-        float out3 = buffer.getSample(4, i) * buffer.getSample(5, i);
-        float out4 = buffer.getSample(6, i) * buffer.getSample(7, i);
-
-        // output multiplied signals and also output their inverted version
-        buffer.setSample(0, i, out1);
-        buffer.setSample(1, i, -out1);
-        buffer.setSample(2, i, out2);
-        buffer.setSample(3, i, -out2);
-        buffer.setSample(4, i, out3);
-        buffer.setSample(5, i, -out3);
-        buffer.setSample(6, i, out4);
-        buffer.setSample(7, i, -out4);
+    // nothing is connected to the outputs, so there is nothing to compute:
+    // the outputs are silent, and the adapter reports the skipped samples in
+    // the plugin's stats. the gains still follow the parameters, so they do
+    // not jump when an output is connected again.
+    bool anyOutput = !connectionsKnown_.load(std::memory_order_relaxed);
+    for (int ch = 0; ch < O_MAX; ch++) anyOutput = anyOutput || outputEnabled_[ch].load(std::memory_order_relaxed);
+    if (!anyOutput) {
+        skipped(n);
+        buffer.clear();
+    } else {
+        SSP_PROFILE_ZONE("multiply");
+        for (int i = 0; i < n; i++) {
+
+            // multiply side by side channels
+            float out1 = buffer.getSample(0, i) * buffer.getSample(1, i);
+            float out2 = buffer.getSample(2, i) * buffer.getSample(3, i);
+            float out3 = buffer.getSample(4, i) * buffer.getSample(5, i);
+            float out4 = buffer.getSample(6, i) * buffer.getSample(7, i);
+
+            // output multiplied signals and also output their inverted version
+            buffer.setSample(0, i, out1);
+            buffer.setSample(1, i, -out1);
+            buffer.setSample(2, i, out2);
+            buffer.setSample(3, i, -out2);
+            buffer.setSample(4, i, out3);
+            buffer.setSample(5, i, -out3);
+            buffer.setSample(6, i, out4);
+            buffer.setSample(7, i, -out4);
+        }
     }
 
-    // now apply gain to output buffers
-    float g1 = params_.gain1.convertFrom0to1(params_.gain1.getValue());
-    float g2 = params_.gain2.convertFrom0to1(params_.gain2.getValue());
-    float g3 = params_.gain3.convertFrom0to1(params_.gain3.getValue());
-    float g4 = params_.gain4.convertFrom0to1(params_.gain4.getValue());
-    buffer.applyGain(0, 0, n, g1);
-    buffer.applyGain(1, 0, n, g1);
-    buffer.applyGain(2, 0, n, g2);
-    buffer.applyGain(3, 0, n, g2);
-    buffer.applyGain(4, 0, n, g3);
-    buffer.applyGain(5, 0, n, g3);
-    buffer.applyGain(6, 0, n, g4);
-    buffer.applyGain(7, 0, n, g4);
+    // now apply gain to output buffers, ramping to new values so they do not click
+    {
+        SSP_PROFILE_ZONE("gain");
+        if (gains_.update(snapshot_)) {
+            for (int k = 0; k < NUM_PARAMS; k++) ramps_[k].setTarget(snapshot_.values[k]);
+        }
+        for (int k = 0; k < NUM_PARAMS; k++) {
+            if (!anyOutput) {
+                ramps_[k].skip(n);
+            } else if (ramps_[k].ramping() && n <= (int) rampBuffer_.size()) {
+                ramps_[k].fill(rampBuffer_.data(), n);
+                FloatVectorOperations::multiply(buffer.getWritePointer(2 * k), rampBuffer_.data(), n);
+                FloatVectorOperations::multiply(buffer.getWritePointer(2 * k + 1), rampBuffer_.data(), n);
+            } else {
+                buffer.applyGain(2 * k, 0, n, ramps_[k].current());
+                buffer.applyGain(2 * k + 1, 0, n, ramps_[k].current());
+            }
+        }
+    }
 
     // try to get lock and copy output buffer
-    if (lock.tryEnter()) {
+    if (scopes && lock.tryEnter()) {
         for (int ch = 0; ch < O_MAX; ch++)
-            outBuffer.copyFrom(ch, 0, buffer, ch, 0, buffer.getNumSamples());
+            outBuffer.copyFrom(ch, pos, buffer, ch, 0, n);
         lock.exit();
     }
 
+    // the spectrum taps never block, so they get every block
+    if (scopes) {
+        if (auto *spectrum = acquireSpectrum()) {
+            for (int ch = 0; ch < O_MAX; ch++) spectrum->write(ch, buffer.getReadPointer(ch), n);
+        }
+        releaseSpectrum();
+    }
+
 }
 
 AudioProcessorEditor *PluginProcessor::createEditor() {
@@ -168,8 +306,9 @@ void PluginProcessor::setStateInformation(const void *data, int sizeInBytes) {
     }
 }
 
-// called by the juce VST framework to instantiate the plugin. 
-AudioProcessor *JUCE_CALLTYPE createPluginFilter() {
+// called by the juce VST framework to instantiate the plugin, and by the
+// adapter (see SSP_PLUGIN_FILTER in SSPAdapter.h)
+AudioProcessor *JUCE_CALLTYPE SSP_PLUGIN_FILTER() {
     return new PluginProcessor();
 }
 
@@ -192,18 +331,17 @@ void PluginProcessor::onInputChanged(int i, bool v) {
 }
 
 void PluginProcessor::onOutputChanged(int i, bool v) {
-    // we could use outputEnabled to optimise DSP processing
-    // if we know an output has not been connected to another modules
-    if (i < O_MAX) outputEnabled_[i] = v;
+    // processBlock() skips the processing while no output is connected
+    if (i < O_MAX) outputEnabled_[i].store(v, std::memory_order_relaxed);
+    connectionsKnown_.store(true, std::memory_order_relaxed);
 }
 
 
 AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParameterLayout() {
     AudioProcessorValueTreeState::ParameterLayout params;
-    params.add(std::make_unique<juce::AudioParameterFloat>(ID::gain1, "Gain 1", -2.0, 2.0f, 1.0f));
-    params.add(std::make_unique<juce::AudioParameterFloat>(ID::gain2, "Gain 2", -2.0, 2.0f, 1.0f));
-    params.add(std::make_unique<juce::AudioParameterFloat>(ID::gain3, "Gain 3", -2.0, 2.0f, 1.0f));
-    params.add(std::make_unique<juce::AudioParameterFloat>(ID::gain4, "Gain 4", -2.0, 2.0f, 1.0f));
+    for (auto &spec: paramSpecs) {
+        params.add(std::make_unique<juce::AudioParameterFloat>(spec.id, spec.name, spec.min, spec.max, spec.defaultValue));
+    }
     return params;
 }
 
@@ -20,9 +20,15 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "Percussa.h"
+#include "PercussaParams.h"
+#include "PercussaSpectrum.h"
+#include "SSPAdapter.h"
 
 #include <array>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <vector>
 
 
 namespace ID {
@@ -34,8 +40,19 @@ PARAMETER_ID (gain4)
 #undef PARAMETER_ID
 }
 
+// the parameters, createParameterLayout() builds the VST parameters from it
+enum { GAIN1, GAIN2, GAIN3, GAIN4, NUM_PARAMS };
 
-class PluginProcessor : public AudioProcessor {
+static constexpr Percussa::SSP::ParamSpec paramSpecs[NUM_PARAMS] = {
+    {ID::gain1, "Gain 1", -2.0f, 2.0f, 1.0f, Percussa::SSP::CURVE_LINEAR, 10.0f},
+    {ID::gain2, "Gain 2", -2.0f, 2.0f, 1.0f, Percussa::SSP::CURVE_LINEAR, 10.0f},
+    {ID::gain3, "Gain 3", -2.0f, 2.0f, 1.0f, Percussa::SSP::CURVE_LINEAR, 10.0f},
+    {ID::gain4, "Gain 4", -2.0f, 2.0f, 1.0f, Percussa::SSP::CURVE_LINEAR, 10.0f},
+};
+
+
+class PluginProcessor : public AudioProcessor, public SSPProcessor,
+                        private AudioProcessorValueTreeState::Listener {
 public:
     PluginProcessor();
     ~PluginProcessor();
@@ -94,11 +111,57 @@ public:
     static constexpr unsigned O_MAX = 8;
 private:
     bool inputEnabled_[I_MAX]{false, false, false, false, false, false, false, false};
-    bool outputEnabled_[O_MAX]{false, false, false, false, false, false, false, false};
+    // set on the UI thread, the audio thread skips the processing without them,
+    // once the host told it about the connections: hosts other than the SSP
+    // never call onOutputChanged()
+    std::atomic<bool> outputEnabled_[O_MAX]{};
+    std::atomic<bool> connectionsKnown_{false};
     AudioProcessorValueTreeState apvts_;
+    bool allocateChannels(float **channels, int numChannels, int numSamples);
+    Percussa::SSP::MemoryArena *arena_ = nullptr;
+    // channel pointers of the buffers allocated from the arena
+    float *inChannels_[I_MAX]{};
+    float *outChannels_[O_MAX]{};
+    int arenaSamples_ = 0;
+    std::atomic<bool> showScopes_{false};
+    // audio thread, where the next part of a block goes in inBuffer/outBuffer
+    int scopePos_ = 0;
+    // spectra of the outputs, only while the scopes are shown: showScopes()
+    // creates the analyser, and hands it to the audio thread in spectrumOut_.
+    // the audio thread acknowledges the one it writes to in spectrumInUse_,
+    // so showScopes(false) can take it back, and free it once it is unused.
+    std::unique_ptr<Percussa::SSP::SpectrumAnalyser> spectrum_;
+    std::atomic<Percussa::SSP::SpectrumAnalyser *> spectrumOut_{nullptr};
+    std::atomic<Percussa::SSP::SpectrumAnalyser *> spectrumInUse_{nullptr};
+    std::atomic<double> sampleRate_{0.0};
+    // audio thread, the analyser to write to until releaseSpectrum(), or nullptr
+    Percussa::SSP::SpectrumAnalyser *acquireSpectrum();
+    void releaseSpectrum() { spectrumInUse_.store(nullptr); }
+    // the gains, as the audio thread reads them: parameter changes are published
+    // into the table, processBlock() takes a snapshot, and ramps to the new values
+    Percussa::SSP::ParamTable<NUM_PARAMS> gains_{paramSpecs};
+    Percussa::SSP::ParamTable<NUM_PARAMS>::Snapshot snapshot_;
+    Percussa::SSP::ParamRamp ramps_[NUM_PARAMS];
+    std::vector<float> rampBuffer_;
+    void parameterChanged(const String &parameterID, float newValue) override;
 public:
-    void onInputChanged(int, bool);
-    void onOutputChanged(int, bool);
+    void onInputChanged(int, bool) override;
+    void onOutputChanged(int, bool) override;
+    // inBuffer/outBuffer are allocated from the arena, if the host has one
+    void setMemoryArena(Percussa::SSP::MemoryArena *arena) override { arena_ = arena; }
+    // only the gain ramps depend on the sample rate, and the buffers are sized
+    // for the prepared block size, which smaller blocks only use the start of
+    bool onReconfigure(double sampleRate, int) override;
+    size_t memoryBytes() const override;
+    // the parameters are all the state there is, apart from the scopes
+    bool onReset() override;
+    // getStateInformation() only saves the parameters, autosaves get deltas of them
+    bool parametersAreState() const override { return true; }
+    // the editor turns the scopes on while it is visible, inBuffer/outBuffer
+    // are only copied to, and the spectrum analyser only exists, while they are on
+    void showScopes(bool show);
+    // UI thread, the spectrum analyser of the outputs, nullptr while the scopes are off
+    Percussa::SSP::SpectrumAnalyser *spectrum() { return spectrum_.get(); }
     CriticalSection lock;
     AudioSampleBuffer inBuffer;
     AudioSampleBuffer outBuffer;
@@ -0,0 +1,43 @@
+// see header file for license 
+
+#include "Spectrum.h"
+
+void Spectrum::paint(Graphics &g)
+{
+	if (!_analyser) return; 
+
+	// keeps the last bands if the worker has no new ones
+	_analyser->read(_channel, _bands.data()); 
+
+	float w=(float)getWidth();
+	float h=(float)getHeight();
+	int n=(int)_bands.size(); 
+	float barWidth=w/n;
+
+	Font f(Font::getDefaultMonospacedFontName(), 0.1f*h, Font::plain);
+	g.setFont(f);
+
+	// draw border 
+	g.setColour(Colours::grey); 
+	g.drawRect(0.0f,
+		0.0f,
+		w,
+		h); 
+
+	// draw the bands as bars, full scale at the top
+	g.setColour(_infoCol); 
+	for (int i=0; i<n; i++) {
+
+		float val = 1.0f + _bands[i]/_rangeDb;
+
+		if (val < 0.0f) val = 0.0f; 
+		if (val > 1.0f) val = 1.0f; 
+
+		float top = h - val*h; 
+		g.fillRect(i*barWidth, top, std::max(1.0f, barWidth-1.0f), h-top); 
+	}
+
+	g.setColour(_infoCol); 
+	g.drawMultiLineText(_info, 10, h-30, w); 
+}
+
@@ -0,0 +1,76 @@
+/*
+	Copyright (c) 2022 - Bert Schiettecatte, Noisetron LLC. 
+
+	This software is part of the Percussa SSP's software development kit (SDK). 
+	For more info about Percussa or the SSP visit http://www.percussa.com/ 
+	and our forum at http://forum.percussa.com/ 
+
+	Permission is granted to use this software under the terms of either:
+	a) the GPL v2 (or any later version)
+	b) the Affero GPL v3
+
+	Details of these licenses can be found at: www.gnu.org/licenses
+
+	This software is distributed in the hope that it will be useful, but WITHOUT ANY
+	WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+	A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#pragma once
+
+#include <vector>
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "PercussaSpectrum.h"
+
+// draws the bands of one channel of a SpectrumAnalyser, which computes them
+// on its worker thread: paint() only copies the latest bands, and draws them
+class Spectrum: public Component
+{
+private: 
+	Percussa::SSP::SpectrumAnalyser* _analyser; 
+	int _channel; 
+	std::vector<float> _bands; 
+	float _rangeDb; 
+	String _info; 
+	Colour _infoCol; 
+public:
+	Spectrum(int ch): 
+		_analyser(nullptr), _channel(ch) 
+	{ 
+		_rangeDb = 96.0f; 
+		_info = String("Info"); 
+		_infoCol = Colours::grey; 
+	}
+
+	// the analyser to draw, nullptr (which frees the bands) while hidden
+	void setAnalyser(Percussa::SSP::SpectrumAnalyser* analyser) { 
+		_analyser = analyser; 
+		if (analyser) _bands.assign(analyser->numBands(), float(Percussa::SSP::SpectrumAnalyser::FLOOR_DB)); 
+		else std::vector<float>().swap(_bands); 
+	}
+
+	size_t memoryBytes() const { 
+		return sizeof(*this) + _bands.capacity()*sizeof(float); 
+	}
+
+	void setInfo(const String& info) { 
+		_info = info; 
+		repaint(); 
+	}
+
+	void setInfoCol(const Colour& col) { 
+		_infoCol = col; 
+		repaint(); 
+	}
+
+	// the bottom of the display, in dB below full scale
+	void setRange(float db) { 
+		_rangeDb = db; 
+		repaint(); 
+	}
+
+private:
+	void paint(Graphics &g);
+	juce_UseDebuggingNewOperator
+};
+